@@ -18,6 +18,11 @@
 #define CHAR_TIME_SYNC_UUID      "d6e1a0b8-4a76-9f0c-dc1a-789abcdef012"  // WRITE
 #define CHAR_DEVICE_CONTROL_UUID "c7f8e0d9-5b87-1a2b-be9d-7890abcdef23"  // WRITE
 #define CHAR_EFFECTS_LIST_UUID   "d8f9e1ea-6c98-2b3c-cf0e-890abcdef234"  // READ
+#define CHAR_POWER_UUID          "e9fa02fb-7da9-3c4d-d01f-90abcdef3456"  // READ (profilo energetico)
+#define CHAR_DIAGNOSTICS_UUID    "fa0b130c-8eba-4d5e-e120-0abcdef34567"  // READ (stack/heap)
+#define CHAR_LED_BINARY_UUID     "0b1c241d-9fcb-4e6f-f231-1bcdef456789"  // WRITE + READ + NOTIFY (TLV binario)
+#define CHAR_LED_TRANSACTION_UUID "1c2d352e-a0dc-4f7a-0342-2cdef4567890" // WRITE + READ (update multi-campo atomico)
+#define CHAR_LED_MIRROR_UUID     "2d3e463f-b1ed-4a8b-9453-3def56789012"  // WRITE + READ + NOTIFY (framebuffer lama)
 
 // NOTA: Il servizio LED richiede ~16 handle (10 char). Il default è 15.
 // In BLELedController.cpp usare: pServer->createService(LED_SERVICE_UUID, 50);
@@ -41,6 +46,11 @@ struct LedState {
     uint32_t autoIgnitionDelayMs = 5000; // Delay accensione automatica (ms)
     bool motionOnBoot = false;        // Se true, abilita motion e avvia camera all'avvio
 
+    // Sentry mode: in deep sleep risveglio periodico + sniff camera, ignition su movimento
+    bool sentryModeEnabled = false;
+    uint16_t sentryIntervalSec = 10;   // Periodo risveglio timer (s)
+    uint8_t sentryThresholdPct = 4;    // % celle thumbnail cambiate per accendere
+
     // Time sync data (ChronoSaber)
     uint32_t epochBase = 0;      // Unix timestamp di riferimento
     uint32_t millisAtSync = 0;   // millis() al momento del sync
@@ -74,17 +84,41 @@ private:
     BLECharacteristic* pCharTimeSync;
     BLECharacteristic* pCharDeviceControl;
     BLECharacteristic* pCharEffectsList;
+    BLECharacteristic* pCharPower;
+    BLECharacteristic* pCharDiagnostics;
+    BLECharacteristic* pCharBinary;
+    BLECharacteristic* pCharTransaction;
+    BLECharacteristic* pCharMirror;
     bool deviceConnected;
     LedState* ledState;
     bool configDirty;
     LedEffectEngine* effectEngine;
     String lastNotifiedBladeState;
     unsigned long lastNotifyMs;
+    uint32_t lastNotifiedVersion;
     bool hasNotified;
     uint8_t effectsListPage;
 
+    // Esito dell'ultima write sulla characteristic Transaction (READ)
+    uint32_t lastTxId;
+    uint8_t lastTxApplied;
+    bool lastTxOk;
+
     String getBladeState() const;
     void sendState(const String& bladeState, unsigned long nowMs);
+    size_t encodeBinaryState(uint8_t* out, size_t capacity, const String& bladeState) const;
+
+    /**
+     * @brief Applica i TLV di un frame binario a uno stato di staging
+     * @return false se il frame o un valore non è valido (target va scartato)
+     */
+    bool applyBinaryFrame(const uint8_t* data, size_t len, LedState& target, uint8_t& applied) const;
+
+    /**
+     * @brief Applica un sottoinsieme qualsiasi di campi LedState (chiavi JSON dello State Notify)
+     * @return false se un valore non è valido (target va scartato)
+     */
+    bool applyJsonFields(JsonVariantConst fields, LedState& target, uint8_t& applied) const;
 
 public:
     explicit BLELedController(LedState* state);
@@ -106,6 +140,11 @@ public:
     friend class TimeSyncCallbacks;
     friend class DeviceControlCallbacks;
     friend class EffectsListCallbacks;
+    friend class PowerCallbacks;
+    friend class DiagnosticsCallbacks;
+    friend class BinaryCallbacks;
+    friend class TransactionCallbacks;
+    friend class MirrorCallbacks;
 };
 
 #endif
@@ -0,0 +1,323 @@
+#ifndef BINARY_PROTOCOL_H
+#define BINARY_PROTOCOL_H
+
+#include <Arduino.h>
+#include <string.h>
+#include "EffectId.h"
+
+/**
+ * @brief Protocollo binario TLV per le characteristic "Binary" (v1)
+ *
+ * Affianca le characteristic JSON (che restano invariate per compatibilità).
+ * Ogni write/notify è un frame:
+ *
+ *   [version:u8] [type:u8 len:u8 payload...] [type:u8 len:u8 payload...] ...
+ *
+ * Un frame può contenere più TLV (es. colore + effetto + luminosità in una
+ * sola write). Tutti i campi multi-byte sono little-endian (nativo ESP32).
+ * I TLV con tipo sconosciuto vengono saltati grazie al campo len, quindi un
+ * client più recente può parlare con un firmware più vecchio.
+ *
+ * Il parsing è zero-allocation: Reader scorre il buffer della write e
+ * readPayload() copia il payload nella struct a layout fisso.
+ */
+namespace BinaryProtocol {
+
+static constexpr uint8_t VERSION = 1;
+static constexpr size_t HEADER_SIZE = 1;
+static constexpr size_t TLV_HEADER_SIZE = 2;
+
+// Tipi TLV: 0x01-0x7F write (client -> device), 0x81-0xFF notify/read (device -> client)
+enum Type : uint8_t {
+    TYPE_COLOR          = 0x01,
+    TYPE_EFFECT         = 0x02,
+    TYPE_BRIGHTNESS     = 0x03,
+    TYPE_STATUS_LED     = 0x04,
+    TYPE_FOLD_POINT     = 0x05,
+    TYPE_MOTION_CONFIG  = 0x06,
+
+    TYPE_LED_STATUS     = 0x81,
+    TYPE_MOTION_STATUS  = 0x82,
+    TYPE_MOTION_EVENT   = 0x83,
+    TYPE_CAMERA_METRICS = 0x84,
+    TYPE_MOTION_TELEMETRY = 0x85,
+    TYPE_MOTION_RECORD  = 0x86,
+};
+
+// ============================================================================
+// PAYLOAD (layout fisso, packed)
+// ============================================================================
+
+#pragma pack(push, 1)
+
+struct ColorPayload {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+};
+
+struct EffectPayload {
+    uint8_t effectId;       // EffectId (EffectId.h)
+    uint8_t speed;
+};
+
+struct BrightnessPayload {
+    uint8_t brightness;
+    uint8_t enabled;
+};
+
+struct StatusLedPayload {
+    uint8_t enabled;
+    uint8_t brightness;
+};
+
+struct FoldPointPayload {
+    uint8_t foldPoint;      // 1-143
+};
+
+// Flag MotionConfigPayload::flags
+static constexpr uint8_t MOTION_CFG_ENABLED  = 1 << 0;
+static constexpr uint8_t MOTION_CFG_GESTURES = 1 << 1;
+static constexpr uint8_t MOTION_CFG_DEBUG    = 1 << 2;
+
+struct MotionConfigPayload {
+    uint8_t flags;
+    uint8_t quality;
+    uint8_t motionIntensityMin;
+    uint8_t motionSpeedMinX10;      // 0-200 -> 0.0-20.0 px/frame
+    uint8_t ignitionIntensity;
+    uint8_t retractIntensity;
+    uint8_t clashIntensity;
+};
+
+// Flag LedStatusPayload::flags
+static constexpr uint8_t LED_FLAG_ENABLED    = 1 << 0;
+static constexpr uint8_t LED_FLAG_BLADE_ON   = 1 << 1;
+static constexpr uint8_t LED_FLAG_STATUS_LED = 1 << 2;
+static constexpr uint8_t LED_FLAG_MOTION     = 1 << 3;   // motionOnBoot
+static constexpr uint8_t LED_FLAG_SENTRY     = 1 << 4;
+
+enum BladeState : uint8_t {
+    BLADE_OFF        = 0,
+    BLADE_ON         = 1,
+    BLADE_IGNITING   = 2,
+    BLADE_RETRACTING = 3,
+};
+
+struct LedStatusPayload {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t brightness;
+    uint8_t effectId;
+    uint8_t speed;
+    uint8_t flags;
+    uint8_t bladeState;
+    uint8_t statusLedBrightness;
+    uint8_t foldPoint;
+};
+
+// Flag MotionStatusPayload::flags
+static constexpr uint8_t MOTION_FLAG_ENABLED        = 1 << 0;
+static constexpr uint8_t MOTION_FLAG_DETECTED       = 1 << 1;
+static constexpr uint8_t MOTION_FLAG_CENTROID_VALID = 1 << 2;
+
+struct MotionStatusPayload {
+    uint32_t frame;                 // totalFramesProcessed
+    uint32_t timestampMs;
+    uint8_t flags;
+    uint8_t intensity;
+    uint8_t direction;              // OpticalFlowDetector::Direction
+    uint8_t speedX10;               // px/frame * 10 (saturato a 255)
+    uint8_t confidence;             // 0-100
+    uint8_t activeBlocks;
+    uint8_t frameDiff;
+    uint8_t gesture;                // MotionProcessor::GestureType
+    uint8_t gestureConfidence;
+    uint16_t centroidX10;           // Coordinate frame * 10
+    uint16_t centroidY10;
+};
+
+enum MotionEventType : uint8_t {
+    EVENT_MOTION_STARTED   = 1,
+    EVENT_MOTION_ENDED     = 2,
+    EVENT_SHAKE_DETECTED   = 3,
+    EVENT_GESTURE_DETECTED = 4,
+};
+
+struct MotionEventPayload {
+    uint32_t timestampMs;
+    uint8_t event;                  // MotionEventType
+    uint8_t intensity;
+    uint8_t direction;
+    uint8_t gesture;
+    uint8_t gestureConfidence;
+};
+
+struct CameraMetricsPayload {
+    uint32_t totalFrames;
+    uint32_t failedCaptures;
+    uint32_t lastFrameSize;
+    uint32_t lastCaptureMs;
+    uint16_t fpsX10;
+    uint16_t heapFreeKb;
+    uint16_t psramFreeKb;
+    uint8_t active;
+};
+
+// Telemetria per frame elaborato (characteristic Motion Telemetry)
+static constexpr uint8_t TELEMETRY_GRID = 8;     // OpticalFlowDetector::GRID_ROWS/COLS
+static constexpr uint8_t TELEMETRY_MAX_FRAME = 182;     // ATT MTU 185 (tipico Android/BlueZ) - 3
+static constexpr int8_t TELEMETRY_VECTOR_MAX = 31;      // dx/dy a 6 bit con segno, saturati
+
+// Flag MotionTelemetryPayload::flags
+static constexpr uint8_t TELEMETRY_FLAG_MOTION         = 1 << 0;
+static constexpr uint8_t TELEMETRY_FLAG_CENTROID_VALID = 1 << 1;
+
+// Cella vettore: bit 0-5 dx, bit 6-11 dy (6 bit con segno, px saturati a
+// ±TELEMETRY_VECTOR_MAX), bit 12-15 confidence >> 4 (0 = vettore non valido)
+inline uint16_t packTelemetryCell(int8_t dx, int8_t dy, uint8_t confidence, bool valid) {
+    if (!valid) {
+        return 0;
+    }
+    const int8_t sx = dx > TELEMETRY_VECTOR_MAX ? TELEMETRY_VECTOR_MAX : (dx < -TELEMETRY_VECTOR_MAX ? -TELEMETRY_VECTOR_MAX : dx);
+    const int8_t sy = dy > TELEMETRY_VECTOR_MAX ? TELEMETRY_VECTOR_MAX : (dy < -TELEMETRY_VECTOR_MAX ? -TELEMETRY_VECTOR_MAX : dy);
+    const uint8_t level = (confidence >> 4) ? (confidence >> 4) : 1;
+    return (uint16_t)(((uint16_t)sx & 0x3F) | (((uint16_t)sy & 0x3F) << 6) | ((uint16_t)level << 12));
+}
+
+struct MotionTelemetryPayload {
+    uint16_t seq;                   // +1 per frame elaborato (anche se poi perso)
+    uint32_t timestampMs;
+    uint8_t dropped;                // Frame persi lato device (saturato)
+    uint8_t processMs;              // Durata processFrame()
+    uint8_t flags;
+    uint8_t intensity;
+    uint8_t direction;              // Già ruotata come MOTION_STATUS
+    uint8_t speedX10;
+    uint8_t gesture;                // Gesture del frame (senza TTL)
+    uint8_t gestureConfidence;
+    uint8_t centroidX;              // Frame sensore, 0-255 normalizzato
+    uint8_t centroidY;
+    uint16_t cells[TELEMETRY_GRID * TELEMETRY_GRID];    // packTelemetryCell, riga per riga, riferimento di montaggio
+    uint8_t perturbation[TELEMETRY_GRID * TELEMETRY_GRID / 2];  // 4 bit per cella (valore >> 4), nibble basso = colonna pari
+    uint8_t gestureStates[3];       // GestureStateMachine: 2 bit per slot, slot 0 nei bit bassi del primo byte
+};
+
+// Record per frame in modalità registrazione (characteristic Motion Record)
+// Flag MotionRecordPayload::flags
+static constexpr uint8_t RECORD_FLAG_CENTROID_VALID = 1 << 0;
+
+struct MotionRecordPayload {
+    uint16_t seq;                   // +1 per frame registrato (anche se perso a ring pieno)
+    uint32_t timestampMs;
+    int16_t flowXQ4;                // Sintesi vettori blocchi (MotionHistory::Sample)
+    int16_t flowYQ4;
+    int16_t divQ4;
+    int16_t curlQ4;
+    uint8_t intensity;
+    uint8_t activeBlocks;
+    uint16_t speedQ4;
+    uint8_t centroidX;              // 0-255 normalizzato
+    uint8_t centroidY;
+    uint8_t flags;
+    uint8_t label;                  // Etichetta utente: MotionProcessor::GestureType
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(MotionRecordPayload) == 22, "Record layout is part of the dataset protocol");
+
+// ============================================================================
+// PARSING / ENCODING
+// ============================================================================
+
+struct Tlv {
+    uint8_t type;
+    uint8_t len;
+    const uint8_t* data;
+};
+
+/**
+ * @brief Iteratore sui TLV di un frame ricevuto (nessuna allocazione)
+ */
+class Reader {
+public:
+    Reader(const uint8_t* data, size_t len) : _data(data), _len(len), _pos(HEADER_SIZE) {}
+
+    /**
+     * @brief true se l'header è presente e la versione è supportata
+     */
+    bool isValid() const { return _len >= HEADER_SIZE && _data[0] == VERSION; }
+
+    uint8_t getVersion() const { return _len >= HEADER_SIZE ? _data[0] : 0; }
+
+    /**
+     * @brief Estrae il prossimo TLV
+     * @return false a fine frame o se il TLV è troncato
+     */
+    bool next(Tlv& tlv) {
+        if (!isValid() || _pos + TLV_HEADER_SIZE > _len) {
+            return false;
+        }
+        const uint8_t len = _data[_pos + 1];
+        if (_pos + TLV_HEADER_SIZE + len > _len) {
+            _pos = _len;
+            return false;
+        }
+        tlv.type = _data[_pos];
+        tlv.len = len;
+        tlv.data = _data + _pos + TLV_HEADER_SIZE;
+        _pos += TLV_HEADER_SIZE + len;
+        return true;
+    }
+
+private:
+    const uint8_t* _data;
+    size_t _len;
+    size_t _pos;
+};
+
+/**
+ * @brief Copia il payload nella struct se la lunghezza è almeno quella attesa
+ *
+ * Payload più lunghi sono accettati (campi aggiunti in coda da versioni future).
+ */
+template <typename T>
+inline bool readPayload(const Tlv& tlv, T& out) {
+    if (tlv.len < sizeof(T)) {
+        return false;
+    }
+    memcpy(&out, tlv.data, sizeof(T));
+    return true;
+}
+
+/**
+ * @brief Scrive un frame con un solo TLV
+ * @return Byte scritti (0 se il buffer è troppo piccolo)
+ */
+template <typename T>
+inline size_t encodeFrame(uint8_t* out, size_t capacity, uint8_t type, const T& payload) {
+    static_assert(sizeof(T) <= 255, "TLV payload too large");
+    const size_t total = HEADER_SIZE + TLV_HEADER_SIZE + sizeof(T);
+    if (capacity < total) {
+        return 0;
+    }
+    out[0] = VERSION;
+    out[1] = type;
+    out[2] = (uint8_t)sizeof(T);
+    memcpy(out + 3, &payload, sizeof(T));
+    return total;
+}
+
+template <typename T>
+constexpr size_t frameSize() {
+    return HEADER_SIZE + TLV_HEADER_SIZE + sizeof(T);
+}
+
+// Una notify per frame anche con l'MTU tipico: oltre verrebbe troncata in silenzio
+static_assert(frameSize<MotionTelemetryPayload>() <= TELEMETRY_MAX_FRAME, "Telemetry must fit ATT MTU 185");
+
+} // namespace BinaryProtocol
+
+#endif // BINARY_PROTOCOL_H
@@ -0,0 +1,92 @@
+#ifndef DELTA_PATCHER_H
+#define DELTA_PATCHER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Applica in streaming una patch binaria contro il firmware in esecuzione
+ *
+ * OTA delta: la patch arriva (decompressa) a pezzi arbitrari e ricostruisce
+ * la nuova immagine leggendo la sorgente (partizione corrente) tramite
+ * SourceReader. RAM fissa: 2 buffer da 256 byte, niente heap.
+ *
+ * Formato: sequenza di operazioni, header varint LEB128 = (n << 2) | op
+ * - COPY  (0): n byte dalla sorgente, senza payload
+ * - DIFF  (1): n byte di payload, output = sorgente + payload (mod 256)
+ * - EXTRA (2): n byte di payload copiati così come sono
+ * - SEEK  (3): sposta la posizione sorgente di n (zigzag: pari avanti, dispari indietro)
+ * COPY e DIFF avanzano la posizione sorgente, EXTRA no.
+ *
+ * Generatore e applicatore di riferimento: delta_diff()/delta_apply() in
+ * ota_protocol.py. Non dipende da Arduino (tools/ota_codec_host.cpp).
+ */
+class DeltaPatcher {
+public:
+    static constexpr size_t BLOCK_SIZE = 256;
+
+    /**
+     * @brief Riceve l'immagine ricostruita (blocchi da max BLOCK_SIZE)
+     * @return false per interrompere (errore del consumatore)
+     */
+    typedef bool (*Sink)(void* context, const uint8_t* data, size_t length);
+
+    /**
+     * @brief Legge length byte della sorgente da offset
+     * @return false in caso di errore di lettura
+     */
+    typedef bool (*SourceReader)(void* context, uint32_t offset, uint8_t* buffer, size_t length);
+
+    void begin(uint32_t sourceSize, SourceReader reader, void* readerContext);
+    void end();
+
+    /**
+     * @brief Applica un pezzo di patch e inoltra l'output al sink
+     * @return false se la patch è corrotta, la sorgente non è leggibile o il
+     *         sink ha rifiutato dati (isCorrupt() distingue il primo caso)
+     */
+    bool feed(const uint8_t* data, size_t length, Sink sink, void* context);
+
+    /**
+     * @brief true se la patch è terminata su un confine di operazione
+     */
+    bool isComplete() const { return _active && _state == STATE_HEADER && _varintShift == 0; }
+    bool isCorrupt() const { return _corrupt; }
+    uint32_t getOutputBytes() const { return _outputBytes; }
+
+private:
+    enum Op : uint8_t {
+        OP_COPY = 0,
+        OP_DIFF = 1,
+        OP_EXTRA = 2,
+        OP_SEEK = 3,
+    };
+
+    enum State : uint8_t {
+        STATE_HEADER,   // Varint in lettura
+        STATE_DIFF,     // _remaining byte di payload DIFF
+        STATE_EXTRA,    // _remaining byte di payload EXTRA
+    };
+
+    bool _fail();
+    bool _readSource(uint32_t length);
+    bool _copy(uint32_t length, Sink sink, void* context);
+
+    SourceReader _reader = nullptr;
+    void* _readerContext = nullptr;
+    uint32_t _sourceSize = 0;
+    uint32_t _sourcePos = 0;
+    bool _active = false;
+    bool _corrupt = false;
+
+    State _state = STATE_HEADER;
+    uint32_t _varint = 0;
+    uint8_t _varintShift = 0;
+    uint32_t _remaining = 0;
+
+    uint8_t _source[BLOCK_SIZE];
+    uint8_t _out[BLOCK_SIZE];
+    uint32_t _outputBytes = 0;
+};
+
+#endif // DELTA_PATCHER_H
@@ -0,0 +1,76 @@
+#ifndef EFFECT_ID_H
+#define EFFECT_ID_H
+
+#include <Arduino.h>
+#include <string.h>
+
+/**
+ * @brief ID fissi degli effetti LED
+ *
+ * Il nome (String) resta il formato di config.json e delle characteristic
+ * JSON; il renderer e il protocollo binario lavorano solo con l'ID, così il
+ * percorso di render non confronta né copia String.
+ *
+ * L'ID è l'indice in EFFECT_NAMES ed è parte del protocollo BLE binario:
+ * aggiungere nuovi effetti solo in coda.
+ */
+enum class EffectId : uint8_t {
+    SOLID = 0,
+    RAINBOW,
+    PULSE,
+    BREATHE,
+    SINE_MOTION,
+    FLICKER,
+    UNSTABLE,
+    DUAL_PULSE,
+    DUAL_PULSE_SIMPLE,
+    RAINBOW_BLADE,
+    RAINBOW_EFFECT,
+    STORM_LIGHTNING,
+    CHRONO_HYBRID,
+    IGNITION,
+    RETRACTION,
+    CLASH,
+    COUNT,
+    UNKNOWN = 0xFF
+};
+
+static constexpr const char* EFFECT_NAMES[] = {
+    "solid", "rainbow", "pulse", "breathe", "sine_motion", "flicker",
+    "unstable", "dual_pulse", "dual_pulse_simple", "rainbow_blade",
+    "rainbow_effect", "storm_lightning", "chrono_hybrid", "ignition",
+    "retraction", "clash"
+};
+static_assert(sizeof(EFFECT_NAMES) / sizeof(EFFECT_NAMES[0]) == (size_t)EffectId::COUNT,
+              "EFFECT_NAMES must match EffectId");
+
+inline EffectId effectIdFromName(const char* name) {
+    if (name == nullptr) {
+        return EffectId::UNKNOWN;
+    }
+    if (strcmp(name, "clock") == 0) {
+        return EffectId::CHRONO_HYBRID;  // Alias storico
+    }
+    for (uint8_t i = 0; i < (uint8_t)EffectId::COUNT; i++) {
+        if (strcmp(name, EFFECT_NAMES[i]) == 0) {
+            return static_cast<EffectId>(i);
+        }
+    }
+    return EffectId::UNKNOWN;
+}
+
+/**
+ * @return Nome dell'effetto, nullptr se l'ID non è valido
+ */
+inline const char* effectIdToName(EffectId id) {
+    return ((uint8_t)id < (uint8_t)EffectId::COUNT) ? EFFECT_NAMES[(uint8_t)id] : nullptr;
+}
+
+/**
+ * @brief true per gli effetti "one-shot" (animazioni sopra un effetto base)
+ */
+inline bool isOneShotEffect(EffectId id) {
+    return id == EffectId::IGNITION || id == EffectId::RETRACTION || id == EffectId::CLASH;
+}
+
+#endif // EFFECT_ID_H
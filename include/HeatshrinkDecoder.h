@@ -0,0 +1,88 @@
+#ifndef HEATSHRINK_DECODER_H
+#define HEATSHRINK_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Decoder LZSS in streaming, formato bitstream di heatshrink
+ *
+ * Usato dall'OTA compresso: i chunk BLE arrivano in ordine ma spezzati in
+ * punti arbitrari, quindi lo stato (bit pendenti, backref a metà) sopravvive
+ * tra una feed() e l'altra. RAM: finestra da 2^windowBits byte + 256 byte di
+ * output, allocati in begin() e liberati in end().
+ *
+ * Bitstream (MSB first): tag 1 + 8 bit = literal; tag 0 + windowBits bit
+ * (distanza - 1) + lookaheadBits bit (lunghezza - 1) = backref.
+ * Compatibile con heatshrink (-w windowBits -l lookaheadBits); l'encoder di
+ * riferimento è heatshrink_compress() in ota_protocol.py.
+ *
+ * Non dipende da Arduino: tools/ota_codec_host.cpp lo compila sull'host per
+ * il round-trip dei firmware reali.
+ */
+class HeatshrinkDecoder {
+public:
+    static constexpr uint8_t MIN_WINDOW_BITS = 4;
+    static constexpr uint8_t MAX_WINDOW_BITS = 14;   // 16KB di finestra al massimo
+    static constexpr uint8_t MIN_LOOKAHEAD_BITS = 3;
+    static constexpr size_t OUT_BUFFER_SIZE = 256;
+
+    /**
+     * @brief Riceve l'output decompresso a blocchi (max OUT_BUFFER_SIZE)
+     * @return false per interrompere la decodifica (errore del consumatore)
+     */
+    typedef bool (*Sink)(void* context, const uint8_t* data, size_t length);
+
+    HeatshrinkDecoder() = default;
+    ~HeatshrinkDecoder();
+    HeatshrinkDecoder(const HeatshrinkDecoder&) = delete;
+    HeatshrinkDecoder& operator=(const HeatshrinkDecoder&) = delete;
+
+    /**
+     * @brief Alloca la finestra e azzera lo stato
+     * @return false se i parametri non sono validi o manca memoria
+     */
+    bool begin(uint8_t windowBits, uint8_t lookaheadBits);
+    void end();
+
+    /**
+     * @brief Decodifica un pezzo di stream e inoltra l'output al sink
+     * @return false se il sink ha rifiutato dati (lo stream va abbandonato)
+     */
+    bool feed(const uint8_t* data, size_t length, Sink sink, void* context);
+
+    /**
+     * @brief Svuota il buffer di output (chiamare a fine stream)
+     */
+    bool flush(Sink sink, void* context);
+
+    bool isActive() const { return _window != nullptr; }
+    uint32_t getOutputBytes() const { return _outputBytes; }
+
+private:
+    enum State : uint8_t {
+        STATE_TAG,
+        STATE_LITERAL,
+        STATE_INDEX,
+        STATE_COUNT,
+    };
+
+    bool _emit(uint8_t byte, Sink sink, void* context);
+
+    uint8_t* _window = nullptr;
+    uint16_t _windowMask = 0;
+    uint16_t _head = 0;
+    uint8_t _windowBits = 0;
+    uint8_t _lookaheadBits = 0;
+
+    State _state = STATE_TAG;
+    uint32_t _bits = 0;         // Accumulatore MSB first
+    uint8_t _bitCount = 0;
+    uint16_t _backrefDistance = 0;
+
+    uint8_t _out[OUT_BUFFER_SIZE];
+    size_t _outLen = 0;
+    uint32_t _outputBytes = 0;
+};
+
+#endif // HEATSHRINK_DECODER_H
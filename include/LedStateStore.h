@@ -0,0 +1,128 @@
+#ifndef LED_STATE_STORE_H
+#define LED_STATE_STORE_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "EffectId.h"
+
+struct LedState;
+
+/**
+ * @brief Copia immutabile di LedState letta dal renderer
+ *
+ * Solo tipi POD (niente String): gli effetti sono EffectId. Stessi nomi di
+ * campo di LedState, così gli effetti leggono state.r, state.foldPoint, ...
+ */
+struct LedSnapshot {
+    uint32_t version;
+
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t brightness;
+    uint8_t statusLedBrightness;
+    EffectId effectId;
+    uint8_t speed;
+    bool enabled;
+    bool bladeEnabled;
+    bool statusLedEnabled;
+    uint8_t foldPoint;
+
+    bool autoIgnitionOnBoot;
+    uint32_t autoIgnitionDelayMs;
+    bool motionOnBoot;
+    bool sentryModeEnabled;
+    uint16_t sentryIntervalSec;
+    uint8_t sentryThresholdPct;
+
+    uint32_t epochBase;
+    uint32_t millisAtSync;
+
+    uint8_t chronoHourTheme;
+    uint8_t chronoSecondTheme;
+    bool chronoWellnessMode;
+    uint8_t breathingRate;
+    uint16_t chronoCycleDuration;
+
+    EffectId gestureClashEffectId;
+    uint16_t gestureClashDurationMs;
+};
+
+/**
+ * @brief Store versionato di LedState condiviso tra task BLE e renderer
+ *
+ * LedState (con le String per config/JSON) resta il documento "master" ed è
+ * modificato solo dentro una Transaction (mutex ricorsivo: task BLE, loop,
+ * BootInitTask). Alla chiusura della transazione lo store costruisce un
+ * LedSnapshot e lo pubblica nel buffer inattivo, poi scambia i buffer.
+ *
+ * Il renderer legge lo snapshot senza lock (seqlock per buffer: se un writer
+ * ha riscritto il buffer durante la copia, la lettura viene ripetuta).
+ * La versione cresce solo se lo snapshot è cambiato: è il contatore usato per
+ * il dirty-tracking (notify stato, pickup del renderer).
+ */
+class LedStateStore {
+public:
+    static LedStateStore& getInstance();
+
+    /**
+     * @brief Collega il master e pubblica il primo snapshot (chiamare in setup)
+     */
+    void begin(LedState* master);
+
+    /**
+     * @brief Accesso esclusivo al master; alla distruzione pubblica lo snapshot
+     *
+     * Va bene anche per sola lettura delle String (publish non incrementa la
+     * versione se nulla è cambiato). Annidabile.
+     */
+    class Transaction {
+    public:
+        Transaction();
+        ~Transaction();
+        Transaction(const Transaction&) = delete;
+        Transaction& operator=(const Transaction&) = delete;
+
+        LedState& state() { return *_store._master; }
+        LedState* operator->() { return _store._master; }
+
+    private:
+        LedStateStore& _store;
+    };
+
+    /**
+     * @brief Copia lo snapshot corrente (lock-free, mai bloccante per i writer)
+     */
+    void read(LedSnapshot& out) const;
+
+    /**
+     * @brief Come read(), ma copia solo se la versione differisce da out.version
+     * @return true se out è stato aggiornato
+     */
+    bool readIfChanged(LedSnapshot& out) const;
+
+    uint32_t getVersion() const { return __atomic_load_n(&_version, __ATOMIC_ACQUIRE); }
+
+    LedState* getMaster() const { return _master; }
+
+private:
+    LedStateStore() = default;
+    LedStateStore(const LedStateStore&) = delete;
+    LedStateStore& operator=(const LedStateStore&) = delete;
+
+    void _lock();
+    void _unlock();
+    void _publish();
+    static void _buildSnapshot(const LedState& state, LedSnapshot& out);
+
+    LedState* _master = nullptr;
+    SemaphoreHandle_t _mutex = nullptr;
+
+    LedSnapshot _slots[2] = {};
+    uint32_t _slotSeq[2] = {0, 0};   // Dispari = scrittura in corso
+    uint8_t _active = 0;
+    uint32_t _version = 0;
+};
+
+#endif // LED_STATE_STORE_H
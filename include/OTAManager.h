@@ -10,6 +10,11 @@
 #include <Arduino.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <mbedtls/sha256.h>
+#include "DeltaPatcher.h"
+#include "HeatshrinkDecoder.h"
 
 // UUID del servizio OTA (diverso dal servizio LED)
 #define OTA_SERVICE_UUID         "4fafc202-1fb5-459e-8fcc-c5c9c331914b"
@@ -18,10 +23,24 @@
 #define CHAR_OTA_CONTROL_UUID    "e2f6b5d5-fc21-5b4f-9b5d-2345678901bc"  // WRITE
 #define CHAR_OTA_PROGRESS_UUID   "f3e7c6e6-0d32-4c5a-ac6e-3456789012cd"  // READ + NOTIFY
 #define CHAR_FW_VERSION_UUID     "a4b8d7fa-1e43-6c7d-ad8f-456789abcdef"  // READ
+#define CHAR_OTA_ACK_UUID        "b5c9e8f0-2a54-4d8e-be06-56789abcde01"  // NOTIFY (ACK finestra)
 
 // Dimensione massima chunk (allineata con MTU massimo ESP32)
 #define OTA_CHUNK_SIZE 512
 
+// Scritture flash a settori interi: erase + write di blocchi da 4KB
+#define OTA_FLASH_BLOCK_SIZE 4096
+
+// Sessione ripristinabile (NVS): checkpoint dei byte scritti ogni 64KB
+#define OTA_RESUME_NVS_NAMESPACE     "ota_resume"
+#define OTA_RESUME_NVS_KEY           "session"
+#define OTA_RESUME_CHECKPOINT_BYTES  (64 * 1024)
+
+// Trasferimento a finestra (START_WINDOWED): ogni chunk è [seq:u16 LE][payload]
+#define OTA_SEQ_HEADER_SIZE  2
+#define OTA_WINDOW_DEFAULT   32   // Chunk in volo senza ACK
+#define OTA_WINDOW_MAX       56   // < profondità coda RX (spazio per NACK/ACK di controllo)
+
 // Timeout (millisecondi)
 #define OTA_GLOBAL_TIMEOUT_MS   (5 * 60 * 1000)  // 5 minuti
 #define OTA_CHUNK_TIMEOUT_MS    (10 * 1000)      // 10 secondi tra chunk
@@ -45,18 +64,57 @@ enum class OTAState {
 
 // Comandi OTA (via CONTROL characteristic)
 enum class OTACommand {
-    START = 0x01,
+    START = 0x01,           // [size:u32] ([sha256:32])
     ABORT = 0x02,
     VERIFY = 0x03,
-    REBOOT = 0x04
+    REBOOT = 0x04,
+    START_WINDOWED = 0x05,  // [size:u32][window:u8] ([encoding:u8][imageSize:u32][param:u8]
+                            //  [sourceSize:u32][sourceCrc32:u32] ([sha256:32] ([resumeOffset:u32])))
+    QUERY_RESUME = 0x06     // [sha256:32] -> notify OTA_ACK type RESUME, offset = byte ripristinabili
+};
+
+// Codifica dello stream OTA (START_WINDOWED esteso)
+enum class OTAEncoding : uint8_t {
+    RAW = 0,            // Immagine così com'è
+    HEATSHRINK = 1,     // LZSS heatshrink, param = (windowBits << 4) | lookaheadBits
+    DELTA = 2           // Patch DeltaPatcher compressa heatshrink, base = firmware in esecuzione
+};
+
+// Parametri dello stream OTA (START_WINDOWED); default = START classico
+struct OTAStreamParams {
+    uint8_t window = 0;             // 0 = START classico (chunk raw, niente ACK)
+    OTAEncoding encoding = OTAEncoding::RAW;
+    uint32_t imageSize = 0;         // Firmware ricostruito (stream compressi/delta)
+    uint8_t codecParam = 0;
+    uint32_t sourceSize = 0;        // DELTA: byte della partizione corrente usati come base
+    uint32_t sourceCrc32 = 0;       // DELTA: CRC32 attesi di quei byte
+    bool hasSha256 = false;         // Digest dell'immagine ricostruita, verificato da VERIFY
+    uint8_t sha256[32] = {0};
+    uint32_t resumeOffset = 0;      // Ripresa: lo stream ricostruisce image[resumeOffset:]
+};
+
+// Notify su OTA_ACK (solo START_WINDOWED)
+enum class OTAAckType : uint8_t {
+    ACK  = 0x01,    // nextSeq/offset: chunk consumati dal writer (liberano la finestra)
+    NACK = 0x02,    // nextSeq/offset: primo chunk mancante, ritrasmettere da qui
+    RESUME = 0x03   // Risposta a QUERY_RESUME: offset = byte già in flash (0 = ricominciare)
+};
+
+#pragma pack(push, 1)
+struct OTAAckPacket {
+    uint8_t type;           // OTAAckType
+    uint8_t window;         // Finestra effettiva (chunk)
+    uint16_t nextSeq;       // Prossimo seq atteso
+    uint32_t offset;        // Byte di firmware corrispondenti a nextSeq
 };
+#pragma pack(pop)
 
 // Struttura stato OTA
 struct OTAStatus {
     OTAState state = OTAState::IDLE;
     uint32_t totalBytes = 0;        // Dimensione totale firmware (ricevuta nel comando START)
     uint32_t receivedBytes = 0;     // Byte ricevuti finora
-    uint32_t crc32 = 0;             // CRC32 calcolato
+    uint32_t crc32 = 0;             // CRC32 dell'immagine scritta (stesso valore di zlib.crc32)
     uint8_t progressPercent = 0;    // Percentuale progresso
     uint32_t lastChunkTime = 0;     // Timestamp ultimo chunk ricevuto
     uint32_t startTime = 0;         // Timestamp inizio OTA
@@ -67,6 +125,7 @@ struct OTAStatus {
 struct OTAPendingCommand {
     bool startPending = false;
     uint32_t startFirmwareSize = 0;
+    OTAStreamParams startStream;
     bool abortPending = false;
     bool verifyPending = false;
     bool rebootPending = false;
@@ -83,25 +142,95 @@ private:
     BLECharacteristic* pCharOTAControl;
     BLECharacteristic* pCharOTAProgress;
     BLECharacteristic* pCharFWVersion;
+    BLECharacteristic* pCharOTAAck;
 
     OTAStatus otaStatus;
     OTAPendingCommand pendingCmd;
-    esp_ota_handle_t otaHandle;
     const esp_partition_t* updatePartition;
 
-    // Evita operazioni lente (flash write) nel callback BLE: accoda i chunk e processali nel loop principale
+    // Evita operazioni lente (flash write) nel callback BLE: accoda i chunk e
+    // li consuma OTAFlashTask, che scrive la flash a blocchi da 4KB
     static constexpr size_t OTA_RX_QUEUE_DEPTH = 64; // 64 * 512 = 32KB buffer
+    enum OTAQueuedKind : uint8_t {
+        QUEUED_DATA = 0,
+        QUEUED_NACK,        // Buco nei seq: il writer notifica il NACK
+        QUEUED_ACK          // Duplicato ricevuto: ripeti l'ultimo ACK
+    };
     struct OTAQueuedChunk {
+        uint8_t kind;
+        uint16_t seq;
         uint16_t len;
+        uint32_t offset;
         uint8_t data[OTA_CHUNK_SIZE];
     };
     QueueHandle_t rxQueue = nullptr;
     volatile uint8_t rxQueueError = 0; // 0=ok, 1=full, 2=oversize
 
+    // Writer flash (OTAFlashTask). flashMutex serializza le scritture della
+    // partizione con VERIFY/reset eseguiti dal loop o dal callback BLE.
+    TaskHandle_t flashTask = nullptr;
+    SemaphoreHandle_t flashMutex = nullptr;
+    uint8_t flashBuffer[OTA_FLASH_BLOCK_SIZE];
+    size_t flashBufferLen = 0;
+    volatile bool flashSessionOpen = false;
+    volatile bool writerDone = false;
+    volatile esp_err_t writerError = ESP_OK;
+    uint32_t lastProgressBytes = 0;
+
+    // Stream compresso: receivedBytes/totalBytes contano i byte trasferiti,
+    // imageWritten/imageBytes quelli decompressi verso la flash
+    OTAEncoding streamEncoding = OTAEncoding::RAW;
+    uint32_t imageBytes = 0;
+    uint32_t imageWritten = 0;
+    uint32_t imageFlushed = 0;      // Byte scritti in flash (multiplo di 4KB fino all'ultimo blocco)
+    HeatshrinkDecoder decoder;
+
+    // Checksum dell'immagine, aggiornati a settori interi prima della scrittura
+    mbedtls_sha256_context imageSha;
+    bool imageShaActive = false;
+    bool expectSha256 = false;
+    uint8_t expectedSha256[32];
+    uint32_t checksumMicros = 0;    // Costo CRC + SHA della sessione (log in VERIFY)
+
+    // OTA delta: la patch decompressa ricostruisce l'immagine leggendo la
+    // partizione in esecuzione (sourcePartition)
+    DeltaPatcher patcher;
+    const esp_partition_t* sourcePartition = nullptr;
+
+    // Sessione ripristinabile: record in NVS con digest, dimensione e byte
+    // scritti (sempre a confine di settore, solo dopo la scrittura in flash).
+    // Sopravvive a disconnessioni, timeout e reboot; cancellato da READY,
+    // digest errato e ABORT del client.
+    static constexpr uint32_t RESUME_MAGIC = 0x4C534F52;  // "LSOR"
+    static constexpr uint16_t RESUME_VERSION = 1;
+    struct OTAResumeRecord {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t reserved;
+        uint8_t sha256[32];
+        uint32_t imageSize;
+        uint32_t partitionAddress;
+        uint32_t committed;
+        uint32_t crc;
+    };
+    bool resumeRecordActive = false;
+    uint32_t resumeCommitted = 0;
+
+    // Finestra: stato lato callback BLE (ricezione) e lato writer (ACK)
+    volatile bool windowed = false;
+    uint8_t windowSize = 0;
+    uint16_t rxExpectedSeq = 0;
+    uint32_t rxAcceptedOffset = 0;
+    bool nackQueued = false;
+    volatile bool ackQueued = false;
+    uint16_t ackSeq = 0;
+    uint16_t chunksSinceAck = 0;
+
     ota_event_callback_t preOtaCallback = nullptr;
     ota_event_callback_t postOtaCallback = nullptr;
 
-    uint32_t crc32Calculate(const uint8_t* data, size_t length);
+    void digestImageBlock(const uint8_t* data, size_t length);
+    void releaseImageSha();
     void setState(OTAState newState);
     void setError(const String& errorMsg);
     void notifyStatus();
@@ -109,7 +238,23 @@ private:
     void resetOTAState();
     bool validateFirmwareSize(uint32_t size);
     bool checkTimeout();
-    void processRxQueue();
+    void processWriterEvents();
+    bool enqueueWindowedChunk(const uint8_t* data, size_t length);
+    bool enqueueControl(OTAQueuedKind kind, uint16_t seq, uint32_t offset);
+    bool flushFlashBuffer();
+    bool writeImageData(const uint8_t* data, size_t length);
+    static bool decoderSink(void* context, const uint8_t* data, size_t length);
+    static bool patchSink(void* context, const uint8_t* data, size_t length);
+    static bool readSourcePartition(void* context, uint32_t offset, uint8_t* buffer, size_t length);
+    bool verifyDeltaSource(uint32_t size, uint32_t expectedCrc32);
+    void sendAck(OTAAckType type, uint16_t nextSeq, uint32_t offset);
+    bool loadResumeRecord(OTAResumeRecord& record);
+    void saveResumeRecord(uint32_t committed);
+    void clearResumeRecord();
+    bool rehashFlashedImage(uint32_t length);
+
+    static void flashTaskEntry(void* param);
+    void flashTaskLoop();
 
 public:
     OTAManager();
@@ -123,17 +268,18 @@ public:
     void setPostOtaCallback(ota_event_callback_t callback) { postOtaCallback = callback; }
 
     // Handler comandi (chiamati dal callback BLE - schedula solo)
-    void scheduleStartCommand(uint32_t firmwareSize);
+    void scheduleStartCommand(uint32_t firmwareSize, const OTAStreamParams& stream = OTAStreamParams());
     void scheduleAbortCommand();
 
     // Esecuzione reale comandi (chiamati da update() nel loop principale)
-    void executeStartCommand(uint32_t firmwareSize);
+    void executeStartCommand(uint32_t firmwareSize, const OTAStreamParams& stream = OTAStreamParams());
     void executeAbortCommand();
     void handleVerifyCommand();
     void handleRebootCommand();
+    void handleQueryResumeCommand(const uint8_t* sha256);
     void processPendingCommands();
 
-    // Handler dati
+    // Handler dati (OTAFlashTask, con flashMutex)
     void handleDataChunk(const uint8_t* data, size_t length);
     bool enqueueDataChunk(const uint8_t* data, size_t length);
 
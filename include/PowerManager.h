@@ -0,0 +1,119 @@
+/**
+ * @file PowerManager.h
+ * @brief CPU power profiles (DFS + automatic light sleep) driven by saber state
+ *
+ * The firmware used to run at 240 MHz all the time, even with the blade off
+ * and the camera stopped. PowerManager picks a profile from the current
+ * engine state and applies it through esp_pm_configure():
+ *
+ * - IDLE:        blade off, camera off   -> 80 MHz, automatic light sleep
+ * - ECO:         blade on, camera off    -> 160 MHz max, DFS down to 80 MHz
+ * - MOTION:      camera/motion streaming -> 240 MHz max, DFS down to 80 MHz
+ * - PERFORMANCE: OTA in progress         -> 240 MHz locked
+ *
+ * The minimum frequency never goes below 80 MHz so APB (LEDC, RMT, UART,
+ * camera XCLK) keeps a fixed clock. BLE connections stay alive: the BT
+ * controller holds its own PM lock whenever it needs the radio, so light
+ * sleep only happens in the gaps it allows.
+ *
+ * If the SDK was built without CONFIG_PM_ENABLE (or without tickless idle),
+ * the manager falls back to setCpuFrequencyMhz() / DFS without light sleep.
+ *
+ * Thread safety: update() must be called from the main loop. Getters are
+ * safe from the BLE task (single 32-bit reads).
+ */
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include <atomic>
+
+class PowerManager {
+public:
+    enum class Profile : uint8_t {
+        IDLE = 0,
+        ECO = 1,
+        MOTION = 2,
+        PERFORMANCE = 3
+    };
+
+    static constexpr uint8_t PROFILE_COUNT = 4;
+
+    /**
+     * @brief Inputs used to select the profile
+     */
+    struct Inputs {
+        bool bladeActive = false;     // Blade on or ignition/retraction animating
+        bool cameraActive = false;    // Camera task streaming frames
+        bool otaInProgress = false;   // OTA transfer/verify running
+    };
+
+    /**
+     * @brief Get singleton instance
+     */
+    static PowerManager& getInstance();
+
+    /**
+     * @brief Detect PM support and apply the initial profile
+     */
+    void begin(Profile initial = Profile::PERFORMANCE);
+
+    /**
+     * @brief Re-evaluate profile from engine state and update residency
+     *
+     * Upgrades are applied immediately; downgrades only after the lower
+     * profile has been requested for DOWNGRADE_HOLD_MS (avoids thrashing
+     * on short idle gaps between gestures).
+     */
+    void update(const Inputs& inputs, uint32_t nowMs);
+
+    Profile getProfile() const { return _profile; }
+    uint16_t getMaxFreqMhz() const { return _profileTable[static_cast<uint8_t>(_profile)].maxFreqMhz; }
+    bool isLightSleepActive() const { return _lightSleepActive; }
+    bool isPmSupported() const { return _pmSupported; }
+
+    /**
+     * @brief Time spent in a profile since boot (ms), including the current stint
+     */
+    uint32_t getResidencyMs(Profile profile, uint32_t nowMs) const;
+
+    uint32_t getSwitchCount() const { return _switchCount; }
+
+    static const char* profileToString(Profile profile);
+
+private:
+    struct ProfileConfig {
+        uint16_t maxFreqMhz;
+        uint16_t minFreqMhz;
+        bool lightSleep;
+    };
+
+    static constexpr uint32_t DOWNGRADE_HOLD_MS = 2000;
+    static const ProfileConfig _profileTable[PROFILE_COUNT];
+
+    PowerManager() = default;
+    PowerManager(const PowerManager&) = delete;
+    PowerManager& operator=(const PowerManager&) = delete;
+
+    Profile _selectProfile(const Inputs& inputs) const;
+    bool _apply(Profile profile);
+
+    Profile _profile = Profile::PERFORMANCE;
+    Profile _pendingDowngrade = Profile::PERFORMANCE;
+    uint32_t _pendingSinceMs = 0;
+    bool _downgradePending = false;
+
+    uint32_t _residencyMs[PROFILE_COUNT] = {0, 0, 0, 0};
+    uint32_t _profileSinceMs = 0;
+    uint32_t _switchCount = 0;
+
+    // begin() gira su core 0 (BootInitTask), update() nel loop su core 1:
+    // pubblicato per ultimo (release) dopo profilo e timestamp
+    std::atomic<bool> _initialized{false};
+    bool _pmSupported = false;
+    bool _lightSleepSupported = false;
+    bool _lightSleepActive = false;
+};
+
+#endif // POWER_MANAGER_H
@@ -6,6 +6,7 @@ Script interattivo per controllare la spada laser LED via Bluetooth LE
 
 import asyncio
 import json
+import struct
 import sys
 from typing import Optional, Callable
 from bleak import BleakClient, BleakScanner
@@ -23,6 +24,7 @@ CHAR_TIME_SYNC_UUID = "d6e1a0b8-4a76-9f0c-dc1a-789abcdef012"
 CHAR_FW_VERSION_UUID = "a4b8d7fa-1e43-6c7d-ad8f-456789abcdef"
 CHAR_DEVICE_CONTROL_UUID = "c7f8e0d9-5b87-1a2b-be9d-7890abcdef23"
 CHAR_EFFECTS_LIST_UUID = "d8f9e1ea-6c98-2b3c-cf0e-890abcdef234"
+CHAR_LED_MIRROR_UUID = "2d3e463f-b1ed-4a8b-9453-3def56789012"
 
 # Camera Service UUIDs
 CAMERA_SERVICE_UUID = "5fafc301-1fb5-459e-8fcc-c5c9c331914b"
@@ -37,6 +39,8 @@ CHAR_MOTION_STATUS_UUID = "7eb5583e-36e1-4688-b7f5-ea07361b26a9"
 CHAR_MOTION_CONTROL_UUID = "8dc5b4c3-eb10-4a3e-8a4c-1234567890ac"
 CHAR_MOTION_EVENTS_UUID = "9ef6c5d4-fc21-5b4f-9b5d-2345678901bd"
 CHAR_MOTION_CONFIG_UUID = "aff7d6e5-0d32-4c5a-ac6e-3456789012ce"
+CHAR_MOTION_TELEMETRY_UUID = "c1f9f807-2f54-4e7c-ce0a-5678901234e0"
+CHAR_MOTION_RECORD_UUID = "d20a0918-3065-4f8d-df1b-6789012345f1"
 
 # Colori ANSI per output colorato
 class Colors:
@@ -50,6 +54,165 @@ class Colors:
     CYAN = "\033[96m"
 
 
+_TELEMETRY_HEADER = struct.Struct("<HIBBBBBBBBBB")
+
+# Ordine = GestureStateMachine::Slot / State
+GESTURE_SLOTS = ["clash", "retract", "ignition", "stab", "spin", "twirl",
+                 "effect_up", "effect_down", "effect_left", "effect_right"]
+GESTURE_STATES = ["idle", "armed", "triggered", "refractory"]
+
+
+def decode_motion_telemetry(data: bytes) -> Optional[dict]:
+    """Decodifica un frame TLV MOTION_TELEMETRY (0x85), vedi BinaryProtocol.h"""
+    if len(data) < 3 or data[0] != 1 or data[1] != 0x85:
+        return None
+    payload = data[3:3 + data[2]]
+    if len(payload) < _TELEMETRY_HEADER.size + 128 + 32:
+        return None
+
+    (seq, ts, dropped, process_ms, flags, intensity, direction, speed_x10,
+     gesture, gesture_conf, cx, cy) = _TELEMETRY_HEADER.unpack_from(payload)
+    off = _TELEMETRY_HEADER.size
+
+    # Cella: dx 6 bit, dy 6 bit (con segno, saturati a ±31 px), confidence >> 4 (0 = non valido)
+    def signed6(value: int) -> int:
+        return value - 64 if value & 0x20 else value
+
+    vectors = []
+    active_blocks = 0
+    for row in range(8):
+        line = []
+        for col in range(8):
+            (cell,) = struct.unpack_from("<H", payload, off + (row * 8 + col) * 2)
+            level = cell >> 12
+            active_blocks += level > 0
+            line.append({"dx": signed6(cell & 0x3F), "dy": signed6((cell >> 6) & 0x3F),
+                         "conf": level * 17, "valid": level > 0})
+        vectors.append(line)
+    off += 128
+
+    grid = [[0] * 8 for _ in range(8)]
+    for index in range(64):
+        nibble = payload[off + index // 2] >> (4 if index & 1 else 0)
+        grid[index // 8][index % 8] = (nibble & 0x0F) * 17  # 0-15 -> 0-255
+
+    off += 32
+
+    # Stati della state machine gesture (2 bit per slot), assenti nei firmware precedenti
+    states = None
+    if len(payload) >= off + 3:
+        packed = int.from_bytes(payload[off:off + 3], "little")
+        states = {slot: GESTURE_STATES[(packed >> (index * 2)) & 0x03]
+                  for index, slot in enumerate(GESTURE_SLOTS)}
+
+    centroid_valid = bool(flags & 0x02)
+    return {
+        "seq": seq, "timestampMs": ts, "dropped": dropped, "processMs": process_ms,
+        "motion": bool(flags & 0x01), "intensity": intensity, "direction": direction,
+        "speed": speed_x10 / 10.0, "activeBlocks": active_blocks,
+        "gesture": gesture, "gestureConfidence": gesture_conf,
+        "centroid": (cx / 255.0, cy / 255.0) if centroid_valid else None,
+        "vectors": vectors, "perturbationGrid": grid, "gestureStates": states,
+    }
+
+
+_RECORD = struct.Struct("<HIhhhhBBHBBBB")
+
+
+def decode_motion_records(data: bytes) -> list:
+    """Decodifica una notify Motion Record: più TLV MOTION_RECORD (0x86), vedi BinaryProtocol.h"""
+    records = []
+    if len(data) < 1 or data[0] != 1:
+        return records
+    off = 1
+    while off + 2 <= len(data):
+        tlv_type, tlv_len = data[off], data[off + 1]
+        payload = data[off + 2:off + 2 + tlv_len]
+        off += 2 + tlv_len
+        if tlv_type != 0x86 or len(payload) < _RECORD.size:
+            continue  # TLV sconosciuto o troncato
+        (seq, ts, flow_x, flow_y, div, curl, intensity, active_blocks, speed,
+         cx, cy, flags, label) = _RECORD.unpack_from(payload)
+        records.append({
+            "seq": seq, "timestampMs": ts, "flowXQ4": flow_x, "flowYQ4": flow_y,
+            "divQ4": div, "curlQ4": curl, "intensity": intensity,
+            "activeBlocks": active_blocks, "speedQ4": speed,
+            "centroidValid": bool(flags & 0x01), "centroidX": cx, "centroidY": cy,
+            "label": label,
+        })
+    return records
+
+
+class LedMirrorDecoder:
+    """Ricostruisce il framebuffer della lama dalle notify LED Mirror (vedi LedMirrorStream.h)"""
+
+    HEADER = struct.Struct("<BBBHHI")
+    ENC_KEY_RGB, ENC_DELTA_RGB, ENC_PAL332, ENC_PAL332_RLE = range(4)
+
+    def __init__(self):
+        self.pixels = [(0, 0, 0)] * 144
+        self.led_count = 0
+        self.brightness = 0
+        self.dropped = 0
+        self.lost = 0          # Notify mancanti (salti di seq)
+        self.frame_ms = 0      # Intervallo tra catture = cadenza render osservata
+        self._last_seq = None
+        self._last_ts = None
+        self._have_key = False
+
+    @staticmethod
+    def _from_pal332(idx: int):
+        return (((idx >> 5) & 7) * 255 // 7, ((idx >> 2) & 7) * 255 // 7, (idx & 3) * 255 // 3)
+
+    def feed(self, data: bytes) -> bool:
+        """Applica un frame; False se è un delta senza keyframe valido (attendere il prossimo)"""
+        if len(data) < self.HEADER.size:
+            return False
+        encoding, count, brightness, seq, dropped, ts = self.HEADER.unpack_from(data)
+        payload = data[self.HEADER.size:]
+
+        if self._last_seq is not None and seq != (self._last_seq + 1) & 0xFFFF:
+            self.lost += (seq - self._last_seq - 1) & 0xFFFF
+            self._have_key = False
+        self._last_seq = seq
+        if self._last_ts is not None:
+            self.frame_ms = (ts - self._last_ts) & 0xFFFFFFFF
+        self._last_ts = ts
+
+        self.led_count = count
+        self.brightness = brightness
+        self.dropped = dropped
+
+        if encoding == self.ENC_KEY_RGB:
+            self.pixels[:count] = [tuple(payload[i * 3:i * 3 + 3]) for i in range(count)]
+        elif encoding == self.ENC_PAL332:
+            self.pixels[:count] = [self._from_pal332(b) for b in payload[:count]]
+        elif encoding == self.ENC_PAL332_RLE:
+            led = 0
+            for i in range(0, len(payload) - 1, 2):
+                color = self._from_pal332(payload[i + 1])
+                for _ in range(payload[i]):
+                    if led < count:
+                        self.pixels[led] = color
+                    led += 1
+        elif encoding == self.ENC_DELTA_RGB:
+            if not self._have_key:
+                return False
+            i = 0
+            while i + 2 <= len(payload):
+                start, span = payload[i], payload[i + 1]
+                for k in range(span):
+                    off = i + 2 + k * 3
+                    self.pixels[start + k] = tuple(payload[off:off + 3])
+                i += 2 + span * 3
+            return True
+        else:
+            return False
+
+        self._have_key = True
+        return True
+
+
 class LedSaberClient:
     """Client BLE per LedSaber"""
 
@@ -74,6 +237,19 @@ class LedSaberClient:
         self.motion_callback: Optional[Callable] = None
         self.motion_event_callback: Optional[Callable] = None
 
+        # LED mirror stream
+        self.mirror_decoder = LedMirrorDecoder()
+        self.mirror_callback: Optional[Callable] = None
+
+        # Motion telemetry (full rate)
+        self.telemetry_callback: Optional[Callable] = None
+        self.telemetry_last_seq: Optional[int] = None
+        self.telemetry_lost = 0
+
+        # Registrazione dataset motion
+        self.record_callback: Optional[Callable] = None
+        self.record_last_rx = 0.0
+
     async def _ensure_services(self) -> bool:
         """Forza la discovery dei servizi GATT (alcune versioni di Bleak non la fanno subito)."""
         if not self.client or not self.client.is_connected:
@@ -739,6 +915,99 @@ class LedSaberClient:
         await self._write(CHAR_MOTION_CONFIG_UUID, config_data.encode('utf-8'), label="set_motion_config")
         print(f"{Colors.GREEN}✓ Motion config aggiornata: {config}{Colors.RESET}")
 
+    async def start_led_mirror(self, fps: int = 10, max_bytes: int = 180,
+                               callback: Optional[Callable] = None):
+        """Avvia lo stream del framebuffer lama (max_bytes ~ MTU-3 negoziato)"""
+        if not self.client or not self.client.is_connected:
+            print(f"{Colors.RED}✗ Non connesso{Colors.RESET}")
+            return
+
+        self.mirror_decoder = LedMirrorDecoder()
+        self.mirror_callback = callback
+        config = {"fps": max(0, min(30, int(fps))), "maxBytes": int(max_bytes), "key": True}
+        await self._write(CHAR_LED_MIRROR_UUID, json.dumps(config).encode('utf-8'), label="start_led_mirror")
+        await self.client.start_notify(CHAR_LED_MIRROR_UUID, self._mirror_notification_handler)
+        print(f"{Colors.GREEN}✓ LED mirror avviato: {config}{Colors.RESET}")
+
+    async def stop_led_mirror(self):
+        """Ferma lo stream del framebuffer lama"""
+        if not self.client or not self.client.is_connected:
+            return
+        try:
+            await self.client.stop_notify(CHAR_LED_MIRROR_UUID)
+        except Exception:
+            pass
+        self.mirror_callback = None
+
+    def _mirror_notification_handler(self, characteristic: BleakGATTCharacteristic, data: bytearray):
+        """Gestisce i frame LED Mirror"""
+        if self.mirror_decoder.feed(bytes(data)) and self.mirror_callback:
+            self.mirror_callback(self.mirror_decoder)
+
+    async def start_motion_telemetry(self, callback: Optional[Callable] = None):
+        """Iscrive la telemetria motion (un frame per frame elaborato dalla camera)"""
+        if not self.client or not self.client.is_connected:
+            print(f"{Colors.RED}✗ Non connesso{Colors.RESET}")
+            return
+        self.telemetry_callback = callback
+        self.telemetry_last_seq = None
+        self.telemetry_lost = 0
+        await self.client.start_notify(CHAR_MOTION_TELEMETRY_UUID, self._telemetry_notification_handler)
+        print(f"{Colors.GREEN}✓ Telemetria motion abilitata{Colors.RESET}")
+
+    async def stop_motion_telemetry(self):
+        """Disiscrive la telemetria motion"""
+        if not self.client or not self.client.is_connected:
+            return
+        try:
+            await self.client.stop_notify(CHAR_MOTION_TELEMETRY_UUID)
+        except Exception:
+            pass
+        self.telemetry_callback = None
+
+    def _telemetry_notification_handler(self, characteristic: BleakGATTCharacteristic, data: bytearray):
+        """Gestisce i frame di telemetria motion e conta quelli persi (salti di seq)"""
+        frame = decode_motion_telemetry(bytes(data))
+        if frame is None:
+            return
+        if self.telemetry_last_seq is not None:
+            self.telemetry_lost += (frame["seq"] - self.telemetry_last_seq - 1) & 0xFFFF
+        self.telemetry_last_seq = frame["seq"]
+        frame["lost"] = self.telemetry_lost
+        if self.telemetry_callback:
+            self.telemetry_callback(frame)
+
+    async def start_motion_record(self, callback: Callable):
+        """Iscrive i record dataset e avvia la registrazione (callback per ogni record)"""
+        if not self.client or not self.client.is_connected:
+            print(f"{Colors.RED}✗ Non connesso{Colors.RESET}")
+            return
+        self.record_callback = callback
+        await self.client.start_notify(CHAR_MOTION_RECORD_UUID, self._record_notification_handler)
+        await self.motion_send_command("record start")
+
+    async def stop_motion_record(self, drain_s: float = 1.0):
+        """Ferma la registrazione e attende che il device svuoti il buffer PSRAM"""
+        if not self.client or not self.client.is_connected:
+            return
+        await self.motion_send_command("record stop")
+        # I record ancora bufferizzati arrivano dopo lo stop: attende il silenzio
+        self.record_last_rx = asyncio.get_running_loop().time()
+        while asyncio.get_running_loop().time() - self.record_last_rx < drain_s:
+            await asyncio.sleep(0.1)
+        try:
+            await self.client.stop_notify(CHAR_MOTION_RECORD_UUID)
+        except Exception:
+            pass
+        self.record_callback = None
+
+    def _record_notification_handler(self, characteristic: BleakGATTCharacteristic, data: bytearray):
+        """Gestisce le notify Motion Record (più record per notify)"""
+        self.record_last_rx = asyncio.get_running_loop().time()
+        if self.record_callback:
+            for record in decode_motion_records(bytes(data)):
+                self.record_callback(record)
+
     async def set_boot_config(self, motion_enabled: Optional[bool] = None, camera_enabled: Optional[bool] = None):
         """Imposta configurazione di avvio (boot)"""
         if not self.client or not self.client.is_connected:
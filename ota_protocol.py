@@ -0,0 +1,435 @@
+#!/usr/bin/env python3
+"""
+Protocollo OTA LedSaber lato host (senza dipendenze BLE)
+
+Usato da update_saber.py e dal banco di prova tools/ota_loopback.py, così la
+logica della finestra è la stessa sia sul link reale che in simulazione.
+
+Trasferimento a finestra (comando START_WINDOWED = 0x05):
+- CONTROL: 0x05 + size:u32 LE + window:u8
+- DATA:    seq:u16 LE + payload (seq parte da 0, +1 per chunk, modulo 65536)
+- ACK:     notify di 8 byte <type:u8 window:u8 nextSeq:u16 offset:u32>
+           type 0x01 = ACK (chunk consumati dal writer, liberano la finestra)
+           type 0x02 = NACK (buco: il device scarta i chunk fino a nextSeq,
+           ritrasmettere da lì - go-back-N)
+
+OTA compresso: START_WINDOWED esteso con encoding=1 (heatshrink), size =
+byte trasferiti, imageSize = firmware decompresso, param = (W << 4) | L.
+Il device decomprime in streaming (src/HeatshrinkDecoder.cpp) verso la flash.
+
+OTA delta: encoding=2, lo stream è una patch (delta_diff) compressa heatshrink
+e il START porta anche sourceSize:u32 + sourceCrc32:u32 del firmware in
+esecuzione. Il device verifica il CRC della partizione corrente prima di
+cancellare la flash e ricostruisce l'immagine con src/DeltaPatcher.cpp.
+
+Verifica end-to-end: START (0x01 o 0x05) può chiudersi con lo SHA-256
+dell'immagine finale (32 byte); VERIFY fallisce prima di cambiare la boot
+partition se il digest calcolato in streaming dal device non corrisponde.
+Nella forma 0x05 il digest sta a offset 20 (campi delta a zero se non usati).
+
+Ripresa dopo una disconnessione: il device tiene in NVS digest, dimensione e
+byte già scritti in flash (a settori da 4KB). QUERY_RESUME (0x06) + SHA-256
+risponde con una notify ACK di tipo 0x03 e offset = byte ripristinabili;
+START_WINDOWED con resumeOffset:u32 a offset 52 invia solo image[offset:]
+(ricompresso o ridiffato come uno stream nuovo, seq di nuovo da 0).
+"""
+
+import hashlib
+import re
+import struct
+import zlib
+from typing import List, Optional
+
+OTA_CMD_START = 0x01
+OTA_CMD_START_WINDOWED = 0x05
+OTA_CMD_QUERY_RESUME = 0x06
+
+OTA_ACK_TYPE_ACK = 0x01
+OTA_ACK_TYPE_NACK = 0x02
+OTA_ACK_TYPE_RESUME = 0x03
+
+OTA_SEQ_HEADER_SIZE = 2
+OTA_WINDOW_DEFAULT = 32
+OTA_ACK_STRUCT = struct.Struct('<BBHI')
+
+OTA_ENCODING_RAW = 0
+OTA_ENCODING_HEATSHRINK = 1
+OTA_ENCODING_DELTA = 2
+
+# Finestra 4KB (RAM sul device), match fino a 32 byte
+HS_WINDOW_BITS = 12
+HS_LOOKAHEAD_BITS = 5
+
+
+# Patch delta: header varint (n << 2) | op
+DELTA_OP_COPY = 0
+DELTA_OP_DIFF = 1
+DELTA_OP_EXTRA = 2
+DELTA_OP_SEEK = 3
+DELTA_MIN_MATCH = 8
+
+
+def build_start_windowed(transfer_size: int, window: int = OTA_WINDOW_DEFAULT,
+                         encoding: int = OTA_ENCODING_RAW, image_size: int = 0,
+                         codec_param: int = 0, source: Optional[bytes] = None,
+                         image: Optional[bytes] = None, resume_offset: int = 0) -> bytes:
+    """
+    Payload CONTROL per START_WINDOWED (comando incluso).
+
+    source = base per OTA delta; image = immagine finale, se presente il suo
+    SHA-256 viene verificato dal device prima di renderla avviabile.
+    resume_offset > 0: lo stream ricostruisce image[resume_offset:] (richiede image).
+    """
+    if resume_offset and image is None:
+        raise ValueError("Ripresa OTA senza immagine (serve il digest)")
+    if encoding == OTA_ENCODING_RAW and image is None:
+        return struct.pack('<BIB', OTA_CMD_START_WINDOWED, transfer_size, window)
+    payload = struct.pack('<BIBBIB', OTA_CMD_START_WINDOWED, transfer_size, window,
+                          encoding, image_size, codec_param)
+    if encoding == OTA_ENCODING_DELTA:
+        if source is None:
+            raise ValueError("OTA delta senza firmware base")
+        payload += struct.pack('<II', len(source), zlib.crc32(source))
+    elif image is not None:
+        payload += struct.pack('<II', 0, 0)
+    if image is not None:
+        payload += hashlib.sha256(image).digest()
+    if resume_offset:
+        payload += struct.pack('<I', resume_offset)
+    return payload
+
+
+def build_query_resume(image: bytes) -> bytes:
+    """Payload CONTROL per QUERY_RESUME: il device risponde con ACK type RESUME"""
+    return bytes([OTA_CMD_QUERY_RESUME]) + hashlib.sha256(image).digest()
+
+
+def build_start(image: bytes) -> bytes:
+    """Payload CONTROL per START classico (0x01) con digest dell'immagine"""
+    return struct.pack('<BI', OTA_CMD_START, len(image)) + hashlib.sha256(image).digest()
+
+
+def heatshrink_compress(data: bytes, window_bits: int = HS_WINDOW_BITS,
+                        lookahead_bits: int = HS_LOOKAHEAD_BITS, max_chain: int = 48) -> bytes:
+    """
+    Encoder LZSS greedy (hash chain su 3 byte) nel formato bitstream heatshrink.
+
+    Tag 1 + 8 bit = literal, tag 0 + W bit (distanza-1) + L bit (lunghezza-1)
+    = backref, bit MSB first, ultimo byte completato con zeri.
+    """
+    window = 1 << window_bits
+    max_len = 1 << lookahead_bits
+    backref_bits = 1 + window_bits + lookahead_bits
+    min_len = backref_bits // 9 + 1     # Sotto questa lunghezza i literal costano meno
+    min_len = max(min_len, 3)
+
+    n = len(data)
+    out = bytearray()
+    acc = 0
+    nbits = 0
+
+    head = {}
+    prev = [-1] * n
+
+    def insert(pos):
+        if pos + 3 <= n:
+            key = data[pos:pos + 3]
+            prev[pos] = head.get(key, -1)
+            head[key] = pos
+
+    i = 0
+    while i < n:
+        best_len = 0
+        best_dist = 0
+        limit = min(max_len, n - i)
+        if limit >= min_len:
+            candidate = head.get(data[i:i + 3], -1)
+            chain = max_chain
+            while candidate >= 0 and i - candidate <= window and chain > 0:
+                chain -= 1
+                # Estende il match con confronti di slice (veloci in C)
+                if data[candidate + best_len:candidate + best_len + 1] == data[i + best_len:i + best_len + 1]:
+                    lo, hi = 3, limit
+                    if data[candidate:candidate + 3] == data[i:i + 3]:
+                        while lo < hi:
+                            mid = (lo + hi + 1) // 2
+                            if data[candidate:candidate + mid] == data[i:i + mid]:
+                                lo = mid
+                            else:
+                                hi = mid - 1
+                        if lo > best_len:
+                            best_len = lo
+                            best_dist = i - candidate
+                            if best_len == limit:
+                                break
+                candidate = prev[candidate]
+
+        if best_len >= min_len:
+            value = (best_dist - 1) << lookahead_bits | (best_len - 1)
+            acc = (acc << backref_bits) | value
+            nbits += backref_bits
+            for pos in range(i, i + best_len):
+                insert(pos)
+            i += best_len
+        else:
+            acc = (acc << 9) | 0x100 | data[i]
+            nbits += 9
+            insert(i)
+            i += 1
+
+        while nbits >= 8:
+            nbits -= 8
+            out.append((acc >> nbits) & 0xFF)
+        acc &= (1 << nbits) - 1
+
+    if nbits:
+        out.append((acc << (8 - nbits)) & 0xFF)
+    return bytes(out)
+
+
+def heatshrink_param(window_bits: int = HS_WINDOW_BITS, lookahead_bits: int = HS_LOOKAHEAD_BITS) -> int:
+    return (window_bits << 4) | lookahead_bits
+
+
+def _varint(value: int) -> bytes:
+    out = bytearray()
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+    return bytes(out)
+
+
+def _delta_op(op: int, n: int) -> bytes:
+    return _varint((n << 2) | op)
+
+
+def delta_diff(source: bytes, target: bytes, min_match: int = DELTA_MIN_MATCH) -> bytes:
+    """
+    Patch sequenziale source -> target per DeltaPatcher.
+
+    Stile bsdiff: ogni match esatto (indice hash su min_match byte) viene
+    esteso in modo approssimato finché i byte uguali superano quelli diversi,
+    così gli indirizzi rilocati dal linker non spezzano le regioni. Dentro una
+    regione allineata le sequenze uguali diventano COPY (nessun payload) e il
+    resto DIFF (differenze byte a byte); i byte senza corrispondenza EXTRA.
+    """
+    k = min_match
+    src_len = len(source)
+    tgt_len = len(target)
+
+    index = {}
+    for i in range(src_len - k + 1):
+        index.setdefault(source[i:i + k], i)
+
+    out = bytearray()
+    src_pos = 0
+    extra_start = 0
+    recent: List[int] = []      # Allineamenti (src - tgt) usati di recente
+
+    def extend(j: int, align: int) -> int:
+        # Lunghezza che massimizza (uguali - diversi), come lenf di bsdiff
+        s = j + align
+        limit = min(tgt_len - j, src_len - s)
+        score = best = best_len = pos = 0
+        while pos < limit:
+            step = min(64, limit - pos)
+            if target[j + pos:j + pos + step] == source[s + pos:s + pos + step]:
+                score += step
+                pos += step
+            else:
+                for t in range(step):
+                    score += 1 if target[j + pos + t] == source[s + pos + t] else -1
+                    if score > best:
+                        best = score
+                        best_len = pos + t + 1
+                pos += step
+                if score < best - 32:
+                    break
+                continue
+            if score > best:
+                best = score
+                best_len = pos
+        return best_len
+
+    def emit_region(j: int, s: int, length: int) -> None:
+        diff = bytes((t - o) & 0xFF for t, o in zip(target[j:j + length], source[s:s + length]))
+        pos = 0
+        for run in re.finditer(b'\x00{%d,}' % k, diff):
+            if run.start() > pos:
+                out.extend(_delta_op(DELTA_OP_DIFF, run.start() - pos))
+                out.extend(diff[pos:run.start()])
+            out.extend(_delta_op(DELTA_OP_COPY, run.end() - run.start()))
+            pos = run.end()
+        if pos < length:
+            out.extend(_delta_op(DELTA_OP_DIFF, length - pos))
+            out.extend(diff[pos:])
+
+    j = 0
+    while j + k <= tgt_len:
+        key = target[j:j + k]
+        align = None
+        for a in recent:
+            s = j + a
+            if 0 <= s <= src_len - k and source[s:s + k] == key:
+                align = a
+                break
+        if align is None:
+            s = index.get(key)
+            if s is None:
+                j += 1
+                continue
+            align = s - j
+
+        length = extend(j, align)
+        if length < k:
+            j += 1
+            continue
+
+        if j > extra_start:
+            out.extend(_delta_op(DELTA_OP_EXTRA, j - extra_start))
+            out.extend(target[extra_start:j])
+        s = j + align
+        if s != src_pos:
+            seek = s - src_pos
+            out.extend(_delta_op(DELTA_OP_SEEK, seek * 2 if seek >= 0 else -seek * 2 - 1))
+        emit_region(j, s, length)
+
+        src_pos = s + length
+        j += length
+        extra_start = j
+        if align in recent:
+            recent.remove(align)
+        recent.insert(0, align)
+        del recent[4:]
+
+    if extra_start < tgt_len:
+        out.extend(_delta_op(DELTA_OP_EXTRA, tgt_len - extra_start))
+        out.extend(target[extra_start:])
+    return bytes(out)
+
+
+def delta_apply(source: bytes, patch: bytes) -> bytes:
+    """Applicatore di riferimento (stessa semantica di src/DeltaPatcher.cpp)"""
+    out = bytearray()
+    src_pos = 0
+    pos = 0
+    while pos < len(patch):
+        value = shift = 0
+        while True:
+            byte = patch[pos]
+            pos += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                break
+        op, n = value & 0x03, value >> 2
+        if op == DELTA_OP_SEEK:
+            src_pos += n // 2 if n % 2 == 0 else -(n + 1) // 2
+            if not 0 <= src_pos <= len(source):
+                raise ValueError("SEEK fuori dalla sorgente")
+            continue
+        if op in (DELTA_OP_COPY, DELTA_OP_DIFF) and src_pos + n > len(source):
+            raise ValueError("operazione oltre la sorgente")
+        if op == DELTA_OP_COPY:
+            out.extend(source[src_pos:src_pos + n])
+            src_pos += n
+        elif op == DELTA_OP_DIFF:
+            out.extend((o + d) & 0xFF for o, d in zip(source[src_pos:src_pos + n], patch[pos:pos + n]))
+            src_pos += n
+            pos += n
+        else:
+            out.extend(patch[pos:pos + n])
+            pos += n
+    return bytes(out)
+
+
+def parse_ack(data: bytes) -> Optional[tuple]:
+    """(type, window, next_seq, offset) oppure None se la notify è troncata"""
+    if len(data) < OTA_ACK_STRUCT.size:
+        return None
+    return OTA_ACK_STRUCT.unpack_from(data)
+
+
+class WindowedSender:
+    """
+    Mittente go-back-N indipendente dal trasporto.
+
+    Il chiamante:
+    1. invia i pacchetti restituiti da next_packets() (write without response)
+    2. passa ogni notify OTA_ACK a on_ack()
+    3. chiama on_timeout() se non arrivano ACK per un po' (ACK/chunk persi a fine finestra)
+    fino a done == True.
+    """
+
+    def __init__(self, data: bytes, chunk_size: int, window: int = OTA_WINDOW_DEFAULT):
+        payload = chunk_size - OTA_SEQ_HEADER_SIZE
+        if payload <= 0:
+            raise ValueError("chunk_size troppo piccolo")
+        self.data = data
+        self.payload_size = payload
+        self.total_chunks = (len(data) + payload - 1) // payload
+        self.window = max(1, window)
+
+        self.base = 0           # Primo chunk non confermato (indice assoluto)
+        self.next = 0           # Prossimo chunk da inviare
+        self.acked_bytes = 0
+
+        self.sent_packets = 0
+        self.retransmits = 0
+        self.nacks = 0
+        self.timeouts = 0
+
+    @property
+    def done(self) -> bool:
+        return self.base >= self.total_chunks
+
+    def packet(self, index: int) -> bytes:
+        offset = index * self.payload_size
+        chunk = self.data[offset:offset + self.payload_size]
+        return struct.pack('<H', index & 0xFFFF) + chunk
+
+    def next_packets(self) -> List[bytes]:
+        """Pacchetti inviabili ora senza superare la finestra"""
+        packets = []
+        while self.next < self.total_chunks and self.next - self.base < self.window:
+            packets.append(self.packet(self.next))
+            self.next += 1
+        self.sent_packets += len(packets)
+        return packets
+
+    def _unwrap(self, seq16: int) -> int:
+        # seq a 16 bit -> indice assoluto più vicino a base
+        delta = (seq16 - (self.base & 0xFFFF)) & 0xFFFF
+        if delta >= 0x8000:
+            delta -= 0x10000
+        return self.base + delta
+
+    def on_ack(self, data: bytes) -> None:
+        parsed = parse_ack(data)
+        if parsed is None:
+            return
+        ack_type, window, next_seq, offset = parsed
+        if window > 0:
+            self.window = min(self.window, window)
+
+        index = self._unwrap(next_seq)
+        if ack_type == OTA_ACK_TYPE_ACK:
+            if self.base < index <= self.total_chunks:
+                self.base = index
+                self.acked_bytes = offset
+                if self.next < self.base:
+                    self.next = self.base
+        elif ack_type == OTA_ACK_TYPE_NACK:
+            self.nacks += 1
+            if self.base <= index < self.next:
+                self.retransmits += self.next - index
+                self.next = index
+
+    def on_timeout(self) -> None:
+        """Nessun ACK: ritrasmette dal primo chunk non confermato"""
+        if self.done:
+            return
+        self.timeouts += 1
+        self.retransmits += self.next - self.base
+        self.next = self.base
@@ -1,4 +1,6 @@
 #include "BLECameraService.h"
+#include "EventDispatcher.h"
+#include "BinaryProtocol.h"
 
 BLECameraService::BLECameraService(CameraManager* cameraManager)
     : _camera(cameraManager)
@@ -7,6 +9,7 @@ BLECameraService::BLECameraService(CameraManager* cameraManager)
     , _pCharControl(nullptr)
     , _pCharMetrics(nullptr)
     , _pCharFlash(nullptr)
+    , _pCharBinary(nullptr)
     , _statusNotifyEnabled(false)
     , _cameraActive(false)
 {
@@ -50,6 +53,13 @@ void BLECameraService::begin(BLEServer* pServer) {
     _pCharFlash->setCallbacks(new FlashCallbacks(this));
     _pCharFlash->setValue("{\"enabled\":false,\"brightness\":0}");
 
+    // Characteristic BINARY (Read + Notify) - metriche in TLV compatto
+    _pCharBinary = _pService->createCharacteristic(
+        CHAR_CAMERA_BINARY_UUID,
+        BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_NOTIFY
+    );
+    _pCharBinary->addDescriptor(new BLE2902());
+
     // Avvia servizio
     _pService->start();
 
@@ -69,6 +79,22 @@ void BLECameraService::notifyStatus() {
 void BLECameraService::updateMetrics() {
     String metricsJson = _getMetricsJson();
     _pCharMetrics->setValue(metricsJson.c_str());
+
+    const CameraManager::CameraMetrics metrics = _camera->getMetrics();
+    BinaryProtocol::CameraMetricsPayload payload;
+    payload.totalFrames = metrics.totalFramesCaptured;
+    payload.failedCaptures = metrics.failedCaptures;
+    payload.lastFrameSize = metrics.lastFrameSize;
+    payload.lastCaptureMs = metrics.lastCaptureTime;
+    payload.fpsX10 = (uint16_t)lroundf(metrics.currentFps * 10.0f);
+    payload.heapFreeKb = (uint16_t)min<uint32_t>(ESP.getFreeHeap() / 1024, 0xFFFF);
+    payload.psramFreeKb = (uint16_t)min<uint32_t>(ESP.getFreePsram() / 1024, 0xFFFF);
+    payload.active = _cameraActive ? 1 : 0;
+
+    uint8_t frame[BinaryProtocol::frameSize<BinaryProtocol::CameraMetricsPayload>()];
+    const size_t len = BinaryProtocol::encodeFrame(frame, sizeof(frame), BinaryProtocol::TYPE_CAMERA_METRICS, payload);
+    _pCharBinary->setValue(frame, len);
+    _pCharBinary->notify();
 }
 
 void BLECameraService::setCameraActive(bool active) {
@@ -79,6 +105,9 @@ void BLECameraService::setCameraActive(bool active) {
     _cameraActive = active;
     Serial.printf("[CAM BLE] Continuous capture %s\n", active ? "started" : "stopped");
     notifyStatus();
+
+    // Il loop principale avvia/ferma il task camera al prossimo risveglio
+    EventDispatcher::getInstance().post(EventDispatcher::EVENT_BLE_WRITE);
 }
 
 String BLECameraService::_getStatusJson() {
@@ -208,6 +237,7 @@ void BLECameraService::FlashCallbacks::onWrite(BLECharacteristic* pCharacteristi
                   enabled ? "ON" : "OFF", brightness);
 
     _service->_camera->setFlash(enabled, brightness);
+    EventDispatcher::getInstance().post(EventDispatcher::EVENT_BLE_WRITE);
 
     // Aggiorna characteristic con nuovo stato
     String response;
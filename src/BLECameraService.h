@@ -15,6 +15,7 @@
 #define CHAR_CAMERA_CONTROL_UUID   "7dc5a4c3-eb10-4a3e-8a4c-1234567890ab"
 #define CHAR_CAMERA_METRICS_UUID   "8ef6b5d4-fc21-5b4f-9b5d-2345678901bc"
 #define CHAR_CAMERA_FLASH_UUID     "9fe7c6e5-0d32-4c5a-ac6e-3456789012cd"
+#define CHAR_CAMERA_BINARY_UUID    "a0f8d7f6-1e43-4d6b-bd7f-4567890123de"
 
 /**
  * @brief Servizio BLE per testare e controllare la camera ESP32-CAM
@@ -24,6 +25,7 @@
  * - CONTROL (Write): Comandi (init, capture, stop, reset_metrics)
  * - METRICS (Read): Metriche dettagliate (fps, frame count, memoria)
  * - FLASH (Read/Write): Controllo flash LED
+ * - BINARY (Read, Notify): Metriche in TLV binario (BinaryProtocol.h)
  */
 class BLECameraService {
 public:
@@ -62,6 +64,7 @@ private:
     BLECharacteristic* _pCharControl;
     BLECharacteristic* _pCharMetrics;
     BLECharacteristic* _pCharFlash;
+    BLECharacteristic* _pCharBinary;
 
     bool _statusNotifyEnabled;
     bool _cameraActive;
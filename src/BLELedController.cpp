@@ -1,5 +1,12 @@
 #include "BLELedController.h"
 #include "LedEffectEngine.h"
+#include "EventDispatcher.h"
+#include "PowerManager.h"
+#include "ResourceMonitor.h"
+#include "BootTimeline.h"
+#include "BinaryProtocol.h"
+#include "LedStateStore.h"
+#include "LedMirrorStream.h"
 #include <esp_system.h>
 
 // Callback scrittura colore
@@ -15,6 +22,7 @@ public:
         DeserializationError error = deserializeJson(doc, value);
 
         if (!error) {
+            LedStateStore::Transaction tx;
             controller->ledState->r = doc["r"] | controller->ledState->r;
             controller->ledState->g = doc["g"] | controller->ledState->g;
             controller->ledState->b = doc["b"] | controller->ledState->b;
@@ -44,6 +52,7 @@ public:
         DeserializationError error = deserializeJson(doc, value);
 
         if (!error) {
+            LedStateStore::Transaction tx;
             bool updated = false;
             if (!doc["mode"].isNull()) {
                 controller->ledState->effect = doc["mode"].as<String>();
@@ -101,6 +110,7 @@ public:
         DeserializationError error = deserializeJson(doc, value);
 
         if (!error) {
+            LedStateStore::Transaction tx;
             uint8_t requestedBrightness = doc["brightness"] | 255;
             // IMPORTANTE: FastLED gestisce la potenza (5V 4500mA), permettiamo range completo 0-255
             static constexpr uint8_t MAX_SAFE_BRIGHTNESS = 255;
@@ -134,6 +144,7 @@ public:
         DeserializationError error = deserializeJson(doc, value);
 
         if (!error) {
+            LedStateStore::Transaction tx;
             bool updated = false;
 
             if (!doc["enabled"].isNull()) {
@@ -180,6 +191,7 @@ public:
         DeserializationError error = deserializeJson(doc, value);
 
         if (!error) {
+            LedStateStore::Transaction tx;
             uint8_t requestedFoldPoint = doc["foldPoint"] | controller->ledState->foldPoint;
 
             // Validazione: deve essere tra 1 e 143 (NUM_LEDS-1)
@@ -218,6 +230,7 @@ public:
         DeserializationError error = deserializeJson(doc, value);
 
         if (!error) {
+            LedStateStore::Transaction tx;
             uint32_t receivedEpoch = doc["epoch"] | 0;
             Serial.printf("[BLE TIME SYNC] Parsed epoch: %lu\n", receivedEpoch);
 
@@ -258,6 +271,7 @@ public:
                     Serial.println("[BLE ERROR] EffectEngine not set!");
                 }
             } else if (command == "boot_config") {
+                LedStateStore::Transaction tx;
                 bool updated = false;
 
                 if (!doc["autoIgnitionOnBoot"].isNull()) {
@@ -276,6 +290,23 @@ public:
                     updated = true;
                 }
 
+                if (!doc["sentryEnabled"].isNull()) {
+                    controller->ledState->sentryModeEnabled = doc["sentryEnabled"];
+                    updated = true;
+                }
+
+                if (!doc["sentryIntervalSec"].isNull()) {
+                    const uint16_t intervalSec = doc["sentryIntervalSec"] | controller->ledState->sentryIntervalSec;
+                    controller->ledState->sentryIntervalSec = constrain(intervalSec, 2, 3600);
+                    updated = true;
+                }
+
+                if (!doc["sentryThresholdPct"].isNull()) {
+                    const uint8_t thresholdPct = doc["sentryThresholdPct"] | controller->ledState->sentryThresholdPct;
+                    controller->ledState->sentryThresholdPct = constrain(thresholdPct, 1, 100);
+                    updated = true;
+                }
+
                 if (updated) {
                     controller->setConfigDirty(true);
                     Serial.printf("[BLE] Boot config updated: autoIgnitionOnBoot=%d, autoIgnitionDelayMs=%lu\n",
@@ -311,6 +342,9 @@ public:
             } else {
                 Serial.printf("[BLE ERROR] Unknown device control command: %s\n", command.c_str());
             }
+
+            // Sveglia il loop: ignition/retract devono partire subito anche col tick lento
+            EventDispatcher::getInstance().post(EventDispatcher::EVENT_BLE_WRITE);
         } else {
             Serial.printf("[BLE ERROR] Invalid JSON for device control: %s\n", error.c_str());
         }
@@ -335,6 +369,186 @@ public:
     }
 };
 
+// Callback Power (READ only) - profilo DFS/light sleep e residenza
+class PowerCallbacks: public BLECharacteristicCallbacks {
+    BLELedController* controller;
+public:
+    explicit PowerCallbacks(BLELedController* ctrl) : controller(ctrl) {}
+
+    void onRead(BLECharacteristic *pChar) override {
+        PowerManager& power = PowerManager::getInstance();
+        const uint32_t now = millis();
+
+        JsonDocument doc;
+        doc["profile"] = PowerManager::profileToString(power.getProfile());
+        doc["cpuMhz"] = power.getMaxFreqMhz();
+        doc["lightSleep"] = power.isLightSleepActive();
+        doc["pm"] = power.isPmSupported();
+        doc["switches"] = power.getSwitchCount();
+
+        JsonObject residency = doc["residencyMs"].to<JsonObject>();
+        for (uint8_t i = 0; i < PowerManager::PROFILE_COUNT; i++) {
+            const PowerManager::Profile profile = static_cast<PowerManager::Profile>(i);
+            residency[PowerManager::profileToString(profile)] = power.getResidencyMs(profile, now);
+        }
+
+        String jsonString;
+        serializeJson(doc, jsonString);
+        pChar->setValue(jsonString.c_str());
+    }
+};
+
+// Callback Diagnostics (READ only) - stack watermark task + heap DRAM/PSRAM
+class DiagnosticsCallbacks: public BLECharacteristicCallbacks {
+    BLELedController* controller;
+public:
+    explicit DiagnosticsCallbacks(BLELedController* ctrl) : controller(ctrl) {}
+
+    void onRead(BLECharacteristic *pChar) override {
+        JsonDocument doc;
+        ResourceMonitor::getInstance().toJson(doc);
+        doc["boot"] = BootTimeline::getFirstLitMs();
+
+        String jsonString;
+        serializeJson(doc, jsonString);
+        pChar->setValue(jsonString.c_str());
+    }
+};
+
+// Callback Binary (WRITE + READ + NOTIFY) - protocollo TLV, vedi BinaryProtocol.h
+// Stessa semantica delle characteristic JSON, senza JsonDocument né String.
+class BinaryCallbacks: public BLECharacteristicCallbacks {
+    BLELedController* controller;
+public:
+    explicit BinaryCallbacks(BLELedController* ctrl) : controller(ctrl) {}
+
+    void onWrite(BLECharacteristic *pChar) override {
+        BinaryProtocol::Reader reader(pChar->getData(), pChar->getLength());
+        if (!reader.isValid()) {
+            Serial.printf("[BLE ERROR] Binary frame rejected (version %u)\n", reader.getVersion());
+            return;
+        }
+
+        // Staging su una copia: il frame è applicato tutto o niente
+        LedStateStore::Transaction tx;
+        LedState staged = tx.state();
+        uint8_t applied = 0;
+        if (!controller->applyBinaryFrame(pChar->getData(), pChar->getLength(), staged, applied)) {
+            Serial.println("[BLE ERROR] Binary frame rejected (invalid value)");
+            return;
+        }
+
+        if (applied > 0) {
+            tx.state() = staged;
+            controller->setConfigDirty(true);
+        }
+    }
+
+    void onRead(BLECharacteristic *pChar) override {
+        uint8_t frame[BinaryProtocol::frameSize<BinaryProtocol::LedStatusPayload>()];
+        const size_t len = controller->encodeBinaryState(frame, sizeof(frame), controller->getBladeState());
+        pChar->setValue(frame, len);
+    }
+};
+
+// Callback Transaction (WRITE + READ) - più campi LedState in una sola write
+// Payload JSON (primo byte '{') o frame TLV binario. I campi sono validati su
+// una copia e applicati insieme: un solo publish verso il renderer (nessuno
+// stato intermedio a schermo), un solo configDirty, una sola notify di stato.
+class TransactionCallbacks: public BLECharacteristicCallbacks {
+    BLELedController* controller;
+public:
+    explicit TransactionCallbacks(BLELedController* ctrl) : controller(ctrl) {}
+
+    void onWrite(BLECharacteristic *pChar) override {
+        const uint8_t* data = pChar->getData();
+        const size_t len = pChar->getLength();
+        if (len == 0) {
+            return;
+        }
+
+        uint32_t txId = 0;
+        uint8_t applied = 0;
+        bool ok = false;
+        {
+            LedStateStore::Transaction tx;
+            LedState staged = tx.state();
+
+            if (data[0] == '{') {
+                JsonDocument doc;
+                DeserializationError error = deserializeJson(doc, reinterpret_cast<const char*>(data), len);
+                if (!error) {
+                    txId = doc["id"] | 0;
+                    ok = controller->applyJsonFields(doc.as<JsonVariantConst>(), staged, applied);
+                } else {
+                    Serial.printf("[BLE ERROR] Invalid JSON for transaction: %s\n", error.c_str());
+                }
+            } else {
+                ok = controller->applyBinaryFrame(data, len, staged, applied);
+            }
+
+            if (ok && applied > 0) {
+                tx.state() = staged;
+                controller->setConfigDirty(true);
+            }
+        }
+
+        controller->lastTxId = txId;
+        controller->lastTxApplied = ok ? applied : 0;
+        controller->lastTxOk = ok;
+
+        if (ok) {
+            Serial.printf("[BLE] Transaction %lu applied: %u fields (v%lu)\n",
+                txId, applied, LedStateStore::getInstance().getVersion());
+        } else {
+            Serial.printf("[BLE ERROR] Transaction %lu rejected, state unchanged\n", txId);
+        }
+    }
+
+    void onRead(BLECharacteristic *pChar) override {
+        JsonDocument doc;
+        doc["id"] = controller->lastTxId;
+        doc["ok"] = controller->lastTxOk;
+        doc["applied"] = controller->lastTxApplied;
+        doc["v"] = LedStateStore::getInstance().getVersion();
+
+        String jsonString;
+        serializeJson(doc, jsonString);
+        pChar->setValue(jsonString.c_str());
+    }
+};
+
+// Callback Mirror (WRITE + READ + NOTIFY) - stream framebuffer, vedi LedMirrorStream.h
+class MirrorCallbacks: public BLECharacteristicCallbacks {
+    BLELedController* controller;
+public:
+    explicit MirrorCallbacks(BLELedController* ctrl) : controller(ctrl) {}
+
+    void onWrite(BLECharacteristic *pChar) override {
+        String value = pChar->getValue().c_str();
+
+        JsonDocument doc;
+        DeserializationError error = deserializeJson(doc, value);
+
+        if (!error) {
+            if (!LedMirrorStream::getInstance().configure(doc.as<JsonVariantConst>())) {
+                Serial.println("[BLE] Mirror config received but no fields provided");
+            }
+        } else {
+            Serial.printf("[BLE ERROR] Invalid JSON for mirror: %s\n", error.c_str());
+        }
+    }
+
+    void onRead(BLECharacteristic *pChar) override {
+        JsonDocument doc;
+        LedMirrorStream::getInstance().toJson(doc);
+
+        String jsonString;
+        serializeJson(doc, jsonString);
+        pChar->setValue(jsonString.c_str());
+    }
+};
+
 // Costruttore
 BLELedController::BLELedController(LedState* state) {
     ledState = state;
@@ -350,18 +564,27 @@ BLELedController::BLELedController(LedState* state) {
     pCharTimeSync = nullptr;
     pCharDeviceControl = nullptr;
     pCharEffectsList = nullptr;
+    pCharPower = nullptr;
+    pCharDiagnostics = nullptr;
+    pCharBinary = nullptr;
+    pCharTransaction = nullptr;
+    pCharMirror = nullptr;
     effectEngine = nullptr;
     lastNotifiedBladeState = "";
     lastNotifyMs = 0;
+    lastNotifiedVersion = 0;
     hasNotified = false;
     effectsListPage = 0;
+    lastTxId = 0;
+    lastTxApplied = 0;
+    lastTxOk = true;
 }
 
 // Inizializzazione BLE
 void BLELedController::begin(BLEServer* server) {
     pServer = server;
 
-    // Crea service con handles sufficienti (10 char * 4 handles ciascuna = 40, +10 margine)
+    // Crea service con handles sufficienti (14 char: ~46 handle usati su 50)
     BLEService *pService = pServer->createService(BLEUUID(LED_SERVICE_UUID), 50);
 
     auto logCreate = [](const char* name, const char* uuid, BLECharacteristic* chr) {
@@ -477,6 +700,72 @@ void BLELedController::begin(BLEServer* server) {
     descEffectsList->setValue("Effects List");
     pCharEffectsList->addDescriptor(descEffectsList);
 
+    // Characteristic 10: Power (READ) - profilo energetico corrente e residenza
+    pCharPower = pService->createCharacteristic(
+        CHAR_POWER_UUID,
+        BLECharacteristic::PROPERTY_READ
+    );
+    logCreate("Power", CHAR_POWER_UUID, pCharPower);
+    pCharPower->setCallbacks(new PowerCallbacks(this));
+    BLEDescriptor* descPower = new BLEDescriptor(BLEUUID((uint16_t)0x2901));
+    descPower->setValue("Power Profile");
+    pCharPower->addDescriptor(descPower);
+
+    // Characteristic 11: Diagnostics (READ) - risorse task/heap
+    pCharDiagnostics = pService->createCharacteristic(
+        CHAR_DIAGNOSTICS_UUID,
+        BLECharacteristic::PROPERTY_READ
+    );
+    logCreate("Diagnostics", CHAR_DIAGNOSTICS_UUID, pCharDiagnostics);
+    pCharDiagnostics->setCallbacks(new DiagnosticsCallbacks(this));
+    BLEDescriptor* descDiagnostics = new BLEDescriptor(BLEUUID((uint16_t)0x2901));
+    descDiagnostics->setValue("Diagnostics");
+    pCharDiagnostics->addDescriptor(descDiagnostics);
+
+    // Characteristic 12: Binary (WRITE + READ + NOTIFY) - protocollo TLV compatto
+    pCharBinary = pService->createCharacteristic(
+        CHAR_LED_BINARY_UUID,
+        BLECharacteristic::PROPERTY_READ |
+        BLECharacteristic::PROPERTY_WRITE |
+        BLECharacteristic::PROPERTY_WRITE_NR |
+        BLECharacteristic::PROPERTY_NOTIFY
+    );
+    logCreate("Binary", CHAR_LED_BINARY_UUID, pCharBinary);
+    pCharBinary->setCallbacks(new BinaryCallbacks(this));
+    pCharBinary->addDescriptor(new BLE2902());
+    BLEDescriptor* descBinary = new BLEDescriptor(BLEUUID((uint16_t)0x2901));
+    descBinary->setValue("LED Binary TLV");
+    pCharBinary->addDescriptor(descBinary);
+
+    // Characteristic 13: Transaction (WRITE + READ) - preset in una sola write
+    pCharTransaction = pService->createCharacteristic(
+        CHAR_LED_TRANSACTION_UUID,
+        BLECharacteristic::PROPERTY_READ |
+        BLECharacteristic::PROPERTY_WRITE |
+        BLECharacteristic::PROPERTY_WRITE_NR
+    );
+    logCreate("Transaction", CHAR_LED_TRANSACTION_UUID, pCharTransaction);
+    pCharTransaction->setCallbacks(new TransactionCallbacks(this));
+    BLEDescriptor* descTransaction = new BLEDescriptor(BLEUUID((uint16_t)0x2901));
+    descTransaction->setValue("LED Transaction");
+    pCharTransaction->addDescriptor(descTransaction);
+
+    // Characteristic 14: Mirror (WRITE + READ + NOTIFY) - framebuffer lama per debug remoto
+    pCharMirror = pService->createCharacteristic(
+        CHAR_LED_MIRROR_UUID,
+        BLECharacteristic::PROPERTY_READ |
+        BLECharacteristic::PROPERTY_WRITE |
+        BLECharacteristic::PROPERTY_NOTIFY
+    );
+    logCreate("Mirror", CHAR_LED_MIRROR_UUID, pCharMirror);
+    pCharMirror->setCallbacks(new MirrorCallbacks(this));
+    BLE2902* mirrorCccd = new BLE2902();
+    pCharMirror->addDescriptor(mirrorCccd);
+    BLEDescriptor* descMirror = new BLEDescriptor(BLEUUID((uint16_t)0x2901));
+    descMirror->setValue("LED Mirror");
+    pCharMirror->addDescriptor(descMirror);
+    LedMirrorStream::getInstance().begin(pCharMirror, mirrorCccd);
+
     // Avvia service
     pService->start();
 
@@ -491,8 +780,13 @@ void BLELedController::begin(BLEServer* server) {
     Serial.printf("  Time:           %s\n", CHAR_TIME_SYNC_UUID);
     Serial.printf("  DeviceControl:  %s\n", CHAR_DEVICE_CONTROL_UUID);
     Serial.printf("  EffectsList:    %s\n", CHAR_EFFECTS_LIST_UUID);
+    Serial.printf("  Power:          %s\n", CHAR_POWER_UUID);
+    Serial.printf("  Diagnostics:    %s\n", CHAR_DIAGNOSTICS_UUID);
+    Serial.printf("  Binary:         %s\n", CHAR_LED_BINARY_UUID);
+    Serial.printf("  Transaction:    %s\n", CHAR_LED_TRANSACTION_UUID);
+    Serial.printf("  Mirror:         %s\n", CHAR_LED_MIRROR_UUID);
 
-    Serial.println("[BLE OK] LED Service initialized with 9 characteristics!");
+    Serial.println("[BLE OK] LED Service initialized with 14 characteristics!");
 }
 
 String BLELedController::getBladeState() const {
@@ -517,6 +811,10 @@ void BLELedController::sendState(const String& bladeState, unsigned long nowMs)
 
     Serial.printf("[BLE] State notify: bladeState=%s\n", bladeState.c_str());
 
+    // Lock sul master: effect/gestureClashEffect sono String scritte dal task BLE
+    LedStateStore::Transaction tx;
+    lastNotifiedVersion = LedStateStore::getInstance().getVersion();
+
     JsonDocument doc;
     doc["r"] = ledState->r;
     doc["g"] = ledState->g;
@@ -533,6 +831,7 @@ void BLELedController::sendState(const String& bladeState, unsigned long nowMs)
     doc["autoIgnitionOnBoot"] = ledState->autoIgnitionOnBoot;
     doc["autoIgnitionDelayMs"] = ledState->autoIgnitionDelayMs;
     doc["motionEnabled"] = ledState->motionOnBoot;
+    doc["sentryEnabled"] = ledState->sentryModeEnabled;
     doc["gestureClashEffect"] = ledState->gestureClashEffect;
     doc["gestureClashDurationMs"] = ledState->gestureClashDurationMs;
 
@@ -542,11 +841,177 @@ void BLELedController::sendState(const String& bladeState, unsigned long nowMs)
     pCharState->setValue(jsonString.c_str());
     pCharState->notify();
 
+    // Stesso stato in formato binario (notify ignorata se il client non è iscritto)
+    uint8_t frame[BinaryProtocol::frameSize<BinaryProtocol::LedStatusPayload>()];
+    const size_t frameLen = encodeBinaryState(frame, sizeof(frame), bladeState);
+    pCharBinary->setValue(frame, frameLen);
+    pCharBinary->notify();
+
     lastNotifiedBladeState = bladeState;
     lastNotifyMs = nowMs;
     hasNotified = true;
 }
 
+size_t BLELedController::encodeBinaryState(uint8_t* out, size_t capacity, const String& bladeState) const {
+    BinaryProtocol::LedStatusPayload status;
+    status.r = ledState->r;
+    status.g = ledState->g;
+    status.b = ledState->b;
+    status.brightness = ledState->brightness;
+    status.effectId = (uint8_t)effectIdFromName(ledState->effect.c_str());
+    status.speed = ledState->speed;
+    status.flags = (ledState->enabled ? BinaryProtocol::LED_FLAG_ENABLED : 0) |
+                   (ledState->bladeEnabled ? BinaryProtocol::LED_FLAG_BLADE_ON : 0) |
+                   (ledState->statusLedEnabled ? BinaryProtocol::LED_FLAG_STATUS_LED : 0) |
+                   (ledState->motionOnBoot ? BinaryProtocol::LED_FLAG_MOTION : 0) |
+                   (ledState->sentryModeEnabled ? BinaryProtocol::LED_FLAG_SENTRY : 0);
+    if (bladeState == "igniting") {
+        status.bladeState = BinaryProtocol::BLADE_IGNITING;
+    } else if (bladeState == "retracting") {
+        status.bladeState = BinaryProtocol::BLADE_RETRACTING;
+    } else if (bladeState == "on") {
+        status.bladeState = BinaryProtocol::BLADE_ON;
+    } else {
+        status.bladeState = BinaryProtocol::BLADE_OFF;
+    }
+    status.statusLedBrightness = ledState->statusLedBrightness;
+    status.foldPoint = ledState->foldPoint;
+
+    return BinaryProtocol::encodeFrame(out, capacity, BinaryProtocol::TYPE_LED_STATUS, status);
+}
+
+bool BLELedController::applyBinaryFrame(const uint8_t* data, size_t len, LedState& target, uint8_t& applied) const {
+    BinaryProtocol::Reader reader(data, len);
+    if (!reader.isValid()) {
+        return false;
+    }
+
+    BinaryProtocol::Tlv tlv;
+    while (reader.next(tlv)) {
+        switch (tlv.type) {
+            case BinaryProtocol::TYPE_COLOR: {
+                BinaryProtocol::ColorPayload p;
+                if (!BinaryProtocol::readPayload(tlv, p)) return false;
+                target.r = p.r;
+                target.g = p.g;
+                target.b = p.b;
+                applied++;
+                break;
+            }
+            case BinaryProtocol::TYPE_EFFECT: {
+                BinaryProtocol::EffectPayload p;
+                if (!BinaryProtocol::readPayload(tlv, p)) return false;
+                const char* name = effectIdToName(static_cast<EffectId>(p.effectId));
+                if (name == nullptr) return false;
+                target.effect = name;
+                target.speed = p.speed;
+                applied++;
+                break;
+            }
+            case BinaryProtocol::TYPE_BRIGHTNESS: {
+                BinaryProtocol::BrightnessPayload p;
+                if (!BinaryProtocol::readPayload(tlv, p)) return false;
+                target.brightness = p.brightness;
+                target.enabled = p.enabled != 0;
+                applied++;
+                break;
+            }
+            case BinaryProtocol::TYPE_STATUS_LED: {
+                BinaryProtocol::StatusLedPayload p;
+                if (!BinaryProtocol::readPayload(tlv, p)) return false;
+                target.statusLedEnabled = p.enabled != 0;
+                target.statusLedBrightness = p.brightness;
+                applied++;
+                break;
+            }
+            case BinaryProtocol::TYPE_FOLD_POINT: {
+                BinaryProtocol::FoldPointPayload p;
+                if (!BinaryProtocol::readPayload(tlv, p)) return false;
+                if (p.foldPoint < 1 || p.foldPoint >= 144) return false;
+                target.foldPoint = p.foldPoint;
+                applied++;
+                break;
+            }
+            default:
+                // Tipo sconosciuto o destinato a un altro servizio: ignorato
+                break;
+        }
+    }
+    return true;
+}
+
+bool BLELedController::applyJsonFields(JsonVariantConst fields, LedState& target, uint8_t& applied) const {
+    if (!fields.is<JsonObjectConst>()) {
+        return false;
+    }
+
+    // Validazione prima di toccare target: un campo errato invalida la transazione
+    const char* effect = fields["effect"].as<const char*>();
+    if (effect == nullptr) {
+        effect = fields["mode"].as<const char*>();  // Stessa chiave della characteristic Effect
+    }
+    if (effect != nullptr && effectIdFromName(effect) == EffectId::UNKNOWN) {
+        Serial.printf("[BLE ERROR] Transaction: unknown effect '%s'\n", effect);
+        return false;
+    }
+    const char* clashEffect = fields["gestureClashEffect"].as<const char*>();
+    if (clashEffect != nullptr && clashEffect[0] != '\0' && effectIdFromName(clashEffect) == EffectId::UNKNOWN) {
+        Serial.printf("[BLE ERROR] Transaction: unknown clash effect '%s'\n", clashEffect);
+        return false;
+    }
+    if (!fields["foldPoint"].isNull()) {
+        const int foldPoint = fields["foldPoint"] | 0;
+        if (foldPoint < 1 || foldPoint >= 144) {
+            Serial.printf("[BLE ERROR] Transaction: invalid fold point %d (must be 1-143)\n", foldPoint);
+            return false;
+        }
+    }
+
+    auto setU8 = [&](const char* key, uint8_t& field) {
+        if (!fields[key].isNull()) {
+            field = (uint8_t)constrain((int)(fields[key] | 0), 0, 255);
+            applied++;
+        }
+    };
+    auto setBool = [&](const char* key, bool& field) {
+        if (!fields[key].isNull()) {
+            field = fields[key] | field;
+            applied++;
+        }
+    };
+
+    setU8("r", target.r);
+    setU8("g", target.g);
+    setU8("b", target.b);
+    setU8("brightness", target.brightness);
+    setBool("enabled", target.enabled);
+    if (effect != nullptr) {
+        target.effect = effect;
+        applied++;
+    }
+    setU8("speed", target.speed);
+    setBool("statusLedEnabled", target.statusLedEnabled);
+    setU8("statusLedBrightness", target.statusLedBrightness);
+    setU8("foldPoint", target.foldPoint);
+    setU8("chronoHourTheme", target.chronoHourTheme);
+    setU8("chronoSecondTheme", target.chronoSecondTheme);
+    setBool("chronoWellnessMode", target.chronoWellnessMode);
+    if (!fields["breathingRate"].isNull()) {
+        target.breathingRate = (uint8_t)constrain((int)(fields["breathingRate"] | 5), 2, 8);
+        applied++;
+    }
+    if (clashEffect != nullptr) {
+        target.gestureClashEffect = clashEffect;
+        applied++;
+    }
+    if (!fields["gestureClashDurationMs"].isNull()) {
+        const int duration = fields["gestureClashDurationMs"] | 500;
+        target.gestureClashDurationMs = (uint16_t)constrain(duration, 50, 5000);
+        applied++;
+    }
+    return true;
+}
+
 // Notifica stato LED ai client connessi
 void BLELedController::notifyState() {
     sendState(getBladeState(), millis());
@@ -558,7 +1023,10 @@ void BLELedController::notifyStateIfNeeded(unsigned long nowMs, unsigned long he
     String bladeState = getBladeState();
     const bool bladeStateChanged = !hasNotified || bladeState != lastNotifiedBladeState;
     const bool heartbeatDue = heartbeatMs > 0 && (!hasNotified || (nowMs - lastNotifyMs >= heartbeatMs));
-    if (!bladeStateChanged && !heartbeatDue) return;
+    // Cambi di stato (colore, effetto, ...) coalescenti: al massimo una notify ogni 100ms
+    const bool stateChanged = LedStateStore::getInstance().getVersion() != lastNotifiedVersion &&
+                              (nowMs - lastNotifyMs >= 100);
+    if (!bladeStateChanged && !heartbeatDue && !stateChanged) return;
 
     sendState(bladeState, nowMs);
 }
@@ -569,15 +1037,23 @@ bool BLELedController::isConnected() {
 
 void BLELedController::setConnected(bool connected) {
     deviceConnected = connected;
+    LedMirrorStream::getInstance().setConnected(connected);
     if (!connected) {
         lastNotifiedBladeState = "";
         lastNotifyMs = 0;
+        lastNotifiedVersion = 0;
         hasNotified = false;
     }
 }
 
 void BLELedController::setConfigDirty(bool dirty) {
     configDirty = dirty;
+    if (dirty) {
+        // Ogni modifica di config arriva da una scrittura BLE: il loop deve
+        // ridisegnare subito e programmare il salvataggio ritardato
+        EventDispatcher::getInstance().post(
+            EventDispatcher::EVENT_CONFIG_DIRTY | EventDispatcher::EVENT_BLE_WRITE);
+    }
 }
 
 bool BLELedController::isConfigDirty() {
@@ -1,8 +1,17 @@
 #include "BLEMotionService.h"
 #include "BLELedController.h"
+#include <esp_heap_caps.h>
 
 extern BLELedController bleController;
 
+static portMUX_TYPE gRecordMux = portMUX_INITIALIZER_UNLOCKED;
+
+static_assert(BinaryProtocol::TELEMETRY_GRID == OpticalFlowDetector::GRID_ROWS &&
+              BinaryProtocol::TELEMETRY_GRID == OpticalFlowDetector::GRID_COLS,
+              "Telemetry grid must match the optical flow grid");
+static_assert(GestureStateMachine::SLOT_COUNT * 2 <= sizeof(BinaryProtocol::MotionTelemetryPayload::gestureStates) * 8,
+              "Telemetry gesture states must cover every slot");
+
 BLEMotionService::BLEMotionService(OpticalFlowDetector* motionDetector, MotionProcessor* motionProcessor)
     : _motion(motionDetector)
     , _processor(motionProcessor)
@@ -11,6 +20,23 @@ BLEMotionService::BLEMotionService(OpticalFlowDetector* motionDetector, MotionPr
     , _pCharControl(nullptr)
     , _pCharEvents(nullptr)
     , _pCharConfig(nullptr)
+    , _pCharBinary(nullptr)
+    , _pBinaryCccd(nullptr)
+    , _pCharTelemetry(nullptr)
+    , _pTelemetryCccd(nullptr)
+    , _telemetryQueue(nullptr)
+    , _telemetrySeq(0)
+    , _telemetryDropped(0)
+    , _pCharRecord(nullptr)
+    , _pRecordCccd(nullptr)
+    , _recordRing(nullptr)
+    , _recordHead(0)
+    , _recordCount(0)
+    , _recordSeq(0)
+    , _recordDropped(0)
+    , _recording(false)
+    , _recordLabel(0)
+    , _recordNotifyFailed(false)
     , _statusNotifyEnabled(false)
     , _eventsNotifyEnabled(false)
     , _motionEnabled(false)
@@ -22,14 +48,16 @@ BLEMotionService::BLEMotionService(OpticalFlowDetector* motionDetector, MotionPr
     , _lastGestureTime(0)
     , _motionCandidateSince(0)
     , _stillCandidateSince(0)
+    , _lastEgo{}
+    , _lastCalibrationState(OpticalFlowDetector::CalibrationState::IDLE)
 {
 }
 
 void BLEMotionService::begin(BLEServer* pServer) {
     Serial.println("[MOTION BLE] Creating Motion Service...");
 
-    // Crea servizio
-    _pService = pServer->createService(MOTION_SERVICE_UUID);
+    // Crea servizio (7 characteristic + descrittori superano i 15 handle di default)
+    _pService = pServer->createService(BLEUUID(MOTION_SERVICE_UUID), 40);
 
     // Characteristic STATUS (Read + Notify)
     _pCharStatus = _pService->createCharacteristic(
@@ -66,6 +94,48 @@ void BLEMotionService::begin(BLEServer* pServer) {
     _pCharConfig->setCallbacks(new ConfigCallbacks(this));
     _pCharConfig->setValue(_getConfigJson().c_str());
 
+    // Characteristic BINARY (Read + Write + Notify) - TLV compatto
+    _pCharBinary = _pService->createCharacteristic(
+        CHAR_MOTION_BINARY_UUID,
+        BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_WRITE |
+        BLECharacteristic::PROPERTY_WRITE_NR | BLECharacteristic::PROPERTY_NOTIFY
+    );
+    _pBinaryCccd = new BLE2902();
+    _pCharBinary->addDescriptor(_pBinaryCccd);
+    BLEDescriptor* pBinaryName = new BLEDescriptor(BLEUUID((uint16_t)0x2901));
+    pBinaryName->setValue("Motion Binary TLV");
+    _pCharBinary->addDescriptor(pBinaryName);
+    _pCharBinary->setCallbacks(new BinaryCallbacks(this));
+
+    // Characteristic TELEMETRY (Notify) - un frame TLV per ogni frame elaborato
+    _pCharTelemetry = _pService->createCharacteristic(
+        CHAR_MOTION_TELEMETRY_UUID,
+        BLECharacteristic::PROPERTY_NOTIFY
+    );
+    _pTelemetryCccd = new BLE2902();
+    _pCharTelemetry->addDescriptor(_pTelemetryCccd);
+    BLEDescriptor* pTelemetryName = new BLEDescriptor(BLEUUID((uint16_t)0x2901));
+    pTelemetryName->setValue("Motion Telemetry");
+    _pCharTelemetry->addDescriptor(pTelemetryName);
+
+    // Characteristic RECORD (Notify) - record dataset, più TLV per notify
+    _pCharRecord = _pService->createCharacteristic(
+        CHAR_MOTION_RECORD_UUID,
+        BLECharacteristic::PROPERTY_NOTIFY
+    );
+    _pRecordCccd = new BLE2902();
+    _pCharRecord->addDescriptor(_pRecordCccd);
+    BLEDescriptor* pRecordName = new BLEDescriptor(BLEUUID((uint16_t)0x2901));
+    pRecordName->setValue("Motion Record");
+    _pCharRecord->addDescriptor(pRecordName);
+    _pCharRecord->setCallbacks(new RecordCallbacks(this));
+
+    _telemetryQueue = xQueueCreate(TELEMETRY_QUEUE_DEPTH,
+                                   BinaryProtocol::frameSize<BinaryProtocol::MotionTelemetryPayload>());
+    if (!_telemetryQueue) {
+        Serial.println("[MOTION BLE] ✗ Failed to create telemetry queue");
+    }
+
     // Avvia servizio
     _pService->start();
 
@@ -97,7 +167,300 @@ void BLEMotionService::notifyStatus() {
     _pCharStatus->notify();
 }
 
+bool BLEMotionService::_binaryNotifyEnabled() const {
+    return _pCharBinary != nullptr && _pBinaryCccd != nullptr && _pBinaryCccd->getNotifications();
+}
+
+void BLEMotionService::notifyBinaryStatus() {
+    if (!_binaryNotifyEnabled()) {
+        return;
+    }
+
+    const OpticalFlowDetector::Metrics metrics = _motion->getMetrics();
+    const unsigned long now = millis();
+
+    BinaryProtocol::MotionStatusPayload status;
+    status.frame = metrics.totalFramesProcessed;
+    status.timestampMs = now;
+    status.intensity = metrics.currentIntensity;
+    status.direction = (uint8_t)metrics.dominantDirection;
+    status.speedX10 = (uint8_t)constrain((int)lroundf(metrics.avgSpeed * 10.0f), 0, 255);
+    status.confidence = (uint8_t)constrain((int)lroundf(metrics.avgConfidence * 100.0f), 0, 100);
+    status.activeBlocks = metrics.avgActiveBlocks;
+    status.frameDiff = metrics.frameDiff;
+
+    static constexpr unsigned long GESTURE_TTL_MS = 700;
+    const bool gestureFresh = _lastGesture != MotionProcessor::GestureType::NONE &&
+                              (now - _lastGestureTime) <= GESTURE_TTL_MS;
+    status.gesture = gestureFresh ? (uint8_t)_lastGesture : 0;
+    status.gestureConfidence = gestureFresh ? _lastGestureConfidence : 0;
+
+    float centroidX = 0.0f;
+    float centroidY = 0.0f;
+    const bool centroidValid = _motion->getCentroid(&centroidX, &centroidY);
+    status.centroidX10 = centroidValid ? (uint16_t)lroundf(centroidX * 10.0f) : 0;
+    status.centroidY10 = centroidValid ? (uint16_t)lroundf(centroidY * 10.0f) : 0;
+
+    status.flags = (_motionEnabled ? BinaryProtocol::MOTION_FLAG_ENABLED : 0) |
+                   (_wasMotionActive ? BinaryProtocol::MOTION_FLAG_DETECTED : 0) |
+                   (centroidValid ? BinaryProtocol::MOTION_FLAG_CENTROID_VALID : 0);
+
+    uint8_t frame[BinaryProtocol::frameSize<BinaryProtocol::MotionStatusPayload>()];
+    const size_t len = BinaryProtocol::encodeFrame(frame, sizeof(frame), BinaryProtocol::TYPE_MOTION_STATUS, status);
+    _pCharBinary->setValue(frame, len);
+    _pCharBinary->notify();
+}
+
+bool BLEMotionService::isTelemetryEnabled() const {
+    return _telemetryQueue != nullptr && _pTelemetryCccd != nullptr && _pTelemetryCccd->getNotifications();
+}
+
+void BLEMotionService::captureTelemetry(const MotionProcessor::ProcessedMotion& processed,
+                                        OpticalFlowDetector::Direction direction,
+                                        bool motionDetected, uint32_t timestampMs, uint32_t processMs) {
+    if (!isTelemetryEnabled()) {
+        return;
+    }
+
+    BinaryProtocol::MotionTelemetryPayload t;
+    memset(&t, 0, sizeof(t));
+    t.seq = _telemetrySeq++;
+    t.timestampMs = timestampMs;
+    t.dropped = (uint8_t)min<uint32_t>(_telemetryDropped, 255);
+    t.processMs = (uint8_t)min<uint32_t>(processMs, 255);
+    t.intensity = processed.motionIntensity;
+    t.direction = (uint8_t)direction;
+    t.speedX10 = (uint8_t)constrain((int)lroundf(processed.speed * 10.0f), 0, 255);
+    t.gesture = (uint8_t)processed.gesture;
+    t.gestureConfidence = processed.gestureConfidence;
+
+    float centroidX = 0.0f;
+    float centroidY = 0.0f;
+    const bool centroidValid = _motion->getCentroidNormalized(&centroidX, &centroidY);
+    t.centroidX = centroidValid ? (uint8_t)constrain((int)lroundf(centroidX * 255.0f), 0, 255) : 0;
+    t.centroidY = centroidValid ? (uint8_t)constrain((int)lroundf(centroidY * 255.0f), 0, 255) : 0;
+    t.flags = (motionDetected ? BinaryProtocol::TELEMETRY_FLAG_MOTION : 0) |
+              (centroidValid ? BinaryProtocol::TELEMETRY_FLAG_CENTROID_VALID : 0);
+
+    for (uint8_t row = 0; row < OpticalFlowDetector::GRID_ROWS; row++) {
+        for (uint8_t col = 0; col < OpticalFlowDetector::GRID_COLS; col++) {
+            const uint8_t index = row * OpticalFlowDetector::GRID_COLS + col;
+            int8_t dx = 0;
+            int8_t dy = 0;
+            uint8_t confidence = 0;
+            const bool valid = _motion->getBlockVector(row, col, &dx, &dy, &confidence);
+            t.cells[index] = BinaryProtocol::packTelemetryCell(dx, dy, confidence, valid);
+            const uint8_t level = processed.perturbationGrid[row][col] >> 4;
+            t.perturbation[index >> 1] |= (index & 1) ? (uint8_t)(level << 4) : level;
+        }
+    }
+    for (uint8_t i = 0; i < sizeof(t.gestureStates); i++) {
+        t.gestureStates[i] = (uint8_t)(processed.gestureStates >> (i * 8));
+    }
+
+    uint8_t frame[BinaryProtocol::frameSize<BinaryProtocol::MotionTelemetryPayload>()];
+    BinaryProtocol::encodeFrame(frame, sizeof(frame), BinaryProtocol::TYPE_MOTION_TELEMETRY, t);
+    if (xQueueSend(_telemetryQueue, frame, 0) != pdTRUE) {
+        _telemetryDropped++;  // Loop in ritardo: il frame è perso, il seq lo segnala
+    }
+}
+
+void BLEMotionService::flushTelemetry() {
+    if (_telemetryQueue == nullptr) {
+        return;
+    }
+
+    uint8_t frame[BinaryProtocol::frameSize<BinaryProtocol::MotionTelemetryPayload>()];
+    while (xQueueReceive(_telemetryQueue, frame, 0) == pdTRUE) {
+        if (!isTelemetryEnabled()) {
+            continue;  // Client disiscritto: svuota la coda
+        }
+        _pCharTelemetry->setValue(frame, sizeof(frame));
+        _pCharTelemetry->notify();
+    }
+}
+
+bool BLEMotionService::_startRecording() {
+    // Il seq non riparte da 0: una sessione precedente può ancora essere in
+    // svuotamento dal ring e l'host vedrebbe il seq tornare indietro
+    portENTER_CRITICAL(&gRecordMux);
+    const bool hasRing = _recordRing != nullptr;
+    if (hasRing) {
+        _recordDropped = 0;
+        _recording = true;      // Sotto mux: flushRecords non libera più il ring
+    }
+    portEXIT_CRITICAL(&gRecordMux);
+    if (hasRing) {
+        return true;
+    }
+
+    auto* ring = (BinaryProtocol::MotionRecordPayload*)heap_caps_malloc(
+        sizeof(BinaryProtocol::MotionRecordPayload) * RECORD_RING_CAPACITY, MALLOC_CAP_SPIRAM);
+    if (!ring) {
+        Serial.println("[MOTION BLE] ✗ Failed to allocate record ring");
+        return false;
+    }
+    portENTER_CRITICAL(&gRecordMux);
+    _recordRing = ring;
+    _recordHead = 0;
+    _recordCount = 0;
+    _recordDropped = 0;
+    _recording = true;
+    portEXIT_CRITICAL(&gRecordMux);
+    return true;
+}
+
+void BLEMotionService::_releaseRecordRing(bool onlyIfDrained) {
+    // Decisione e scambio del puntatore nella stessa sezione critica
+    BinaryProtocol::MotionRecordPayload* ring = nullptr;
+    portENTER_CRITICAL(&gRecordMux);
+    if (!_recording && (!onlyIfDrained || _recordCount == 0)) {
+        ring = _recordRing;
+        _recordRing = nullptr;
+        _recordCount = 0;
+    }
+    portEXIT_CRITICAL(&gRecordMux);
+    if (ring != nullptr) {
+        heap_caps_free(ring);
+        Serial.printf("[MOTION BLE] Recording buffer released (dropped %lu)\n", (unsigned long)_recordDropped);
+    }
+}
+
+void BLEMotionService::_stopRecording() {
+    _recording = false;
+
+    // Senza client i record rimasti non hanno destinatario: libera subito.
+    // Altrimenti flushRecords() libera il ring quando è svuotato.
+    if (_pRecordCccd != nullptr && _pRecordCccd->getNotifications()) {
+        return;
+    }
+    _releaseRecordRing(false);
+}
+
+void BLEMotionService::captureRecord(const MotionHistory::Sample& sample) {
+    if (!_recording) {
+        return;
+    }
+
+    BinaryProtocol::MotionRecordPayload r;
+    r.timestampMs = sample.timestamp;
+    r.flowXQ4 = sample.flowXQ4;
+    r.flowYQ4 = sample.flowYQ4;
+    r.divQ4 = sample.divQ4;
+    r.curlQ4 = sample.curlQ4;
+    r.intensity = sample.intensity;
+    r.activeBlocks = sample.activeBlocks;
+    r.speedQ4 = sample.speedQ4;
+    r.centroidX = sample.centroidValid ? sample.centroidX : 0;
+    r.centroidY = sample.centroidValid ? sample.centroidY : 0;
+    r.flags = sample.centroidValid ? BinaryProtocol::RECORD_FLAG_CENTROID_VALID : 0;
+    r.label = _recordLabel;
+
+    portENTER_CRITICAL(&gRecordMux);
+    r.seq = _recordSeq++;
+    if (_recordRing != nullptr && _recordCount < RECORD_RING_CAPACITY) {
+        _recordRing[_recordHead] = r;
+        _recordHead = (uint16_t)((_recordHead + 1) % RECORD_RING_CAPACITY);
+        _recordCount++;
+    } else {
+        _recordDropped++;  // Link fermo da troppo: il buco nel seq lo segnala all'host
+    }
+    portEXIT_CRITICAL(&gRecordMux);
+}
+
+void BLEMotionService::flushRecords() {
+    portENTER_CRITICAL(&gRecordMux);
+    const bool hasRing = _recordRing != nullptr;
+    portEXIT_CRITICAL(&gRecordMux);
+    if (!hasRing) {
+        return;
+    }
+
+    const bool subscribed = _pRecordCccd != nullptr && _pRecordCccd->getNotifications();
+    static constexpr size_t RECORD_TLV_SIZE =
+        BinaryProtocol::TLV_HEADER_SIZE + sizeof(BinaryProtocol::MotionRecordPayload);
+    // Un notify oltre la MTU viene troncato senza errore: l'ultimo record andrebbe perso
+    static_assert(BinaryProtocol::HEADER_SIZE + RECORDS_PER_NOTIFY * RECORD_TLV_SIZE <= BinaryProtocol::TELEMETRY_MAX_FRAME,
+                  "Record batch must fit ATT MTU 185");
+    uint8_t frame[BinaryProtocol::HEADER_SIZE + RECORDS_PER_NOTIFY * RECORD_TLV_SIZE];
+
+    for (uint8_t sent = 0; subscribed && sent < RECORD_NOTIFY_BUDGET; sent++) {
+        // Copia i più vecchi senza toglierli: escono dal ring solo a notify riuscita
+        uint8_t batch = 0;
+        portENTER_CRITICAL(&gRecordMux);
+        if (_recordRing == nullptr) {
+            portEXIT_CRITICAL(&gRecordMux);
+            break;      // Liberato da _stopRecording (client disiscritto)
+        }
+        const uint16_t tail = (uint16_t)((_recordHead + RECORD_RING_CAPACITY - _recordCount) % RECORD_RING_CAPACITY);
+        while (batch < RECORDS_PER_NOTIFY && batch < _recordCount) {
+            uint8_t* tlv = frame + BinaryProtocol::HEADER_SIZE + batch * RECORD_TLV_SIZE;
+            tlv[0] = BinaryProtocol::TYPE_MOTION_RECORD;
+            tlv[1] = (uint8_t)sizeof(BinaryProtocol::MotionRecordPayload);
+            memcpy(tlv + BinaryProtocol::TLV_HEADER_SIZE,
+                   &_recordRing[(tail + batch) % RECORD_RING_CAPACITY],
+                   sizeof(BinaryProtocol::MotionRecordPayload));
+            batch++;
+        }
+        portEXIT_CRITICAL(&gRecordMux);
+        if (batch == 0) {
+            break;
+        }
+
+        frame[0] = BinaryProtocol::VERSION;
+        _recordNotifyFailed = false;
+        _pCharRecord->setValue(frame, BinaryProtocol::HEADER_SIZE + batch * RECORD_TLV_SIZE);
+        _pCharRecord->notify();
+        if (_recordNotifyFailed) {
+            break;  // Stack BLE congestionato: riprova al prossimo frame
+        }
+
+        portENTER_CRITICAL(&gRecordMux);
+        _recordCount -= batch;
+        portEXIT_CRITICAL(&gRecordMux);
+    }
+
+    // Sessione chiusa: il ring si libera quando l'host ha ricevuto tutto
+    _releaseRecordRing(subscribed);
+}
+
+void BLEMotionService::_notifyBinaryEvent(const String& eventType, bool includeGesture) {
+    if (!_binaryNotifyEnabled()) {
+        return;
+    }
+
+    uint8_t event;
+    if (eventType == "motion_started") {
+        event = BinaryProtocol::EVENT_MOTION_STARTED;
+    } else if (eventType == "motion_ended") {
+        event = BinaryProtocol::EVENT_MOTION_ENDED;
+    } else if (eventType == "shake_detected") {
+        event = BinaryProtocol::EVENT_SHAKE_DETECTED;
+    } else if (eventType == "gesture_detected") {
+        event = BinaryProtocol::EVENT_GESTURE_DETECTED;
+    } else {
+        return;
+    }
+
+    const OpticalFlowDetector::Metrics metrics = _motion->getMetrics();
+    BinaryProtocol::MotionEventPayload payload;
+    payload.timestampMs = millis();
+    payload.event = event;
+    payload.intensity = metrics.currentIntensity;
+    payload.direction = (uint8_t)metrics.dominantDirection;
+    payload.gesture = includeGesture ? (uint8_t)_lastGesture : 0;
+    payload.gestureConfidence = includeGesture ? _lastGestureConfidence : 0;
+
+    uint8_t frame[BinaryProtocol::frameSize<BinaryProtocol::MotionEventPayload>()];
+    const size_t len = BinaryProtocol::encodeFrame(frame, sizeof(frame), BinaryProtocol::TYPE_MOTION_EVENT, payload);
+    _pCharBinary->setValue(frame, len);
+    _pCharBinary->notify();
+}
+
 void BLEMotionService::notifyEvent(const String& eventType, bool includeGesture) {
+    // Il canale binario non ha debounce: ogni evento arriva al client
+    _notifyBinaryEvent(eventType, includeGesture);
+
     OpticalFlowDetector::Metrics metrics = _motion->getMetrics();
     const char* directionStr = OpticalFlowDetector::directionToString(metrics.dominantDirection);
     const char* gestureStr = includeGesture ? MotionProcessor::gestureToString(_lastGesture) : "none";
@@ -148,6 +511,9 @@ void BLEMotionService::notifyEvent(const String& eventType, bool includeGesture)
         doc["gestureConfidence"] = 0;
         doc["gestureTimestamp"] = 0;
     }
+    if (_processor && _processor->getConfig().classifierEnabled) {
+        doc["classifierUs"] = _processor->getClassifierTimeUs();
+    }
 
     String output;
     serializeJson(doc, output);
@@ -167,8 +533,22 @@ void BLEMotionService::update(bool motionDetected, bool shakeDetected, const Mot
         return;
     }
 
+    // Fine calibrazione montaggio: notifica e salva il nuovo angolo
+    const OpticalFlowDetector::CalibrationState calibration = _motion->getCalibrationState();
+    if (calibration != _lastCalibrationState) {
+        _lastCalibrationState = calibration;
+        if (calibration == OpticalFlowDetector::CalibrationState::DONE) {
+            notifyEvent("calibration_done", false);
+            bleController.setConfigDirty(true);
+            _pCharConfig->setValue(_getConfigJson().c_str());
+        } else if (calibration == OpticalFlowDetector::CalibrationState::FAILED) {
+            notifyEvent("calibration_failed", false);
+        }
+    }
+
     // Track last gesture from processor (if available)
     if (processed) {
+        _lastEgo = processed->ego;
         const MotionProcessor::GestureType gesture = processed->gesture;
         const uint8_t confidence = processed->gestureConfidence;
         if (gesture != MotionProcessor::GestureType::NONE && confidence > 0) {
@@ -232,96 +612,6 @@ String BLEMotionService::_getStatusJson() {
     JsonDocument doc;
     OpticalFlowDetector::Metrics metrics = _motion->getMetrics();
 
-    auto rotateDirectionCW = [](OpticalFlowDetector::Direction dir, uint16_t degrees) -> OpticalFlowDetector::Direction {
-        switch (degrees % 360) {
-            case 0:
-                return dir;
-            case 90:
-                switch (dir) {
-                    case OpticalFlowDetector::Direction::UP:         return OpticalFlowDetector::Direction::RIGHT;
-                    case OpticalFlowDetector::Direction::UP_RIGHT:   return OpticalFlowDetector::Direction::DOWN_RIGHT;
-                    case OpticalFlowDetector::Direction::RIGHT:      return OpticalFlowDetector::Direction::DOWN;
-                    case OpticalFlowDetector::Direction::DOWN_RIGHT: return OpticalFlowDetector::Direction::DOWN_LEFT;
-                    case OpticalFlowDetector::Direction::DOWN:       return OpticalFlowDetector::Direction::LEFT;
-                    case OpticalFlowDetector::Direction::DOWN_LEFT:  return OpticalFlowDetector::Direction::UP_LEFT;
-                    case OpticalFlowDetector::Direction::LEFT:       return OpticalFlowDetector::Direction::UP;
-                    case OpticalFlowDetector::Direction::UP_LEFT:    return OpticalFlowDetector::Direction::UP_RIGHT;
-                    default: return dir;
-                }
-            case 180:
-                switch (dir) {
-                    case OpticalFlowDetector::Direction::UP:         return OpticalFlowDetector::Direction::DOWN;
-                    case OpticalFlowDetector::Direction::UP_RIGHT:   return OpticalFlowDetector::Direction::DOWN_LEFT;
-                    case OpticalFlowDetector::Direction::RIGHT:      return OpticalFlowDetector::Direction::LEFT;
-                    case OpticalFlowDetector::Direction::DOWN_RIGHT: return OpticalFlowDetector::Direction::UP_LEFT;
-                    case OpticalFlowDetector::Direction::DOWN:       return OpticalFlowDetector::Direction::UP;
-                    case OpticalFlowDetector::Direction::DOWN_LEFT:  return OpticalFlowDetector::Direction::UP_RIGHT;
-                    case OpticalFlowDetector::Direction::LEFT:       return OpticalFlowDetector::Direction::RIGHT;
-                    case OpticalFlowDetector::Direction::UP_LEFT:    return OpticalFlowDetector::Direction::DOWN_RIGHT;
-                    default: return dir;
-                }
-            case 270:
-                switch (dir) {
-                    case OpticalFlowDetector::Direction::UP:         return OpticalFlowDetector::Direction::LEFT;
-                    case OpticalFlowDetector::Direction::UP_RIGHT:   return OpticalFlowDetector::Direction::UP_LEFT;
-                    case OpticalFlowDetector::Direction::RIGHT:      return OpticalFlowDetector::Direction::UP;
-                    case OpticalFlowDetector::Direction::DOWN_RIGHT: return OpticalFlowDetector::Direction::UP_RIGHT;
-                    case OpticalFlowDetector::Direction::DOWN:       return OpticalFlowDetector::Direction::RIGHT;
-                    case OpticalFlowDetector::Direction::DOWN_LEFT:  return OpticalFlowDetector::Direction::DOWN_RIGHT;
-                    case OpticalFlowDetector::Direction::LEFT:       return OpticalFlowDetector::Direction::DOWN;
-                    case OpticalFlowDetector::Direction::UP_LEFT:    return OpticalFlowDetector::Direction::DOWN_LEFT;
-                    default: return dir;
-                }
-            default:
-                return dir;
-        }
-    };
-
-    auto rotateTagCW = [](char tag, uint16_t degrees) -> char {
-        switch (degrees % 360) {
-            case 0:
-                return tag;
-            case 90:
-                switch (tag) {
-                    case '^': return '>';
-                    case '>': return 'v';
-                    case 'v': return '<';
-                    case '<': return '^';
-                    case 'A': return 'C'; // up-right -> down-right
-                    case 'C': return 'D'; // down-right -> down-left
-                    case 'D': return 'B'; // down-left -> up-left
-                    case 'B': return 'A'; // up-left -> up-right
-                    default: return tag;
-                }
-            case 180:
-                switch (tag) {
-                    case '^': return 'v';
-                    case '>': return '<';
-                    case 'v': return '^';
-                    case '<': return '>';
-                    case 'A': return 'D'; // up-right -> down-left
-                    case 'C': return 'B'; // down-right -> up-left
-                    case 'D': return 'A'; // down-left -> up-right
-                    case 'B': return 'C'; // up-left -> down-right
-                    default: return tag;
-                }
-            case 270:
-                switch (tag) {
-                    case '^': return '<';
-                    case '>': return '^';
-                    case 'v': return '>';
-                    case '<': return 'v';
-                    case 'A': return 'B'; // up-right -> up-left
-                    case 'C': return 'A'; // down-right -> up-right
-                    case 'D': return 'C'; // down-left -> down-right
-                    case 'B': return 'D'; // up-left -> down-left
-                    default: return tag;
-                }
-            default:
-                return tag;
-        }
-    };
-
     doc["enabled"] = _motionEnabled;
     doc["motionDetected"] = _wasMotionActive;
     doc["quality"] = _motion->getQuality();
@@ -346,12 +636,23 @@ String BLEMotionService::_getStatusJson() {
     doc["centroidRow"] = centroidBlockValid ? centroidRow : 255;
     doc["centroidCol"] = centroidBlockValid ? centroidCol : 255;
 
+    // Centroide filtrato estrapolato di un frame (normalizzato, velocità per frame)
+    float predX = 0.0f, predY = 0.0f, velX = 0.0f, velY = 0.0f;
+    if (_motion->getCentroidPrediction(&predX, &predY, &velX, &velY)) {
+        JsonObject track = doc["track"].to<JsonObject>();
+        track["x"] = round(predX * 1000.0f) / 1000.0f;
+        track["y"] = round(predY * 1000.0f) / 1000.0f;
+        track["vx"] = round(velX * 1000.0f) / 1000.0f;
+        track["vy"] = round(velY * 1000.0f) / 1000.0f;
+    }
+
     // NUOVI campi optical flow
-    // Rotate for display to match gesture reference (main.cpp rotates motion direction before gesture processing)
-    doc["direction"] = OpticalFlowDetector::directionToString(rotateDirectionCW(metrics.dominantDirection, 180));
+    // Direzione già nel riferimento di montaggio (motionMountAngle)
+    doc["direction"] = OpticalFlowDetector::directionToString(metrics.dominantDirection);
     doc["speed"] = round(metrics.avgSpeed * 10.0f) / 10.0f;  // 1 decimal
     doc["confidence"] = round(metrics.avgConfidence * 100.0f);  // 0-100%
     doc["activeBlocks"] = metrics.avgActiveBlocks;
+    doc["noise"] = metrics.pixelNoise;
 
     // Gesture fields (from MotionProcessor via update()) with expiry to avoid "stuck" UI
     const unsigned long now = millis();
@@ -366,6 +667,33 @@ String BLEMotionService::_getStatusJson() {
         doc["gestureTimestamp"] = 0;
     }
 
+    // Moto della camera (globale) e quota di moto locale
+    JsonObject ego = doc["ego"].to<JsonObject>();
+    ego["model"] = EgoMotion::modelToString(_lastEgo.model);
+    ego["tx"] = round(_lastEgo.tx * 10.0f) / 10.0f;
+    ego["ty"] = round(_lastEgo.ty * 10.0f) / 10.0f;
+    ego["zoom"] = round(_lastEgo.zoom * 1000.0f) / 1000.0f;
+    ego["rotation"] = round(_lastEgo.rotation * 1000.0f) / 1000.0f;
+    ego["inliers"] = _lastEgo.inliers;
+    ego["local"] = _lastEgo.localIntensity;
+    if (_processor) {
+        ego["us"] = _processor->getEgoTimeUs();
+    }
+
+    // Snapshot coerente: captureRecord li modifica dal task camera
+    portENTER_CRITICAL(&gRecordMux);
+    const bool hasRecordRing = _recordRing != nullptr;
+    const bool recording = _recording;
+    const uint16_t recordBuffered = _recordCount;
+    const uint32_t recordDropped = _recordDropped;
+    portEXIT_CRITICAL(&gRecordMux);
+    if (hasRecordRing) {
+        JsonObject record = doc["record"].to<JsonObject>();
+        record["active"] = recording;
+        record["buffered"] = recordBuffered;
+        record["dropped"] = recordDropped;
+    }
+
     // 6x6 grid tags for quick visualization via BLE
     doc["gridRows"] = OpticalFlowDetector::GRID_ROWS;
     doc["gridCols"] = OpticalFlowDetector::GRID_COLS;
@@ -379,7 +707,7 @@ String BLEMotionService::_getStatusJson() {
             if (centroidBlockValid && row == centroidRow && col == centroidCol) {
                 tag = 'X';
             }
-            rowStr += rotateTagCW(tag, 0);
+            rowStr += tag;
         }
         gridArray.add(rowStr);
     }
@@ -398,17 +726,31 @@ String BLEMotionService::_getConfigJson() {
     doc["quality"] = _motion->getQuality();
     doc["motionIntensityMin"] = _motion->getMotionIntensityThreshold();
     doc["motionSpeedMin"] = _motion->getMotionSpeedThreshold();
+    doc["motionMountAngle"] = _motion->getMountAngle();
     if (_processor) {
         const MotionProcessor::Config& cfg = _processor->getConfig();
         doc["gesturesEnabled"] = cfg.gesturesEnabled;
-        doc["gestureIgnitionIntensity"] = cfg.ignitionIntensityThreshold;
-        doc["gestureRetractIntensity"] = cfg.retractIntensityThreshold;
-        doc["gestureClashIntensity"] = cfg.clashIntensityThreshold;
+        doc["gestureClassifier"] = cfg.classifierEnabled;
+        doc["egoCompensation"] = cfg.egoCompensation;
+        doc["gestureIgnitionIntensity"] = cfg.rules[GestureStateMachine::SLOT_IGNITION].minIntensity;
+        doc["gestureRetractIntensity"] = cfg.rules[GestureStateMachine::SLOT_RETRACT].minIntensity;
+        doc["gestureClashIntensity"] = cfg.rules[GestureStateMachine::SLOT_CLASH].minIntensity;
         doc["effectMapUp"] = cfg.effectOnUp;
         doc["effectMapDown"] = cfg.effectOnDown;
         doc["effectMapLeft"] = cfg.effectOnLeft;
         doc["effectMapRight"] = cfg.effectOnRight;
         doc["debugLogs"] = cfg.debugLogsEnabled;
+
+        // Tabella gesture: solo i campi diversi dal default (la tabella intera supera l'MTU)
+        JsonObject rules = doc["gestureRules"].to<JsonObject>();
+        for (uint8_t slot = 0; slot < GestureStateMachine::SLOT_COUNT; slot++) {
+            for (uint8_t field = 0; field < GestureStateMachine::FIELD_COUNT; field++) {
+                const uint32_t value = GestureStateMachine::getField(cfg.rules[slot], field);
+                if (value != GestureStateMachine::getField(GestureStateMachine::DEFAULT_RULES[slot], field)) {
+                    rules[GestureStateMachine::slotToString(slot)][GestureStateMachine::fieldToString(field)] = value;
+                }
+            }
+        }
     }
 
     String output;
@@ -419,6 +761,13 @@ String BLEMotionService::_getConfigJson() {
 void BLEMotionService::_executeCommand(const String& command) {
     Serial.printf("[MOTION BLE] Command received: %s\n", command.c_str());
 
+    // Registrazione: stato di sessione, non configurazione (niente salvataggio NVS)
+    if (command.startsWith("record ") || command.startsWith("label ")) {
+        _executeRecordCommand(command);
+        notifyStatus();
+        return;
+    }
+
     if (command == "enable") {
         _motionEnabled = true;
         Serial.println("[MOTION BLE] ✓ Motion detection enabled");
@@ -460,6 +809,48 @@ void BLEMotionService::_executeCommand(const String& command) {
         } else {
             Serial.printf("[MOTION BLE] ✗ Invalid speedmin: %.2f (must be 0-20)\n", minSpeed);
         }
+    } else if (command == "calibrate") {
+        // Il prossimo colpo "su" definisce l'angolo di montaggio (evento calibration_done)
+        _motion->startMountCalibration();
+        Serial.println("[MOTION BLE] ✓ Mount calibration started");
+    } else if (command.startsWith("mount ")) {
+        int degrees = command.substring(6).toInt();
+        if (degrees >= 0 && degrees < 360) {
+            _motion->setMountAngle((uint16_t)degrees);
+            Serial.printf("[MOTION BLE] ✓ Mount angle set: %d\n", degrees);
+        } else {
+            Serial.printf("[MOTION BLE] ✗ Invalid mount: %d (must be 0-359)\n", degrees);
+        }
+    } else if (command.startsWith("classifier ") && _processor) {
+        // Comando: "classifier on" / "classifier off"
+        MotionProcessor::Config cfg = _processor->getConfig();
+        cfg.classifierEnabled = command.substring(11) == "on";
+        _processor->setConfig(cfg);
+        Serial.printf("[MOTION BLE] ✓ Gesture classifier %s\n", cfg.classifierEnabled ? "enabled" : "disabled");
+    } else if (command.startsWith("ego ") && _processor) {
+        // Comando: "ego on" / "ego off"
+        MotionProcessor::Config cfg = _processor->getConfig();
+        cfg.egoCompensation = command.substring(4) == "on";
+        _processor->setConfig(cfg);
+        Serial.printf("[MOTION BLE] ✓ Ego-motion compensation %s\n", cfg.egoCompensation ? "enabled" : "disabled");
+    } else if (command.startsWith("rule ") && _processor) {
+        // Comando: "rule clash refractoryMs 3000"
+        const int fieldStart = command.indexOf(' ', 5);
+        const int valueStart = fieldStart > 0 ? command.indexOf(' ', fieldStart + 1) : -1;
+        const int8_t slot = fieldStart > 0
+            ? GestureStateMachine::slotFromString(command.substring(5, fieldStart).c_str()) : -1;
+        const int8_t field = valueStart > 0
+            ? GestureStateMachine::fieldFromString(command.substring(fieldStart + 1, valueStart).c_str()) : -1;
+        if (slot >= 0 && field >= 0) {
+            MotionProcessor::Config cfg = _processor->getConfig();
+            GestureStateMachine::setField(cfg.rules[slot], field, command.substring(valueStart + 1).toInt());
+            _processor->setConfig(cfg);
+            Serial.printf("[MOTION BLE] ✓ Rule %s.%s = %lu\n",
+                          GestureStateMachine::slotToString(slot), GestureStateMachine::fieldToString(field),
+                          (unsigned long)GestureStateMachine::getField(cfg.rules[slot], field));
+        } else {
+            Serial.printf("[MOTION BLE] ✗ Invalid rule command: %s\n", command.c_str());
+        }
     } else if (command.startsWith("isup ") && _processor) {
         MotionProcessor::Config cfg = _processor->getConfig();
         cfg.effectOnUp = command.substring(5);
@@ -493,6 +884,37 @@ void BLEMotionService::_executeCommand(const String& command) {
     notifyStatus();
 }
 
+void BLEMotionService::_executeRecordCommand(const String& command) {
+    if (command == "record start") {
+        if (_startRecording()) {
+            Serial.printf("[MOTION BLE] ✓ Recording started (label %s)\n",
+                          MotionProcessor::gestureToString((MotionProcessor::GestureType)_recordLabel));
+        }
+    } else if (command == "record stop") {
+        _stopRecording();
+        Serial.printf("[MOTION BLE] ✓ Recording stopped (next seq %u, dropped %lu)\n",
+                      _recordSeq, (unsigned long)_recordDropped);
+    } else if (command.startsWith("label ")) {
+        // Comando: "label clash" ... "label none"; resta valida fino al prossimo label
+        const String name = command.substring(6);
+        bool found = false;
+        for (uint8_t i = 0; i < GestureClassifier::CLASS_COUNT; i++) {
+            if (name == MotionProcessor::gestureToString((MotionProcessor::GestureType)i)) {
+                _recordLabel = i;
+                found = true;
+                break;
+            }
+        }
+        if (found) {
+            Serial.printf("[MOTION BLE] ✓ Record label: %s\n", name.c_str());
+        } else {
+            Serial.printf("[MOTION BLE] ✗ Unknown label: %s\n", name.c_str());
+        }
+    } else {
+        Serial.printf("[MOTION BLE] ✗ Unknown command: %s\n", command.c_str());
+    }
+}
+
 // ============================================================================
 // CALLBACKS
 // ============================================================================
@@ -505,16 +927,56 @@ void BLEMotionService::ControlCallbacks::onWrite(BLECharacteristic* pCharacteris
     }
 }
 
+void BLEMotionService::BinaryCallbacks::onWrite(BLECharacteristic* pCharacteristic) {
+    BinaryProtocol::Reader reader(pCharacteristic->getData(), pCharacteristic->getLength());
+    if (!reader.isValid()) {
+        Serial.printf("[MOTION BLE] Binary frame rejected (version %u)\n", reader.getVersion());
+        return;
+    }
+
+    bool applied = false;
+    BinaryProtocol::Tlv tlv;
+    while (reader.next(tlv)) {
+        BinaryProtocol::MotionConfigPayload cfgPayload;
+        if (tlv.type != BinaryProtocol::TYPE_MOTION_CONFIG || !BinaryProtocol::readPayload(tlv, cfgPayload)) {
+            continue;
+        }
+
+        _service->_motionEnabled = (cfgPayload.flags & BinaryProtocol::MOTION_CFG_ENABLED) != 0;
+        _service->_motion->setQuality(cfgPayload.quality);
+        _service->_motion->setMotionIntensityThreshold(cfgPayload.motionIntensityMin);
+        _service->_motion->setMotionSpeedThreshold(min<uint8_t>(cfgPayload.motionSpeedMinX10, 200) / 10.0f);
+
+        if (_service->_processor) {
+            MotionProcessor::Config cfg = _service->_processor->getConfig();
+            cfg.gesturesEnabled = (cfgPayload.flags & BinaryProtocol::MOTION_CFG_GESTURES) != 0;
+            cfg.debugLogsEnabled = (cfgPayload.flags & BinaryProtocol::MOTION_CFG_DEBUG) != 0;
+            cfg.rules[GestureStateMachine::SLOT_IGNITION].minIntensity = cfgPayload.ignitionIntensity;
+            cfg.rules[GestureStateMachine::SLOT_RETRACT].minIntensity = cfgPayload.retractIntensity;
+            cfg.rules[GestureStateMachine::SLOT_CLASH].minIntensity = cfgPayload.clashIntensity;
+            _service->_processor->setConfig(cfg);
+        }
+        applied = true;
+    }
+
+    if (!applied) {
+        return;
+    }
+
+    bleController.setConfigDirty(true);
+    _service->_pCharConfig->setValue(_service->_getConfigJson().c_str());
+}
+
 void BLEMotionService::ConfigCallbacks::onWrite(BLECharacteristic* pCharacteristic) {
     std::string value = pCharacteristic->getValue();
     if (value.length() == 0) return;
 
     // Parse JSON payload: {"enabled": bool, "quality": 0-255,
-    // "motionIntensityMin": 0-255, "motionSpeedMin": 0-20,
+    // "motionIntensityMin": 0-255, "motionSpeedMin": 0-20, "motionMountAngle": 0-359,
     // "gestureIgnitionIntensity": 0-255, "gestureRetractIntensity": 0-255,
-    // "gestureClashIntensity": 0-255, "effectMapUp": "flicker",
+    // "gestureClashIntensity": 0-255, "gestureClassifier": bool, "effectMapUp": "flicker",
     // "effectMapDown": "...", "effectMapLeft": "...", "effectMapRight": "...",
-    // "debugLogs": bool}
+    // "debugLogs": bool, "egoCompensation": bool, "gestureRules": {"clash": {"dwellMs": 0, "refractoryMs": 3000}, ...}}
     JsonDocument doc;
     DeserializationError error = deserializeJson(doc, value.c_str());
 
@@ -527,7 +989,10 @@ void BLEMotionService::ConfigCallbacks::onWrite(BLECharacteristic* pCharacterist
     const bool hasQuality = !doc["quality"].isNull();
     const bool hasMotionIntensity = !doc["motionIntensityMin"].isNull();
     const bool hasMotionSpeed = !doc["motionSpeedMin"].isNull();
+    const bool hasMountAngle = !doc["motionMountAngle"].isNull();
     const bool hasGesturesEnabled = !doc["gesturesEnabled"].isNull();
+    const bool hasClassifier = !doc["gestureClassifier"].isNull();
+    const bool hasEgoCompensation = !doc["egoCompensation"].isNull();
     const bool hasIgnitionIntensity = !doc["gestureIgnitionIntensity"].isNull();
     const bool hasRetractIntensity = !doc["gestureRetractIntensity"].isNull();
     const bool hasClashIntensity = !doc["gestureClashIntensity"].isNull();
@@ -536,6 +1001,7 @@ void BLEMotionService::ConfigCallbacks::onWrite(BLECharacteristic* pCharacterist
     const bool hasMapLeft = !doc["effectMapLeft"].isNull();
     const bool hasMapRight = !doc["effectMapRight"].isNull();
     const bool hasDebugLogs = !doc["debugLogs"].isNull();
+    const bool hasRules = doc["gestureRules"].is<JsonObject>();
 
     uint8_t quality = doc["quality"] | _service->_motion->getQuality();
     uint8_t motionIntensityMin = doc["motionIntensityMin"] | _service->_motion->getMotionIntensityThreshold();
@@ -554,21 +1020,30 @@ void BLEMotionService::ConfigCallbacks::onWrite(BLECharacteristic* pCharacterist
     if (hasMotionSpeed) {
         _service->_motion->setMotionSpeedThreshold(motionSpeedMin);
     }
+    if (hasMountAngle) {
+        _service->_motion->setMountAngle((uint16_t)constrain((int)doc["motionMountAngle"], 0, 359));
+    }
     if (_service->_processor &&
-        (hasGesturesEnabled || hasIgnitionIntensity || hasRetractIntensity || hasClashIntensity ||
-         hasMapUp || hasMapDown || hasMapLeft || hasMapRight || hasDebugLogs)) {
+        (hasGesturesEnabled || hasClassifier || hasEgoCompensation || hasIgnitionIntensity || hasRetractIntensity || hasClashIntensity ||
+         hasMapUp || hasMapDown || hasMapLeft || hasMapRight || hasDebugLogs || hasRules)) {
         MotionProcessor::Config cfg = _service->_processor->getConfig();
         if (hasGesturesEnabled) {
             cfg.gesturesEnabled = (bool)doc["gesturesEnabled"];
         }
+        if (hasClassifier) {
+            cfg.classifierEnabled = (bool)doc["gestureClassifier"];
+        }
+        if (hasEgoCompensation) {
+            cfg.egoCompensation = (bool)doc["egoCompensation"];
+        }
         if (hasIgnitionIntensity) {
-            cfg.ignitionIntensityThreshold = (uint8_t)constrain((int)doc["gestureIgnitionIntensity"], 0, 255);
+            cfg.rules[GestureStateMachine::SLOT_IGNITION].minIntensity = (uint8_t)constrain((int)doc["gestureIgnitionIntensity"], 0, 255);
         }
         if (hasRetractIntensity) {
-            cfg.retractIntensityThreshold = (uint8_t)constrain((int)doc["gestureRetractIntensity"], 0, 255);
+            cfg.rules[GestureStateMachine::SLOT_RETRACT].minIntensity = (uint8_t)constrain((int)doc["gestureRetractIntensity"], 0, 255);
         }
         if (hasClashIntensity) {
-            cfg.clashIntensityThreshold = (uint8_t)constrain((int)doc["gestureClashIntensity"], 0, 255);
+            cfg.rules[GestureStateMachine::SLOT_CLASH].minIntensity = (uint8_t)constrain((int)doc["gestureClashIntensity"], 0, 255);
         }
         if (hasMapUp) {
             cfg.effectOnUp = (const char*)doc["effectMapUp"];
@@ -585,12 +1060,30 @@ void BLEMotionService::ConfigCallbacks::onWrite(BLECharacteristic* pCharacterist
         if (hasDebugLogs) {
             cfg.debugLogsEnabled = (bool)doc["debugLogs"];
         }
+        if (hasRules) {
+            // Merge parziale: slot e campi assenti restano invariati
+            for (JsonPair slotPair : doc["gestureRules"].as<JsonObject>()) {
+                const int8_t slot = GestureStateMachine::slotFromString(slotPair.key().c_str());
+                if (slot < 0 || !slotPair.value().is<JsonObject>()) {
+                    Serial.printf("[MOTION BLE] ✗ Unknown gesture rule: %s\n", slotPair.key().c_str());
+                    continue;
+                }
+                for (JsonPair fieldPair : slotPair.value().as<JsonObject>()) {
+                    const int8_t field = GestureStateMachine::fieldFromString(fieldPair.key().c_str());
+                    if (field < 0) {
+                        Serial.printf("[MOTION BLE] ✗ Unknown rule field: %s\n", fieldPair.key().c_str());
+                        continue;
+                    }
+                    GestureStateMachine::setField(cfg.rules[slot], field, fieldPair.value().as<long>());
+                }
+            }
+        }
         _service->_processor->setConfig(cfg);
         Serial.printf("[MOTION BLE] Gesture update: enabled=%s ignition=%u retract=%u clash=%u\n",
                       cfg.gesturesEnabled ? "true" : "false",
-                      cfg.ignitionIntensityThreshold,
-                      cfg.retractIntensityThreshold,
-                      cfg.clashIntensityThreshold);
+                      cfg.rules[GestureStateMachine::SLOT_IGNITION].minIntensity,
+                      cfg.rules[GestureStateMachine::SLOT_RETRACT].minIntensity,
+                      cfg.rules[GestureStateMachine::SLOT_CLASH].minIntensity);
     }
     bleController.setConfigDirty(true);
 
@@ -7,8 +7,11 @@
 #include <BLEUtils.h>
 #include <BLE2902.h>
 #include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
 #include "OpticalFlowDetector.h"
 #include "MotionProcessor.h"
+#include "BinaryProtocol.h"
 
 // UUIDs per Motion Service
 #define MOTION_SERVICE_UUID        "6fafc401-1fb5-459e-8fcc-c5c9c331914b"
@@ -16,6 +19,9 @@
 #define CHAR_MOTION_CONTROL_UUID   "8dc5b4c3-eb10-4a3e-8a4c-1234567890ac"
 #define CHAR_MOTION_EVENTS_UUID    "9ef6c5d4-fc21-5b4f-9b5d-2345678901bd"
 #define CHAR_MOTION_CONFIG_UUID    "aff7d6e5-0d32-4c5a-ac6e-3456789012ce"
+#define CHAR_MOTION_BINARY_UUID    "b0f8e7f6-1e43-4d6b-bd7f-4567890123df"
+#define CHAR_MOTION_TELEMETRY_UUID "c1f9f807-2f54-4e7c-ce0a-5678901234e0"
+#define CHAR_MOTION_RECORD_UUID    "d20a0918-3065-4f8d-df1b-6789012345f1"
 
 /**
  * @brief Servizio BLE per motion detection e gesture recognition
@@ -25,6 +31,12 @@
  * - CONTROL (Write): Comandi (enable, disable, reset, calibrate)
  * - EVENTS (Notify): Eventi motion (shake_detected, motion_started, motion_ended)
  * - CONFIG (Read/Write): Configurazione (quality, motionIntensityMin, motionSpeedMin, gesture intensities)
+ * - BINARY (Read/Write/Notify): TLV binario (BinaryProtocol.h): status ad ogni frame,
+ *   eventi, write MOTION_CONFIG
+ * - TELEMETRY (Notify): TLV MOTION_TELEMETRY ad ogni frame elaborato (vettori 8x8,
+ *   griglia perturbazione, centroide, gesture) per il tuning del detector
+ * - RECORD (Notify): record compatti per frame in modalità registrazione
+ *   ("record start"), con l'etichetta utente ("label <gesture>") per i dataset
  */
 class BLEMotionService {
 public:
@@ -47,6 +59,59 @@ public:
      */
     void notifyEvent(const String& eventType, bool includeGesture = false);
 
+    /**
+     * @brief Notifica lo status binario (chiamare ad ogni frame elaborato)
+     *
+     * Nessun debounce: il payload è ~25 byte e viene costruito solo se il
+     * client è iscritto alla characteristic BINARY.
+     */
+    void notifyBinaryStatus();
+
+    /**
+     * @brief true se un client è iscritto alla telemetria (chiamabile da ogni task)
+     */
+    bool isTelemetryEnabled() const;
+
+    /**
+     * @brief Costruisce la telemetria del frame appena elaborato (CameraCaptureTask)
+     *
+     * Va chiamata nello stesso task di processFrame(): i vettori del detector
+     * sono coerenti solo lì. Il frame (≤ TELEMETRY_MAX_FRAME) va in una coda; se è piena
+     * viene perso e conteggiato in dropped. Il seq avanza comunque, così il
+     * client vede anche le perdite lato BLE.
+     */
+    void captureTelemetry(const MotionProcessor::ProcessedMotion& processed,
+                          OpticalFlowDetector::Direction direction,
+                          bool motionDetected, uint32_t timestampMs, uint32_t processMs);
+
+    /**
+     * @brief Invia tutti i frame di telemetria in coda (chiamare dal loop)
+     */
+    void flushTelemetry();
+
+    /**
+     * @brief true se la modalità registrazione è attiva (chiamabile da ogni task)
+     */
+    bool isRecording() const { return _recording; }
+
+    /**
+     * @brief Accoda il record del frame appena elaborato (CameraCaptureTask)
+     *
+     * Il record (22 byte) porta l'etichetta corrente, così l'allineamento
+     * etichetta/frame avviene sul device e non dipende dalla latenza BLE.
+     * Il ring in PSRAM assorbe gli stalli del link; se è pieno il record è
+     * perso e conteggiato, il seq avanza comunque.
+     */
+    void captureRecord(const MotionHistory::Sample& sample);
+
+    /**
+     * @brief Invia i record bufferizzati, più record per notify (chiamare dal loop)
+     *
+     * I record restano nel ring finché nessun client è iscritto o la notify
+     * fallisce (link congestionato): vengono ritentati al giro successivo.
+     */
+    void flushRecords();
+
     /**
      * @brief Verifica se motion detection è abilitato
      */
@@ -73,6 +138,31 @@ private:
     BLECharacteristic* _pCharControl;
     BLECharacteristic* _pCharEvents;
     BLECharacteristic* _pCharConfig;
+    BLECharacteristic* _pCharBinary;
+    BLE2902* _pBinaryCccd;
+    BLECharacteristic* _pCharTelemetry;
+    BLE2902* _pTelemetryCccd;
+
+    // Telemetria: prodotta da CameraCaptureTask, inviata dal loop
+    static constexpr uint8_t TELEMETRY_QUEUE_DEPTH = 4;
+    QueueHandle_t _telemetryQueue;
+    uint16_t _telemetrySeq;
+    uint32_t _telemetryDropped;
+
+    // Registrazione dataset: ring in PSRAM allocato solo durante la sessione
+    static constexpr uint16_t RECORD_RING_CAPACITY = 8192;     // ~180KB, ~4.5 min @ 30fps senza link
+    static constexpr uint8_t RECORDS_PER_NOTIFY = 7;           // 1 + 7 * 24 = 169 byte, entro TELEMETRY_MAX_FRAME
+    static constexpr uint8_t RECORD_NOTIFY_BUDGET = 4;         // Notify per flush: il loop non resta bloccato
+    BLECharacteristic* _pCharRecord;
+    BLE2902* _pRecordCccd;
+    BinaryProtocol::MotionRecordPayload* _recordRing;
+    uint16_t _recordHead;           // Prossimo slot da scrivere
+    uint16_t _recordCount;
+    uint16_t _recordSeq;
+    uint32_t _recordDropped;
+    volatile bool _recording;
+    volatile uint8_t _recordLabel;  // MotionProcessor::GestureType
+    volatile bool _recordNotifyFailed;
 
     bool _statusNotifyEnabled;
     bool _eventsNotifyEnabled;
@@ -85,6 +175,8 @@ private:
     MotionProcessor::GestureType _lastGesture;
     uint8_t _lastGestureConfidence;
     unsigned long _lastGestureTime;
+    EgoMotion::Estimate _lastEgo;       // Ultimo moto globale/locale (status JSON)
+    OpticalFlowDetector::CalibrationState _lastCalibrationState;
 
     // Motion event hysteresis (reduce chatter)
     unsigned long _motionCandidateSince;
@@ -116,6 +208,36 @@ private:
         BLEMotionService* _service;
     };
 
+    /**
+     * @brief Callback per write binarie (TLV MOTION_CONFIG)
+     */
+    class BinaryCallbacks : public BLECharacteristicCallbacks {
+    public:
+        BinaryCallbacks(BLEMotionService* service) : _service(service) {}
+
+        void onWrite(BLECharacteristic* pCharacteristic) override;
+
+    private:
+        BLEMotionService* _service;
+    };
+
+    /**
+     * @brief Esito delle notify RECORD: un errore lascia i record nel ring
+     */
+    class RecordCallbacks : public BLECharacteristicCallbacks {
+    public:
+        RecordCallbacks(BLEMotionService* service) : _service(service) {}
+
+        void onStatus(BLECharacteristic* pCharacteristic, Status s, uint32_t code) override {
+            if (s != SUCCESS_NOTIFY && s != SUCCESS_INDICATE) {
+                _service->_recordNotifyFailed = true;
+            }
+        }
+
+    private:
+        BLEMotionService* _service;
+    };
+
     /**
      * @brief Callback per gestione sottoscrizione notifiche STATUS
      */
@@ -163,6 +285,22 @@ private:
      */
     void _executeCommand(const String& command);
 
+    /**
+     * @brief Comandi di registrazione: "record start|stop", "label <gesture>"
+     */
+    void _executeRecordCommand(const String& command);
+
+    /**
+     * @brief Avvia/ferma la registrazione (alloca/libera il ring)
+     */
+    bool _startRecording();
+    void _stopRecording();
+
+    /**
+     * @brief Libera il ring se la registrazione è ferma (e, se richiesto, svuotato)
+     */
+    void _releaseRecordRing(bool onlyIfDrained);
+
     /**
      * @brief Serializza stato motion in JSON
      */
@@ -172,6 +310,16 @@ private:
      * @brief Serializza configurazione in JSON
      */
     String _getConfigJson();
+
+    /**
+     * @brief true se il client è iscritto alle notify BINARY
+     */
+    bool _binaryNotifyEnabled() const;
+
+    /**
+     * @brief Invia un evento sulla characteristic BINARY (nessun debounce)
+     */
+    void _notifyBinaryEvent(const String& eventType, bool includeGesture);
 };
 
 #endif // BLE_MOTION_SERVICE_H
@@ -0,0 +1,59 @@
+#include "BootTimeline.h"
+#include <esp_timer.h>
+
+BootTimeline::Milestone BootTimeline::_milestones[BootTimeline::MAX_MILESTONES];
+volatile uint8_t BootTimeline::_count = 0;
+volatile uint32_t BootTimeline::_firstLitUs = 0;
+
+static portMUX_TYPE gBootTimelineMux = portMUX_INITIALIZER_UNLOCKED;
+
+void BootTimeline::mark(const char* name) {
+    portENTER_CRITICAL(&gBootTimelineMux);
+    const uint32_t now = (uint32_t)esp_timer_get_time();
+    const uint8_t index = _count;
+    if (index < MAX_MILESTONES) {
+        _milestones[index].name = name;
+        _milestones[index].us = now;
+        _count = index + 1;
+    }
+    portEXIT_CRITICAL(&gBootTimelineMux);
+
+    if (index < MAX_MILESTONES) {
+        Serial.printf("[BOOT] +%lu.%03lu ms  %s\n", now / 1000, now % 1000, name);
+    }
+}
+
+void BootTimeline::markFirstLit() {
+    if (_firstLitUs != 0) {
+        return;
+    }
+    _firstLitUs = (uint32_t)esp_timer_get_time();
+    mark("first_lit_led");
+}
+
+BootTimeline::Milestone BootTimeline::get(uint8_t index) {
+    Milestone m = {nullptr, 0};
+    portENTER_CRITICAL(&gBootTimelineMux);
+    if (index < _count) {
+        m = _milestones[index];
+    }
+    portEXIT_CRITICAL(&gBootTimelineMux);
+    return m;
+}
+
+void BootTimeline::printReport() {
+    Serial.println("\n=== BOOT TIMELINE ===");
+    uint32_t prevUs = 0;
+    const uint8_t count = _count;
+    for (uint8_t i = 0; i < count; i++) {
+        const Milestone m = get(i);
+        Serial.printf("  %8lu us  (+%6lu)  %s\n", m.us, m.us - prevUs, m.name);
+        prevUs = m.us;
+    }
+    if (hasFirstLit()) {
+        Serial.printf("  Time to first lit LED: %lu ms\n", getFirstLitMs());
+    } else {
+        Serial.println("  Blade not lit yet");
+    }
+    Serial.println("=====================\n");
+}
@@ -0,0 +1,53 @@
+#ifndef BOOT_TIMELINE_H
+#define BOOT_TIMELINE_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Milestone di boot con timestamp (µs da avvio app, esp_timer)
+ *
+ * Il boot è a stadi: LED engine + config da cache subito, poi BLE e camera
+ * in un task in background. Ogni stadio registra un milestone; la metrica
+ * principale è il tempo dall'avvio (power-on o wake da deep sleep) al primo
+ * LED acceso sulla lama.
+ *
+ * Thread safety: mark() è protetto da spinlock (loop + BootInitTask).
+ * I nomi devono essere stringhe statiche (non vengono copiati).
+ */
+class BootTimeline {
+public:
+    static constexpr uint8_t MAX_MILESTONES = 16;
+
+    struct Milestone {
+        const char* name;
+        uint32_t us;
+    };
+
+    /**
+     * @brief Registra un milestone (ignorato se la tabella è piena)
+     */
+    static void mark(const char* name);
+
+    /**
+     * @brief Registra il primo frame con almeno un LED acceso (una sola volta)
+     */
+    static void markFirstLit();
+
+    static bool hasFirstLit() { return _firstLitUs != 0; }
+    static uint32_t getFirstLitMs() { return _firstLitUs / 1000; }
+
+    static uint8_t getCount() { return _count; }
+    static Milestone get(uint8_t index);
+
+    /**
+     * @brief Stampa la timeline su Serial
+     */
+    static void printReport();
+
+private:
+    static Milestone _milestones[MAX_MILESTONES];
+    static volatile uint8_t _count;
+    static volatile uint32_t _firstLitUs;
+};
+
+#endif // BOOT_TIMELINE_H
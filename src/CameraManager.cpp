@@ -142,6 +142,46 @@ bool CameraManager::begin(uint8_t flashPin) {
     return true;
 }
 
+bool CameraManager::beginSniff() {
+    if (_initialized) {
+        return true;
+    }
+
+    camera_config_t config;
+    memset(&config, 0, sizeof(config));
+
+    _configurePinout(config);
+
+    config.xclk_freq_hz = 20000000;
+    config.ledc_timer = LEDC_TIMER_0;
+    config.ledc_channel = LEDC_CHANNEL_0;
+    config.pixel_format = PIXFORMAT_GRAYSCALE;
+    config.frame_size = FRAMESIZE_96X96;         // Minimo supportato dall'OV2640
+    config.jpeg_quality = 12;
+    config.fb_count = 1;
+    config.fb_location = CAMERA_FB_IN_DRAM;      // 9KB: evita latenza PSRAM
+    config.grab_mode = CAMERA_GRAB_LATEST;
+
+    esp_err_t err = esp_camera_init(&config);
+    if (err != ESP_OK) {
+        Serial.printf("[CAMERA ERROR] Sniff init failed: 0x%x\n", err);
+        return false;
+    }
+
+    sensor_t* s = esp_camera_sensor_get();
+    if (s != nullptr) {
+        s->set_exposure_ctrl(s, 1);
+        s->set_aec2(s, 1);
+        s->set_gain_ctrl(s, 1);
+        s->set_gainceiling(s, (gainceiling_t)6);
+        s->set_dcw(s, 1);
+    }
+
+    _initialized = true;
+    _fpsStartTime = millis();
+    return true;
+}
+
 void CameraManager::deinit() {
     if (_currentFrameBuffer) {
         esp_camera_fb_return(_currentFrameBuffer);
@@ -25,6 +25,15 @@ public:
      */
     bool begin(uint8_t flashPin = 4);
 
+    /**
+     * @brief Inizializzazione minima per lo sniff della sentinella
+     *
+     * 96x96 grayscale, singolo buffer in DRAM: avvio rapido e consumo minimo.
+     * Chiamare deinit() prima di begin() per tornare alla modalità normale.
+     * @return true se inizializzazione OK
+     */
+    bool beginSniff();
+
     /**
      * @brief De-inizializza la camera e libera le risorse
      */
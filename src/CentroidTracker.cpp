@@ -0,0 +1,113 @@
+#include "CentroidTracker.h"
+
+namespace {
+// Rumore di processo: accelerazione bianca a per frame -> Q = a^2 * [1/4 1/2; 1/2 1]
+constexpr int32_t ACCEL_VAR = CentroidTracker::PROCESS_ACCEL_Q4 * CentroidTracker::PROCESS_ACCEL_Q4;
+constexpr int32_t Q00 = ACCEL_VAR / 4;
+constexpr int32_t Q01 = ACCEL_VAR / 2;
+constexpr int32_t Q11 = ACCEL_VAR;
+constexpr int32_t R = CentroidTracker::MEASUREMENT_SIGMA_Q4 * CentroidTracker::MEASUREMENT_SIGMA_Q4;
+constexpr int32_t MAX_VARIANCE = 1L << 24;     // Tetto durante le planate: i prodotti restano in 64 bit
+
+int32_t divRound(int64_t num, int64_t den) {
+    return (int32_t)((num >= 0 ? num + den / 2 : num - den / 2) / den);
+}
+
+int32_t capVariance(int64_t value) {
+    return (int32_t)(value > MAX_VARIANCE ? MAX_VARIANCE : value);
+}
+}
+
+CentroidTracker::CentroidTracker() {
+    reset();
+}
+
+void CentroidTracker::reset() {
+    _state = {0, 0, 0, 0};
+    _axisX = {0, 0, 0};
+    _axisY = {0, 0, 0};
+    _updates = 0;
+    _coastFrames = 0;
+}
+
+void CentroidTracker::_start(int32_t xQ4, int32_t yQ4) {
+    // Prima misura: posizione nota a meno del rumore, velocità ignota
+    const Axis initial = {R, 0, INITIAL_VELOCITY_SIGMA_Q4 * INITIAL_VELOCITY_SIGMA_Q4};
+    _state = {xQ4, yQ4, 0, 0};
+    _axisX = initial;
+    _axisY = initial;
+    _updates = 1;
+    _coastFrames = 0;
+}
+
+void CentroidTracker::_predictAxis(int32_t& pos, int32_t vel, Axis& p) {
+    // x' = x + v, P' = F P F^T + Q con F = [1 1; 0 1]
+    pos += vel;
+    p.p00 = capVariance((int64_t)p.p00 + 2 * (int64_t)p.p01 + p.p11 + Q00);
+    p.p01 = capVariance((int64_t)p.p01 + p.p11 + Q01);
+    p.p11 = capVariance((int64_t)p.p11 + Q11);
+}
+
+void CentroidTracker::predict() {
+    if (!hasEstimate()) {
+        return;
+    }
+    if (++_coastFrames > MAX_COAST_FRAMES) {
+        reset();
+        return;
+    }
+    _predictAxis(_state.x, _state.vx, _axisX);
+    _predictAxis(_state.y, _state.vy, _axisY);
+}
+
+int32_t CentroidTracker::_innovationGate(const Axis& p) {
+    return p.p00 + R;
+}
+
+void CentroidTracker::_updateAxis(int32_t& pos, int32_t& vel, Axis& p, int32_t innovation) {
+    // Guadagno K = P H^T / S con H = [1 0], S = P00 + R
+    const int64_t s = (int64_t)p.p00 + R;
+    pos += divRound((int64_t)innovation * p.p00, s);
+    vel += divRound((int64_t)innovation * p.p01, s);
+
+    // P = (I - K H) P
+    const int32_t p00 = p.p00;
+    const int32_t p01 = p.p01;
+    p.p00 = divRound((int64_t)p00 * R, s);
+    p.p01 = divRound((int64_t)p01 * R, s);
+    p.p11 -= divRound((int64_t)p01 * p01, s);
+    if (p.p11 < 1) {
+        p.p11 = 1;
+    }
+}
+
+bool CentroidTracker::update(int32_t xQ4, int32_t yQ4) {
+    if (!hasEstimate()) {
+        _start(xQ4, yQ4);
+        return true;
+    }
+
+    const int32_t innovationX = xQ4 - _state.x;
+    const int32_t innovationY = yQ4 - _state.y;
+    const int64_t gate = (int64_t)GATE_SIGMA * GATE_SIGMA;
+    if ((int64_t)innovationX * innovationX > gate * _innovationGate(_axisX) ||
+        (int64_t)innovationY * innovationY > gate * _innovationGate(_axisY)) {
+        _start(xQ4, yQ4);
+        return false;
+    }
+
+    _updateAxis(_state.x, _state.vx, _axisX, innovationX);
+    _updateAxis(_state.y, _state.vy, _axisY, innovationY);
+    if (_updates < UINT16_MAX) {
+        _updates++;
+    }
+    _coastFrames = 0;
+    return true;
+}
+
+CentroidTracker::State CentroidTracker::predictAhead(uint8_t frames) const {
+    State ahead = _state;
+    ahead.x += _state.vx * frames;
+    ahead.y += _state.vy * frames;
+    return ahead;
+}
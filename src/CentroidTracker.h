@@ -0,0 +1,86 @@
+#ifndef CENTROID_TRACKER_H
+#define CENTROID_TRACKER_H
+
+#include <stdint.h>
+
+/**
+ * @brief Filtro di Kalman a velocità costante sul centroide, in virgola fissa
+ *
+ * Stato per asse: posizione e velocità in px Q4 (velocità per frame), con
+ * covarianza 2x2 simmetrica. Il passo temporale è il frame: predict() ad ogni
+ * frame elaborato, update() quando c'è una misura del centroide. Rumore di
+ * processo da accelerazione bianca (PROCESS_ACCEL_Q4 px/frame^2), rumore di
+ * misura MEASUREMENT_SIGMA_Q4.
+ *
+ * Una misura fuori dal gate (innovazione > GATE_SIGMA deviazioni) o più di
+ * MAX_COAST_FRAMES frame senza misure riavviano il filtro: il centroide è
+ * saltato su un altro oggetto o il moto è finito.
+ * Costo fisso di poche moltiplicazioni a 64 bit, nessuna allocazione.
+ * Nessuna dipendenza da Arduino (come EgoMotion).
+ */
+class CentroidTracker {
+public:
+    static constexpr int32_t MEASUREMENT_SIGMA_Q4 = 24;     // 1.5 px: jitter del centroide a blocchi
+    static constexpr int32_t PROCESS_ACCEL_Q4 = 16;         // 1 px/frame^2
+    static constexpr int32_t INITIAL_VELOCITY_SIGMA_Q4 = 128;   // 8 px/frame alla prima misura
+    static constexpr uint8_t GATE_SIGMA = 5;
+    static constexpr uint8_t MAX_COAST_FRAMES = 5;
+
+    struct State {
+        int32_t x;          // px Q4
+        int32_t y;
+        int32_t vx;         // px/frame Q4
+        int32_t vy;
+    };
+
+    CentroidTracker();
+
+    void reset();
+
+    /**
+     * @brief Avanza il modello di un frame (senza misura: il filtro "plana")
+     */
+    void predict();
+
+    /**
+     * @brief Corregge con la misura del frame corrente (dopo predict())
+     * @return false se la misura era fuori gate e il filtro è ripartito da lì
+     */
+    bool update(int32_t xQ4, int32_t yQ4);
+
+    /**
+     * @brief Almeno due misure ravvicinate: velocità significativa
+     */
+    bool isTracking() const { return _updates >= 2; }
+
+    bool hasEstimate() const { return _updates > 0; }
+
+    const State& getState() const { return _state; }
+
+    /**
+     * @brief Stato estrapolato di frames frame in avanti (latenza della pipeline)
+     */
+    State predictAhead(uint8_t frames) const;
+
+    uint8_t getCoastFrames() const { return _coastFrames; }
+
+private:
+    struct Axis {
+        int32_t p00;        // Varianza posizione, (px Q4)^2
+        int32_t p01;
+        int32_t p11;        // Varianza velocità
+    };
+
+    State _state;
+    Axis _axisX;
+    Axis _axisY;
+    uint16_t _updates;
+    uint8_t _coastFrames;
+
+    void _start(int32_t xQ4, int32_t yQ4);
+    static void _predictAxis(int32_t& pos, int32_t vel, Axis& p);
+    static int32_t _innovationGate(const Axis& p);
+    static void _updateAxis(int32_t& pos, int32_t& vel, Axis& p, int32_t innovation);
+};
+
+#endif // CENTROID_TRACKER_H
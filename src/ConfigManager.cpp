@@ -1,6 +1,21 @@
 #include "ConfigManager.h"
-
- 
+#include <Preferences.h>
+#include <esp_rom_crc.h>
+#include "LedStateStore.h"
+
+// Copia della fast cache che sopravvive al deep sleep (evita anche la lettura NVS)
+static RTC_DATA_ATTR uint8_t gRtcFastCache[sizeof(ConfigManager::FastCache)];
+
+static constexpr const char* FAST_CACHE_NVS_NAMESPACE = "ledsaber";
+static constexpr const char* FAST_CACHE_NVS_KEY = "fastcfg";
+
+// minIntensity di questi slot ha già le chiavi storiche gestureIgnitionMin/RetractMin/ClashMin
+static bool isLegacyRuleField(uint8_t slot, uint8_t field) {
+    return field == GestureStateMachine::FIELD_MIN_INTENSITY &&
+           (slot == GestureStateMachine::SLOT_IGNITION ||
+            slot == GestureStateMachine::SLOT_RETRACT ||
+            slot == GestureStateMachine::SLOT_CLASH);
+}
 
 ConfigManager::ConfigManager(LedState* state) {
     ledState = state;
@@ -39,6 +54,9 @@ bool ConfigManager::begin() {
 bool ConfigManager::loadConfig() {
     Serial.println("[CONFIG] Loading /config.json...");
 
+    // Il loop può già renderizzare (boot a stadi): modifica il master sotto lock
+    LedStateStore::Transaction tx;
+
     if (!LittleFS.exists(CONFIG_FILE)) {
         Serial.println("[CONFIG] File not found - first boot, using defaults");
         createDefaultConfig();
@@ -78,6 +96,9 @@ bool ConfigManager::loadConfig() {
     ledState->autoIgnitionOnBoot = doc["autoIgnitionOnBoot"] | defaults.autoIgnitionOnBoot;
     ledState->autoIgnitionDelayMs = doc["autoIgnitionDelayMs"] | defaults.autoIgnitionDelayMs;
     ledState->motionOnBoot = doc["motionOnBoot"] | defaults.motionOnBoot;
+    ledState->sentryModeEnabled = doc["sentryModeEnabled"] | defaults.sentryModeEnabled;
+    ledState->sentryIntervalSec = doc["sentryIntervalSec"] | defaults.sentryIntervalSec;
+    ledState->sentryThresholdPct = doc["sentryThresholdPct"] | defaults.sentryThresholdPct;
     ledState->gestureClashEffect = doc["gestureClashEffect"] | defaults.gestureClashEffect;
     ledState->gestureClashDurationMs = doc["gestureClashDurationMs"] | defaults.gestureClashDurationMs;
 
@@ -86,23 +107,42 @@ bool ConfigManager::loadConfig() {
         uint8_t quality = doc["motionQuality"] | defaults.motionQuality;
         uint8_t intensity = doc["motionIntensityMin"] | defaults.motionIntensityMin;
         float speed = doc["motionSpeedMin"] | defaults.motionSpeedMin;
+        uint16_t mountAngle = doc["motionMountAngle"] | defaults.motionMountAngle;
         
         motionDetector->setQuality(quality);
         motionDetector->setMotionIntensityThreshold(intensity);
         motionDetector->setMotionSpeedThreshold(speed);
+        motionDetector->setMountAngle(mountAngle);
     }
 
     if (motionProcessor) {
         MotionProcessor::Config cfg = motionProcessor->getConfig();
         cfg.gesturesEnabled = doc["gesturesEnabled"] | defaults.gesturesEnabled;
-        cfg.ignitionIntensityThreshold = doc["gestureIgnitionMin"] | defaults.gestureIgnitionMin;
-        cfg.retractIntensityThreshold = doc["gestureRetractMin"] | defaults.gestureRetractMin;
-        cfg.clashIntensityThreshold = doc["gestureClashMin"] | defaults.gestureClashMin;
+        cfg.classifierEnabled = doc["gestureClassifier"] | defaults.gestureClassifier;
+        cfg.egoCompensation = doc["egoCompensation"] | defaults.egoCompensation;
+        cfg.rules[GestureStateMachine::SLOT_IGNITION].minIntensity = doc["gestureIgnitionMin"] | defaults.gestureIgnitionMin;
+        cfg.rules[GestureStateMachine::SLOT_RETRACT].minIntensity = doc["gestureRetractMin"] | defaults.gestureRetractMin;
+        cfg.rules[GestureStateMachine::SLOT_CLASH].minIntensity = doc["gestureClashMin"] | defaults.gestureClashMin;
         cfg.effectOnUp = doc["effectMapUp"] | defaults.effectMapUp;
         cfg.effectOnDown = doc["effectMapDown"] | defaults.effectMapDown;
         cfg.effectOnLeft = doc["effectMapLeft"] | defaults.effectMapLeft;
         cfg.effectOnRight = doc["effectMapRight"] | defaults.effectMapRight;
-        
+
+        // Tabella gesture: default + campi salvati (minIntensity di clash/retract/ignition
+        // resta sulle chiavi storiche gesture*Min)
+        for (uint8_t slot = 0; slot < GestureStateMachine::SLOT_COUNT; slot++) {
+            JsonObject saved = doc["gestureRules"][GestureStateMachine::slotToString(slot)];
+            for (uint8_t field = 0; field < GestureStateMachine::FIELD_COUNT; field++) {
+                if (isLegacyRuleField(slot, field)) {
+                    continue;
+                }
+                JsonVariant value = saved[GestureStateMachine::fieldToString(field)];
+                GestureStateMachine::setField(cfg.rules[slot], field, value.isNull()
+                    ? GestureStateMachine::getField(GestureStateMachine::DEFAULT_RULES[slot], field)
+                    : value.as<long>());
+            }
+        }
+
         motionProcessor->setConfig(cfg);
     }
 
@@ -119,6 +159,14 @@ bool ConfigManager::loadConfig() {
         ledState->autoIgnitionDelayMs = defaults.autoIgnitionDelayMs;
     }
 
+    // Validazione sentry (risveglio 2s..1h, soglia 1..100%)
+    if (ledState->sentryIntervalSec < 2 || ledState->sentryIntervalSec > 3600) {
+        ledState->sentryIntervalSec = defaults.sentryIntervalSec;
+    }
+    if (ledState->sentryThresholdPct == 0 || ledState->sentryThresholdPct > 100) {
+        ledState->sentryThresholdPct = defaults.sentryThresholdPct;
+    }
+
     // Validazione foldPoint: deve essere tra 1 e 143 (NUM_LEDS-1)
     if (ledState->foldPoint == 0 || ledState->foldPoint >= 144) {
         ledState->foldPoint = 72;  // Fallback a metà di 144
@@ -136,16 +184,19 @@ bool ConfigManager::loadConfig() {
         ledState->enabled, ledState->statusLedEnabled, ledState->statusLedBrightness);
     
     if (motionDetector) {
-        Serial.printf("[CONFIG] Motion: quality=%d, intMin=%d, speedMin=%.2f\n",
+        Serial.printf("[CONFIG] Motion: quality=%d, intMin=%d, speedMin=%.2f, mount=%u\n",
             motionDetector->getQuality(), 
             motionDetector->getMotionIntensityThreshold(), 
-            motionDetector->getMotionSpeedThreshold());
+            motionDetector->getMotionSpeedThreshold(),
+            motionDetector->getMountAngle());
     }
 
     return true;
 }
 
 bool ConfigManager::saveConfig() {
+    // Lock anche in lettura: effect/gestureClashEffect sono String scritte dal task BLE
+    LedStateStore::Transaction tx;
     JsonDocument doc;
     int modifiedCount = 0;
 
@@ -196,6 +247,18 @@ bool ConfigManager::saveConfig() {
         doc["motionOnBoot"] = ledState->motionOnBoot;
         modifiedCount++;
     }
+    if (ledState->sentryModeEnabled != defaults.sentryModeEnabled) {
+        doc["sentryModeEnabled"] = ledState->sentryModeEnabled;
+        modifiedCount++;
+    }
+    if (ledState->sentryIntervalSec != defaults.sentryIntervalSec) {
+        doc["sentryIntervalSec"] = ledState->sentryIntervalSec;
+        modifiedCount++;
+    }
+    if (ledState->sentryThresholdPct != defaults.sentryThresholdPct) {
+        doc["sentryThresholdPct"] = ledState->sentryThresholdPct;
+        modifiedCount++;
+    }
     if (ledState->gestureClashEffect != defaults.gestureClashEffect) {
         doc["gestureClashEffect"] = ledState->gestureClashEffect;
         modifiedCount++;
@@ -219,6 +282,10 @@ bool ConfigManager::saveConfig() {
             doc["motionSpeedMin"] = motionDetector->getMotionSpeedThreshold();
             modifiedCount++;
         }
+        if (motionDetector->getMountAngle() != defaults.motionMountAngle) {
+            doc["motionMountAngle"] = motionDetector->getMountAngle();
+            modifiedCount++;
+        }
     }
 
     if (motionProcessor) {
@@ -227,18 +294,37 @@ bool ConfigManager::saveConfig() {
             doc["gesturesEnabled"] = cfg.gesturesEnabled;
             modifiedCount++;
         }
-        if (cfg.ignitionIntensityThreshold != defaults.gestureIgnitionMin) {
-            doc["gestureIgnitionMin"] = cfg.ignitionIntensityThreshold;
+        if (cfg.classifierEnabled != defaults.gestureClassifier) {
+            doc["gestureClassifier"] = cfg.classifierEnabled;
+            modifiedCount++;
+        }
+        if (cfg.egoCompensation != defaults.egoCompensation) {
+            doc["egoCompensation"] = cfg.egoCompensation;
+            modifiedCount++;
+        }
+        if (cfg.rules[GestureStateMachine::SLOT_IGNITION].minIntensity != defaults.gestureIgnitionMin) {
+            doc["gestureIgnitionMin"] = cfg.rules[GestureStateMachine::SLOT_IGNITION].minIntensity;
             modifiedCount++;
         }
-        if (cfg.retractIntensityThreshold != defaults.gestureRetractMin) {
-            doc["gestureRetractMin"] = cfg.retractIntensityThreshold;
+        if (cfg.rules[GestureStateMachine::SLOT_RETRACT].minIntensity != defaults.gestureRetractMin) {
+            doc["gestureRetractMin"] = cfg.rules[GestureStateMachine::SLOT_RETRACT].minIntensity;
             modifiedCount++;
         }
-        if (cfg.clashIntensityThreshold != defaults.gestureClashMin) {
-            doc["gestureClashMin"] = cfg.clashIntensityThreshold;
+        if (cfg.rules[GestureStateMachine::SLOT_CLASH].minIntensity != defaults.gestureClashMin) {
+            doc["gestureClashMin"] = cfg.rules[GestureStateMachine::SLOT_CLASH].minIntensity;
             modifiedCount++;
         }
+        for (uint8_t slot = 0; slot < GestureStateMachine::SLOT_COUNT; slot++) {
+            for (uint8_t field = 0; field < GestureStateMachine::FIELD_COUNT; field++) {
+                const uint32_t value = GestureStateMachine::getField(cfg.rules[slot], field);
+                if (isLegacyRuleField(slot, field) ||
+                    value == GestureStateMachine::getField(GestureStateMachine::DEFAULT_RULES[slot], field)) {
+                    continue;
+                }
+                doc["gestureRules"][GestureStateMachine::slotToString(slot)][GestureStateMachine::fieldToString(field)] = value;
+                modifiedCount++;
+            }
+        }
         if (cfg.effectOnUp != defaults.effectMapUp) {
             doc["effectMapUp"] = cfg.effectOnUp;
             modifiedCount++;
@@ -263,6 +349,7 @@ bool ConfigManager::saveConfig() {
             Serial.println("[CONFIG] All values match defaults - removing config file");
             LittleFS.remove(CONFIG_FILE);
         }
+        saveFastCache();
         return true;
     }
 
@@ -285,12 +372,106 @@ bool ConfigManager::saveConfig() {
     Serial.printf("[CONFIG] Filesystem: %lu/%lu bytes used\n",
         LittleFS.usedBytes(), LittleFS.totalBytes());
 
+    saveFastCache();
+    return true;
+}
+
+// ============================================================================
+// FAST CACHE (boot veloce)
+// ============================================================================
+
+static uint32_t fastCacheCrc(const ConfigManager::FastCache& cache) {
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&cache),
+                            offsetof(ConfigManager::FastCache, crc));
+}
+
+bool ConfigManager::loadFastCache() {
+    FastCache cache;
+    const char* source = "RTC";
+
+    memcpy(&cache, gRtcFastCache, sizeof(cache));
+    if (cache.magic != FAST_CACHE_MAGIC || cache.version != FAST_CACHE_VERSION ||
+        cache.crc != fastCacheCrc(cache)) {
+        // Power-on: RTC vuota, prova il blob NVS (molto più rapido di LittleFS + JSON)
+        source = "NVS";
+        Preferences prefs;
+        if (!prefs.begin(FAST_CACHE_NVS_NAMESPACE, true)) {
+            return false;
+        }
+        const size_t len = prefs.getBytes(FAST_CACHE_NVS_KEY, &cache, sizeof(cache));
+        prefs.end();
+
+        if (len != sizeof(cache) || cache.magic != FAST_CACHE_MAGIC ||
+            cache.version != FAST_CACHE_VERSION || cache.crc != fastCacheCrc(cache)) {
+            Serial.println("[CONFIG] Fast cache not available");
+            return false;
+        }
+        memcpy(gRtcFastCache, &cache, sizeof(cache));
+    }
+
+    cache.effect[sizeof(cache.effect) - 1] = '\0';
+
+    LedStateStore::Transaction tx;
+
+    ledState->r = cache.r;
+    ledState->g = cache.g;
+    ledState->b = cache.b;
+    ledState->brightness = cache.brightness;
+    ledState->speed = cache.speed;
+    ledState->statusLedBrightness = cache.statusLedBrightness;
+    ledState->foldPoint = (cache.foldPoint == 0 || cache.foldPoint >= 144) ? defaults.foldPoint : cache.foldPoint;
+    ledState->enabled = cache.enabled;
+    ledState->statusLedEnabled = cache.statusLedEnabled;
+    ledState->autoIgnitionOnBoot = cache.autoIgnitionOnBoot;
+    ledState->motionOnBoot = cache.motionOnBoot;
+    ledState->autoIgnitionDelayMs = min<uint32_t>(cache.autoIgnitionDelayMs, 60000);
+    ledState->effect = cache.effect;
+
+    Serial.printf("[CONFIG] Fast cache loaded from %s: effect=%s, brightness=%d\n",
+        source, ledState->effect.c_str(), ledState->brightness);
     return true;
 }
 
+void ConfigManager::saveFastCache() {
+    FastCache cache;
+    memset(&cache, 0, sizeof(cache));
+
+    LedStateStore::Transaction tx;
+    cache.magic = FAST_CACHE_MAGIC;
+    cache.version = FAST_CACHE_VERSION;
+    cache.r = ledState->r;
+    cache.g = ledState->g;
+    cache.b = ledState->b;
+    cache.brightness = ledState->brightness;
+    cache.speed = ledState->speed;
+    cache.statusLedBrightness = ledState->statusLedBrightness;
+    cache.foldPoint = ledState->foldPoint;
+    cache.enabled = ledState->enabled;
+    cache.statusLedEnabled = ledState->statusLedEnabled;
+    cache.autoIgnitionOnBoot = ledState->autoIgnitionOnBoot;
+    cache.motionOnBoot = ledState->motionOnBoot;
+    cache.autoIgnitionDelayMs = ledState->autoIgnitionDelayMs;
+    strlcpy(cache.effect, ledState->effect.c_str(), sizeof(cache.effect));
+    cache.crc = fastCacheCrc(cache);
+
+    memcpy(gRtcFastCache, &cache, sizeof(cache));
+
+    Preferences prefs;
+    if (!prefs.begin(FAST_CACHE_NVS_NAMESPACE, false)) {
+        Serial.println("[CONFIG ERROR] Failed to open NVS for fast cache");
+        return;
+    }
+    if (prefs.putBytes(FAST_CACHE_NVS_KEY, &cache, sizeof(cache)) != sizeof(cache)) {
+        Serial.println("[CONFIG ERROR] Failed to write fast cache");
+    }
+    prefs.end();
+}
+
 void ConfigManager::resetToDefaults() {
     Serial.println("[CONFIG] Resetting to defaults...");
 
+    LedStateStore::Transaction tx;
+
     ledState->brightness = defaults.brightness;
     ledState->r = defaults.r;
     ledState->g = defaults.g;
@@ -304,6 +485,9 @@ void ConfigManager::resetToDefaults() {
     ledState->autoIgnitionOnBoot = defaults.autoIgnitionOnBoot;
     ledState->autoIgnitionDelayMs = defaults.autoIgnitionDelayMs;
     ledState->motionOnBoot = defaults.motionOnBoot;
+    ledState->sentryModeEnabled = defaults.sentryModeEnabled;
+    ledState->sentryIntervalSec = defaults.sentryIntervalSec;
+    ledState->sentryThresholdPct = defaults.sentryThresholdPct;
     ledState->gestureClashEffect = defaults.gestureClashEffect;
     ledState->gestureClashDurationMs = defaults.gestureClashDurationMs;
 
@@ -311,13 +495,16 @@ void ConfigManager::resetToDefaults() {
         motionDetector->setQuality(defaults.motionQuality);
         motionDetector->setMotionIntensityThreshold(defaults.motionIntensityMin);
         motionDetector->setMotionSpeedThreshold(defaults.motionSpeedMin);
+        motionDetector->setMountAngle(defaults.motionMountAngle);
     }
     if (motionProcessor) {
         MotionProcessor::Config cfg;
         cfg.gesturesEnabled = defaults.gesturesEnabled;
-        cfg.ignitionIntensityThreshold = defaults.gestureIgnitionMin;
-        cfg.retractIntensityThreshold = defaults.gestureRetractMin;
-        cfg.clashIntensityThreshold = defaults.gestureClashMin;
+        cfg.classifierEnabled = defaults.gestureClassifier;
+        cfg.egoCompensation = defaults.egoCompensation;
+        cfg.rules[GestureStateMachine::SLOT_IGNITION].minIntensity = defaults.gestureIgnitionMin;
+        cfg.rules[GestureStateMachine::SLOT_RETRACT].minIntensity = defaults.gestureRetractMin;
+        cfg.rules[GestureStateMachine::SLOT_CLASH].minIntensity = defaults.gestureClashMin;
         cfg.effectOnUp = defaults.effectMapUp;
         cfg.effectOnDown = defaults.effectMapDown;
         cfg.effectOnLeft = defaults.effectMapLeft;
@@ -329,6 +516,7 @@ void ConfigManager::resetToDefaults() {
         LittleFS.remove(CONFIG_FILE);
         Serial.println("[CONFIG] Config file removed");
     }
+    saveFastCache();
 
     Serial.println("[CONFIG] Reset complete - all defaults restored");
 }
@@ -367,6 +555,7 @@ void ConfigManager::printDebugInfo() {
 }
 
 void ConfigManager::createDefaultConfig() {
+    LedStateStore::Transaction tx;
     ledState->brightness = defaults.brightness;
     ledState->r = defaults.r;
     ledState->g = defaults.g;
@@ -380,6 +569,9 @@ void ConfigManager::createDefaultConfig() {
     ledState->autoIgnitionOnBoot = defaults.autoIgnitionOnBoot;
     ledState->autoIgnitionDelayMs = defaults.autoIgnitionDelayMs;
     ledState->motionOnBoot = defaults.motionOnBoot;
+    ledState->sentryModeEnabled = defaults.sentryModeEnabled;
+    ledState->sentryIntervalSec = defaults.sentryIntervalSec;
+    ledState->sentryThresholdPct = defaults.sentryThresholdPct;
     ledState->gestureClashEffect = defaults.gestureClashEffect;
     ledState->gestureClashDurationMs = defaults.gestureClashDurationMs;
 
@@ -387,13 +579,16 @@ void ConfigManager::createDefaultConfig() {
         motionDetector->setQuality(defaults.motionQuality);
         motionDetector->setMotionIntensityThreshold(defaults.motionIntensityMin);
         motionDetector->setMotionSpeedThreshold(defaults.motionSpeedMin);
+        motionDetector->setMountAngle(defaults.motionMountAngle);
     }
     if (motionProcessor) {
         MotionProcessor::Config cfg;
         cfg.gesturesEnabled = defaults.gesturesEnabled;
-        cfg.ignitionIntensityThreshold = defaults.gestureIgnitionMin;
-        cfg.retractIntensityThreshold = defaults.gestureRetractMin;
-        cfg.clashIntensityThreshold = defaults.gestureClashMin;
+        cfg.classifierEnabled = defaults.gestureClassifier;
+        cfg.egoCompensation = defaults.egoCompensation;
+        cfg.rules[GestureStateMachine::SLOT_IGNITION].minIntensity = defaults.gestureIgnitionMin;
+        cfg.rules[GestureStateMachine::SLOT_RETRACT].minIntensity = defaults.gestureRetractMin;
+        cfg.rules[GestureStateMachine::SLOT_CLASH].minIntensity = defaults.gestureClashMin;
         cfg.effectOnUp = defaults.effectMapUp;
         cfg.effectOnDown = defaults.effectMapDown;
         cfg.effectOnLeft = defaults.effectMapLeft;
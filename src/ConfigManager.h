@@ -29,16 +29,22 @@ private:
         bool autoIgnitionOnBoot = true;
         uint32_t autoIgnitionDelayMs = 2000;
         bool motionOnBoot = false;
+        bool sentryModeEnabled = false;
+        uint16_t sentryIntervalSec = 10;
+        uint8_t sentryThresholdPct = 4;
         String gestureClashEffect = "clash";
         uint16_t gestureClashDurationMs = 500;
         // Motion defaults
         uint8_t motionQuality = 160;
         uint8_t motionIntensityMin = 6;
         float motionSpeedMin = 0.4f;
+        uint16_t motionMountAngle = 0;      // Gradi, da "calibrate"; 0 = frame sensore delle gesture storiche
         uint8_t gestureIgnitionMin = 15;
         uint8_t gestureRetractMin = 15;
         uint8_t gestureClashMin = 15;
         bool gesturesEnabled = true;
+        bool gestureClassifier = false;
+        bool egoCompensation = false;
         String effectMapUp = "";
         String effectMapDown = "";
         String effectMapLeft = "";
@@ -50,12 +56,35 @@ private:
     void createDefaultConfig();
 
 public:
+    // Cache binaria dei campi necessari per accendere la lama (fast boot).
+    // Copia in RTC memory (wake da deep sleep) + blob NVS (power-on).
+    static constexpr uint32_t FAST_CACHE_MAGIC = 0x4C534643;  // "LSFC"
+    static constexpr uint16_t FAST_CACHE_VERSION = 1;
+    struct FastCache {
+        uint32_t magic;
+        uint16_t version;
+        uint8_t r, g, b;
+        uint8_t brightness;
+        uint8_t speed;
+        uint8_t statusLedBrightness;
+        uint8_t foldPoint;
+        bool enabled;
+        bool statusLedEnabled;
+        bool autoIgnitionOnBoot;
+        bool motionOnBoot;
+        uint32_t autoIgnitionDelayMs;
+        char effect[24];
+        uint32_t crc;  // CRC32 di tutti i campi precedenti
+    };
+
     explicit ConfigManager(LedState* state);
 
     void setMotionComponents(OpticalFlowDetector* detector, MotionProcessor* processor);
     bool begin();           // Inizializza LittleFS e carica config
     bool loadConfig();      // Carica config da JSON
     bool saveConfig();      // Salva SOLO valori diversi dai default
+    bool loadFastCache();   // Carica i campi lama da RTC/NVS senza montare LittleFS
+    void saveFastCache();   // Aggiorna cache RTC + NVS (chiamato da saveConfig)
     void resetToDefaults(); // Ripristina default ed elimina config.json
     void printDebugInfo();  // Stampa stato filesystem e config
 };
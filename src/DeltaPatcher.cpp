@@ -0,0 +1,153 @@
+#include "DeltaPatcher.h"
+
+void DeltaPatcher::begin(uint32_t sourceSize, SourceReader reader, void* readerContext) {
+    _reader = reader;
+    _readerContext = readerContext;
+    _sourceSize = sourceSize;
+    _sourcePos = 0;
+    _active = true;
+    _corrupt = false;
+    _state = STATE_HEADER;
+    _varint = 0;
+    _varintShift = 0;
+    _remaining = 0;
+    _outputBytes = 0;
+}
+
+void DeltaPatcher::end() {
+    _active = false;
+    _reader = nullptr;
+    _readerContext = nullptr;
+}
+
+bool DeltaPatcher::_fail() {
+    _corrupt = true;
+    return false;
+}
+
+bool DeltaPatcher::_readSource(uint32_t length) {
+    if (!_reader(_readerContext, _sourcePos, _source, length)) {
+        return false;
+    }
+    _sourcePos += length;
+    return true;
+}
+
+bool DeltaPatcher::_copy(uint32_t length, Sink sink, void* context) {
+    while (length > 0) {
+        const uint32_t n = length < BLOCK_SIZE ? length : (uint32_t)BLOCK_SIZE;
+        if (!_readSource(n) || !sink(context, _source, n)) {
+            return false;
+        }
+        _outputBytes += n;
+        length -= n;
+    }
+    return true;
+}
+
+bool DeltaPatcher::feed(const uint8_t* data, size_t length, Sink sink, void* context) {
+    if (!_active || _corrupt) {
+        return false;
+    }
+
+    size_t pos = 0;
+    while (pos < length) {
+        switch (_state) {
+            case STATE_HEADER: {
+                const uint8_t byte = data[pos++];
+                _varint |= (uint32_t)(byte & 0x7F) << _varintShift;
+                _varintShift += 7;
+                if (byte & 0x80) {
+                    if (_varintShift >= 35) {
+                        return _fail();
+                    }
+                    break;
+                }
+
+                const uint8_t op = _varint & 0x03;
+                const uint32_t n = _varint >> 2;
+                _varint = 0;
+                _varintShift = 0;
+
+                // Nessuna operazione può leggere oltre la sorgente
+                const uint32_t available = _sourceSize - _sourcePos;
+                switch (op) {
+                    case OP_COPY:
+                        if (n > available) {
+                            return _fail();
+                        }
+                        if (!_copy(n, sink, context)) {
+                            return false;
+                        }
+                        break;
+                    case OP_DIFF:
+                        if (n > available) {
+                            return _fail();
+                        }
+                        _remaining = n;
+                        _state = n > 0 ? STATE_DIFF : STATE_HEADER;
+                        break;
+                    case OP_EXTRA:
+                        _remaining = n;
+                        _state = n > 0 ? STATE_EXTRA : STATE_HEADER;
+                        break;
+                    case OP_SEEK: {
+                        const uint32_t magnitude = (n >> 1) + (n & 1);
+                        if (n & 1) {
+                            if (magnitude > _sourcePos) {
+                                return _fail();
+                            }
+                            _sourcePos -= magnitude;
+                        } else {
+                            if (magnitude > available) {
+                                return _fail();
+                            }
+                            _sourcePos += magnitude;
+                        }
+                        break;
+                    }
+                }
+                break;
+            }
+
+            case STATE_DIFF: {
+                uint32_t n = _remaining;
+                if (n > length - pos) n = (uint32_t)(length - pos);
+                if (n > BLOCK_SIZE) n = BLOCK_SIZE;
+                if (!_readSource(n)) {
+                    return false;
+                }
+                for (uint32_t i = 0; i < n; i++) {
+                    _out[i] = (uint8_t)(_source[i] + data[pos + i]);
+                }
+                if (!sink(context, _out, n)) {
+                    return false;
+                }
+                _outputBytes += n;
+                pos += n;
+                _remaining -= n;
+                if (_remaining == 0) {
+                    _state = STATE_HEADER;
+                }
+                break;
+            }
+
+            case STATE_EXTRA: {
+                uint32_t n = _remaining;
+                if (n > length - pos) n = (uint32_t)(length - pos);
+                if (n > BLOCK_SIZE) n = BLOCK_SIZE;
+                if (!sink(context, data + pos, n)) {
+                    return false;
+                }
+                _outputBytes += n;
+                pos += n;
+                _remaining -= n;
+                if (_remaining == 0) {
+                    _state = STATE_HEADER;
+                }
+                break;
+            }
+        }
+    }
+    return true;
+}
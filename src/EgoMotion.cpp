@@ -0,0 +1,245 @@
+#include "EgoMotion.h"
+#include <math.h>
+#include <string.h>
+
+namespace {
+constexpr float MAD_TO_SIGMA = 1.4826f;
+constexpr float LOCAL_FULL_SCALE_PX = 10.0f;    // Residuo che satura localIntensity
+constexpr uint8_t RESIDUAL_BINS_PER_PX = 8;
+constexpr uint8_t RESIDUAL_BINS = 128;          // Fino a 16 px, oltre nell'ultimo bin
+
+struct Point {
+    float x;        // Mezze celle dal centro griglia
+    float y;
+    float dx;
+    float dy;
+    float w;        // Confidenza 0-1
+    uint8_t index;
+};
+
+struct Params {
+    float tx, ty;
+    float a11, a12, a21, a22;
+};
+
+// Mediane per istogramma (O(n), niente ordinamento: nth_element su 64 float
+// costava più di tutto il resto della stima)
+int8_t medianInt8(const int8_t* values, uint8_t count) {
+    uint8_t hist[256] = {};
+    uint8_t lo = 255;
+    uint8_t hi = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        const uint8_t bin = (uint8_t)(values[i] + 128);
+        hist[bin]++;
+        if (bin < lo) lo = bin;
+        if (bin > hi) hi = bin;
+    }
+    uint8_t seen = 0;
+    for (uint16_t bin = lo; bin <= hi; bin++) {
+        seen += hist[bin];
+        if (seen * 2 > count) {
+            return (int8_t)(bin - 128);
+        }
+    }
+    return 0;
+}
+
+float medianResidual(const float* values, uint8_t count) {
+    uint8_t hist[RESIDUAL_BINS] = {};
+    for (uint8_t i = 0; i < count; i++) {
+        const float bin = values[i] * RESIDUAL_BINS_PER_PX;
+        hist[bin < RESIDUAL_BINS - 1 ? (uint8_t)bin : RESIDUAL_BINS - 1]++;
+    }
+    uint8_t seen = 0;
+    for (uint8_t bin = 0; bin < RESIDUAL_BINS; bin++) {
+        seen += hist[bin];
+        if (seen * 2 > count) {
+            return (bin + 0.5f) / RESIDUAL_BINS_PER_PX;
+        }
+    }
+    return (float)RESIDUAL_BINS / RESIDUAL_BINS_PER_PX;
+}
+
+// Residuo L1 del blocco rispetto al modello
+float residual(const Point& p, const Params& m, float* outRx, float* outRy) {
+    const float rx = p.dx - (m.tx + m.a11 * p.x + m.a12 * p.y);
+    const float ry = p.dy - (m.ty + m.a21 * p.x + m.a22 * p.y);
+    if (outRx) *outRx = rx;
+    if (outRy) *outRy = ry;
+    return fabsf(rx) + fabsf(ry);
+}
+
+int8_t sat8(float value) {
+    const long rounded = lroundf(value);
+    if (rounded > 127) return 127;
+    if (rounded < -127) return -127;
+    return (int8_t)rounded;
+}
+
+// Minimi quadrati pesati: affine se i pesi coprono un'area (sistema 3x3 ben
+// condizionato), altrimenti traslazione. false se tutti i pesi sono nulli.
+bool fit(const Point* pts, const float* weights, uint8_t count, bool allowAffine,
+         Params& m, EgoMotion::Model& model) {
+    float s = 0, sx = 0, sy = 0, sxx = 0, sxy = 0, syy = 0;
+    float bx0 = 0, bx1 = 0, bx2 = 0, by0 = 0, by1 = 0, by2 = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        const float w = weights[i];
+        if (w <= 0.0f) continue;
+        const Point& p = pts[i];
+        s += w;
+        sx += w * p.x;
+        sy += w * p.y;
+        sxx += w * p.x * p.x;
+        sxy += w * p.x * p.y;
+        syy += w * p.y * p.y;
+        bx0 += w * p.dx;
+        bx1 += w * p.dx * p.x;
+        bx2 += w * p.dx * p.y;
+        by0 += w * p.dy;
+        by1 += w * p.dy * p.x;
+        by2 += w * p.dy * p.y;
+    }
+    if (s <= 0.0f) {
+        return false;
+    }
+
+    if (allowAffine) {
+        // Inversa per aggiunta (matrice simmetrica)
+        const float c00 = sxx * syy - sxy * sxy;
+        const float c01 = sy * sxy - sx * syy;
+        const float c02 = sx * sxy - sy * sxx;
+        const float c11 = s * syy - sy * sy;
+        const float c12 = sx * sy - s * sxy;
+        const float c22 = s * sxx - sx * sx;
+        const float det = s * c00 + sx * c01 + sy * c02;
+        // det / s^3 ~ varianza x * varianza y: < 1 = blocchi su una sola riga/colonna
+        if (det > s * s * s) {
+            const float inv = 1.0f / det;
+            m.tx = (c00 * bx0 + c01 * bx1 + c02 * bx2) * inv;
+            m.a11 = (c01 * bx0 + c11 * bx1 + c12 * bx2) * inv;
+            m.a12 = (c02 * bx0 + c12 * bx1 + c22 * bx2) * inv;
+            m.ty = (c00 * by0 + c01 * by1 + c02 * by2) * inv;
+            m.a21 = (c01 * by0 + c11 * by1 + c12 * by2) * inv;
+            m.a22 = (c02 * by0 + c12 * by1 + c22 * by2) * inv;
+            model = EgoMotion::Model::AFFINE;
+            return true;
+        }
+    }
+
+    m.tx = bx0 / s;
+    m.ty = by0 / s;
+    m.a11 = m.a12 = m.a21 = m.a22 = 0.0f;
+    model = EgoMotion::Model::TRANSLATION;
+    return true;
+}
+}
+
+bool EgoMotion::estimate(const Vector* vectors, Estimate& out, int16_t cosQ14, int16_t sinQ14) {
+    memset(&out, 0, sizeof(out));
+    const float c = cosQ14 / 16384.0f;
+    const float s = sinQ14 / 16384.0f;
+
+    Point pts[BLOCK_COUNT];
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < BLOCK_COUNT; i++) {
+        const Vector& v = vectors[i];
+        if (!v.valid || v.confidence == 0) {
+            continue;
+        }
+        Point& p = pts[count++];
+        const float cx = (float)(2 * (i % GRID_COLS) - (GRID_COLS - 1));
+        const float cy = (float)(2 * (i / GRID_COLS) - (GRID_ROWS - 1));
+        p.x = cx * c - cy * s;
+        p.y = cx * s + cy * c;
+        p.dx = v.dx;
+        p.dy = v.dy;
+        p.w = v.confidence / 255.0f;
+        p.index = i;
+    }
+    out.validBlocks = count;
+
+    if (count < 2) {
+        // Nessun riferimento globale: tutto il moto è locale
+        out.model = Model::NONE;
+        for (uint8_t i = 0; i < count; i++) {
+            out.localDx[pts[i].index] = (int8_t)pts[i].dx;
+            out.localDy[pts[i].index] = (int8_t)pts[i].dy;
+            out.outlierMask |= 1ULL << pts[i].index;
+        }
+        return false;
+    }
+
+    // Partenza: mediana per componente (robusta fino a metà blocchi fuori modello)
+    int8_t components[BLOCK_COUNT];
+    Params m = {};
+    for (uint8_t i = 0; i < count; i++) components[i] = vectors[pts[i].index].dx;
+    m.tx = medianInt8(components, count);
+    for (uint8_t i = 0; i < count; i++) components[i] = vectors[pts[i].index].dy;
+    m.ty = medianInt8(components, count);
+    Model model = Model::TRANSLATION;
+
+    float residuals[BLOCK_COUNT];
+    float weights[BLOCK_COUNT];
+    for (uint8_t pass = 0; pass <= ITERATIONS; pass++) {
+        for (uint8_t i = 0; i < count; i++) {
+            residuals[i] = residual(pts[i], m, nullptr, nullptr);
+        }
+        out.residualScale = fmaxf(MIN_RESIDUAL_SCALE, MAD_TO_SIGMA * medianResidual(residuals, count));
+        const float invCutoff = 1.0f / (TUKEY_K * out.residualScale);
+
+        uint8_t inliers = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            const float u = residuals[i] * invCutoff;
+            if (u < 1.0f) {
+                const float t = 1.0f - u * u;
+                weights[i] = pts[i].w * t * t;
+                inliers++;
+            } else {
+                weights[i] = 0.0f;
+            }
+        }
+        out.inliers = inliers;
+        if (pass == ITERATIONS) {
+            break;  // Ultima passata: solo classificazione con il modello finale
+        }
+        fit(pts, weights, count, inliers >= AFFINE_MIN_BLOCKS, m, model);
+    }
+
+    out.model = model;
+    out.tx = m.tx;
+    out.ty = m.ty;
+    out.a11 = m.a11;
+    out.a12 = m.a12;
+    out.a21 = m.a21;
+    out.a22 = m.a22;
+    out.zoom = 0.5f * (m.a11 + m.a22);
+    out.rotation = 0.5f * (m.a21 - m.a12);
+
+    // Moto locale: residuo dei soli blocchi fuori modello (quelli coerenti sono rumore)
+    float localSum = 0.0f;
+    float totalWeight = 0.0f;
+    for (uint8_t i = 0; i < count; i++) {
+        const Point& p = pts[i];
+        totalWeight += p.w;
+        if (weights[i] > 0.0f) {
+            continue;
+        }
+        float rx, ry;
+        const float r = residual(p, m, &rx, &ry);
+        out.localDx[p.index] = sat8(rx);
+        out.localDy[p.index] = sat8(ry);
+        out.outlierMask |= 1ULL << p.index;
+        localSum += p.w * fminf(r / LOCAL_FULL_SCALE_PX, 1.0f);
+    }
+    out.localIntensity = (uint8_t)lroundf(255.0f * localSum / totalWeight);
+    return true;
+}
+
+const char* EgoMotion::modelToString(Model model) {
+    switch (model) {
+        case Model::NONE:        return "none";
+        case Model::TRANSLATION: return "translation";
+        case Model::AFFINE:      return "affine";
+        default:                 return "unknown";
+    }
+}
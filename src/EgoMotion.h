@@ -0,0 +1,85 @@
+#ifndef EGO_MOTION_H
+#define EGO_MOTION_H
+
+#include <stdint.h>
+
+/**
+ * @brief Stima del moto globale della camera (ego-motion) dai vettori blocco
+ *
+ * Con la camera sull'elsa, muovere la lama sposta tutta la scena: ogni blocco
+ * riceve circa lo stesso vettore. estimate() adatta ai 64 vettori un modello
+ * affine (traslazione + gradiente: zoom, rotazione, taglio) con minimi quadrati
+ * robusti: partenza dalla mediana, poi ITERATIONS passi di IRLS con pesi di
+ * Tukey sulla dispersione mediana dei residui. I blocchi che restano fuori
+ * (mano, oggetti in movimento) sono il moto locale.
+ *
+ * Se i blocchi coerenti sono pochi o tutti allineati su una riga/colonna il
+ * modello ricade sulla sola traslazione. Costo fisso: ITERATIONS + 1 passate
+ * sui blocchi e un sistema 3x3, nessuna allocazione.
+ * Nessuna dipendenza da Arduino (come MotionHistory).
+ */
+class EgoMotion {
+public:
+    static constexpr uint8_t GRID_COLS = 8;
+    static constexpr uint8_t GRID_ROWS = 8;
+    static constexpr uint8_t BLOCK_COUNT = GRID_COLS * GRID_ROWS;
+    static constexpr uint8_t ITERATIONS = 3;
+    static constexpr uint8_t AFFINE_MIN_BLOCKS = 8;     // Sotto: solo traslazione
+    static constexpr float MIN_RESIDUAL_SCALE = 0.75f;  // px: sotto è quantizzazione SAD
+    static constexpr float TUKEY_K = 3.0f;              // Soglia outlier in unità di dispersione
+
+    /**
+     * @brief Vettore di un blocco (come OpticalFlowDetector::getBlockVector)
+     */
+    struct Vector {
+        int8_t dx;
+        int8_t dy;
+        uint8_t confidence;
+        bool valid;
+    };
+
+    enum class Model : uint8_t {
+        NONE = 0,           // Blocchi validi insufficienti
+        TRANSLATION,
+        AFFINE,
+    };
+
+    /**
+     * @brief Moto globale + residuo locale del frame
+     *
+     * Coordinate dei blocchi in mezze celle dal centro griglia (2*col - 7), ruotate
+     * come i vettori, come div/curl di MotionProcessor: dx(rx, ry) = tx + a11*rx + a12*ry.
+     */
+    struct Estimate {
+        Model model;
+        uint8_t validBlocks;        // Blocchi validi in ingresso
+        uint8_t inliers;            // Blocchi coerenti col modello
+        float tx;                   // Traslazione al centro griglia, px/frame
+        float ty;
+        float a11;                  // Gradiente, px/frame per mezza cella
+        float a12;
+        float a21;
+        float a22;
+        float zoom;                 // (a11 + a22) / 2: >0 la scena si espande (affondo)
+        float rotation;             // (a21 - a12) / 2: >0 orario (y verso il basso)
+        float residualScale;        // Dispersione robusta dei residui, px
+        uint8_t localIntensity;     // Moto locale 0-255 (somma residui outlier pesati)
+        uint64_t outlierMask;       // Bit row * GRID_COLS + col: blocco con moto locale
+        int8_t localDx[BLOCK_COUNT];    // Vettore - modello (0 se blocco non valido)
+        int8_t localDy[BLOCK_COUNT];
+    };
+
+    /**
+     * @brief Stima il moto globale
+     * @param vectors BLOCK_COUNT vettori, riga per riga
+     * @param cosQ14, sinQ14 rotazione di montaggio già applicata ai vettori
+     *        (OpticalFlowDetector::getMountRotationQ14): ruota le posizioni dei blocchi
+     * @return false se i blocchi validi sono meno di 2 (out.model = NONE, residui = vettori)
+     */
+    static bool estimate(const Vector* vectors, Estimate& out,
+                         int16_t cosQ14 = 16384, int16_t sinQ14 = 0);
+
+    static const char* modelToString(Model model);
+};
+
+#endif // EGO_MOTION_H
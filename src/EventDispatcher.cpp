@@ -0,0 +1,104 @@
+/**
+ * @file EventDispatcher.cpp
+ * @brief Event group + timer di render per il loop principale
+ */
+
+#include "EventDispatcher.h"
+
+// ============================================================================
+// SINGLETON ACCESS
+// ============================================================================
+
+EventDispatcher& EventDispatcher::getInstance() {
+    static EventDispatcher instance;
+    return instance;
+}
+
+// ============================================================================
+// INITIALIZATION
+// ============================================================================
+
+bool EventDispatcher::begin(uint16_t renderPeriodMs) {
+    if (_group != nullptr) {
+        return true;
+    }
+
+    _group = xEventGroupCreate();
+    if (!_group) {
+        Serial.println("[EVENTS] ✗ Failed to create event group");
+        return false;
+    }
+
+    _renderPeriodMs = renderPeriodMs > 0 ? renderPeriodMs : 1;
+    _renderTimer = xTimerCreate(
+        "RenderTick",
+        pdMS_TO_TICKS(_renderPeriodMs),
+        pdTRUE,     // auto-reload
+        nullptr,
+        _renderTimerCallback
+    );
+    if (!_renderTimer || xTimerStart(_renderTimer, 0) != pdPASS) {
+        Serial.println("[EVENTS] ✗ Failed to start render timer");
+        return false;
+    }
+
+    Serial.printf("[EVENTS] ✓ Dispatcher ready (render tick %u ms)\n", _renderPeriodMs);
+    return true;
+}
+
+// ============================================================================
+// EVENTS
+// ============================================================================
+
+void EventDispatcher::post(uint32_t events) {
+    // Le callback BLE possono arrivare prima di begin(): in quel caso il loop
+    // non è ancora in attesa e non serve svegliarlo
+    if (_group == nullptr) {
+        return;
+    }
+    xEventGroupSetBits(_group, static_cast<EventBits_t>(events));
+}
+
+uint32_t EventDispatcher::wait(uint32_t timeoutMs) {
+    if (_group == nullptr) {
+        // Fallback: nessun dispatcher, comportamento equivalente al vecchio yield()
+        yield();
+        return ALL_EVENTS;
+    }
+
+    const TickType_t ticks = (timeoutMs == portMAX_DELAY) ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+    const EventBits_t bits = xEventGroupWaitBits(
+        _group,
+        ALL_EVENTS,
+        pdTRUE,     // azzera i bit ricevuti
+        pdFALSE,    // basta un evento qualsiasi
+        ticks
+    ) & ALL_EVENTS;
+
+    _stats.wakeups++;
+    if (bits == 0) {
+        _stats.timeouts++;
+        return 0;
+    }
+    if (bits & EVENT_RENDER_TICK)  _stats.renderTicks++;
+    if (bits & EVENT_MOTION_READY) _stats.motionEvents++;
+    if (bits & EVENT_BLE_WRITE)    _stats.bleWrites++;
+    if (bits & EVENT_CONFIG_DIRTY) _stats.configEvents++;
+    if (bits & EVENT_OTA_DATA)     _stats.otaEvents++;
+
+    return static_cast<uint32_t>(bits);
+}
+
+void EventDispatcher::setRenderPeriod(uint16_t periodMs) {
+    if (periodMs == 0 || periodMs == _renderPeriodMs || _renderTimer == nullptr) {
+        return;
+    }
+    if (xTimerChangePeriod(_renderTimer, pdMS_TO_TICKS(periodMs), 0) == pdPASS) {
+        _renderPeriodMs = periodMs;
+    }
+}
+
+void EventDispatcher::_renderTimerCallback(TimerHandle_t timer) {
+    (void)timer;
+    getInstance().post(EVENT_RENDER_TICK);
+}
@@ -0,0 +1,104 @@
+/**
+ * @file EventDispatcher.h
+ * @brief Event group che sveglia il loop principale solo quando c'è lavoro
+ *
+ * Sostituisce il busy-polling di loop() + yield(): ogni sorgente (timer di
+ * render, task camera, callback BLE, ricezione OTA) imposta un bit e il loop
+ * resta bloccato in wait() finché almeno un bit non è attivo. Mentre il loop
+ * è bloccato gira l'idle task del core 1, che rende possibile DFS e light
+ * sleep automatico.
+ *
+ * Il tick di render è generato da un software timer FreeRTOS con periodo
+ * variabile: veloce quando la lama anima, lento quando è spenta e ferma.
+ *
+ * Thread safety: post() può essere chiamato da qualsiasi task (BLE, camera,
+ * timer service). wait() e le statistiche vanno usati solo dal loop principale.
+ */
+
+#ifndef EVENT_DISPATCHER_H
+#define EVENT_DISPATCHER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/timers.h>
+
+class EventDispatcher {
+public:
+    /**
+     * @brief Bit dell'event group (uno per sorgente)
+     */
+    enum Event : uint32_t {
+        EVENT_RENDER_TICK  = (1u << 0),  // Timer periodico di render/housekeeping
+        EVENT_MOTION_READY = (1u << 1),  // Nuovo risultato in gMotionResultQueue
+        EVENT_BLE_WRITE    = (1u << 2),  // Scrittura BLE che cambia lo stato visibile
+        EVENT_CONFIG_DIRTY = (1u << 3),  // Configurazione modificata, da salvare
+        EVENT_OTA_DATA     = (1u << 4)   // Chunk o comando OTA in coda
+    };
+
+    static constexpr uint32_t ALL_EVENTS =
+        EVENT_RENDER_TICK | EVENT_MOTION_READY | EVENT_BLE_WRITE |
+        EVENT_CONFIG_DIRTY | EVENT_OTA_DATA;
+
+    /**
+     * @brief Contatori risvegli per sorgente (per debug/diagnostica)
+     */
+    struct Stats {
+        uint32_t wakeups = 0;
+        uint32_t renderTicks = 0;
+        uint32_t motionEvents = 0;
+        uint32_t bleWrites = 0;
+        uint32_t configEvents = 0;
+        uint32_t otaEvents = 0;
+        uint32_t timeouts = 0;
+    };
+
+    /**
+     * @brief Get singleton instance
+     */
+    static EventDispatcher& getInstance();
+
+    /**
+     * @brief Crea event group e timer di render
+     * @param renderPeriodMs Periodo iniziale del tick di render
+     * @return true se l'inizializzazione è riuscita
+     */
+    bool begin(uint16_t renderPeriodMs);
+
+    /**
+     * @brief Segnala uno o più eventi (sicuro da qualsiasi task)
+     */
+    void post(uint32_t events);
+
+    /**
+     * @brief Blocca il chiamante finché non arriva almeno un evento
+     * @param timeoutMs Timeout massimo (portMAX_DELAY = infinito)
+     * @return Bit degli eventi ricevuti (già azzerati), 0 se timeout
+     */
+    uint32_t wait(uint32_t timeoutMs = portMAX_DELAY);
+
+    /**
+     * @brief Cambia il periodo del tick di render (no-op se invariato)
+     */
+    void setRenderPeriod(uint16_t periodMs);
+
+    uint16_t getRenderPeriod() const { return _renderPeriodMs; }
+    bool isInitialized() const { return _group != nullptr; }
+
+    const Stats& getStats() const { return _stats; }
+    void resetStats() { _stats = Stats(); }
+
+private:
+    EventDispatcher() = default;
+    EventDispatcher(const EventDispatcher&) = delete;
+    EventDispatcher& operator=(const EventDispatcher&) = delete;
+
+    static void _renderTimerCallback(TimerHandle_t timer);
+
+    EventGroupHandle_t _group = nullptr;
+    TimerHandle_t _renderTimer = nullptr;
+    uint16_t _renderPeriodMs = 0;
+    Stats _stats;
+};
+
+#endif // EVENT_DISPATCHER_H
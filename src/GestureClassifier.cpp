@@ -0,0 +1,103 @@
+#include "GestureClassifier.h"
+#include "GestureModel.h"
+#include <string.h>
+
+static_assert(GestureModel::FEATURE_COUNT == GestureClassifier::FEATURE_COUNT,
+              "GestureModel.h generato con un altro set di feature: rigenera con tools/gesture_train.py");
+static_assert(GestureModel::CLASS_COUNT == GestureClassifier::CLASS_COUNT,
+              "GestureModel.h generato con un altro set di classi");
+
+namespace {
+constexpr uint8_t MAX_DEPTH = 32;   // Guardia contro tabelle cicliche
+
+int8_t sat8(int64_t value) {
+    if (value > 127) return 127;
+    if (value < -128) return -128;
+    return (int8_t)value;
+}
+
+int64_t abs64(int64_t value) {
+    return value < 0 ? -value : value;
+}
+
+uint32_t isqrt64(uint64_t value) {
+    uint64_t result = 0;
+    uint64_t bit = 1ULL << 62;
+    while (bit > value) bit >>= 2;
+    while (bit != 0) {
+        if (value >= result + bit) {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)result;
+}
+}
+
+GestureClassifier::GestureClassifier()
+    : _nodes(GestureModel::NODES)
+    , _nodeCount(GestureModel::NODE_COUNT) {
+}
+
+GestureClassifier::GestureClassifier(const Node* nodes, uint16_t nodeCount)
+    : _nodes(nodes)
+    , _nodeCount(nodeCount) {
+}
+
+bool GestureClassifier::extract(const MotionHistory& history, Features& out) {
+    memset(&out, 0, sizeof(out));
+    if (history.size() < 2) {
+        return false;
+    }
+
+    const MotionHistory::Stats w = history.stats();
+    const MotionHistory::Frame& curr = history.latest();
+
+    // Accelerazione proiettata sulla velocità media (norma L1: niente sqrt)
+    const int64_t meanVelL1 = abs64(w.meanVelX) + abs64(w.meanVelY);
+    const int64_t accAlong = meanVelL1 > 0
+        ? ((int64_t)curr.accX * w.meanVelX + (int64_t)curr.accY * w.meanVelY) / meanVelL1
+        : 0;
+
+    out.v[F_MEAN_VEL_X] = sat8(w.meanVelX / 4);
+    out.v[F_MEAN_VEL_Y] = sat8(w.meanVelY / 4);
+    out.v[F_RMS_VEL] = sat8(isqrt64(w.energy) / 4);
+    out.v[F_MEAN_ABS_ACC] = sat8(w.meanAbsAcc / 16);
+    out.v[F_MEAN_ABS_JERK] = sat8(w.meanAbsJerk / 256);
+    out.v[F_JERK] = sat8((abs64(curr.jerkX) + abs64(curr.jerkY)) / 1024);
+    out.v[F_ACC_ALONG_VEL] = sat8(accAlong / 64);
+    out.v[F_VEL_X] = sat8(curr.velX / 4);
+    out.v[F_VEL_Y] = sat8(curr.velY / 4);
+    out.v[F_SPEED] = sat8((abs64(curr.velX) + abs64(curr.velY)) / 4);
+    out.v[F_REVERSALS] = sat8(w.reversals);
+    out.v[F_ABS_NET_TURNS] = sat8(abs64(w.netTurns));
+    out.v[F_MEAN_DIV] = sat8(w.meanDivQ4 / 4);
+    out.v[F_ABS_MEAN_CURL] = sat8(abs64(w.meanCurlQ4) / 4);
+    out.v[F_MEAN_INTENSITY] = sat8(w.meanIntensity / 2);
+    out.v[F_MEAN_ACTIVE_BLOCKS] = sat8(w.meanActiveBlocks);
+    out.v[F_SPAN] = sat8(w.spanMs / 32);
+    return true;
+}
+
+GestureClassifier::Result GestureClassifier::classify(const Features& features) const {
+    Result result = {0, 0};
+    uint16_t index = 0;
+    for (uint8_t depth = 0; depth < MAX_DEPTH && index < _nodeCount; depth++) {
+        const Node& node = _nodes[index];
+        if (node.feature == LEAF) {
+            if (node.left < CLASS_COUNT) {
+                result.gesture = node.left;
+                result.confidence = node.right > 100 ? 100 : node.right;
+            }
+            return result;
+        }
+        if (node.feature < 0 || node.feature >= FEATURE_COUNT) {
+            return result;
+        }
+        index = features.v[(uint8_t)node.feature] <= node.threshold ? node.left : node.right;
+    }
+    return result;
+}
@@ -0,0 +1,96 @@
+#ifndef GESTURE_CLASSIFIER_H
+#define GESTURE_CLASSIFIER_H
+
+#include <stdint.h>
+#include "MotionHistory.h"
+
+/**
+ * @brief Classificatore gesture int8: albero di decisione sulle feature a finestra
+ *
+ * Le feature sono ricavate da MotionHistory (statistiche O(1) + ultimo frame),
+ * quantizzate a int8 con saturazione. L'albero è una tabella constexpr generata
+ * da tools/gesture_train.py (src/GestureModel.h): nessun float, nessuna
+ * allocazione, profondità limitata -> pochi confronti per frame.
+ *
+ * Nessuna dipendenza da Arduino: lo stesso sorgente gira nel replay host
+ * (tools/gesture_replay_host.cpp) usato per addestramento e benchmark.
+ * Le classi coincidono con MotionProcessor::GestureType.
+ */
+class GestureClassifier {
+public:
+    // Indici delle feature: l'ordine fa parte del modello generato
+    enum Feature : uint8_t {
+        F_MEAN_VEL_X = 0,       // px/s / 4
+        F_MEAN_VEL_Y,
+        F_RMS_VEL,              // sqrt(energy) / 4
+        F_MEAN_ABS_ACC,         // px/s^2 / 16
+        F_MEAN_ABS_JERK,        // px/s^3 / 256
+        F_JERK,                 // |jerk| ultimo frame / 1024 (stop da 300 px/s @ 20fps ≈ 120000)
+        F_ACC_ALONG_VEL,        // Accelerazione lungo la velocità media (<0 = frenata) / 64
+        F_VEL_X,                // Ultimo frame, px/s / 4
+        F_VEL_Y,
+        F_SPEED,                // |v| L1 ultimo frame / 4: lo stop dopo un clash resta fermo, lo scuotimento no
+        F_REVERSALS,
+        F_ABS_NET_TURNS,
+        F_MEAN_DIV,             // divQ4 / 4
+        F_ABS_MEAN_CURL,        // |curlQ4| / 4
+        F_MEAN_INTENSITY,       // 0-255 / 2
+        F_MEAN_ACTIVE_BLOCKS,
+        F_SPAN,                 // Durata finestra, ms / 32
+        FEATURE_COUNT
+    };
+
+    static constexpr uint8_t CLASS_COUNT = 7;   // NONE, IGNITION, RETRACT, CLASH, STAB, SPIN, TWIRL
+    static constexpr int8_t LEAF = -1;
+
+    /**
+     * @brief Nodo dell'albero (4 byte)
+     *
+     * Interno: x[feature] <= threshold -> left, altrimenti right.
+     * Foglia (feature == LEAF): left = classe, right = confidenza 0-100.
+     */
+    struct Node {
+        int8_t feature;
+        int8_t threshold;
+        uint8_t left;
+        uint8_t right;
+    };
+
+    struct Features {
+        int8_t v[FEATURE_COUNT];
+    };
+
+    struct Result {
+        uint8_t gesture;        // Indice classe (MotionProcessor::GestureType)
+        uint8_t confidence;     // 0-100
+    };
+
+    /**
+     * @brief Usa il modello generato (GestureModel.h)
+     */
+    GestureClassifier();
+
+    /**
+     * @brief Modello alternativo (es. caricato a runtime); la tabella deve restare valida
+     */
+    GestureClassifier(const Node* nodes, uint16_t nodeCount);
+
+    /**
+     * @brief Feature int8 della finestra corrente
+     * @return false se lo storico ha meno di 2 frame
+     */
+    static bool extract(const MotionHistory& history, Features& out);
+
+    /**
+     * @brief Percorre l'albero; nodo malformato -> classe 0 con confidenza 0
+     */
+    Result classify(const Features& features) const;
+
+    uint16_t getNodeCount() const { return _nodeCount; }
+
+private:
+    const Node* _nodes;
+    uint16_t _nodeCount;
+};
+
+#endif // GESTURE_CLASSIFIER_H
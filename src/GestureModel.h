@@ -0,0 +1,198 @@
+// Generato da tools/gesture_train.py - non modificare a mano.
+// 240 sessioni / 41475 frame (incl. sintetiche), profondità max 8, 181 nodi (724 byte)
+#ifndef GESTURE_MODEL_H
+#define GESTURE_MODEL_H
+
+#include "GestureClassifier.h"
+
+namespace GestureModel {
+constexpr uint8_t FEATURE_COUNT = 17;
+constexpr uint8_t CLASS_COUNT = 7;
+constexpr uint16_t NODE_COUNT = 181;
+
+constexpr GestureClassifier::Node NODES[NODE_COUNT] = {
+    {   9,    5,   1, 124 },  //   0: speed <= 5
+    {   5,   53,   2,  85 },  //   1: jerk <= 53
+    {  12,    0,   3,  46 },  //   2: mean_div <= 0
+    {  13,    1,   4,  19 },  //   3: abs_mean_curl <= 1
+    {   6,  -23,   5,   8 },  //   4: acc_along_vel <= -23
+    {   4,   91,   6,   7 },  //   5: mean_abs_jerk <= 91
+    {  -1,    0,   3,  52 },  //   6: clash (52%)
+    {  -1,    0,   0, 100 },  //   7: none (100%)
+    {  16,   52,   9,  14 },  //   8: span <= 52
+    {   5,   35,  10,  11 },  //   9: jerk <= 35
+    {  -1,    0,   0,  95 },  //  10: none (95%)
+    {  16,   32,  12,  13 },  //  11: span <= 32
+    {  -1,    0,   0,  99 },  //  12: none (99%)
+    {  -1,    0,   3,  73 },  //  13: clash (73%)
+    {   5,   10,  15,  16 },  //  14: jerk <= 10
+    {  -1,    0,   0, 100 },  //  15: none (100%)
+    {  11,    3,  17,  18 },  //  16: abs_net_turns <= 3
+    {  -1,    0,   3,  94 },  //  17: clash (94%)
+    {  -1,    0,   0,  55 },  //  18: none (55%)
+    {   5,   18,  20,  35 },  //  19: jerk <= 18
+    {   9,    3,  21,  28 },  //  20: speed <= 3
+    {   6,   -4,  22,  25 },  //  21: acc_along_vel <= -4
+    {   5,   12,  23,  24 },  //  22: jerk <= 12
+    {  -1,    0,   0,  74 },  //  23: none (74%)
+    {  -1,    0,   5,  70 },  //  24: spin (70%)
+    {   0,   -8,  26,  27 },  //  25: mean_vel_x <= -8
+    {  -1,    0,   5,  73 },  //  26: spin (73%)
+    {  -1,    0,   0,  89 },  //  27: none (89%)
+    {   5,    3,  29,  32 },  //  28: jerk <= 3
+    {   0,   -3,  30,  31 },  //  29: mean_vel_x <= -3
+    {  -1,    0,   5,  71 },  //  30: spin (71%)
+    {  -1,    0,   0, 100 },  //  31: none (100%)
+    {   4,   37,  33,  34 },  //  32: mean_abs_jerk <= 37
+    {  -1,    0,   5,  84 },  //  33: spin (84%)
+    {  -1,    0,   0,  61 },  //  34: none (61%)
+    {   4,  114,  36,  39 },  //  35: mean_abs_jerk <= 114
+    {   2,   15,  37,  38 },  //  36: rms_vel <= 15
+    {  -1,    0,   5,  76 },  //  37: spin (76%)
+    {  -1,    0,   3,  94 },  //  38: clash (94%)
+    {   9,    2,  40,  43 },  //  39: speed <= 2
+    {   2,    8,  41,  42 },  //  40: rms_vel <= 8
+    {  -1,    0,   0,  83 },  //  41: none (83%)
+    {  -1,    0,   5,  68 },  //  42: spin (68%)
+    {  16,   17,  44,  45 },  //  43: span <= 17
+    {  -1,    0,   0,  66 },  //  44: none (66%)
+    {  -1,    0,   5,  75 },  //  45: spin (75%)
+    {   5,   16,  47,  70 },  //  46: jerk <= 16
+    {   9,    3,  48,  57 },  //  47: speed <= 3
+    {   6,   -3,  49,  54 },  //  48: acc_along_vel <= -3
+    {   2,    4,  50,  53 },  //  49: rms_vel <= 4
+    {   5,   13,  51,  52 },  //  50: jerk <= 13
+    {  -1,    0,   4,  68 },  //  51: stab (68%)
+    {  -1,    0,   0, 100 },  //  52: none (100%)
+    {  -1,    0,   0, 100 },  //  53: none (100%)
+    {  13,    1,  55,  56 },  //  54: abs_mean_curl <= 1
+    {  -1,    0,   0,  69 },  //  55: none (69%)
+    {  -1,    0,   4,  55 },  //  56: stab (55%)
+    {   2,    2,  58,  63 },  //  57: rms_vel <= 2
+    {   9,    4,  59,  62 },  //  58: speed <= 4
+    {  16,   25,  60,  61 },  //  59: span <= 25
+    {  -1,    0,   4,  77 },  //  60: stab (77%)
+    {  -1,    0,   0,  67 },  //  61: none (67%)
+    {  -1,    0,   4,  84 },  //  62: stab (84%)
+    {   2,   13,  64,  67 },  //  63: rms_vel <= 13
+    {  13,    7,  65,  66 },  //  64: abs_mean_curl <= 7
+    {  -1,    0,   0,  75 },  //  65: none (75%)
+    {  -1,    0,   5,  94 },  //  66: spin (94%)
+    {   5,    4,  68,  69 },  //  67: jerk <= 4
+    {  -1,    0,   0,  57 },  //  68: none (57%)
+    {  -1,    0,   4,  88 },  //  69: stab (88%)
+    {   4,   86,  71,  78 },  //  70: mean_abs_jerk <= 86
+    {   5,   21,  72,  77 },  //  71: jerk <= 21
+    {   4,   52,  73,  74 },  //  72: mean_abs_jerk <= 52
+    {  -1,    0,   4,  63 },  //  73: stab (63%)
+    {   9,    3,  75,  76 },  //  74: speed <= 3
+    {  -1,    0,   0, 100 },  //  75: none (100%)
+    {  -1,    0,   4,  76 },  //  76: stab (76%)
+    {  -1,    0,   4,  37 },  //  77: stab (37%)
+    {   2,    9,  79,  84 },  //  78: rms_vel <= 9
+    {   6,  -10,  80,  81 },  //  79: acc_along_vel <= -10
+    {  -1,    0,   4, 100 },  //  80: stab (100%)
+    {   3,   34,  82,  83 },  //  81: mean_abs_acc <= 34
+    {  -1,    0,   4,  61 },  //  82: stab (61%)
+    {  -1,    0,   0,  82 },  //  83: none (82%)
+    {  -1,    0,   4,  89 },  //  84: stab (89%)
+    {   2,   22,  86, 101 },  //  85: rms_vel <= 22
+    {  13,    1,  87,  96 },  //  86: abs_mean_curl <= 1
+    {  12,    0,  88,  89 },  //  87: mean_div <= 0
+    {  -1,    0,   0, 100 },  //  88: none (100%)
+    {   9,    2,  90,  95 },  //  89: speed <= 2
+    {  14,    4,  91,  92 },  //  90: mean_intensity <= 4
+    {  -1,    0,   4,  93 },  //  91: stab (93%)
+    {   4,  125,  93,  94 },  //  92: mean_abs_jerk <= 125
+    {  -1,    0,   0,  52 },  //  93: none (52%)
+    {  -1,    0,   4,  58 },  //  94: stab (58%)
+    {  -1,    0,   4,  81 },  //  95: stab (81%)
+    {   9,    1,  97, 100 },  //  96: speed <= 1
+    {   2,    7,  98,  99 },  //  97: rms_vel <= 7
+    {  -1,    0,   5,  77 },  //  98: spin (77%)
+    {  -1,    0,   0,  50 },  //  99: none (50%)
+    {  -1,    0,   5,  62 },  // 100: spin (62%)
+    {   3,  126, 102, 115 },  // 101: mean_abs_acc <= 126
+    {   5,   76, 103, 108 },  // 102: jerk <= 76
+    {  16,   26, 104, 105 },  // 103: span <= 26
+    {  -1,    0,   0,  64 },  // 104: none (64%)
+    {   3,   80, 106, 107 },  // 105: mean_abs_acc <= 80
+    {  -1,    0,   3, 100 },  // 106: clash (100%)
+    {  -1,    0,   0,  57 },  // 107: none (57%)
+    {  16,   16, 109, 110 },  // 108: span <= 16
+    {  -1,    0,   3,  56 },  // 109: clash (56%)
+    {   5,   99, 111, 114 },  // 110: jerk <= 99
+    {   3,   94, 112, 113 },  // 111: mean_abs_acc <= 94
+    {  -1,    0,   3,  99 },  // 112: clash (99%)
+    {  -1,    0,   0,  54 },  // 113: none (54%)
+    {  -1,    0,   3,  96 },  // 114: clash (96%)
+    {   6,   14, 116, 119 },  // 115: acc_along_vel <= 14
+    {   0,  -37, 117, 118 },  // 116: mean_vel_x <= -37
+    {  -1,    0,   3,  56 },  // 117: clash (56%)
+    {  -1,    0,   0, 100 },  // 118: none (100%)
+    {  16,   22, 120, 121 },  // 119: span <= 22
+    {  -1,    0,   3,  75 },  // 120: clash (75%)
+    {  16,   32, 122, 123 },  // 121: span <= 32
+    {  -1,    0,   0,  63 },  // 122: none (63%)
+    {  -1,    0,   3,  56 },  // 123: clash (56%)
+    {  11,    3, 125, 180 },  // 124: abs_net_turns <= 3
+    {  13,    1, 126, 163 },  // 125: abs_mean_curl <= 1
+    {   8,  -38, 127, 140 },  // 126: vel_y <= -38
+    {   1,   -3, 128, 135 },  // 127: mean_vel_y <= -3
+    {   9,  109, 129, 134 },  // 128: speed <= 109
+    {   6,   -9, 130, 131 },  // 129: acc_along_vel <= -9
+    {  -1,    0,   0, 100 },  // 130: none (100%)
+    {   7,   24, 132, 133 },  // 131: vel_x <= 24
+    {  -1,    0,   1,  99 },  // 132: ignition (99%)
+    {  -1,    0,   0,  71 },  // 133: none (71%)
+    {  -1,    0,   0, 100 },  // 134: none (100%)
+    {   5,   14, 136, 139 },  // 135: jerk <= 14
+    {   0,    2, 137, 138 },  // 136: mean_vel_x <= 2
+    {  -1,    0,   1,  82 },  // 137: ignition (82%)
+    {  -1,    0,   6,  83 },  // 138: twirl (83%)
+    {  -1,    0,   0,  69 },  // 139: none (69%)
+    {   8,   35, 141, 152 },  // 140: vel_y <= 35
+    {  12,    0, 142, 147 },  // 141: mean_div <= 0
+    {   6,  -41, 143, 146 },  // 142: acc_along_vel <= -41
+    {   9,   39, 144, 145 },  // 143: speed <= 39
+    {  -1,    0,   3,  97 },  // 144: clash (97%)
+    {  -1,    0,   0,  95 },  // 145: none (95%)
+    {  -1,    0,   0,  60 },  // 146: none (60%)
+    {   9,   21, 148, 149 },  // 147: speed <= 21
+    {  -1,    0,   4,  84 },  // 148: stab (84%)
+    {   6,  -35, 150, 151 },  // 149: acc_along_vel <= -35
+    {  -1,    0,   3,  94 },  // 150: clash (94%)
+    {  -1,    0,   0, 100 },  // 151: none (100%)
+    {   3,   75, 153, 158 },  // 152: mean_abs_acc <= 75
+    {   9,  109, 154, 157 },  // 153: speed <= 109
+    {   6,  -13, 155, 156 },  // 154: acc_along_vel <= -13
+    {  -1,    0,   0,  68 },  // 155: none (68%)
+    {  -1,    0,   2,  97 },  // 156: retract (97%)
+    {  -1,    0,   0, 100 },  // 157: none (100%)
+    {   8,   55, 159, 160 },  // 158: vel_y <= 55
+    {  -1,    0,   0,  65 },  // 159: none (65%)
+    {   5,   45, 161, 162 },  // 160: jerk <= 45
+    {  -1,    0,   2, 100 },  // 161: retract (100%)
+    {  -1,    0,   0, 100 },  // 162: none (100%)
+    {   9,   32, 164, 175 },  // 163: speed <= 32
+    {   6,  -32, 165, 168 },  // 164: acc_along_vel <= -32
+    {   2,   10, 166, 167 },  // 165: rms_vel <= 10
+    {  -1,    0,   5,  95 },  // 166: spin (95%)
+    {  -1,    0,   3, 100 },  // 167: clash (100%)
+    {  15,    2, 169, 170 },  // 168: mean_active_blocks <= 2
+    {  -1,    0,   0,  64 },  // 169: none (64%)
+    {  12,    0, 171, 172 },  // 170: mean_div <= 0
+    {  -1,    0,   5,  83 },  // 171: spin (83%)
+    {  13,    5, 173, 174 },  // 172: abs_mean_curl <= 5
+    {  -1,    0,   4,  87 },  // 173: stab (87%)
+    {  -1,    0,   5, 100 },  // 174: spin (100%)
+    {   8,  -36, 176, 179 },  // 175: vel_y <= -36
+    {   6,   -2, 177, 178 },  // 176: acc_along_vel <= -2
+    {  -1,    0,   0,  50 },  // 177: none (50%)
+    {  -1,    0,   1,  70 },  // 178: ignition (70%)
+    {  -1,    0,   0,  56 },  // 179: none (56%)
+    {  -1,    0,   6,  91 },  // 180: twirl (91%)
+};
+}  // namespace GestureModel
+
+#endif // GESTURE_MODEL_H
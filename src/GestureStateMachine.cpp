@@ -0,0 +1,191 @@
+#include "GestureStateMachine.h"
+#include <string.h>
+
+// Default = comportamento della vecchia catena di if (cooldown globale 1200ms,
+// clash 5000ms, nessun dwell); minIntensity come i default di ConfigManager
+const GestureStateMachine::Rule GestureStateMachine::DEFAULT_RULES[SLOT_COUNT] = {
+    //  en  minI  spdX10 minConf  minJerk rel% conf dwell refractory lockout
+    {   1,   15,    20,    75,    6000,   50,  70,    0,   5000,     5000 },   // clash
+    {   1,   15,     4,    75,       0,   50,  60,    0,   1200,     1200 },   // retract
+    {   1,   15,     4,    75,       0,   50,  85,    0,   1200,     1200 },   // ignition
+    {   1,    0,     0,    75,       0,   50,   0,    0,   1200,     1200 },   // stab (solo classificatore)
+    {   1,    0,     0,    75,       0,   50,   0,    0,   1200,     1200 },   // spin
+    {   1,    0,     0,    75,       0,   50,   0,    0,   1200,     1200 },   // twirl
+    {   1,    6,     4,     0,       0,   50,  40,    0,   1200,     1200 },   // effect_up
+    {   1,    6,     4,     0,       0,   50,  40,    0,   1200,     1200 },   // effect_down
+    {   1,    6,     4,     0,       0,   50,  40,    0,   1200,     1200 },   // effect_left
+    {   1,    6,     4,     0,       0,   50,  40,    0,   1200,     1200 },   // effect_right
+};
+
+namespace {
+const char* const SLOT_NAMES[GestureStateMachine::SLOT_COUNT] = {
+    "clash", "retract", "ignition", "stab", "spin", "twirl",
+    "effect_up", "effect_down", "effect_left", "effect_right",
+};
+
+const char* const FIELD_NAMES[GestureStateMachine::FIELD_COUNT] = {
+    "enabled", "minIntensity", "minSpeedX10", "minConfidence", "minJerk",
+    "releasePct", "confidence", "dwellMs", "refractoryMs", "lockoutMs",
+};
+
+// Confronto con wrap di millis()
+bool reached(uint32_t now, uint32_t deadline) {
+    return (int32_t)(now - deadline) >= 0;
+}
+
+uint32_t clampU(int64_t value, uint32_t maxValue) {
+    if (value < 0) return 0;
+    if (value > (int64_t)maxValue) return maxValue;
+    return (uint32_t)value;
+}
+}
+
+GestureStateMachine::GestureStateMachine() {
+    reset();
+}
+
+void GestureStateMachine::reset() {
+    memset(_state, 0, sizeof(_state));
+    memset(_since, 0, sizeof(_since));
+    _lockoutUntil = 0;
+    _lockoutActive = false;
+    _changedMask = 0;
+}
+
+void GestureStateMachine::_enter(uint8_t slot, State state, uint32_t timestamp) {
+    _state[slot] = state;
+    _since[slot] = timestamp;
+    _changedMask |= (uint16_t)(1u << slot);
+}
+
+uint16_t GestureStateMachine::step(const Rule* rules, const uint16_t* levels, uint32_t timestamp) {
+    _changedMask = 0;
+    if (_lockoutActive && reached(timestamp, _lockoutUntil)) {
+        _lockoutActive = false;
+    }
+    // Lockout valutato a inizio frame: slot diversi possono scattare insieme
+    // (es. RETRACT + effetto DOWN), come faceva la vecchia catena
+    const bool locked = _lockoutActive;
+
+    uint16_t triggered = 0;
+    for (uint8_t slot = 0; slot < SLOT_COUNT; slot++) {
+        const Rule& rule = rules[slot];
+        const uint16_t level = rule.enabled ? levels[slot] : 0;
+
+        switch (_state[slot]) {
+            case IDLE:
+                if (locked || level < 100) {
+                    break;
+                }
+                _enter(slot, ARMED, timestamp);
+                // fallthrough - con dwell 0 scatta nello stesso frame
+            case ARMED:
+                if (locked || level < rule.releasePct) {
+                    _enter(slot, IDLE, timestamp);
+                    break;
+                }
+                if (!reached(timestamp, _since[slot] + rule.dwellMs)) {
+                    break;
+                }
+                _enter(slot, TRIGGERED, timestamp);
+                triggered |= (uint16_t)(1u << slot);
+                break;
+            case TRIGGERED:
+                _enter(slot, REFRACTORY, _since[slot]);
+                // fallthrough - un refrattario breve può essere già scaduto
+            case REFRACTORY:
+                if (reached(timestamp, _since[slot] + rule.refractoryMs)) {
+                    _enter(slot, IDLE, timestamp);
+                }
+                break;
+        }
+    }
+
+    for (uint8_t slot = 0; slot < SLOT_COUNT; slot++) {
+        if ((triggered & (1u << slot)) == 0 || rules[slot].lockoutMs == 0) {
+            continue;
+        }
+        const uint32_t until = timestamp + rules[slot].lockoutMs;
+        if (!_lockoutActive || reached(until, _lockoutUntil)) {
+            _lockoutUntil = until;
+        }
+        _lockoutActive = true;
+    }
+    return triggered;
+}
+
+uint32_t GestureStateMachine::getPackedStates() const {
+    uint32_t packed = 0;
+    for (uint8_t slot = 0; slot < SLOT_COUNT; slot++) {
+        packed |= (uint32_t)(_state[slot] & 0x03) << (slot * 2);
+    }
+    return packed;
+}
+
+const char* GestureStateMachine::slotToString(uint8_t slot) {
+    return slot < SLOT_COUNT ? SLOT_NAMES[slot] : "unknown";
+}
+
+int8_t GestureStateMachine::slotFromString(const char* name) {
+    for (uint8_t slot = 0; name && slot < SLOT_COUNT; slot++) {
+        if (strcmp(name, SLOT_NAMES[slot]) == 0) {
+            return (int8_t)slot;
+        }
+    }
+    return -1;
+}
+
+const char* GestureStateMachine::stateToString(State state) {
+    switch (state) {
+        case IDLE:       return "idle";
+        case ARMED:      return "armed";
+        case TRIGGERED:  return "triggered";
+        case REFRACTORY: return "refractory";
+        default:         return "unknown";
+    }
+}
+
+const char* GestureStateMachine::fieldToString(uint8_t field) {
+    return field < FIELD_COUNT ? FIELD_NAMES[field] : "unknown";
+}
+
+int8_t GestureStateMachine::fieldFromString(const char* name) {
+    for (uint8_t field = 0; name && field < FIELD_COUNT; field++) {
+        if (strcmp(name, FIELD_NAMES[field]) == 0) {
+            return (int8_t)field;
+        }
+    }
+    return -1;
+}
+
+uint32_t GestureStateMachine::getField(const Rule& rule, uint8_t field) {
+    switch (field) {
+        case FIELD_ENABLED:         return rule.enabled;
+        case FIELD_MIN_INTENSITY:   return rule.minIntensity;
+        case FIELD_MIN_SPEED_X10:   return rule.minSpeedX10;
+        case FIELD_MIN_CONFIDENCE:  return rule.minConfidence;
+        case FIELD_MIN_JERK:        return rule.minJerk;
+        case FIELD_RELEASE_PCT:     return rule.releasePct;
+        case FIELD_CONFIDENCE:      return rule.confidence;
+        case FIELD_DWELL_MS:        return rule.dwellMs;
+        case FIELD_REFRACTORY_MS:   return rule.refractoryMs;
+        case FIELD_LOCKOUT_MS:      return rule.lockoutMs;
+        default:                    return 0;
+    }
+}
+
+bool GestureStateMachine::setField(Rule& rule, uint8_t field, int64_t value) {
+    switch (field) {
+        case FIELD_ENABLED:         rule.enabled = value != 0 ? 1 : 0; return true;
+        case FIELD_MIN_INTENSITY:   rule.minIntensity = (uint8_t)clampU(value, 255); return true;
+        case FIELD_MIN_SPEED_X10:   rule.minSpeedX10 = (uint8_t)clampU(value, 255); return true;
+        case FIELD_MIN_CONFIDENCE:  rule.minConfidence = (uint8_t)clampU(value, 100); return true;
+        case FIELD_MIN_JERK:        rule.minJerk = clampU(value, UINT32_MAX); return true;
+        case FIELD_RELEASE_PCT:     rule.releasePct = (uint8_t)clampU(value, 100); return true;
+        case FIELD_CONFIDENCE:      rule.confidence = (uint8_t)clampU(value, 100); return true;
+        case FIELD_DWELL_MS:        rule.dwellMs = (uint16_t)clampU(value, 65535); return true;
+        case FIELD_REFRACTORY_MS:   rule.refractoryMs = (uint16_t)clampU(value, 65535); return true;
+        case FIELD_LOCKOUT_MS:      rule.lockoutMs = (uint16_t)clampU(value, 65535); return true;
+        default:                    return false;
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef GESTURE_STATE_MACHINE_H
+#define GESTURE_STATE_MACHINE_H
+
+#include <stdint.h>
+
+/**
+ * @brief State machine delle gesture guidata da tabella
+ *
+ * Ogni slot (gesture o richiesta effetto) ha il proprio stato
+ * IDLE -> ARMED -> TRIGGERED -> REFRACTORY -> IDLE e una riga Rule con
+ * soglie, isteresi, dwell e periodi refrattari. MotionProcessor calcola per
+ * ogni slot il livello di evidenza del frame in percentuale della soglia
+ * (100 = soglia raggiunta); step() fa il resto in tempo costante
+ * (SLOT_COUNT iterazioni, nessuna allocazione).
+ *
+ * - IDLE -> ARMED: livello >= 100 e nessun lockout attivo
+ * - ARMED -> IDLE: livello < releasePct (isteresi) o lockout di un altro slot
+ * - ARMED -> TRIGGERED: armato da almeno dwellMs (0 = stesso frame)
+ * - TRIGGERED: dura un frame, avvia refractoryMs per lo slot e lockoutMs per tutti
+ * - REFRACTORY -> IDLE: scaduto refractoryMs
+ *
+ * Aggiungere una gesture = una riga in Slot, DEFAULT_RULES e SLOT_NAMES più
+ * il calcolo del suo livello in MotionProcessor. Nessuna dipendenza da
+ * Arduino (come GestureClassifier).
+ */
+class GestureStateMachine {
+public:
+    // L'ordine è anche la priorità quando più slot scattano nello stesso frame
+    enum Slot : uint8_t {
+        SLOT_CLASH = 0,
+        SLOT_RETRACT,
+        SLOT_IGNITION,
+        SLOT_STAB,
+        SLOT_SPIN,
+        SLOT_TWIRL,
+        SLOT_EFFECT_UP,         // Mappatura direzione -> effetto (Config::effectOn*)
+        SLOT_EFFECT_DOWN,
+        SLOT_EFFECT_LEFT,
+        SLOT_EFFECT_RIGHT,
+        SLOT_COUNT
+    };
+
+    enum State : uint8_t {
+        IDLE = 0,
+        ARMED,
+        TRIGGERED,
+        REFRACTORY,
+    };
+
+    /**
+     * @brief Riga della tabella (editabile a runtime via BLE, salvata da ConfigManager)
+     */
+    struct Rule {
+        uint8_t enabled;
+        uint8_t minIntensity;       // 0-255, 0 = termine ignorato
+        uint8_t minSpeedX10;        // px/frame * 10, 0 = termine ignorato
+        uint8_t minConfidence;      // Confidenza minima del classificatore 0-100
+        uint32_t minJerk;           // px/s^3 (solo CLASH a regole)
+        uint8_t releasePct;         // Isteresi: ARMED resta tale sopra questa % della soglia
+        uint8_t confidence;         // Confidenza riportata dalle regole 0-100
+        uint16_t dwellMs;           // Permanenza in ARMED prima di TRIGGERED
+        uint16_t refractoryMs;      // Blocco dello slot dopo TRIGGERED
+        uint16_t lockoutMs;         // Blocco degli altri slot dopo TRIGGERED
+    };
+
+    // Campi di Rule per nome (JSON BLE / config.json / comando "rule")
+    enum Field : uint8_t {
+        FIELD_ENABLED = 0,
+        FIELD_MIN_INTENSITY,
+        FIELD_MIN_SPEED_X10,
+        FIELD_MIN_CONFIDENCE,
+        FIELD_MIN_JERK,
+        FIELD_RELEASE_PCT,
+        FIELD_CONFIDENCE,
+        FIELD_DWELL_MS,
+        FIELD_REFRACTORY_MS,
+        FIELD_LOCKOUT_MS,
+        FIELD_COUNT
+    };
+
+    static const Rule DEFAULT_RULES[SLOT_COUNT];
+
+    GestureStateMachine();
+
+    /**
+     * @brief Tutti gli slot in IDLE, lockout azzerato
+     */
+    void reset();
+
+    /**
+     * @brief Avanza di un frame
+     * @param rules Tabella di SLOT_COUNT righe
+     * @param levels Evidenza per slot in % della soglia (0 = assente)
+     * @return Bitmask degli slot passati a TRIGGERED in questo frame
+     */
+    uint16_t step(const Rule* rules, const uint16_t* levels, uint32_t timestamp);
+
+    State getState(uint8_t slot) const { return slot < SLOT_COUNT ? _state[slot] : IDLE; }
+
+    /**
+     * @brief Bitmask degli slot che hanno cambiato stato nell'ultimo step
+     */
+    uint16_t getChangedMask() const { return _changedMask; }
+
+    /**
+     * @brief Stati di tutti gli slot, 2 bit ciascuno (slot 0 nei bit bassi)
+     */
+    uint32_t getPackedStates() const;
+
+    static const char* slotToString(uint8_t slot);
+    static int8_t slotFromString(const char* name);     // -1 se sconosciuto
+    static const char* stateToString(State state);
+    static const char* fieldToString(uint8_t field);
+    static int8_t fieldFromString(const char* name);    // -1 se sconosciuto
+
+    static uint32_t getField(const Rule& rule, uint8_t field);
+
+    /**
+     * @brief Scrive un campo saturando al suo tipo
+     * @return false se il campo non esiste
+     */
+    static bool setField(Rule& rule, uint8_t field, int64_t value);
+
+private:
+    State _state[SLOT_COUNT];
+    uint32_t _since[SLOT_COUNT];    // Ingresso nello stato corrente (ms)
+    uint32_t _lockoutUntil;
+    bool _lockoutActive;
+    uint16_t _changedMask;
+
+    void _enter(uint8_t slot, State state, uint32_t timestamp);
+};
+
+#endif // GESTURE_STATE_MACHINE_H
@@ -0,0 +1,125 @@
+#include "HeatshrinkDecoder.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+HeatshrinkDecoder::~HeatshrinkDecoder() {
+    end();
+}
+
+bool HeatshrinkDecoder::begin(uint8_t windowBits, uint8_t lookaheadBits) {
+    end();
+
+    if (windowBits < MIN_WINDOW_BITS || windowBits > MAX_WINDOW_BITS ||
+        lookaheadBits < MIN_LOOKAHEAD_BITS || lookaheadBits >= windowBits) {
+        return false;
+    }
+
+    const size_t windowSize = (size_t)1 << windowBits;
+    _window = (uint8_t*)malloc(windowSize);
+    if (_window == nullptr) {
+        return false;
+    }
+    // Backref prima dell'inizio dello stream leggono zeri (come heatshrink)
+    memset(_window, 0, windowSize);
+
+    _windowMask = (uint16_t)(windowSize - 1);
+    _head = 0;
+    _windowBits = windowBits;
+    _lookaheadBits = lookaheadBits;
+    _state = STATE_TAG;
+    _bits = 0;
+    _bitCount = 0;
+    _backrefDistance = 0;
+    _outLen = 0;
+    _outputBytes = 0;
+    return true;
+}
+
+void HeatshrinkDecoder::end() {
+    free(_window);
+    _window = nullptr;
+    _outLen = 0;
+}
+
+bool HeatshrinkDecoder::_emit(uint8_t byte, Sink sink, void* context) {
+    _window[_head & _windowMask] = byte;
+    _head++;
+
+    _out[_outLen++] = byte;
+    _outputBytes++;
+    if (_outLen == OUT_BUFFER_SIZE) {
+        _outLen = 0;
+        return sink(context, _out, OUT_BUFFER_SIZE);
+    }
+    return true;
+}
+
+bool HeatshrinkDecoder::flush(Sink sink, void* context) {
+    if (_outLen == 0) {
+        return true;
+    }
+    const size_t len = _outLen;
+    _outLen = 0;
+    return sink(context, _out, len);
+}
+
+bool HeatshrinkDecoder::feed(const uint8_t* data, size_t length, Sink sink, void* context) {
+    if (_window == nullptr) {
+        return false;
+    }
+
+    size_t pos = 0;
+    for (;;) {
+        // Bit richiesti dal campo corrente (max 14 + 7 già presenti: sta in 32 bit)
+        uint8_t need;
+        switch (_state) {
+            case STATE_TAG:     need = 1; break;
+            case STATE_LITERAL: need = 8; break;
+            case STATE_INDEX:   need = _windowBits; break;
+            default:            need = _lookaheadBits; break;
+        }
+
+        while (_bitCount < need) {
+            if (pos >= length) {
+                return true;  // Campo a metà: riprende alla prossima feed()
+            }
+            _bits = (_bits << 8) | data[pos++];
+            _bitCount += 8;
+        }
+
+        _bitCount -= need;
+        const uint32_t value = (_bits >> _bitCount) & ((1UL << need) - 1);
+
+        switch (_state) {
+            case STATE_TAG:
+                _state = value ? STATE_LITERAL : STATE_INDEX;
+                break;
+
+            case STATE_LITERAL:
+                _state = STATE_TAG;
+                if (!_emit((uint8_t)value, sink, context)) {
+                    return false;
+                }
+                break;
+
+            case STATE_INDEX:
+                _backrefDistance = (uint16_t)(value + 1);
+                _state = STATE_COUNT;
+                break;
+
+            case STATE_COUNT: {
+                _state = STATE_TAG;
+                // Copia byte per byte: sovrapposizioni (distanza < lunghezza) = ripetizioni
+                const uint32_t count = value + 1;
+                for (uint32_t i = 0; i < count; i++) {
+                    const uint8_t byte = _window[(uint16_t)(_head - _backrefDistance) & _windowMask];
+                    if (!_emit(byte, sink, context)) {
+                        return false;
+                    }
+                }
+                break;
+            }
+        }
+    }
+}
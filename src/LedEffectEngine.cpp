@@ -1,19 +1,27 @@
 #include "LedEffectEngine.h"
 #include <esp_sleep.h>
+#include "SentryMode.h"
+#include "LedStateStore.h"
 
 static constexpr uint8_t MAX_SAFE_BRIGHTNESS = 255;
 static constexpr uint8_t GRID_ROWS = OpticalFlowDetector::GRID_ROWS;
 static constexpr uint8_t GRID_COLS = OpticalFlowDetector::GRID_COLS;
 
+// Profilo lama del frame, solo se calcolato per il foldPoint corrente
+// (un foldPoint appena cambiato lo invalida per un frame)
+static const uint8_t* bladeProfileFor(const LedSnapshot& state, const MotionProcessor::ProcessedMotion* motion) {
+    return (motion && motion->bladeLength == state.foldPoint) ? motion->bladeProfile : nullptr;
+}
+
 LedEffectEngine::LedEffectEngine(CRGB* leds, uint16_t numLeds) :
     _leds(leds),
     _numLeds(numLeds),
     _mode(Mode::IDLE),
     _modeStartTime(0),
     _suppressGestureOverrides(false),
-    _gestureEffectName(""),
+    _gestureEffect(EffectId::CLASH),
     _gestureEffectDurationMs(500),
-    _lastBaseEffect("solid"),
+    _lastBaseEffect(EffectId::SOLID),
     _deepSleepRequested(false),
     _ledStateRef(nullptr),
     _hue(0),
@@ -60,7 +68,7 @@ LedEffectEngine::LedEffectEngine(CRGB* leds, uint16_t numLeds) :
     }
 }
 
-void LedEffectEngine::render(const LedState& state, const MotionProcessor::ProcessedMotion* motion) {
+void LedEffectEngine::render(const LedSnapshot& state, const MotionProcessor::ProcessedMotion* motion) {
     const unsigned long now = millis();
 
     // Rate limiting: Ridotto a 15ms (~66 FPS) per animazioni più fluide
@@ -75,8 +83,8 @@ void LedEffectEngine::render(const LedState& state, const MotionProcessor::Proce
         return;
     }
 
-    if (state.effect != "ignition" && state.effect != "retraction" && state.effect != "clash") {
-        _lastBaseEffect = state.effect;
+    if (!isOneShotEffect(state.effectId) && state.effectId != EffectId::UNKNOWN) {
+        _lastBaseEffect = state.effectId;
     }
 
     // Auto-IGNITION when blade is off: any direction ("spicchio") triggers ignition
@@ -126,12 +134,15 @@ void LedEffectEngine::render(const LedState& state, const MotionProcessor::Proce
 
     // In some modes we don't want gestures to override the running effect
     // (e.g. Dual Pong/Dual Pulse manages its own "collision clash").
-    _suppressGestureOverrides = (state.effect == "dual_pulse" || state.effect == "dual_pulse_simple");
+    _suppressGestureOverrides = (state.effectId == EffectId::DUAL_PULSE || state.effectId == EffectId::DUAL_PULSE_SIMPLE);
+
+    // Effetto richiesto dalla gesture map (risolto una volta per frame)
+    const bool hasEffectRequest = motion != nullptr && motion->effectRequest[0] != '\0';
+    const EffectId requestedEffect = hasEffectRequest ? effectIdFromName(motion->effectRequest) : EffectId::UNKNOWN;
 
     // Handle gesture triggers (if motion available)
     if (motion != nullptr) {
-        const bool hasEffectRequest = (motion->effectRequest[0] != '\0');
-        const bool effectMatches = hasEffectRequest && (state.effect == motion->effectRequest);
+        const bool effectMatches = hasEffectRequest && (state.effectId == requestedEffect);
         if (!hasEffectRequest || effectMatches) {
             handleGestureTriggers(motion->gesture, now, state);
         }
@@ -157,8 +168,9 @@ void LedEffectEngine::render(const LedState& state, const MotionProcessor::Proce
             _clashBrightness = 255;
             _lastClashTrigger = now;
             Serial.println("[LED] Clash triggered by gesture map");
-        } else if (state.effect != motion->effectRequest) {
-            _ledStateRef->effect = String(motion->effectRequest);
+        } else if (state.effectId != requestedEffect) {
+            LedStateStore::Transaction tx;
+            tx->effect = motion->effectRequest;
             Serial.printf("[LED] Effect changed by gesture: %s\n", motion->effectRequest);
         }
     }
@@ -188,57 +200,36 @@ void LedEffectEngine::render(const LedState& state, const MotionProcessor::Proce
             break;
 
         case Mode::GESTURE_EFFECT:
-            renderBaseEffect(state, motion, _gestureEffectName);
+            renderBaseEffect(state, motion, _gestureEffect);
             break;
 
         case Mode::IDLE:
         default:
             // Render base effect with optional perturbations
-            if (state.effect == "solid") {
-                renderSolid(state, motion ? motion->perturbationGrid : nullptr);
-            } else if (state.effect == "rainbow") {
-                renderRainbow(state, motion ? motion->perturbationGrid : nullptr);
-            } else if (state.effect == "breathe") {
-                renderBreathe(state, motion ? motion->perturbationGrid : nullptr);
-            } else if (state.effect == "sine_motion") {
-                renderSineMotion(state, motion ? motion->perturbationGrid : nullptr);
-            } else if (state.effect == "flicker") {
-                renderFlicker(state, motion ? motion->perturbationGrid : nullptr);
-            } else if (state.effect == "unstable") {
-                renderUnstable(state, motion ? motion->perturbationGrid : nullptr);
-            } else if (state.effect == "pulse") {
-                renderPulse(state, motion ? motion->perturbationGrid : nullptr);
-            } else if (state.effect == "dual_pulse") {
-                renderDualPulse(state, motion ? motion->perturbationGrid : nullptr);
-            } else if (state.effect == "dual_pulse_simple") {
-                renderDualPulseSimple(state, motion ? motion->perturbationGrid : nullptr);
-            } else if (state.effect == "rainbow_blade") {
-                renderRainbowBlade(state, motion ? motion->perturbationGrid : nullptr);
-            } else if (state.effect == "rainbow_effect") {
-                renderRainbowEffect(state, motion ? motion->perturbationGrid : nullptr, motion);
-            } else if (state.effect == "storm_lightning") {
-                renderStormLightning(state, motion ? motion->perturbationGrid : nullptr);
-            } else if (state.effect == "chrono_hybrid" || state.effect == "clock") {
-                renderChronoHybrid(state, motion ? motion->perturbationGrid : nullptr, motion);
-            } else if (state.effect == "ignition") {
-                // Manual ignition effect (user triggered)
-                renderIgnition(state, motion);
-            } else if (state.effect == "retraction") {
-                // Manual retraction effect (user triggered)
-                renderRetraction(state, motion);
-            } else if (state.effect == "clash") {
-                // Manual clash effect (user triggered)
-                renderClash(state, motion);
-            } else {
-                // Unknown effect: fallback to solid
-                renderSolid(state, nullptr);
+            switch (state.effectId) {
+                case EffectId::IGNITION:
+                    // Manual ignition effect (user triggered)
+                    renderIgnition(state, motion);
+                    break;
+                case EffectId::RETRACTION:
+                    // Manual retraction effect (user triggered)
+                    renderRetraction(state, motion);
+                    break;
+                case EffectId::CLASH:
+                    // Manual clash effect (user triggered)
+                    renderClash(state, motion);
+                    break;
+                default:
+                    // Unknown effect: fallback to solid (in renderBaseEffect)
+                    renderBaseEffect(state, motion, state.effectId);
+                    break;
             }
             break;
     }
 
     // Apply brightness (use override if breathe effect set it)
     uint8_t finalBrightness = min(_breathOverride, MAX_SAFE_BRIGHTNESS);
-    if (state.effect != "breathe") {
+    if (state.effectId != EffectId::BREATHE) {
         finalBrightness = min(state.brightness, MAX_SAFE_BRIGHTNESS);
     }
 
@@ -274,6 +265,16 @@ uint8_t LedEffectEngine::getHueFromDirection(OpticalFlowDetector::Direction dir)
     }
 }
 
+uint8_t LedEffectEngine::getHueFromAngle(uint16_t angle) {
+    // Tinte di getHueFromDirection ogni 45°, da destra in senso orario (y verso il basso)
+    static const uint8_t ANCHORS[9] = {64, 192, 160, 128, 96, 48, 0, 32, 64};
+    const uint8_t sector = angle >> 13;
+    const uint16_t frac = angle & 0x1FFF;
+    // Interpolazione sul percorso più corto della ruota dei colori
+    const int16_t delta = (int8_t)(uint8_t)(ANCHORS[sector + 1] - ANCHORS[sector]);
+    return (uint8_t)(ANCHORS[sector] + ((delta * (int32_t)frac) >> 13));
+}
+
 void LedEffectEngine::setLedPair(uint16_t logicalIndex, uint16_t foldPoint, CRGB color) {
     if (logicalIndex >= foldPoint) {
         return;
@@ -298,37 +299,25 @@ void LedEffectEngine::setLedPairDual(uint16_t logicalIndex, uint16_t foldPoint,
     _leds[led2] = colorB;
 }
 
-void LedEffectEngine::renderBaseEffect(const LedState& state, const MotionProcessor::ProcessedMotion* motion, const String& effectName) {
+void LedEffectEngine::renderBaseEffect(const LedSnapshot& state, const MotionProcessor::ProcessedMotion* motion, EffectId effect) {
     const uint8_t (*perturbationGrid)[GRID_COLS] = motion ? motion->perturbationGrid : nullptr;
-
-    if (effectName == "solid") {
-        renderSolid(state, perturbationGrid);
-    } else if (effectName == "rainbow") {
-        renderRainbow(state, perturbationGrid);
-    } else if (effectName == "breathe") {
-        renderBreathe(state, perturbationGrid);
-    } else if (effectName == "sine_motion") {
-        renderSineMotion(state, perturbationGrid);
-    } else if (effectName == "flicker") {
-        renderFlicker(state, perturbationGrid);
-    } else if (effectName == "unstable") {
-        renderUnstable(state, perturbationGrid);
-    } else if (effectName == "pulse") {
-        renderPulse(state, perturbationGrid);
-    } else if (effectName == "dual_pulse") {
-        renderDualPulse(state, perturbationGrid);
-    } else if (effectName == "dual_pulse_simple") {
-        renderDualPulseSimple(state, perturbationGrid);
-    } else if (effectName == "rainbow_blade") {
-        renderRainbowBlade(state, perturbationGrid);
-    } else if (effectName == "rainbow_effect") {
-        renderRainbowEffect(state, perturbationGrid, motion);
-    } else if (effectName == "storm_lightning") {
-        renderStormLightning(state, perturbationGrid);
-    } else if (effectName == "chrono_hybrid" || effectName == "clock") {
-        renderChronoHybrid(state, perturbationGrid, motion);
-    } else {
-        renderSolid(state, nullptr);
+    const uint8_t* bladeProfile = bladeProfileFor(state, motion);
+
+    switch (effect) {
+        case EffectId::SOLID:             renderSolid(state, bladeProfile); break;
+        case EffectId::RAINBOW:           renderRainbow(state, bladeProfile); break;
+        case EffectId::BREATHE:           renderBreathe(state, bladeProfile); break;
+        case EffectId::SINE_MOTION:       renderSineMotion(state, bladeProfile); break;
+        case EffectId::FLICKER:           renderFlicker(state, bladeProfile); break;
+        case EffectId::UNSTABLE:          renderUnstable(state, perturbationGrid); break;
+        case EffectId::PULSE:             renderPulse(state, perturbationGrid); break;
+        case EffectId::DUAL_PULSE:        renderDualPulse(state, perturbationGrid); break;
+        case EffectId::DUAL_PULSE_SIMPLE: renderDualPulseSimple(state, bladeProfile); break;
+        case EffectId::RAINBOW_BLADE:     renderRainbowBlade(state, bladeProfile); break;
+        case EffectId::RAINBOW_EFFECT:    renderRainbowEffect(state, bladeProfile, motion); break;
+        case EffectId::STORM_LIGHTNING:   renderStormLightning(state, bladeProfile); break;
+        case EffectId::CHRONO_HYBRID:     renderChronoHybrid(state, perturbationGrid, motion); break;
+        default:                          renderSolid(state, nullptr); break;
     }
 }
 
@@ -370,10 +359,10 @@ void LedEffectEngine::applyBladeMask(uint16_t activeCount, uint16_t foldPoint) {
 // BASE EFFECT RENDERERS
 // ═══════════════════════════════════════════════════════════
 
-void LedEffectEngine::renderSolid(const LedState& state, const uint8_t perturbationGrid[GRID_ROWS][GRID_COLS]) {
+void LedEffectEngine::renderSolid(const LedSnapshot& state, const uint8_t* bladeProfile) {
     CRGB baseColor = CRGB(state.r, state.g, state.b);
 
-    if (perturbationGrid == nullptr) {
+    if (bladeProfile == nullptr) {
         // No perturbations: simple solid fill
         fill_solid(_leds, _numLeds, baseColor);
         return;
@@ -383,13 +372,7 @@ void LedEffectEngine::renderSolid(const LedState& state, const uint8_t perturbat
     uint8_t safeBrightness = min(state.brightness, MAX_SAFE_BRIGHTNESS);
 
     for (uint16_t i = 0; i < state.foldPoint; i++) {
-        uint8_t col = map(i, 0, state.foldPoint - 1, 0, GRID_COLS - 1);
-
-        // Sample multiple rows for fuller effect
-        uint8_t maxPerturbation = 0;
-        for (uint8_t row = 2; row <= 4; row++) {
-            maxPerturbation = max(maxPerturbation, perturbationGrid[row][col]);
-        }
+        uint8_t maxPerturbation = bladeProfile[i];
 
         if (maxPerturbation > 10) {
             // BREATHING EFFECT: motion makes blade pulse locally
@@ -412,11 +395,11 @@ void LedEffectEngine::renderSolid(const LedState& state, const uint8_t perturbat
     // Note: Brightness scaling already applied, will be set globally in render()
 }
 
-void LedEffectEngine::renderRainbow(const LedState& state, const uint8_t perturbationGrid[GRID_ROWS][GRID_COLS]) {
+void LedEffectEngine::renderRainbow(const LedSnapshot& state, const uint8_t* bladeProfile) {
     uint8_t step = map(state.speed, 1, 255, 1, 15);
     if (step == 0) step = 1;
 
-    if (perturbationGrid == nullptr) {
+    if (bladeProfile == nullptr || state.foldPoint == 0) {
         // No motion: classic rainbow
         fill_rainbow(_leds, _numLeds, _hue, 256 / _numLeds);
     } else {
@@ -424,16 +407,9 @@ void LedEffectEngine::renderRainbow(const LedState& state, const uint8_t perturb
         for (uint16_t i = 0; i < _numLeds; i++) {
             uint8_t hue = _hue + (i * 256 / _numLeds);
 
-            // Map physical LED to grid column
+            // Map physical LED to logical blade position
             uint16_t logicalPos = (i < _numLeds / 2) ? i : (_numLeds - 1 - i);
-            uint8_t col = map(logicalPos, 0, state.foldPoint - 1, 0, GRID_COLS - 1);
-
-            // Average perturbation
-            uint16_t perturbSum = 0;
-            for (uint8_t row = 1; row <= 4; row++) {
-                perturbSum += perturbationGrid[row][col];
-            }
-            uint8_t avgPerturbation = perturbSum / 4;
+            uint8_t avgPerturbation = bladeProfile[min<uint16_t>(logicalPos, state.foldPoint - 1)];
 
             // Motion creates shimmer: vary saturation and brightness
             uint8_t saturation = 255;
@@ -452,7 +428,7 @@ void LedEffectEngine::renderRainbow(const LedState& state, const uint8_t perturb
     _hue += step;
 }
 
-void LedEffectEngine::renderBreathe(const LedState& state, const uint8_t perturbationGrid[GRID_ROWS][GRID_COLS]) {
+void LedEffectEngine::renderBreathe(const LedSnapshot& state, const uint8_t* bladeProfile) {
     // Subtle breathe: reduce depth so the effect is less pronounced
     const uint8_t breathDepth = 140;  // 0-255, lower = subtler
     const uint8_t stripeLowScale = 150;  // Alternating brightness between lines
@@ -462,7 +438,7 @@ void LedEffectEngine::renderBreathe(const LedState& state, const uint8_t perturb
     uint8_t safeBrightness = min(state.brightness, MAX_SAFE_BRIGHTNESS);
     bool flipPhase = (beat8(state.speed) & 0x80) != 0;
 
-    if (perturbationGrid == nullptr) {
+    if (bladeProfile == nullptr) {
         // No motion: classic breathe
         CRGB baseColor = CRGB(state.r, state.g, state.b);
 
@@ -485,14 +461,7 @@ void LedEffectEngine::renderBreathe(const LedState& state, const uint8_t perturb
         CRGB baseColor = CRGB(state.r, state.g, state.b);
 
         for (uint16_t i = 0; i < state.foldPoint; i++) {
-            uint8_t col = map(i, 0, state.foldPoint - 1, 0, GRID_COLS - 1);
-
-            // Sample perturbation
-            uint16_t perturbSum = 0;
-            for (uint8_t row = 2; row <= 4; row++) {
-                perturbSum += perturbationGrid[row][col];
-            }
-            uint8_t avgPerturbation = perturbSum / 3;
+            uint8_t avgPerturbation = bladeProfile[i];
 
             // Motion modulates breath: creates wave-like breathing
             uint8_t localBreath = effectiveBreath;
@@ -521,7 +490,7 @@ void LedEffectEngine::renderBreathe(const LedState& state, const uint8_t perturb
     }
 }
 
-void LedEffectEngine::renderSineMotion(const LedState& state, const uint8_t perturbationGrid[GRID_ROWS][GRID_COLS]) {
+void LedEffectEngine::renderSineMotion(const LedSnapshot& state, const uint8_t* bladeProfile) {
     const uint16_t foldPoint = state.foldPoint;
     if (foldPoint == 0) {
         return;
@@ -532,11 +501,6 @@ void LedEffectEngine::renderSineMotion(const LedState& state, const uint8_t pert
     uint8_t timePhase = (millis() / 3) & 0xFF;
 
     for (uint16_t i = 0; i < foldPoint; i++) {
-        uint8_t col = 0;
-        if (foldPoint > 1) {
-            col = map(i, 0, foldPoint - 1, 0, GRID_COLS - 1);
-        }
-
         // Calcola posizione normalizzata: 0 = impugnatura, 255 = punta
         uint16_t maxPos = (foldPoint > 1) ? (foldPoint - 1) : 1;
         uint8_t positionRatio = map(i, 0, maxPos, 0, 255);
@@ -544,14 +508,7 @@ void LedEffectEngine::renderSineMotion(const LedState& state, const uint8_t pert
         // Intensità del tremolìo aumenta verso la punta (quadratica per enfasi)
         uint8_t tipIntensity = scale8(positionRatio, positionRatio);
 
-        uint8_t avgPerturbation = 0;
-        if (perturbationGrid != nullptr) {
-            uint16_t perturbSum = 0;
-            for (uint8_t row = 2; row <= 4; row++) {
-                perturbSum += perturbationGrid[row][col];
-            }
-            avgPerturbation = perturbSum / 3;
-        }
+        uint8_t avgPerturbation = bladeProfile != nullptr ? bladeProfile[i] : 0;
 
         // Frequenza aumenta verso la punta (tremolìo più rapido)
         uint8_t freqBoost = map(avgPerturbation, 0, 255, 0, 6);
@@ -580,7 +537,7 @@ void LedEffectEngine::renderSineMotion(const LedState& state, const uint8_t pert
     }
 }
 
-void LedEffectEngine::renderFlicker(const LedState& state, const uint8_t perturbationGrid[GRID_ROWS][GRID_COLS]) {
+void LedEffectEngine::renderFlicker(const LedSnapshot& state, const uint8_t* bladeProfile) {
     CRGB baseColor = CRGB(state.r, state.g, state.b);
     uint8_t safeBrightness = min(state.brightness, MAX_SAFE_BRIGHTNESS);
     uint8_t flickerIntensity = state.speed;
@@ -589,14 +546,8 @@ void LedEffectEngine::renderFlicker(const LedState& state, const uint8_t perturb
         uint8_t noise = random8(flickerIntensity);
 
         // KYLO REN STYLE: Motion perturbations VIOLENTLY disturb the blade
-        if (perturbationGrid != nullptr) {
-            uint8_t col = map(i, 0, state.foldPoint - 1, 0, GRID_COLS - 1);
-
-            // Sample multiple rows to create wider perturbation effect
-            uint8_t perturbSum = 0;
-            for (uint8_t row = 2; row <= 4; row++) {  // Center 3 rows
-                perturbSum = qadd8(perturbSum, perturbationGrid[row][col] / 3);
-            }
+        if (bladeProfile != nullptr) {
+            uint8_t perturbSum = bladeProfile[i];
 
             // AGGRESSIVE: Motion adds MAJOR instability (up to 200% of base flicker)
             uint8_t motionBoost = scale8(perturbSum, 255);  // Maximum amplify perturbation
@@ -621,7 +572,7 @@ void LedEffectEngine::renderFlicker(const LedState& state, const uint8_t perturb
     // Note: Brightness scaling already applied, will be set globally in render()
 }
 
-void LedEffectEngine::renderUnstable(const LedState& state, const uint8_t perturbationGrid[GRID_ROWS][GRID_COLS]) {
+void LedEffectEngine::renderUnstable(const LedSnapshot& state, const uint8_t perturbationGrid[GRID_ROWS][GRID_COLS]) {
     CRGB baseColor = CRGB(state.r, state.g, state.b);
     uint8_t safeBrightness = min(state.brightness, MAX_SAFE_BRIGHTNESS);
     uint16_t maxIndex = min((uint16_t)state.foldPoint, (uint16_t)72);
@@ -690,7 +641,7 @@ void LedEffectEngine::renderUnstable(const LedState& state, const uint8_t pertur
     // Note: Brightness scaling already applied, will be set globally in render()
 }
 
-void LedEffectEngine::renderPulse(const LedState& state, const uint8_t perturbationGrid[GRID_ROWS][GRID_COLS]) {
+void LedEffectEngine::renderPulse(const LedSnapshot& state, const uint8_t perturbationGrid[GRID_ROWS][GRID_COLS]) {
     // --- Costanti per l'effetto Pulse ---
     static constexpr uint8_t PERTURBATION_THRESHOLD = 3;
     static constexpr float ACCELERATION_COEFFICIENT = 3.0f;
@@ -940,7 +891,7 @@ void LedEffectEngine::renderPulse(const LedState& state, const uint8_t perturbat
     // Note: Brightness scaling already applied, will be set globally in render()
 }
 
-void LedEffectEngine::renderDualPulse(const LedState& state, const uint8_t perturbationGrid[GRID_ROWS][GRID_COLS]) {
+void LedEffectEngine::renderDualPulse(const LedSnapshot& state, const uint8_t perturbationGrid[GRID_ROWS][GRID_COLS]) {
     const unsigned long now = millis();
 
     // ═══════════════════════════════════════════════════════════
@@ -1858,7 +1809,7 @@ void LedEffectEngine::renderDualPulse(const LedState& state, const uint8_t pertu
     }
 }
 
-void LedEffectEngine::renderDualPulseSimple(const LedState& state, const uint8_t perturbationGrid[GRID_ROWS][GRID_COLS]) {
+void LedEffectEngine::renderDualPulseSimple(const LedSnapshot& state, const uint8_t* bladeProfile) {
     const unsigned long now = millis();
 
     // Dual Pulse Simple:
@@ -1928,22 +1879,19 @@ void LedEffectEngine::renderDualPulseSimple(const LedState& state, const uint8_t
 
     uint8_t ball1Perturb = 0;
     uint8_t ball2Perturb = 0;
-    if (perturbationGrid != nullptr) {
+    if (bladeProfile != nullptr && state.foldPoint > 0) {
+        // Media del profilo attorno alla palla (circa una colonna di griglia per lato)
+        const int halfWidth = max(1, (int)state.foldPoint / GRID_COLS);
         auto sampleBallPerturb = [&](float pos) -> uint8_t {
-            uint16_t idx = (uint16_t)constrain((int)lroundf(pos), 0, (int)state.foldPoint - 1);
-            uint8_t col = (uint8_t)map(idx, 0, state.foldPoint - 1, 0, GRID_COLS - 1);
+            const int idx = constrain((int)lroundf(pos), 0, (int)state.foldPoint - 1);
+            const int first = max(0, idx - halfWidth);
+            const int last = min((int)state.foldPoint - 1, idx + halfWidth);
 
             uint16_t sum = 0;
-            uint8_t samples = 0;
-            for (int8_t dc = -1; dc <= 1; dc++) {
-                int8_t c = (int8_t)col + dc;
-                if (c < 0 || c >= GRID_COLS) continue;
-                for (uint8_t row = 1; row + 1 < GRID_ROWS; row++) {
-                    sum += perturbationGrid[row][(uint8_t)c];
-                    samples++;
-                }
+            for (int i = first; i <= last; i++) {
+                sum += bladeProfile[i];
             }
-            return samples ? (uint8_t)(sum / samples) : 0;
+            return (uint8_t)(sum / (last - first + 1));
         };
 
         ball1Perturb = sampleBallPerturb(ball1_pos);
@@ -2189,7 +2137,7 @@ void LedEffectEngine::renderDualPulseSimple(const LedState& state, const uint8_t
     }
 }
 
-void LedEffectEngine::renderRainbowBlade(const LedState& state, const uint8_t perturbationGrid[GRID_ROWS][GRID_COLS]) {
+void LedEffectEngine::renderRainbowBlade(const LedSnapshot& state, const uint8_t* bladeProfile) {
     uint8_t hueStep = map(state.speed, 1, 255, 1, 15);
     if (hueStep == 0) hueStep = 1;
 
@@ -2199,15 +2147,8 @@ void LedEffectEngine::renderRainbowBlade(const LedState& state, const uint8_t pe
         uint8_t brightness = 255;
 
         // CHROMATIC ABERRATION: motion creates color shifts and sparkles
-        if (perturbationGrid != nullptr) {
-            uint8_t col = map(i, 0, state.foldPoint - 1, 0, GRID_COLS - 1);
-
-            // Sample perturbation
-            uint16_t perturbSum = 0;
-            for (uint8_t row = 2; row <= 4; row++) {
-                perturbSum += perturbationGrid[row][col];
-            }
-            uint8_t avgPerturbation = perturbSum / 3;
+        if (bladeProfile != nullptr) {
+            uint8_t avgPerturbation = bladeProfile[i];
 
             if (avgPerturbation > 8) {  // More sensitive threshold
                 // Motion creates chromatic shimmer: hue shift + saturation pulse
@@ -2232,7 +2173,7 @@ void LedEffectEngine::renderRainbowBlade(const LedState& state, const uint8_t pe
     _rainbowHue += hueStep;
 }
 
-void LedEffectEngine::renderRainbowEffect(const LedState& state, const uint8_t perturbationGrid[GRID_ROWS][GRID_COLS], const MotionProcessor::ProcessedMotion* motion) {
+void LedEffectEngine::renderRainbowEffect(const LedSnapshot& state, const uint8_t* bladeProfile, const MotionProcessor::ProcessedMotion* motion) {
     CRGB whiteBase = CRGB(255, 255, 255);  // Lama bianca come base
     uint8_t safeBrightness = min(state.brightness, MAX_SAFE_BRIGHTNESS);
 
@@ -2240,19 +2181,14 @@ void LedEffectEngine::renderRainbowEffect(const LedState& state, const uint8_t p
         CRGB ledColor = whiteBase;  // Start with white
 
         // RAINBOW PERTURBATIONS: motion adds colors based on direction
-        if (perturbationGrid != nullptr && motion != nullptr) {
-            uint8_t col = map(i, 0, state.foldPoint - 1, 0, GRID_COLS - 1);
-
-            // Sample perturbation in this column
-            uint16_t perturbSum = 0;
-            for (uint8_t row = 2; row <= 4; row++) {
-                perturbSum += perturbationGrid[row][col];
-            }
-            uint8_t avgPerturbation = perturbSum / 3;
+        if (bladeProfile != nullptr && motion != nullptr) {
+            uint8_t avgPerturbation = bladeProfile[i];
 
             if (avgPerturbation > 12) {  // Sensitive threshold for color appearance
-                // Get color based on motion direction
-                uint8_t hue = getHueFromDirection(motion->direction);
+                // Get color based on motion direction (continuous angle when available)
+                uint8_t hue = motion->flowMagnitudeQ4 > 0
+                    ? getHueFromAngle(motion->flowAngle)
+                    : getHueFromDirection(motion->direction);
 
                 // Create saturated color from direction
                 CRGB perturbColor = CHSV(hue, 255, 255);
@@ -2277,7 +2213,7 @@ void LedEffectEngine::renderRainbowEffect(const LedState& state, const uint8_t p
     }
 }
 
-void LedEffectEngine::renderStormLightning(const LedState& state, const uint8_t perturbationGrid[GRID_ROWS][GRID_COLS]) {
+void LedEffectEngine::renderStormLightning(const LedSnapshot& state, const uint8_t* bladeProfile) {
     const unsigned long now = millis();
     const uint16_t foldPoint = state.foldPoint;
     const CRGB boltColor = CRGB(200, 220, 255);
@@ -2298,24 +2234,20 @@ void LedEffectEngine::renderStormLightning(const LedState& state, const uint8_t
     uint32_t weightedSum = 0;
     uint32_t totalWeight = 0;
 
-    if (perturbationGrid != nullptr) {
-        for (uint8_t col = 0; col < GRID_COLS; col++) {
-            uint8_t colMax = 0;
-            for (uint8_t row = 2; row <= 4; row++) {
-                colMax = max(colMax, perturbationGrid[row][col]);
-            }
-            if (colMax > 5) {  // Soglia rumore
-                weightedSum += col * colMax;
-                totalWeight += colMax;
-                maxMotion = max(maxMotion, colMax);
+    if (bladeProfile != nullptr) {
+        for (uint16_t i = 0; i < foldPoint; i++) {
+            const uint8_t value = bladeProfile[i];
+            if (value > 5) {  // Soglia rumore
+                weightedSum += i * value;
+                totalWeight += value;
+                maxMotion = max(maxMotion, value);
             }
         }
     }
 
     uint16_t motionPos = 0;
     if (totalWeight > 0) {
-        float centerCol = (float)weightedSum / totalWeight;
-        motionPos = map((long)(centerCol * 100), 0, (GRID_COLS - 1) * 100, 0, foldPoint - 1);
+        motionPos = (uint16_t)(weightedSum / totalWeight);
     } else {
         motionPos = foldPoint / 2;
     }
@@ -2524,7 +2456,7 @@ void LedEffectEngine::renderStormLightning(const LedState& state, const uint8_t
 // GESTURE-TRIGGERED EFFECTS
 // ═══════════════════════════════════════════════════════════
 
-void LedEffectEngine::renderIgnition(const LedState& state, const MotionProcessor::ProcessedMotion* motion) {
+void LedEffectEngine::renderIgnition(const LedSnapshot& state, const MotionProcessor::ProcessedMotion* motion) {
     // If one-shot mode and already completed, skip rendering
     if (_ignitionOneShot && _ignitionCompleted) {
         return;
@@ -2555,13 +2487,13 @@ void LedEffectEngine::renderIgnition(const LedState& state, const MotionProcesso
         }
     }
 
-    String baseEffect = state.effect;
-    if (baseEffect == "ignition" || baseEffect == "retraction" || baseEffect == "clash") {
-        baseEffect = _lastBaseEffect.length() ? _lastBaseEffect : String("solid");
+    EffectId baseEffect = state.effectId;
+    if (isOneShotEffect(baseEffect)) {
+        baseEffect = _lastBaseEffect;
     }
 
-    if (baseEffect == "storm_lightning") {
-        renderStormLightning(state, motion ? motion->perturbationGrid : nullptr);
+    if (baseEffect == EffectId::STORM_LIGHTNING) {
+        renderStormLightning(state, bladeProfileFor(state, motion));
 
         auto addLedPair = [&](uint16_t logicalIndex, CRGB color) {
             if (logicalIndex >= state.foldPoint) {
@@ -2604,7 +2536,7 @@ void LedEffectEngine::renderIgnition(const LedState& state, const MotionProcesso
     applyBladeMask(_ignitionProgress, state.foldPoint);
 }
 
-void LedEffectEngine::renderRetraction(const LedState& state, const MotionProcessor::ProcessedMotion* motion) {
+void LedEffectEngine::renderRetraction(const LedSnapshot& state, const MotionProcessor::ProcessedMotion* motion) {
     // If one-shot mode and already completed, keep all LEDs off
     // (Deep sleep is handled in the animation completion block below)
     if (_retractionOneShot && _retractionCompleted) {
@@ -2634,7 +2566,8 @@ void LedEffectEngine::renderRetraction(const LedState& state, const MotionProces
             if (_retractionDisableBlade) {
                 // CRITICAL: Disable blade BEFORE returning to IDLE mode
                 if (_ledStateRef && _ledStateRef->bladeEnabled) {
-                    _ledStateRef->bladeEnabled = false;
+                    LedStateStore::Transaction tx;
+                    tx->bladeEnabled = false;
                     Serial.println("[LED POWER] Blade disabled after retraction");
                 }
 
@@ -2648,19 +2581,27 @@ void LedEffectEngine::renderRetraction(const LedState& state, const MotionProces
                 Serial.println("[LED POWER] Entering deep sleep in 500ms...");
                 Serial.println("[LED POWER] Wake-up sources:");
                 Serial.println("[LED POWER]   - EXT0 (GPIO 0 / BOOT button) LOW level");
-                Serial.println("[LED POWER]   - Timer wake-up disabled (wake only via reset/button)");
+                if (_ledStateRef && _ledStateRef->sentryModeEnabled) {
+                    Serial.printf("[LED POWER]   - Sentry timer every %u s (camera sniff)\n",
+                                  _ledStateRef->sentryIntervalSec);
+                } else {
+                    Serial.println("[LED POWER]   - Timer wake-up disabled (wake only via reset/button)");
+                }
 
                 fill_solid(_leds, _numLeds, CRGB::Black);
                 FastLED.show();  // Ensure LEDs are off
                 delay(500);
 
-                // Configure wake-up source: GPIO 0 (BOOT button) on LOW level
-                esp_sleep_enable_ext0_wakeup(GPIO_NUM_0, 0);  // 0 = LOW level trigger
-
                 Serial.println("[LED POWER] Entering deep sleep NOW!");
-                Serial.flush();  // Ensure serial buffer is flushed
 
-                esp_deep_sleep_start();
+                // Wake-up sources (EXT0 + optional sentry timer) configured by SentryMode
+                if (_ledStateRef) {
+                    SentryMode::enterDeepSleep(*_ledStateRef);
+                } else {
+                    esp_sleep_enable_ext0_wakeup(GPIO_NUM_0, 0);  // 0 = LOW level trigger
+                    Serial.flush();
+                    esp_deep_sleep_start();
+                }
                 // Code never reaches here - ESP32 enters deep sleep
             }
 
@@ -2676,13 +2617,13 @@ void LedEffectEngine::renderRetraction(const LedState& state, const MotionProces
         }
     }
 
-    String baseEffect = state.effect;
-    if (baseEffect == "ignition" || baseEffect == "retraction" || baseEffect == "clash") {
-        baseEffect = _lastBaseEffect.length() ? _lastBaseEffect : String("solid");
+    EffectId baseEffect = state.effectId;
+    if (isOneShotEffect(baseEffect)) {
+        baseEffect = _lastBaseEffect;
     }
 
-    if (baseEffect == "storm_lightning") {
-        renderStormLightning(state, motion ? motion->perturbationGrid : nullptr);
+    if (baseEffect == EffectId::STORM_LIGHTNING) {
+        renderStormLightning(state, bladeProfileFor(state, motion));
 
         auto addLedPair = [&](uint16_t logicalIndex, CRGB color) {
             if (logicalIndex >= state.foldPoint) {
@@ -2725,7 +2666,7 @@ void LedEffectEngine::renderRetraction(const LedState& state, const MotionProces
     applyBladeMask(_retractionProgress, state.foldPoint);
 }
 
-void LedEffectEngine::renderClash(const LedState& state, const MotionProcessor::ProcessedMotion* motion) {
+void LedEffectEngine::renderClash(const LedSnapshot& state, const MotionProcessor::ProcessedMotion* motion) {
     const unsigned long now = millis();
 
     // Trigger clash periodically (for manual effect mode)
@@ -2742,9 +2683,9 @@ void LedEffectEngine::renderClash(const LedState& state, const MotionProcessor::
         }
     }
 
-    String baseEffect = state.effect;
-    if (baseEffect == "ignition" || baseEffect == "retraction" || baseEffect == "clash") {
-        baseEffect = _lastBaseEffect.length() ? _lastBaseEffect : String("solid");
+    EffectId baseEffect = state.effectId;
+    if (isOneShotEffect(baseEffect)) {
+        baseEffect = _lastBaseEffect;
     }
     renderBaseEffect(state, motion, baseEffect);
 
@@ -2801,7 +2742,8 @@ void LedEffectEngine::powerOn() {
 
     // Step 1: Enable blade state FIRST
     if (_ledStateRef) {
-        _ledStateRef->bladeEnabled = true;
+        LedStateStore::Transaction tx;
+        tx->bladeEnabled = true;
         Serial.println("[LED POWER] Blade enabled");
     } else {
         Serial.println("[LED POWER ERROR] LedState reference not set!");
@@ -2884,7 +2826,7 @@ bool LedEffectEngine::checkModeTimeout(uint32_t now) {
     }
 }
 
-void LedEffectEngine::handleGestureTriggers(MotionProcessor::GestureType gesture, uint32_t now, const LedState& state) {
+void LedEffectEngine::handleGestureTriggers(MotionProcessor::GestureType gesture, uint32_t now, const LedSnapshot& state) {
     if (_mode != Mode::IDLE) {
         // Already in override mode, ignore new gestures
         return;
@@ -2908,8 +2850,7 @@ void LedEffectEngine::handleGestureTriggers(MotionProcessor::GestureType gesture
             break;
 
         case MotionProcessor::GestureType::CLASH:
-            if (state.gestureClashEffect.length() == 0 ||
-                state.gestureClashEffect == "clash") {
+            if (state.gestureClashEffectId == EffectId::CLASH) {
                 _mode = Mode::CLASH_ACTIVE;
                 _modeStartTime = now;
                 _clashActive = true;
@@ -2917,12 +2858,12 @@ void LedEffectEngine::handleGestureTriggers(MotionProcessor::GestureType gesture
                 _lastClashTrigger = now;
                 Serial.println("[LED] CLASH effect triggered by gesture!");
             } else {
-                _gestureEffectName = state.gestureClashEffect;
+                _gestureEffect = state.gestureClashEffectId;
                 _gestureEffectDurationMs = max<uint16_t>(100, state.gestureClashDurationMs);
                 _mode = Mode::GESTURE_EFFECT;
                 _modeStartTime = now;
                 Serial.printf("[LED] Gesture effect override: %s (%ums)\n",
-                              _gestureEffectName.c_str(),
+                              effectIdToName(_gestureEffect) ? effectIdToName(_gestureEffect) : "unknown",
                               _gestureEffectDurationMs);
             }
             break;
@@ -2936,7 +2877,7 @@ void LedEffectEngine::handleGestureTriggers(MotionProcessor::GestureType gesture
 // CHRONO HYBRID EFFECT - Orologio ibrido con motion reactive
 // ═══════════════════════════════════════════════════════════
 
-void LedEffectEngine::renderChronoHybrid(const LedState& state, const uint8_t perturbationGrid[GRID_ROWS][GRID_COLS], const MotionProcessor::ProcessedMotion* motion) {
+void LedEffectEngine::renderChronoHybrid(const LedSnapshot& state, const uint8_t perturbationGrid[GRID_ROWS][GRID_COLS], const MotionProcessor::ProcessedMotion* motion) {
     const unsigned long now = millis();
 
     // ═══ STEP 1: CALCOLO TEMPO REALE ═══
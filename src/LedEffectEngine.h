@@ -4,6 +4,7 @@
 #include <Arduino.h>
 #include <FastLED.h>
 #include "BLELedController.h"
+#include "LedStateStore.h"
 #include "MotionProcessor.h"
 
 /**
@@ -39,10 +40,10 @@ public:
 
     /**
      * @brief Main render function with motion integration
-     * @param state Current LED state
+     * @param state Snapshot LedState del frame (LedStateStore, lock-free)
      * @param motion Processed motion data (gestures + perturbations)
      */
-    void render(const LedState& state, const MotionProcessor::ProcessedMotion* motion);
+    void render(const LedSnapshot& state, const MotionProcessor::ProcessedMotion* motion);
 
     /**
      * @brief Get current rendering mode
@@ -86,13 +87,13 @@ private:
     Mode _mode;
     uint32_t _modeStartTime;
     bool _suppressGestureOverrides;
-    String _gestureEffectName;
+    EffectId _gestureEffect;
     uint16_t _gestureEffectDurationMs;
-    String _lastBaseEffect;
+    EffectId _lastBaseEffect;
 
     // Power state management
     bool _deepSleepRequested;     // true = enter deep sleep after retraction completes
-    LedState* _ledStateRef;       // Reference to LedState for bladeEnabled control
+    LedState* _ledStateRef;       // Master LedState (scritture via LedStateStore::Transaction)
 
     // Animation state variables
     uint8_t _hue;
@@ -187,23 +188,32 @@ private:
      */
     static uint8_t getHueFromDirection(OpticalFlowDetector::Direction dir);
 
+    /**
+     * @brief Hue da angolo continuo (ProcessedMotion::flowAngle), interpolando
+     *        le tinte di getHueFromDirection tra le 8 direzioni
+     */
+    static uint8_t getHueFromAngle(uint16_t angle);
+
     // ═══════════════════════════════════════════════════════════
     // BASE EFFECT RENDERERS
     // ═══════════════════════════════════════════════════════════
 
-    void renderSolid(const LedState& state, const uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS]);
-    void renderRainbow(const LedState& state, const uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS]);
-    void renderBreathe(const LedState& state, const uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS]);
-    void renderSineMotion(const LedState& state, const uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS]);
-    void renderFlicker(const LedState& state, const uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS]);
-    void renderUnstable(const LedState& state, const uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS]);
-    void renderPulse(const LedState& state, const uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS]);
-    void renderDualPulse(const LedState& state, const uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS]);
-    void renderDualPulseSimple(const LedState& state, const uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS]);
-    void renderRainbowBlade(const LedState& state, const uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS]);
-    void renderRainbowEffect(const LedState& state, const uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS], const MotionProcessor::ProcessedMotion* motion);
-    void renderStormLightning(const LedState& state, const uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS]);
-    void renderChronoHybrid(const LedState& state, const uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS], const MotionProcessor::ProcessedMotion* motion);
+    // Renderer per LED: bladeProfile = ProcessedMotion::bladeProfile (foldPoint campioni,
+    // nullptr senza motion). Renderer globali: griglia di perturbazione.
+
+    void renderSolid(const LedSnapshot& state, const uint8_t* bladeProfile);
+    void renderRainbow(const LedSnapshot& state, const uint8_t* bladeProfile);
+    void renderBreathe(const LedSnapshot& state, const uint8_t* bladeProfile);
+    void renderSineMotion(const LedSnapshot& state, const uint8_t* bladeProfile);
+    void renderFlicker(const LedSnapshot& state, const uint8_t* bladeProfile);
+    void renderUnstable(const LedSnapshot& state, const uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS]);
+    void renderPulse(const LedSnapshot& state, const uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS]);
+    void renderDualPulse(const LedSnapshot& state, const uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS]);
+    void renderDualPulseSimple(const LedSnapshot& state, const uint8_t* bladeProfile);
+    void renderRainbowBlade(const LedSnapshot& state, const uint8_t* bladeProfile);
+    void renderRainbowEffect(const LedSnapshot& state, const uint8_t* bladeProfile, const MotionProcessor::ProcessedMotion* motion);
+    void renderStormLightning(const LedSnapshot& state, const uint8_t* bladeProfile);
+    void renderChronoHybrid(const LedSnapshot& state, const uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS], const MotionProcessor::ProcessedMotion* motion);
 
     // ═══════════════════════════════════════════════════════════
     // CHRONO THEME RENDERERS (modular)
@@ -253,11 +263,11 @@ private:
     // GESTURE-TRIGGERED EFFECTS
     // ═══════════════════════════════════════════════════════════
 
-    void renderIgnition(const LedState& state, const MotionProcessor::ProcessedMotion* motion);
-    void renderRetraction(const LedState& state, const MotionProcessor::ProcessedMotion* motion);
-    void renderClash(const LedState& state, const MotionProcessor::ProcessedMotion* motion);
+    void renderIgnition(const LedSnapshot& state, const MotionProcessor::ProcessedMotion* motion);
+    void renderRetraction(const LedSnapshot& state, const MotionProcessor::ProcessedMotion* motion);
+    void renderClash(const LedSnapshot& state, const MotionProcessor::ProcessedMotion* motion);
 
-    void renderBaseEffect(const LedState& state, const MotionProcessor::ProcessedMotion* motion, const String& effectName);
+    void renderBaseEffect(const LedSnapshot& state, const MotionProcessor::ProcessedMotion* motion, EffectId effect);
     void applyBladeMask(uint16_t activeCount, uint16_t foldPoint);
 
     // ═══════════════════════════════════════════════════════════
@@ -265,7 +275,7 @@ private:
     // ═══════════════════════════════════════════════════════════
 
     bool checkModeTimeout(uint32_t now);
-    void handleGestureTriggers(MotionProcessor::GestureType gesture, uint32_t now, const LedState& state);
+    void handleGestureTriggers(MotionProcessor::GestureType gesture, uint32_t now, const LedSnapshot& state);
 };
 
 #endif // LED_EFFECT_ENGINE_H
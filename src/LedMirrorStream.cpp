@@ -0,0 +1,282 @@
+#include "LedMirrorStream.h"
+
+static portMUX_TYPE gLedMirrorMux = portMUX_INITIALIZER_UNLOCKED;
+
+static_assert(sizeof(CRGB) == 3, "CRGB must be packed r,g,b");
+
+LedMirrorStream& LedMirrorStream::getInstance() {
+    static LedMirrorStream instance;
+    return instance;
+}
+
+bool LedMirrorStream::begin(BLECharacteristic* characteristic, BLE2902* cccd) {
+    _characteristic = characteristic;
+    _cccd = cccd;
+
+    if (_task != nullptr) {
+        return true;
+    }
+
+    // Core 0 come lo stack BLE: il core 1 resta al loop/render
+    BaseType_t created = xTaskCreatePinnedToCore(
+        _taskEntry,
+        "LedMirrorTask",
+        4096,
+        this,
+        1,
+        &_task,
+        0
+    );
+    if (created != pdPASS) {
+        _task = nullptr;
+        Serial.println("[LED MIRROR] ✗ Failed to create LedMirrorTask");
+        return false;
+    }
+    return true;
+}
+
+bool LedMirrorStream::isStreaming() const {
+    return _connected && _fps > 0 && _characteristic != nullptr &&
+           _cccd != nullptr && _cccd->getNotifications();
+}
+
+void LedMirrorStream::setConnected(bool connected) {
+    _connected = connected;
+    if (!connected) {
+        // Nuovo client = nuovo riferimento per i delta
+        _keyRequested = true;
+        _fps = DEFAULT_FPS;
+        _maxBytes = DEFAULT_PAYLOAD;
+    }
+}
+
+void LedMirrorStream::capture(const CRGB* leds, uint8_t ledCount, uint8_t brightness, uint32_t nowMs) {
+    const uint8_t fps = _fps;
+    if (_task == nullptr || fps == 0 || !isStreaming()) {
+        return;
+    }
+
+    const uint32_t periodMs = 1000 / fps;
+    if (nowMs - _lastCaptureMs < periodMs) {
+        return;
+    }
+    _lastCaptureMs = nowMs;
+
+    const uint8_t count = min<uint8_t>(ledCount, MAX_LEDS);
+
+    portENTER_CRITICAL(&gLedMirrorMux);
+    if (_pendingValid) {
+        _dropped++;  // L'encoder non ha fatto in tempo: il frame vecchio è perso
+    }
+    memcpy(_pending, leds, count * sizeof(CRGB));
+    _pendingCount = count;
+    _pendingBrightness = brightness;
+    _pendingTimestamp = nowMs;
+    _pendingValid = true;
+    portEXIT_CRITICAL(&gLedMirrorMux);
+
+    xTaskNotifyGive(_task);
+}
+
+bool LedMirrorStream::configure(JsonVariantConst config) {
+    bool updated = false;
+
+    if (!config["fps"].isNull()) {
+        _fps = (uint8_t)constrain((int)(config["fps"] | DEFAULT_FPS), 0, MAX_FPS);
+        updated = true;
+    }
+    if (!config["maxBytes"].isNull()) {
+        _maxBytes = (uint16_t)constrain((int)(config["maxBytes"] | DEFAULT_PAYLOAD), MIN_PAYLOAD, MAX_PAYLOAD);
+        updated = true;
+    }
+    if (config["key"] | false) {
+        _keyRequested = true;
+        updated = true;
+    }
+
+    if (updated) {
+        Serial.printf("[LED MIRROR] Config: fps=%u maxBytes=%u\n", _fps, _maxBytes);
+    }
+    return updated;
+}
+
+void LedMirrorStream::toJson(JsonDocument& doc) const {
+    portENTER_CRITICAL(&gLedMirrorMux);
+    const uint32_t dropped = _dropped;
+    portEXIT_CRITICAL(&gLedMirrorMux);
+
+    doc["fps"] = _fps;
+    doc["maxBytes"] = _maxBytes;
+    doc["streaming"] = isStreaming();
+    doc["sent"] = _sent;
+    doc["dropped"] = dropped;
+    doc["keyframes"] = _keyframes;
+    doc["bytes"] = _bytesSent;
+}
+
+void LedMirrorStream::_taskEntry(void* param) {
+    static_cast<LedMirrorStream*>(param)->_taskLoop();
+}
+
+void LedMirrorStream::_taskLoop() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        uint8_t count;
+        uint8_t brightness;
+        uint32_t timestampMs;
+        uint32_t dropped;
+
+        portENTER_CRITICAL(&gLedMirrorMux);
+        if (!_pendingValid) {
+            portEXIT_CRITICAL(&gLedMirrorMux);
+            continue;
+        }
+        count = _pendingCount;
+        memcpy(_work, _pending, count * 3);
+        brightness = _pendingBrightness;
+        timestampMs = _pendingTimestamp;
+        _pendingValid = false;
+        dropped = _dropped;
+        portEXIT_CRITICAL(&gLedMirrorMux);
+
+        if (!isStreaming()) {
+            continue;
+        }
+
+        const size_t len = _encodeFrame(count, brightness, timestampMs,
+                                        (uint16_t)min<uint32_t>(dropped, 0xFFFF));
+        if (len == 0) {
+            portENTER_CRITICAL(&gLedMirrorMux);
+            _dropped++;  // Non entra nel budget nemmeno in RGB332
+            portEXIT_CRITICAL(&gLedMirrorMux);
+            continue;
+        }
+
+        _characteristic->setValue(_out, len);
+        _characteristic->notify();
+        _sent++;
+        _bytesSent += len;
+    }
+}
+
+size_t LedMirrorStream::_encodeFrame(uint8_t count, uint8_t brightness, uint32_t timestampMs, uint16_t dropped) {
+    const size_t budget = min<size_t>(_maxBytes, MAX_PAYLOAD);
+    uint8_t* payload = _out + sizeof(FrameHeader);
+    const size_t capacity = budget - sizeof(FrameHeader);
+    const size_t rgbBytes = (size_t)count * 3;
+
+    bool key = _keyRequested || !_refValid || _refCount != count ||
+               (timestampMs - _lastKeyMs >= KEYFRAME_INTERVAL_MS);
+
+    Encoding encoding = ENC_DELTA_RGB;
+    size_t len = 0;
+
+    if (!key) {
+        len = _encodeDelta(payload, capacity, count);
+        if (len == SIZE_MAX) {
+            key = true;  // Troppi LED cambiati: meglio un frame completo
+        }
+    }
+
+    if (key) {
+        if (rgbBytes <= capacity) {
+            encoding = ENC_KEY_RGB;
+            memcpy(payload, _work, rgbBytes);
+            len = rgbBytes;
+        } else {
+            len = _encodePal332Rle(payload, capacity, count);
+            if (len != SIZE_MAX && len < count) {
+                encoding = ENC_PAL332_RLE;
+            } else if (count <= capacity) {
+                encoding = ENC_PAL332;
+                for (uint8_t i = 0; i < count; i++) {
+                    payload[i] = _toPal332(&_work[i * 3]);
+                }
+                len = count;
+            } else {
+                return 0;
+            }
+        }
+    }
+
+    // Aggiorna il riferimento come lo ricostruirà il client
+    if (encoding == ENC_PAL332 || encoding == ENC_PAL332_RLE) {
+        _storePal332Reference(count);
+    } else {
+        memcpy(_ref, _work, rgbBytes);
+    }
+    _refCount = count;
+    _refValid = true;
+    if (key) {
+        _keyRequested = false;
+        _lastKeyMs = timestampMs;
+        _keyframes++;
+    }
+
+    FrameHeader header;
+    header.encoding = encoding;
+    header.ledCount = count;
+    header.brightness = brightness;
+    header.seq = _seq++;
+    header.dropped = dropped;
+    header.timestampMs = timestampMs;
+    memcpy(_out, &header, sizeof(header));
+
+    return sizeof(FrameHeader) + len;
+}
+
+size_t LedMirrorStream::_encodeDelta(uint8_t* out, size_t capacity, uint8_t count) const {
+    size_t pos = 0;
+    uint8_t i = 0;
+    while (i < count) {
+        if (memcmp(&_work[i * 3], &_ref[i * 3], 3) == 0) {
+            i++;
+            continue;
+        }
+
+        // Span massimo di LED cambiati (header 2 byte < 3 byte di un LED invariato)
+        const uint8_t start = i;
+        while (i < count && memcmp(&_work[i * 3], &_ref[i * 3], 3) != 0) {
+            i++;
+        }
+        const uint8_t spanLen = i - start;
+        const size_t spanBytes = 2 + (size_t)spanLen * 3;
+        if (pos + spanBytes > capacity) {
+            return SIZE_MAX;
+        }
+        out[pos++] = start;
+        out[pos++] = spanLen;
+        memcpy(&out[pos], &_work[start * 3], spanLen * 3);
+        pos += spanLen * 3;
+    }
+    return pos;
+}
+
+size_t LedMirrorStream::_encodePal332Rle(uint8_t* out, size_t capacity, uint8_t count) const {
+    size_t pos = 0;
+    uint8_t i = 0;
+    while (i < count) {
+        const uint8_t index = _toPal332(&_work[i * 3]);
+        uint8_t run = 1;
+        while (i + run < count && run < 255 && _toPal332(&_work[(i + run) * 3]) == index) {
+            run++;
+        }
+        if (pos + 2 > capacity) {
+            return SIZE_MAX;
+        }
+        out[pos++] = run;
+        out[pos++] = index;
+        i += run;
+    }
+    return pos;
+}
+
+void LedMirrorStream::_storePal332Reference(uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        const uint8_t index = _toPal332(&_work[i * 3]);
+        _ref[i * 3]     = (uint8_t)(((index >> 5) & 0x07) * 255 / 7);
+        _ref[i * 3 + 1] = (uint8_t)(((index >> 2) & 0x07) * 255 / 7);
+        _ref[i * 3 + 2] = (uint8_t)((index & 0x03) * 255 / 3);
+    }
+}
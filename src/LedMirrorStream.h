@@ -0,0 +1,143 @@
+#ifndef LED_MIRROR_STREAM_H
+#define LED_MIRROR_STREAM_H
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include <BLE2902.h>
+#include <BLEDevice.h>
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/**
+ * @brief Stream BLE del framebuffer logico della lama (LED 0..foldPoint-1)
+ *
+ * Serve a debuggare gli effetti e misurare la cadenza di render da remoto
+ * (dashboard, app). Il loop chiama capture() dopo FastLED.show(): costa solo
+ * una memcpy di max 432 byte e solo quando il client è iscritto e il periodo
+ * negoziato è scaduto. Codifica e notify avvengono in LedMirrorTask (core 0,
+ * priorità bassa), quindi non ritardano mai il render.
+ *
+ * Ogni notify è un frame binario: FrameHeader + payload. Il payload dipende
+ * da encoding e dal budget (maxBytes negoziato, ~MTU-3):
+ * - KEY_RGB:     ledCount * [r g b]
+ * - DELTA_RGB:   span [start len rgb*len] dei LED cambiati rispetto al frame
+ *                ricostruito dal client (vuoto = nessun cambiamento)
+ * - PAL332:      ledCount * idx RGB332 (lossy, quando RGB non entra)
+ * - PAL332_RLE:  coppie [run idx] RGB332 (lossy)
+ * Un keyframe parte alla prima notify, ogni KEYFRAME_INTERVAL_MS o su
+ * richiesta. Dopo un keyframe PAL332 il delta RGB verso il riferimento
+ * quantizzato quasi mai entra nel budget: in pratica ogni frame torna
+ * keyframe e lo stream resta lossy (con maxBytes 180 oltre 56 LED).
+ *
+ * dropped conta i frame catturati ma non inviati (encoder ancora occupato o
+ * frame che non entra nel budget).
+ */
+class LedMirrorStream {
+public:
+    static constexpr uint8_t MAX_LEDS = 144;
+    static constexpr uint8_t MAX_FPS = 30;
+    static constexpr uint8_t DEFAULT_FPS = 10;
+    static constexpr uint16_t MIN_PAYLOAD = 64;
+    static constexpr uint16_t MAX_PAYLOAD = 509;     // ATT MTU 512 - 3
+    static constexpr uint16_t DEFAULT_PAYLOAD = 180; // MTU 185 (tipico Android/BlueZ)
+    static constexpr uint32_t KEYFRAME_INTERVAL_MS = 2000;
+
+    enum Encoding : uint8_t {
+        ENC_KEY_RGB    = 0,
+        ENC_DELTA_RGB  = 1,
+        ENC_PAL332     = 2,
+        ENC_PAL332_RLE = 3,
+    };
+
+#pragma pack(push, 1)
+    struct FrameHeader {
+        uint8_t encoding;       // Encoding
+        uint8_t ledCount;       // foldPoint del frame
+        uint8_t brightness;     // FastLED.getBrightness() (i valori RGB non sono scalati)
+        uint16_t seq;           // +1 per ogni frame inviato
+        uint16_t dropped;       // Totale frame persi (saturato)
+        uint32_t timestampMs;   // millis() della cattura (cadenza render)
+    };
+#pragma pack(pop)
+
+    static LedMirrorStream& getInstance();
+
+    /**
+     * @brief Collega la characteristic (NOTIFY) e avvia LedMirrorTask
+     */
+    bool begin(BLECharacteristic* characteristic, BLE2902* cccd);
+
+    /**
+     * @brief Copia il frame renderizzato se lo stream è attivo e il periodo è scaduto
+     *
+     * Chiamare dal loop subito dopo il render. Non blocca: se l'encoder non ha
+     * ancora consumato il frame precedente, questo lo sostituisce (dropped++).
+     */
+    void capture(const CRGB* leds, uint8_t ledCount, uint8_t brightness, uint32_t nowMs);
+
+    /**
+     * @brief Applica la config del client: {"fps":15,"maxBytes":244,"key":true}
+     * @return false se il JSON non contiene campi validi
+     */
+    bool configure(JsonVariantConst config);
+
+    void setConnected(bool connected);
+    bool isStreaming() const;
+
+    /**
+     * @brief Config e contatori per la READ della characteristic
+     */
+    void toJson(JsonDocument& doc) const;
+
+private:
+    LedMirrorStream() = default;
+    LedMirrorStream(const LedMirrorStream&) = delete;
+    LedMirrorStream& operator=(const LedMirrorStream&) = delete;
+
+    static void _taskEntry(void* param);
+    void _taskLoop();
+    size_t _encodeFrame(uint8_t count, uint8_t brightness, uint32_t timestampMs, uint16_t dropped);
+    size_t _encodeDelta(uint8_t* out, size_t capacity, uint8_t count) const;
+    size_t _encodePal332Rle(uint8_t* out, size_t capacity, uint8_t count) const;
+    void _storePal332Reference(uint8_t count);
+
+    static inline uint8_t _toPal332(const uint8_t* rgb) {
+        return (rgb[0] & 0xE0) | ((rgb[1] >> 3) & 0x1C) | (rgb[2] >> 6);
+    }
+
+    BLECharacteristic* _characteristic = nullptr;
+    BLE2902* _cccd = nullptr;
+    TaskHandle_t _task = nullptr;
+    volatile bool _connected = false;
+
+    // Config negoziata dal client
+    volatile uint8_t _fps = DEFAULT_FPS;
+    volatile uint16_t _maxBytes = DEFAULT_PAYLOAD;
+    volatile bool _keyRequested = true;
+
+    // Frame catturato dal loop (protetto da spinlock)
+    uint8_t _pending[MAX_LEDS * 3] = {};
+    uint8_t _pendingCount = 0;
+    uint8_t _pendingBrightness = 0;
+    uint32_t _pendingTimestamp = 0;
+    bool _pendingValid = false;
+    uint32_t _lastCaptureMs = 0;
+
+    // Stato dell'encoder (solo LedMirrorTask)
+    uint8_t _work[MAX_LEDS * 3] = {};
+    uint8_t _ref[MAX_LEDS * 3] = {};      // Frame ricostruito dal client
+    uint8_t _refCount = 0;
+    bool _refValid = false;
+    uint32_t _lastKeyMs = 0;
+    uint8_t _out[MAX_PAYLOAD] = {};
+    uint16_t _seq = 0;
+
+    // Contatori
+    uint32_t _dropped = 0;
+    uint32_t _sent = 0;
+    uint32_t _bytesSent = 0;
+    uint32_t _keyframes = 0;
+};
+
+#endif // LED_MIRROR_STREAM_H
@@ -0,0 +1,130 @@
+#include "LedStateStore.h"
+#include "BLELedController.h"
+#include "EventDispatcher.h"
+
+LedStateStore& LedStateStore::getInstance() {
+    static LedStateStore instance;
+    return instance;
+}
+
+void LedStateStore::begin(LedState* master) {
+    _master = master;
+    if (_mutex == nullptr) {
+        _mutex = xSemaphoreCreateRecursiveMutex();
+    }
+
+    _lock();
+    _publish();
+    _unlock();
+}
+
+void LedStateStore::_lock() {
+    if (_mutex != nullptr) {
+        xSemaphoreTakeRecursive(_mutex, portMAX_DELAY);
+    }
+}
+
+void LedStateStore::_unlock() {
+    if (_mutex != nullptr) {
+        xSemaphoreGiveRecursive(_mutex);
+    }
+}
+
+LedStateStore::Transaction::Transaction() : _store(LedStateStore::getInstance()) {
+    _store._lock();
+}
+
+LedStateStore::Transaction::~Transaction() {
+    _store._publish();
+    _store._unlock();
+}
+
+void LedStateStore::_buildSnapshot(const LedState& state, LedSnapshot& out) {
+    // memset: il confronto con memcmp deve ignorare il padding
+    memset(&out, 0, sizeof(out));
+
+    out.r = state.r;
+    out.g = state.g;
+    out.b = state.b;
+    out.brightness = state.brightness;
+    out.statusLedBrightness = state.statusLedBrightness;
+    out.effectId = effectIdFromName(state.effect.c_str());
+    out.speed = state.speed;
+    out.enabled = state.enabled;
+    out.bladeEnabled = state.bladeEnabled;
+    out.statusLedEnabled = state.statusLedEnabled;
+    out.foldPoint = state.foldPoint;
+
+    out.autoIgnitionOnBoot = state.autoIgnitionOnBoot;
+    out.autoIgnitionDelayMs = state.autoIgnitionDelayMs;
+    out.motionOnBoot = state.motionOnBoot;
+    out.sentryModeEnabled = state.sentryModeEnabled;
+    out.sentryIntervalSec = state.sentryIntervalSec;
+    out.sentryThresholdPct = state.sentryThresholdPct;
+
+    out.epochBase = state.epochBase;
+    out.millisAtSync = state.millisAtSync;
+
+    out.chronoHourTheme = state.chronoHourTheme;
+    out.chronoSecondTheme = state.chronoSecondTheme;
+    out.chronoWellnessMode = state.chronoWellnessMode;
+    out.breathingRate = state.breathingRate;
+    out.chronoCycleDuration = state.chronoCycleDuration;
+
+    // Stringa vuota = flash clash classico
+    out.gestureClashEffectId = state.gestureClashEffect.length() == 0
+        ? EffectId::CLASH
+        : effectIdFromName(state.gestureClashEffect.c_str());
+    out.gestureClashDurationMs = state.gestureClashDurationMs;
+}
+
+void LedStateStore::_publish() {
+    if (_master == nullptr) {
+        return;
+    }
+
+    LedSnapshot next;
+    _buildSnapshot(*_master, next);
+
+    const uint8_t active = __atomic_load_n(&_active, __ATOMIC_ACQUIRE);
+    next.version = _slots[active].version;
+    if (_version != 0 && memcmp(&next, &_slots[active], sizeof(LedSnapshot)) == 0) {
+        return;  // Nessun cambiamento: versione invariata
+    }
+    next.version = _version + 1;
+
+    // Scrive nel buffer inattivo (seq dispari durante la copia), poi lo attiva
+    const uint8_t back = active ^ 1;
+    __atomic_add_fetch(&_slotSeq[back], 1, __ATOMIC_ACQ_REL);
+    _slots[back] = next;
+    __atomic_add_fetch(&_slotSeq[back], 1, __ATOMIC_RELEASE);
+
+    __atomic_store_n(&_active, back, __ATOMIC_RELEASE);
+    __atomic_store_n(&_version, next.version, __ATOMIC_RELEASE);
+
+    // Sveglia il loop: il nuovo snapshot va renderizzato subito
+    EventDispatcher::getInstance().post(EventDispatcher::EVENT_BLE_WRITE);
+}
+
+void LedStateStore::read(LedSnapshot& out) const {
+    for (;;) {
+        const uint8_t index = __atomic_load_n(&_active, __ATOMIC_ACQUIRE);
+        const uint32_t seqBefore = __atomic_load_n(&_slotSeq[index], __ATOMIC_ACQUIRE);
+        if (seqBefore & 1) {
+            continue;  // Writer a metà copia (succede solo con due publish ravvicinati)
+        }
+        out = _slots[index];
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&_slotSeq[index], __ATOMIC_RELAXED) == seqBefore) {
+            return;
+        }
+    }
+}
+
+bool LedStateStore::readIfChanged(LedSnapshot& out) const {
+    if (out.version == getVersion()) {
+        return false;
+    }
+    read(out);
+    return true;
+}
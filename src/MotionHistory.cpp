@@ -0,0 +1,161 @@
+#include "MotionHistory.h"
+#include <string.h>
+
+namespace {
+constexpr uint16_t MAX_DT_MS = 1000;    // Pausa più lunga: il frame riparte da zero
+
+int32_t clampI32(int64_t value) {
+    if (value > INT32_MAX) return INT32_MAX;
+    if (value < INT32_MIN) return INT32_MIN;
+    return (int32_t)value;
+}
+
+uint32_t absI32(int32_t value) {
+    return value < 0 ? (uint32_t)(-(int64_t)value) : (uint32_t)value;
+}
+
+// Derivata discreta sul dt reale: (curr - prev) / dt, unità per secondo
+int32_t derivative(int32_t curr, int32_t prev, uint16_t dtMs) {
+    return clampI32(((int64_t)curr - prev) * 1000 / dtMs);
+}
+}
+
+void MotionHistory::reset() {
+    memset(_frames, 0, sizeof(_frames));
+    _head = 0;
+    _count = 0;
+    _sumVelX = 0;
+    _sumVelY = 0;
+    _sumEnergy = 0;
+    _sumAbsAcc = 0;
+    _sumAbsJerk = 0;
+    _sumDt = 0;
+    _sumSpeedQ4 = 0;
+    _sumIntensity = 0;
+    _sumActiveBlocks = 0;
+    _reversals = 0;
+    _netTurns = 0;
+    _sumDivQ4 = 0;
+    _sumCurlQ4 = 0;
+}
+
+const MotionHistory::Frame& MotionHistory::at(uint8_t age) const {
+    if (age >= _count) {
+        age = _count > 0 ? _count - 1 : 0;
+    }
+    return _frames[(uint8_t)(_head + CAPACITY - 1 - age) % CAPACITY];
+}
+
+void MotionHistory::_accumulate(const Frame& frame, int sign) {
+    const int64_t velX = frame.velX;
+    const int64_t velY = frame.velY;
+    const uint64_t energy = (uint64_t)(velX * velX + velY * velY);
+    const uint64_t absAcc = (uint64_t)absI32(frame.accX) + absI32(frame.accY);
+    const uint64_t absJerk = (uint64_t)absI32(frame.jerkX) + absI32(frame.jerkY);
+
+    if (sign > 0) {
+        _sumVelX += velX;
+        _sumVelY += velY;
+        _sumEnergy += energy;
+        _sumAbsAcc += absAcc;
+        _sumAbsJerk += absJerk;
+        _sumDt += frame.dtMs;
+        _sumSpeedQ4 += frame.sample.speedQ4;
+        _sumIntensity += frame.sample.intensity;
+        _sumActiveBlocks += frame.sample.activeBlocks;
+        _reversals += frame.reversal ? 1 : 0;
+        _netTurns += frame.turn;
+        _sumDivQ4 += frame.sample.divQ4;
+        _sumCurlQ4 += frame.sample.curlQ4;
+    } else {
+        _sumVelX -= velX;
+        _sumVelY -= velY;
+        _sumEnergy -= energy;
+        _sumAbsAcc -= absAcc;
+        _sumAbsJerk -= absJerk;
+        _sumDt -= frame.dtMs;
+        _sumSpeedQ4 -= frame.sample.speedQ4;
+        _sumIntensity -= frame.sample.intensity;
+        _sumActiveBlocks -= frame.sample.activeBlocks;
+        _reversals -= frame.reversal ? 1 : 0;
+        _netTurns -= frame.turn;
+        _sumDivQ4 -= frame.sample.divQ4;
+        _sumCurlQ4 -= frame.sample.curlQ4;
+    }
+}
+
+void MotionHistory::push(const Sample& sample) {
+    Frame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.sample = sample;
+
+    const Frame* prev = _count > 0 ? &latest() : nullptr;
+    if (prev && sample.timestamp > prev->sample.timestamp &&
+        sample.timestamp - prev->sample.timestamp <= MAX_DT_MS) {
+        frame.dtMs = (uint16_t)(sample.timestamp - prev->sample.timestamp);
+    }
+
+    if (frame.dtMs > 0) {
+        // Flusso px/frame Q4 -> px/s sul dt effettivo del frame
+        frame.velX = clampI32((int64_t)sample.flowXQ4 * 1000 / (16 * (int32_t)frame.dtMs));
+        frame.velY = clampI32((int64_t)sample.flowYQ4 * 1000 / (16 * (int32_t)frame.dtMs));
+        frame.accX = derivative(frame.velX, prev->velX, frame.dtMs);
+        frame.accY = derivative(frame.velY, prev->velY, frame.dtMs);
+        // Jerk solo se anche il frame precedente aveva un'accelerazione valida
+        if (prev->dtMs > 0) {
+            frame.jerkX = derivative(frame.accX, prev->accX, frame.dtMs);
+            frame.jerkY = derivative(frame.accY, prev->accY, frame.dtMs);
+        }
+
+        // Inversione: flussi opposti, entrambi oltre il rumore di quantizzazione
+        const int32_t dot = (int32_t)sample.flowXQ4 * prev->sample.flowXQ4 +
+                            (int32_t)sample.flowYQ4 * prev->sample.flowYQ4;
+        const auto strong = [](const Sample& s) {
+            return (s.flowXQ4 < 0 ? -s.flowXQ4 : s.flowXQ4) +
+                   (s.flowYQ4 < 0 ? -s.flowYQ4 : s.flowYQ4) >= REVERSAL_MIN_FLOW_Q4;
+        };
+        frame.reversal = dot < 0 && strong(sample) && strong(prev->sample);
+
+        // Svolta: angolo oltre ~18 gradi (|cross| > |dot| / 3) tra flussi forti
+        const int32_t cross = (int32_t)prev->sample.flowXQ4 * sample.flowYQ4 -
+                              (int32_t)prev->sample.flowYQ4 * sample.flowXQ4;
+        if (!frame.reversal && strong(sample) && strong(prev->sample) &&
+            (int64_t)absI32(cross) * 3 > (int64_t)absI32(dot)) {
+            frame.turn = cross > 0 ? 1 : -1;
+        }
+    }
+
+    if (_count == CAPACITY) {
+        _accumulate(_frames[_head], -1);
+    } else {
+        _count++;
+    }
+    _frames[_head] = frame;
+    _head = (uint8_t)((_head + 1) % CAPACITY);
+    _accumulate(frame, +1);
+}
+
+MotionHistory::Stats MotionHistory::stats() const {
+    Stats s;
+    memset(&s, 0, sizeof(s));
+    if (_count == 0) {
+        return s;
+    }
+
+    const int32_t n = _count;
+    s.frames = _count;
+    s.spanMs = _sumDt;
+    s.meanVelX = (int32_t)(_sumVelX / n);
+    s.meanVelY = (int32_t)(_sumVelY / n);
+    s.energy = (uint32_t)(_sumEnergy / n > UINT32_MAX ? UINT32_MAX : _sumEnergy / n);
+    s.meanAbsAcc = (uint32_t)(_sumAbsAcc / n > UINT32_MAX ? UINT32_MAX : _sumAbsAcc / n);
+    s.meanAbsJerk = (uint32_t)(_sumAbsJerk / n > UINT32_MAX ? UINT32_MAX : _sumAbsJerk / n);
+    s.meanSpeedQ4 = (uint16_t)(_sumSpeedQ4 / n);
+    s.meanIntensity = (uint8_t)(_sumIntensity / n);
+    s.meanActiveBlocks = (uint8_t)(_sumActiveBlocks / n);
+    s.reversals = _reversals;
+    s.netTurns = _netTurns;
+    s.meanDivQ4 = (int16_t)(_sumDivQ4 / n);
+    s.meanCurlQ4 = (int16_t)(_sumCurlQ4 / n);
+    return s;
+}
@@ -0,0 +1,124 @@
+#ifndef MOTION_HISTORY_H
+#define MOTION_HISTORY_H
+
+#include <stdint.h>
+
+/**
+ * @brief Ring buffer delle feature di movimento per frame + statistiche a finestra
+ *
+ * Ogni push() aggiunge un frame e aggiorna in O(1) le somme della finestra
+ * (ultimi CAPACITY frame): il frame che esce viene sottratto, quello che entra
+ * sommato. stats() ricava medie e conteggi dalle somme senza riscandire lo
+ * storico, quindi regole gesture ed effetti possono usare evidenza multi-frame
+ * a costo costante.
+ *
+ * Tutto intero a punto fisso: le somme scorrevoli float accumulerebbero
+ * errore di arrotondamento a ogni add/sub nelle ore di funzionamento.
+ * Velocità, accelerazione e jerk sono in px/s, px/s^2, px/s^3 (normalizzati
+ * sul dt reale: il frame rate varia da ~5 a 30 FPS).
+ */
+class MotionHistory {
+public:
+    static constexpr uint8_t CAPACITY = 16;         // ~0.5s @ 30fps, ~3s @ 5.6fps
+    static constexpr int16_t REVERSAL_MIN_FLOW_Q4 = 16;  // 1 px/frame: sotto è rumore di quantizzazione SAD
+
+    /**
+     * @brief Misure di un frame (input di push)
+     */
+    struct Sample {
+        int16_t flowXQ4;        // Flusso medio pesato dei blocchi, px/frame Q4 (1/16 px)
+        int16_t flowYQ4;
+        int16_t divQ4;          // Divergenza del campo (>0 = espansione, affondo verso la camera)
+        int16_t curlQ4;         // Rotazione del campo attorno al centro immagine
+        uint8_t intensity;      // 0-255
+        uint8_t activeBlocks;
+        uint16_t speedQ4;       // Velocità del detector, px/frame Q4
+        bool centroidValid;
+        uint8_t centroidX;      // 0-255 (normalizzato)
+        uint8_t centroidY;
+        uint32_t timestamp;     // ms
+    };
+
+    /**
+     * @brief Frame memorizzato: misure + derivate calcolate al push
+     */
+    struct Frame {
+        Sample sample;
+        uint16_t dtMs;          // Dal frame precedente (0 = primo frame)
+        int32_t velX;           // px/s
+        int32_t velY;
+        int32_t accX;           // px/s^2
+        int32_t accY;
+        int32_t jerkX;          // px/s^3
+        int32_t jerkY;
+        bool reversal;          // Verso opposto al frame precedente (entrambi sopra soglia)
+        int8_t turn;            // Svolta del verso rispetto al frame precedente: +1/-1 (segno del prodotto vettore), 0 = dritto
+    };
+
+    /**
+     * @brief Statistiche sulla finestra corrente (tutti i frame nel ring)
+     */
+    struct Stats {
+        uint8_t frames;
+        uint32_t spanMs;        // Somma dei dt
+        int32_t meanVelX;       // px/s
+        int32_t meanVelY;
+        uint32_t energy;        // Media di |v|^2, (px/s)^2
+        uint32_t meanAbsAcc;    // Media di |a| (L1), px/s^2
+        uint32_t meanAbsJerk;   // Media di |j| (L1), px/s^3
+        uint16_t meanSpeedQ4;   // px/frame Q4
+        uint8_t meanIntensity;
+        uint8_t meanActiveBlocks;
+        uint8_t reversals;      // Inversioni di verso nella finestra
+        int8_t netTurns;        // Somma delle svolte: |alto| = traiettoria circolare
+        int16_t meanDivQ4;
+        int16_t meanCurlQ4;
+    };
+
+    MotionHistory() { reset(); }
+
+    void reset();
+
+    /**
+     * @brief Aggiunge un frame (O(1)); sovrascrive il più vecchio a buffer pieno
+     */
+    void push(const Sample& sample);
+
+    uint8_t size() const { return _count; }
+    bool empty() const { return _count == 0; }
+
+    /**
+     * @brief Frame per età: 0 = ultimo inserito, size()-1 = più vecchio
+     */
+    const Frame& at(uint8_t age) const;
+    const Frame& latest() const { return at(0); }
+
+    /**
+     * @brief Statistiche della finestra ricavate dalle somme incrementali (O(1))
+     */
+    Stats stats() const;
+
+private:
+    // Contributi di un frame alle somme (sommati al push, sottratti all'uscita)
+    void _accumulate(const Frame& frame, int sign);
+
+    Frame _frames[CAPACITY];
+    uint8_t _head;              // Prossimo slot da scrivere
+    uint8_t _count;
+
+    int64_t _sumVelX;
+    int64_t _sumVelY;
+    uint64_t _sumEnergy;
+    uint64_t _sumAbsAcc;
+    uint64_t _sumAbsJerk;
+    uint32_t _sumDt;
+    uint32_t _sumSpeedQ4;
+    uint32_t _sumIntensity;
+    uint32_t _sumActiveBlocks;
+    uint8_t _reversals;
+    int8_t _netTurns;
+    int32_t _sumDivQ4;
+    int32_t _sumCurlQ4;
+};
+
+#endif // MOTION_HISTORY_H
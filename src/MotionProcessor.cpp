@@ -1,5 +1,6 @@
 #include "MotionProcessor.h"
 #include <cmath>
+#include <cstdlib>
 #include <cstring>
 
 namespace {
@@ -15,18 +16,73 @@ const uint8_t* gammaLut07() {
     }
     return lut;
 }
+
+// Gesture emessa da ogni slot (NONE = slot effetto)
+constexpr MotionProcessor::GestureType SLOT_GESTURES[GestureStateMachine::SLOT_COUNT] = {
+    MotionProcessor::GestureType::CLASH,
+    MotionProcessor::GestureType::RETRACT,
+    MotionProcessor::GestureType::IGNITION,
+    MotionProcessor::GestureType::STAB,
+    MotionProcessor::GestureType::SPIN,
+    MotionProcessor::GestureType::TWIRL,
+    MotionProcessor::GestureType::NONE,
+    MotionProcessor::GestureType::NONE,
+    MotionProcessor::GestureType::NONE,
+    MotionProcessor::GestureType::NONE,
+};
+
+// atan2 intero in angolo binario (65536 = giro completo), errore < 0.1°
+uint16_t atan2Binary(int32_t y, int32_t x) {
+    if (x == 0 && y == 0) {
+        return 0;
+    }
+    const uint32_t ax = (uint32_t)(x < 0 ? -(int64_t)x : x);
+    const uint32_t ay = (uint32_t)(y < 0 ? -(int64_t)y : y);
+    const bool swap = ay > ax;
+    // r = min/max in Q15, atan(r) ~ r*pi/4 + r*(1-r)*(0.2447 + 0.0663*r)
+    const uint32_t r = (uint32_t)(((uint64_t)(swap ? ax : ay) << 15) / (swap ? ay : ax));
+    const uint32_t rr = (uint32_t)(((uint64_t)r * (32768 - r)) >> 15);
+    uint32_t angle = (r >> 2) + (uint32_t)(((uint64_t)rr * (2552 + ((691 * r) >> 15))) >> 15);
+    if (swap) angle = 16384 - angle;
+    if (x < 0) angle = 32768 - angle;
+    if (y < 0) angle = 65536 - angle;
+    return (uint16_t)angle;
+}
+
+uint32_t isqrt32(uint32_t value) {
+    uint32_t result = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > value) bit >>= 2;
+    while (bit != 0) {
+        if (value >= result + bit) {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return result;
+}
+
+// Evidenza in % della soglia (100 = soglia raggiunta); soglia 0 = termine ignorato
+uint16_t levelPercent(uint32_t value, uint32_t threshold) {
+    if (threshold == 0) {
+        return 0;
+    }
+    const uint64_t pct = (uint64_t)value * 100 / threshold;
+    return pct > UINT16_MAX ? UINT16_MAX : (uint16_t)pct;
+}
 }
 
 MotionProcessor::MotionProcessor() :
-    _lastDirection(OpticalFlowDetector::Direction::NONE),
-    _directionStartTime(0),
-    _lastFrameTime(0),
-    _gestureCooldown(false),
-    _gestureCooldownEnd(0),
-    _clashCooldownEnd(0),
-    _lastGestureConfidence(0)
+    _lastGestureConfidence(0),
+    _classifierTimeUs(0),
+    _egoTimeUs(0),
+    _bladeLength(72)
 {
     _lastEffectRequest[0] = '\0';
+    memset(_bladeProfile, 0, sizeof(_bladeProfile));
 }
 
 MotionProcessor::ProcessedMotion MotionProcessor::process(
@@ -40,10 +96,26 @@ MotionProcessor::ProcessedMotion MotionProcessor::process(
     result.motionIntensity = motionIntensity;
     result.direction = direction;
     result.speed = speed;
+    result.flowAngle = 0;
+    result.flowMagnitudeQ4 = 0;
     result.timestamp = timestamp;
     result.gesture = GestureType::NONE;
     result.gestureConfidence = 0;
     result.effectRequest[0] = '\0';
+    result.gestureStates = 0;
+    result.gestureTransitions = 0;
+
+    // Moto della camera prima di perturbazioni e gesture
+    _estimateEgoMotion(detector, result.ego);
+    const bool compensated = _egoCompensated(result.ego);
+
+    // Centroide al prossimo frame: gli effetti lo mostrano quando la mano è già lì
+    float predX = 0.0f, predY = 0.0f, velX = 0.0f, velY = 0.0f;
+    result.centroidTracked = detector.getCentroidPrediction(&predX, &predY, &velX, &velY);
+    result.predictedCentroidX = (uint8_t)constrain(lroundf(predX * 255.0f), 0L, 255L);
+    result.predictedCentroidY = (uint8_t)constrain(lroundf(predY * 255.0f), 0L, 255L);
+    result.centroidVelXQ4 = (int16_t)constrain(lroundf(velX * 255.0f * 16.0f), -32767L, 32767L);
+    result.centroidVelYQ4 = (int16_t)constrain(lroundf(velY * 255.0f * 16.0f), -32767L, 32767L);
 
     // Calculate perturbation grid based on algorithm
     if (_config.perturbationEnabled) {
@@ -53,16 +125,34 @@ MotionProcessor::ProcessedMotion MotionProcessor::process(
             _calculatePerturbationFromCentroid(detector, result.perturbationGrid);
         } else {
             // Optical flow mode: use motion vectors for local perturbations
-            _calculatePerturbationGrid(detector, result.perturbationGrid);
+            _calculatePerturbationGrid(detector, compensated ? &result.ego : nullptr, result.perturbationGrid);
         }
     } else {
         memset(result.perturbationGrid, 0, sizeof(result.perturbationGrid));
     }
+    result.bladeLength = _bladeLength;
+    _updateBladeProfile(result.perturbationGrid, result.bladeProfile);
+
+    // Feature del frame nello storico: statistiche a finestra aggiornate in O(1)
+    const BlockSums sums = _sumBlockVectors(detector);
+    _pushHistory(sums, result.ego, motionIntensity, speed, timestamp, detector);
+    result.window = _history.stats();
+    const MotionHistory::Frame& frame = _history.latest();
+    result.jerk = (uint32_t)min<int64_t>(UINT32_MAX,
+        llabs((int64_t)frame.jerkX) + llabs((int64_t)frame.jerkY));
+
+    // Flusso sub-pixel del frame (traslazione globale se compensato) in forma polare
+    const int32_t flowX = frame.sample.flowXQ4;
+    const int32_t flowY = frame.sample.flowYQ4;
+    result.flowAngle = atan2Binary(flowY, flowX);
+    result.flowMagnitudeQ4 = (uint16_t)min<uint32_t>(UINT16_MAX, isqrt32((uint32_t)(flowX * flowX + flowY * flowY)));
 
     // Detect gestures
     if (_config.gesturesEnabled) {
-        result.gesture = _detectGesture(motionIntensity, direction, speed, timestamp, detector);
+        result.gesture = _detectGesture(motionIntensity, speed, timestamp, flowX, flowY);
         result.gestureConfidence = (result.gesture != GestureType::NONE) ? _lastGestureConfidence : 0;
+        result.gestureStates = _gestureMachine.getPackedStates();
+        result.gestureTransitions = _gestureMachine.getChangedMask();
     }
     if (_lastEffectRequest[0] != '\0') {
         strncpy(result.effectRequest, _lastEffectRequest, sizeof(result.effectRequest) - 1);
@@ -72,227 +162,271 @@ MotionProcessor::ProcessedMotion MotionProcessor::process(
     return result;
 }
 
-MotionProcessor::GestureType MotionProcessor::_detectGesture(
+MotionProcessor::BlockSums MotionProcessor::_sumBlockVectors(const OpticalFlowDetector& detector) {
+    BlockSums sums = {0, 0, 0, 0, 0};
+    // I vettori sono nel riferimento di montaggio: ruota anche le posizioni,
+    // così div/curl non dipendono dall'angolo
+    int16_t cosQ14 = 16384;
+    int16_t sinQ14 = 0;
+    detector.getMountRotationQ14(&cosQ14, &sinQ14);
+    for (uint8_t row = 0; row < OpticalFlowDetector::GRID_ROWS; row++) {
+        for (uint8_t col = 0; col < OpticalFlowDetector::GRID_COLS; col++) {
+            int16_t dx = 0;     // Q4
+            int16_t dy = 0;
+            uint8_t conf = 0;
+            if (!detector.getBlockVectorQ4(row, col, &dx, &dy, &conf)) {
+                continue;
+            }
+            const int32_t mag = abs((int32_t)dx) + abs((int32_t)dy);
+            if (mag == 0 || conf == 0) {
+                continue;
+            }
+            // w <= 4064 * 255: 64 blocchi * w restano in 32 bit, le somme pesate no
+            const int32_t w = mag * (int32_t)conf;
+            sums.sumDxQ4 += (int64_t)dx * w;
+            sums.sumDyQ4 += (int64_t)dy * w;
+            sums.sumW += w;
+
+            // Posizione del blocco dal centro griglia in mezze celle, ruotata (Q4)
+            const int32_t cx = 2 * col - (OpticalFlowDetector::GRID_COLS - 1);
+            const int32_t cy = 2 * row - (OpticalFlowDetector::GRID_ROWS - 1);
+            const int32_t rx = (cx * cosQ14 - cy * sinQ14 + 512) >> 10;
+            const int32_t ry = (cx * sinQ14 + cy * cosQ14 + 512) >> 10;
+            sums.sumDiv += (int64_t)((int32_t)dx * rx + (int32_t)dy * ry) * w;
+            sums.sumCurl += (int64_t)(rx * (int32_t)dy - ry * (int32_t)dx) * w;
+        }
+    }
+    return sums;
+}
+
+void MotionProcessor::_estimateEgoMotion(const OpticalFlowDetector& detector, EgoMotion::Estimate& out) {
+    static_assert(EgoMotion::GRID_COLS == OpticalFlowDetector::GRID_COLS &&
+                  EgoMotion::GRID_ROWS == OpticalFlowDetector::GRID_ROWS,
+                  "EgoMotion e OpticalFlowDetector devono usare la stessa griglia");
+    const uint32_t start = micros();
+    EgoMotion::Vector vectors[EgoMotion::BLOCK_COUNT];
+    for (uint8_t row = 0; row < OpticalFlowDetector::GRID_ROWS; row++) {
+        for (uint8_t col = 0; col < OpticalFlowDetector::GRID_COLS; col++) {
+            EgoMotion::Vector& v = vectors[row * OpticalFlowDetector::GRID_COLS + col];
+            v.valid = detector.getBlockVector(row, col, &v.dx, &v.dy, &v.confidence);
+        }
+    }
+    int16_t cosQ14 = 16384;
+    int16_t sinQ14 = 0;
+    detector.getMountRotationQ14(&cosQ14, &sinQ14);
+    EgoMotion::estimate(vectors, out, cosQ14, sinQ14);
+    _egoTimeUs = micros() - start;
+}
+
+void MotionProcessor::_pushHistory(
+    const BlockSums& sums,
+    const EgoMotion::Estimate& ego,
     uint8_t intensity,
-    OpticalFlowDetector::Direction direction,
     float speed,
     uint32_t timestamp,
     const OpticalFlowDetector& detector)
 {
-    _lastGestureConfidence = 0;
-    _lastEffectRequest[0] = '\0';
-
-    (void)speed;
+    MotionHistory::Sample sample;
+    memset(&sample, 0, sizeof(sample));
+
+    // Media pesata dei vettori blocco in px/frame Q4 (vettori già Q4)
+    if (sums.sumW > 0) {
+        sample.flowXQ4 = (int16_t)constrain(sums.sumDxQ4 / sums.sumW, -32767LL, 32767LL);
+        sample.flowYQ4 = (int16_t)constrain(sums.sumDyQ4 / sums.sumW, -32767LL, 32767LL);
+        // Posizioni in Q4: /16 in più
+        sample.divQ4 = (int16_t)constrain(sums.sumDiv / (16 * (int64_t)sums.sumW), -32767LL, 32767LL);
+        sample.curlQ4 = (int16_t)constrain(sums.sumCurl / (16 * (int64_t)sums.sumW), -32767LL, 32767LL);
+    }
+    if (_egoCompensated(ego)) {
+        // Flusso della lama senza il moto locale (mano, oggetti)
+        sample.flowXQ4 = (int16_t)constrain(lroundf(ego.tx * 16.0f), -32767L, 32767L);
+        sample.flowYQ4 = (int16_t)constrain(lroundf(ego.ty * 16.0f), -32767L, 32767L);
+    }
+    sample.intensity = intensity;
+    sample.activeBlocks = detector.getActiveBlocks();
+    sample.speedQ4 = (uint16_t)constrain(lroundf(speed * 16.0f), 0L, 65535L);
 
-    auto max16 = [](uint16_t a, uint16_t b) { return (a > b) ? a : b; };
+    float cx, cy;
+    sample.centroidValid = detector.getCentroidNormalized(&cx, &cy);
+    if (sample.centroidValid) {
+        sample.centroidX = (uint8_t)constrain(lroundf(cx * 255.0f), 0L, 255L);
+        sample.centroidY = (uint8_t)constrain(lroundf(cy * 255.0f), 0L, 255L);
+    }
+    sample.timestamp = timestamp;
 
-    // Per-gesture thresholds (configurable via BLE)
-    const uint8_t retractIntensityThreshold = _config.retractIntensityThreshold;
+    _history.push(sample);
+}
 
-    const uint8_t clashIntensityThreshold = _config.clashIntensityThreshold;
-    const uint16_t clashCooldown = max16(_config.clashCooldownMs, (uint16_t)400);
+MotionProcessor::GestureType MotionProcessor::_detectGesture(
+    uint8_t intensity,
+    float speed,
+    uint32_t timestamp,
+    int32_t flowX,
+    int32_t flowY)
+{
+    _lastGestureConfidence = 0;
+    _lastEffectRequest[0] = '\0';
 
-    // Cooldown management: prevent gesture spam
-    if (_gestureCooldown) {
-        if (timestamp < _gestureCooldownEnd) {
-            return GestureType::NONE;
-        }
-        _gestureCooldown = false;
+    // Classificatore: sostituisce le regole degli slot gesture; gli slot
+    // effetto restano sulla direzione del flusso
+    GestureClassifier::Result classified = {0, 0};
+    if (_config.classifierEnabled) {
+        classified = _runClassifier();
     }
 
-    const bool clashOnCooldown = (timestamp < _clashCooldownEnd);
-
-    int32_t sumDx = 0;
-    int32_t sumDy = 0;
-    int32_t sumW = 0;
-    uint16_t weightScaleQ8 = 256; // 1.0 in Q8
-    if (_lastFrameTime > 0 && timestamp > _lastFrameTime) {
-        const uint32_t dtMs = timestamp - _lastFrameTime;
-        if (dtMs > 0) {
-            uint32_t scaled = (1000UL << 8) / dtMs;
-            if (scaled < 64) scaled = 64;      // 0.25 in Q8
-            if (scaled > 1024) scaled = 1024;  // 4.0 in Q8
-            weightScaleQ8 = (uint16_t)scaled;
-        }
-    }
-    _lastFrameTime = timestamp;
-    for (uint8_t row = 0; row < OpticalFlowDetector::GRID_ROWS; row++) {
-        for (uint8_t col = 0; col < OpticalFlowDetector::GRID_COLS; col++) {
-            int8_t dx = 0;
-            int8_t dy = 0;
-            uint8_t conf = 0;
-            if (!detector.getBlockVector(row, col, &dx, &dy, &conf)) {
-                continue;
+    uint16_t levels[GestureStateMachine::SLOT_COUNT];
+    _gestureLevels(intensity, speed, flowX, flowY, classified, levels);
+    const uint16_t triggered = _gestureMachine.step(_config.rules, levels, timestamp);
+
+    if (_config.debugLogsEnabled && _gestureMachine.getChangedMask() != 0) {
+        for (uint8_t slot = 0; slot < GestureStateMachine::SLOT_COUNT; slot++) {
+            if (_gestureMachine.getChangedMask() & (1u << slot)) {
+                Serial.printf("[MOTION] %s -> %s (level %u%%)\n",
+                              GestureStateMachine::slotToString(slot),
+                              GestureStateMachine::stateToString(_gestureMachine.getState(slot)),
+                              levels[slot]);
             }
-            const int mag = abs((int)dx) + abs((int)dy);
-            if (mag == 0 || conf == 0) {
-                continue;
-            }
-            const int32_t temp = (int32_t)mag * (int32_t)conf * (int32_t)weightScaleQ8;
-            const int32_t w = (temp + 128) >> 8;
-            sumDx += (int32_t)dx * w;
-            sumDy += (int32_t)dy * w;
-            sumW += w;
         }
     }
-
-    if (sumW == 0) {
-        _lastDirection = direction;
+    if (triggered == 0) {
         return GestureType::NONE;
     }
 
-    int32_t absDx = (sumDx < 0) ? -sumDx : sumDx;
-    int32_t absDy = (sumDy < 0) ? -sumDy : sumDy;
-    const int32_t maxAbs = (absDx > absDy) ? absDx : absDy;
-    if (maxAbs > 0) {
-        const int32_t limit = 4800000; // keeps multiplications in 32-bit
-        if (maxAbs > limit) {
-            uint8_t shift = 0;
-            int32_t scaled = maxAbs;
-            while (scaled > limit && shift < 16) {
-                scaled >>= 1;
-                ++shift;
+    GestureType gesture = GestureType::NONE;
+    for (uint8_t slot = 0; slot < GestureStateMachine::SLOT_COUNT; slot++) {
+        if ((triggered & (1u << slot)) == 0) {
+            continue;
+        }
+        const String* effectName = nullptr;
+        switch (slot) {
+            case GestureStateMachine::SLOT_EFFECT_UP:    effectName = &_config.effectOnUp; break;
+            case GestureStateMachine::SLOT_EFFECT_DOWN:  effectName = &_config.effectOnDown; break;
+            case GestureStateMachine::SLOT_EFFECT_LEFT:  effectName = &_config.effectOnLeft; break;
+            case GestureStateMachine::SLOT_EFFECT_RIGHT: effectName = &_config.effectOnRight; break;
+            default: break;
+        }
+        if (effectName) {
+            if (_lastEffectRequest[0] == '\0') {
+                strncpy(_lastEffectRequest, effectName->c_str(), sizeof(_lastEffectRequest) - 1);
+                _lastEffectRequest[sizeof(_lastEffectRequest) - 1] = '\0';
+                if (_config.debugLogsEnabled) {
+                    Serial.printf("[MOTION] EFFECT change requested: %s\n", _lastEffectRequest);
+                }
             }
-            absDx >>= shift;
-            absDy >>= shift;
+        } else if (gesture == GestureType::NONE) {
+            gesture = SLOT_GESTURES[slot];
+            _lastGestureConfidence = _config.classifierEnabled ? classified.confidence : _config.rules[slot].confidence;
         }
     }
+    return gesture;
+}
+
+void MotionProcessor::_gestureLevels(
+    uint8_t intensity,
+    float speed,
+    int32_t flowX,
+    int32_t flowY,
+    const GestureClassifier::Result& classified,
+    uint16_t levels[GestureStateMachine::SLOT_COUNT]) const
+{
+    memset(levels, 0, sizeof(uint16_t) * GestureStateMachine::SLOT_COUNT);
+    const uint32_t speedX10 = (uint32_t)lroundf(speed * 10.0f);
+
+    // Intensità o velocità (il termine con soglia 0 è ignorato)
+    auto motionLevel = [&](const GestureStateMachine::Rule& rule) -> uint16_t {
+        const uint16_t byIntensity = levelPercent(intensity, rule.minIntensity);
+        const uint16_t bySpeed = levelPercent(speedX10, rule.minSpeedX10);
+        return byIntensity > bySpeed ? byIntensity : bySpeed;
+    };
+
+    // Direzione 4-way del flusso
     enum class CardinalDirection : uint8_t { NONE, UP, DOWN, LEFT, RIGHT };
     CardinalDirection dir4 = CardinalDirection::NONE;
-    if (absDx > 0 || absDy > 0) {
-        if (absDx >= absDy) {
-            dir4 = (sumDx >= 0) ? CardinalDirection::RIGHT : CardinalDirection::LEFT;
+    if (flowX != 0 || flowY != 0) {
+        if (abs(flowX) >= abs(flowY)) {
+            dir4 = (flowX >= 0) ? CardinalDirection::RIGHT : CardinalDirection::LEFT;
         } else {
-            dir4 = (sumDy >= 0) ? CardinalDirection::DOWN : CardinalDirection::UP;
+            dir4 = (flowY >= 0) ? CardinalDirection::DOWN : CardinalDirection::UP;
         }
     }
 
-    const bool effectTrigger = (intensity >= _config.gestureThreshold ||
-                                speed >= _config.ignitionSpeedThreshold);
-    if (effectTrigger) {
-        const String* effectName = nullptr;
-        switch (dir4) {
-            case CardinalDirection::UP:
-                effectName = &_config.effectOnUp;
-                break;
-            case CardinalDirection::DOWN:
-                effectName = &_config.effectOnDown;
-                break;
-            case CardinalDirection::LEFT:
-                effectName = &_config.effectOnLeft;
-                break;
-            case CardinalDirection::RIGHT:
-                effectName = &_config.effectOnRight;
-                break;
-            default:
-                break;
+    if (_config.classifierEnabled) {
+        for (uint8_t slot = 0; slot < GestureStateMachine::SLOT_COUNT; slot++) {
+            if (SLOT_GESTURES[slot] != GestureType::NONE && (uint8_t)SLOT_GESTURES[slot] == classified.gesture) {
+                const uint8_t minConfidence = _config.rules[slot].minConfidence;
+                levels[slot] = minConfidence > 0 ? levelPercent(classified.confidence, minConfidence) : 100;
+            }
         }
-        if (effectName && effectName->length() > 0) {
-            _gestureCooldown = true;
-            _gestureCooldownEnd = timestamp + _config.gestureCooldownMs;
-            _lastGestureConfidence = 40;
-            strncpy(_lastEffectRequest, effectName->c_str(), sizeof(_lastEffectRequest) - 1);
-            _lastEffectRequest[sizeof(_lastEffectRequest) - 1] = '\0';
-            if (_config.debugLogsEnabled) {
-                Serial.printf("[MOTION] EFFECT change requested: %s\n", _lastEffectRequest);
+    } else {
+        // CLASH = impatto: picco di jerk con accelerazione opposta alla velocità
+        // media della finestra (frenata, non partenza) dopo un frame veloce.
+        // Indipendente dalla direzione e valutato anche senza vettori nel frame
+        // corrente (la lama ferma dopo l'urto non produce flusso)
+        const GestureStateMachine::Rule& clash = _config.rules[GestureStateMachine::SLOT_CLASH];
+        if (_history.size() >= 3) {
+            const MotionHistory::Frame& curr = _history.latest();
+            const MotionHistory::Frame& before = _history.at(1);
+            const MotionHistory::Stats window = _history.stats();
+            const int64_t jerk = llabs((int64_t)curr.jerkX) + llabs((int64_t)curr.jerkY);
+            const int64_t accAlongMotion = (int64_t)curr.accX * window.meanVelX +
+                                           (int64_t)curr.accY * window.meanVelY;
+            const bool fastBefore = before.sample.intensity >= clash.minIntensity ||
+                                    (uint32_t)before.sample.speedQ4 * 10 >= (uint32_t)clash.minSpeedX10 * 16;
+            if (accAlongMotion < 0 && fastBefore) {
+                levels[GestureStateMachine::SLOT_CLASH] =
+                    levelPercent((uint32_t)min<int64_t>(jerk, UINT32_MAX), clash.minJerk);
             }
         }
+
+        if (dir4 == CardinalDirection::DOWN) {
+            levels[GestureStateMachine::SLOT_RETRACT] = motionLevel(_config.rules[GestureStateMachine::SLOT_RETRACT]);
+        } else if (dir4 == CardinalDirection::UP) {
+            levels[GestureStateMachine::SLOT_IGNITION] = motionLevel(_config.rules[GestureStateMachine::SLOT_IGNITION]);
+        }
     }
 
-    GestureType mappedGesture = GestureType::NONE;
+    // Slot effetto: solo se la direzione ha un effetto mappato
+    uint8_t effectSlot = GestureStateMachine::SLOT_COUNT;
+    const String* effectName = nullptr;
     switch (dir4) {
         case CardinalDirection::UP:
-            mappedGesture = GestureType::IGNITION;
+            effectSlot = GestureStateMachine::SLOT_EFFECT_UP;
+            effectName = &_config.effectOnUp;
             break;
         case CardinalDirection::DOWN:
-            mappedGesture = GestureType::RETRACT;
+            effectSlot = GestureStateMachine::SLOT_EFFECT_DOWN;
+            effectName = &_config.effectOnDown;
             break;
         case CardinalDirection::LEFT:
+            effectSlot = GestureStateMachine::SLOT_EFFECT_LEFT;
+            effectName = &_config.effectOnLeft;
+            break;
         case CardinalDirection::RIGHT:
-            mappedGesture = GestureType::CLASH;
+            effectSlot = GestureStateMachine::SLOT_EFFECT_RIGHT;
+            effectName = &_config.effectOnRight;
             break;
         default:
             break;
     }
-
-    if (mappedGesture == GestureType::RETRACT &&
-        (intensity >= retractIntensityThreshold || speed >= _config.retractSpeedThreshold))
-    {
-        _gestureCooldown = true;
-        _gestureCooldownEnd = timestamp + _config.gestureCooldownMs;
-        _lastGestureConfidence = 60;
-        if (_config.debugLogsEnabled) {
-            Serial.println("[MOTION] RETRACT detected (4-way mapping).");
-        }
-        _lastDirection = direction;
-        return GestureType::RETRACT;
+    if (effectName && effectName->length() > 0) {
+        levels[effectSlot] = motionLevel(_config.rules[effectSlot]);
     }
-
-    if (mappedGesture == GestureType::IGNITION &&
-        (intensity >= _config.ignitionIntensityThreshold || speed >= _config.ignitionSpeedThreshold))
-    {
-        _gestureCooldown = true;
-        _gestureCooldownEnd = timestamp + _config.gestureCooldownMs;
-        _lastGestureConfidence = 85;
-        if (_config.debugLogsEnabled) {
-            Serial.println("[MOTION] IGNITION detected (4-way mapping).");
-        }
-        _lastDirection = direction;
-        return GestureType::IGNITION;
-    }
-
-    if (mappedGesture == GestureType::CLASH &&
-        (intensity >= clashIntensityThreshold || speed >= _config.clashSpeedThreshold) &&
-        !clashOnCooldown)
-    {
-        _gestureCooldown = true;
-        uint16_t cooldownHalf = (uint16_t)(_config.gestureCooldownMs / 2);
-        if (cooldownHalf < 200) cooldownHalf = 200;
-        const uint16_t appliedCooldown = max16(cooldownHalf, clashCooldown);
-        _gestureCooldownEnd = timestamp + appliedCooldown;
-        _clashCooldownEnd = timestamp + clashCooldown;
-        _lastGestureConfidence = 70;
-        if (_config.debugLogsEnabled) {
-            Serial.println("[MOTION] CLASH detected (4-way mapping).");
-        }
-        _lastDirection = direction;
-        return GestureType::CLASH;
-    }
-
-    // No gesture detected
-    _lastDirection = direction;
-    return GestureType::NONE;
 }
 
-bool MotionProcessor::_isSustainedDirection(
-    OpticalFlowDetector::Direction direction,
-    uint32_t timestamp,
-    uint16_t minDurationMs)
-{
-    if (direction == OpticalFlowDetector::Direction::NONE) {
-        _directionStartTime = 0;
-        return false;
-    }
-
-    if (direction != _lastDirection) {
-        // Direction changed
-        _directionStartTime = timestamp;
-        return false;
-    }
-
-    // Same direction as last frame
-    if (_directionStartTime == 0) {
-        _directionStartTime = timestamp;
-        return false;
+GestureClassifier::Result MotionProcessor::_runClassifier() {
+    const uint32_t start = micros();
+    GestureClassifier::Features features;
+    GestureClassifier::Result result = {0, 0};
+    if (GestureClassifier::extract(_history, features)) {
+        result = _classifier.classify(features);
     }
-
-    // Check duration
-    uint32_t duration = timestamp - _directionStartTime;
-    return duration >= minDurationMs;
+    _classifierTimeUs = micros() - start;
+    return result;
 }
 
 void MotionProcessor::_calculatePerturbationGrid(
     const OpticalFlowDetector& detector,
+    const EgoMotion::Estimate* local,
     uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS])
 {
     const uint8_t* gamma = gammaLut07();
@@ -306,6 +440,13 @@ void MotionProcessor::_calculatePerturbationGrid(
             uint8_t confidence;
 
             if (detector.getBlockVector(row, col, &dx, &dy, &confidence)) {
+                if (local) {
+                    // Solo moto locale: i blocchi che seguono la camera restano a 0
+                    const uint8_t index = row * OpticalFlowDetector::GRID_COLS + col;
+                    dx = local->localDx[index];
+                    dy = local->localDy[index];
+                }
+
                 // Calculate magnitude of motion vector
                 float magnitude = sqrtf(dx * dx + dy * dy);
 
@@ -352,9 +493,12 @@ void MotionProcessor::_calculatePerturbationFromCentroid(
     // Reset grid to zero first
     memset(perturbationGrid, 0, sizeof(uint8_t) * OpticalFlowDetector::GRID_ROWS * OpticalFlowDetector::GRID_COLS);
 
-    // Get centroid normalized position (0.0-1.0)
+    // Get centroid normalized position (0.0-1.0), predicted one frame ahead when tracked
     float cx, cy;
-    if (!detector.getCentroidNormalized(&cx, &cy)) {
+    if (detector.getCentroidPrediction(&cx, &cy, nullptr, nullptr)) {
+        cx = constrain(cx, 0.0f, 1.0f);
+        cy = constrain(cy, 0.0f, 1.0f);
+    } else if (!detector.getCentroidNormalized(&cx, &cy)) {
         // No valid centroid: no perturbation
         return;
     }
@@ -412,14 +556,67 @@ void MotionProcessor::_calculatePerturbationFromCentroid(
 }
 
 void MotionProcessor::reset() {
-    _lastDirection = OpticalFlowDetector::Direction::NONE;
-    _directionStartTime = 0;
-    _lastFrameTime = 0;
-    _gestureCooldown = false;
-    _gestureCooldownEnd = 0;
-    _clashCooldownEnd = 0;
+    _history.reset();
+    _gestureMachine.reset();
     _lastGestureConfidence = 0;
     _lastEffectRequest[0] = '\0';
+    memset(_bladeProfile, 0, sizeof(_bladeProfile));
+}
+
+void MotionProcessor::setBladeLength(uint8_t length) {
+    if (length > BLADE_PROFILE_MAX) {
+        length = BLADE_PROFILE_MAX;
+    }
+    if (length != _bladeLength) {
+        _bladeLength = length;
+        memset(_bladeProfile, 0, sizeof(_bladeProfile));
+    }
+}
+
+void MotionProcessor::_updateBladeProfile(
+    const uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS],
+    uint8_t out[BLADE_PROFILE_MAX])
+{
+    constexpr uint8_t COLS = OpticalFlowDetector::GRID_COLS;
+
+    // Massimo della fascia centrale per colonna: una perturbazione su una sola
+    // riga resta piena (con la media scenderebbe sotto le soglie dei renderer)
+    int32_t column[COLS];
+    for (uint8_t col = 0; col < COLS; col++) {
+        uint8_t peak = 0;
+        for (uint8_t row = PROFILE_ROW_FIRST; row <= PROFILE_ROW_LAST; row++) {
+            peak = max(peak, perturbationGrid[row][col]);
+        }
+        column[col] = peak;
+    }
+
+    for (uint8_t i = 0; i < _bladeLength; i++) {
+        // Posizione sulla griglia in Q8: LED 0 -> colonna 0, ultimo LED -> ultima colonna
+        const uint32_t pos = _bladeLength > 1 ? (uint32_t)i * (COLS - 1) * 256 / (_bladeLength - 1) : 0;
+        const uint8_t seg = min<uint32_t>(pos >> 8, COLS - 2);
+        const int32_t f = (int32_t)(pos - (uint32_t)seg * 256);
+        const int32_t p0 = column[seg > 0 ? seg - 1 : 0];
+        const int32_t p1 = column[seg];
+        const int32_t p2 = column[seg + 1];
+        const int32_t p3 = column[seg + 2 < COLS ? seg + 2 : COLS - 1];
+
+        // Catmull-Rom: passa per i valori di colonna, derivata continua tra i segmenti
+        const int32_t a = -p0 + 3 * p1 - 3 * p2 + p3;
+        const int32_t b = 2 * p0 - 5 * p1 + 4 * p2 - p3;
+        const int32_t c = p2 - p0;
+        const int32_t value = ((((a * f >> 8) + b) * f >> 8) + c) * f >> 8;
+        const uint8_t target = (uint8_t)constrain((value + 2 * p1) / 2, 0L, 255L);
+
+        // Salita rapida, discesa esponenziale: niente sfarfallio tra frame
+        uint8_t& current = _bladeProfile[i];
+        if (target > current) {
+            current += (uint8_t)max(1, ((target - current) * PROFILE_ATTACK) >> 8);
+        } else {
+            current = max(target, (uint8_t)((current * PROFILE_DECAY) >> 8));
+        }
+    }
+    memcpy(out, _bladeProfile, _bladeLength);
+    memset(out + _bladeLength, 0, BLADE_PROFILE_MAX - _bladeLength);
 }
 
 const char* MotionProcessor::gestureToString(GestureType gesture) {
@@ -428,6 +625,9 @@ const char* MotionProcessor::gestureToString(GestureType gesture) {
         case GestureType::IGNITION:  return "ignition";
         case GestureType::RETRACT:   return "retract";
         case GestureType::CLASH:     return "clash";
+        case GestureType::STAB:      return "stab";
+        case GestureType::SPIN:      return "spin";
+        case GestureType::TWIRL:     return "twirl";
         default:                     return "unknown";
     }
 }
@@ -2,22 +2,37 @@
 #define MOTION_PROCESSOR_H
 
 #include <Arduino.h>
+#include "EgoMotion.h"
+#include "GestureClassifier.h"
+#include "GestureStateMachine.h"
+#include "MotionHistory.h"
 #include "OpticalFlowDetector.h"
 
 /**
  * @brief Processes raw motion data into gestures and perturbations
  *
  * Converts optical flow data into:
- * 1. Classified gestures (IGNITION, RETRACT, CLASH)
+ * 1. Classified gestures (IGNITION, RETRACT, CLASH; STAB, SPIN, TWIRL with classifier)
  * 2. Localized perturbation grid for LED effects
+ * 3. Moto globale della camera separato dal moto locale (EgoMotion)
+ * 4. Profilo di perturbazione 1-D alla risoluzione della lama (letto dai renderer)
  */
 class MotionProcessor {
 public:
+    static constexpr uint8_t BLADE_PROFILE_MAX = 144;   // Campioni massimi (foldPoint)
+    static constexpr uint8_t PROFILE_ROW_FIRST = 2;     // Fascia centrale della griglia
+    static constexpr uint8_t PROFILE_ROW_LAST = 4;
+    static constexpr uint8_t PROFILE_ATTACK = 192;      // Salita verso il nuovo valore, /256 per frame
+    static constexpr uint8_t PROFILE_DECAY = 216;       // Discesa: valore * DECAY/256 per frame
+
     enum class GestureType : uint8_t {
         NONE = 0,
         IGNITION,      // Gestita a livello LED quando lama spenta
         RETRACT,       // DOWN sostenuto
-        CLASH,         // LEFT/RIGHT sostenuto
+        CLASH,         // Impatto: picco di jerk in decelerazione dopo movimento veloce
+        STAB,          // Affondo verso la camera (solo classificatore)
+        SPIN,          // Rotazione della lama sul proprio asse (solo classificatore)
+        TWIRL,         // Traiettoria circolare (solo classificatore)
     };
 
     struct ProcessedMotion {
@@ -26,33 +41,49 @@ public:
         uint8_t motionIntensity;      // 0-255 (raw motion intensity)
         OpticalFlowDetector::Direction direction;
         float speed;                   // px/frame
+        uint16_t flowAngle;            // Direzione continua del flusso: 0-65535 = 0-360°, 0 = destra, 16384 = giù (riferimento di direction)
+        uint16_t flowMagnitudeQ4;      // Modulo del flusso, px/frame Q4 (0 = fermo: flowAngle non significativo)
         uint32_t timestamp;
         char effectRequest[32];       // Requested effect id (empty = none)
 
+        // Evidenza multi-frame (ultimi MotionHistory::CAPACITY frame)
+        MotionHistory::Stats window;
+        uint32_t jerk;                 // |jerk| L1 dell'ultimo frame, px/s^3
+
+        // Moto globale della camera (lama) + residuo locale per blocco
+        EgoMotion::Estimate ego;
+
+        // Centroide filtrato (Kalman) estrapolato di un frame: compensa la latenza camera -> LED
+        bool centroidTracked;
+        uint8_t predictedCentroidX;    // 0-255 normalizzato (come MotionHistory::Sample)
+        uint8_t predictedCentroidY;
+        int16_t centroidVelXQ4;        // Stessa scala per frame, Q4
+        int16_t centroidVelYQ4;
+
+        // State machine gesture: 2 bit per slot (GestureStateMachine::State) + slot cambiati nel frame
+        uint32_t gestureStates;
+        uint16_t gestureTransitions;
+
         // Localized perturbation data (6x6 grid matching optical flow)
         uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS];
+
+        // Perturbazione per LED logico (0 = impugnatura): colonne della griglia
+        // interpolate (Catmull-Rom) e smussate nel tempo (attacco/decadimento)
+        uint8_t bladeLength;           // Campioni validi (= foldPoint passato a setBladeLength)
+        uint8_t bladeProfile[BLADE_PROFILE_MAX];
     };
 
     struct Config {
         bool gesturesEnabled;
-        uint8_t gestureThreshold;      // Min intensity base (legacy/swing)
-        uint8_t ignitionIntensityThreshold; // Min intensity for IGNITION
-        uint8_t retractIntensityThreshold;  // Min intensity for RETRACT
-        uint8_t clashIntensityThreshold;    // Min intensity for CLASH
-        uint16_t gestureDurationMs;    // Min duration for sustained gestures (default: 100ms)
-        uint8_t clashDeltaThreshold;   // Min delta for clash (default: 15)
-        uint16_t clashWindowMs;        // Time window for clash delta (default: 350ms)
-        uint16_t gestureCooldownMs;    // Cooldown after major gesture (default: 800ms)
-        uint16_t clashCooldownMs;      // Specific cooldown for clash spam control
-
         bool perturbationEnabled;
         uint8_t perturbationScale;     // Perturbation multiplier 0-255 (default: 255)
         bool debugLogsEnabled;         // Enable motion debug logs (default: false)
+        bool classifierEnabled;        // Albero int8 (GestureModel.h) al posto delle regole
+        bool egoCompensation;          // Camera sull'elsa: perturbazioni dal moto locale, gesture dal moto globale
+
+        // Soglie, isteresi, dwell e refrattari per slot (GestureStateMachine::Slot)
+        GestureStateMachine::Rule rules[GestureStateMachine::SLOT_COUNT];
 
-        // Speed thresholds (px/frame) - Alternative trigger for fast gestures
-        float ignitionSpeedThreshold;
-        float retractSpeedThreshold;
-        float clashSpeedThreshold;
         // Direction -> effect mapping (4-way, 90 degrees)
         String effectOnUp;
         String effectOnDown;
@@ -61,25 +92,17 @@ public:
 
         Config() :
             gesturesEnabled(true),
-            gestureThreshold(6),   // Ridotto a 6 per rilevare gesture più leggere
-            ignitionIntensityThreshold(12),  // Ridotto a 6 per facilitare ignition
-            retractIntensityThreshold(12),   // Ridotto a 6 (logs mostrano picchi di 9-10)
-            clashIntensityThreshold(12),     // Aumentato da 14 a 30 per evitare rumore
-            gestureDurationMs(150),  // Aumentato da 100 a 150ms per gesture più stabili
-            clashDeltaThreshold(60), // Aumentato da 15 a 60 per ridurre falsi positivi
-            clashWindowMs(600),     // ~2.2 frame @ 5.6fps per catturare veri clash
-            gestureCooldownMs(1200), // Aumentato da 800 a 1200ms per ridurre spam
-            clashCooldownMs(5000),   // Clash dedicato per evitare raffiche
             perturbationEnabled(true),
             perturbationScale(255),
             debugLogsEnabled(false),
-            ignitionSpeedThreshold(0.4f),  // Ridotto a 0.5 per facilitare ignition
-            retractSpeedThreshold(0.4f),   // Ridotto a 0.4 per facilitare retract
-            clashSpeedThreshold(2.0f),
+            classifierEnabled(false),      // Modello di partenza addestrato su sessioni sintetiche
+            egoCompensation(false),
             effectOnUp(""),
             effectOnDown(""),
             effectOnLeft(""),
-            effectOnRight("") {}
+            effectOnRight("") {
+            memcpy(rules, GestureStateMachine::DEFAULT_RULES, sizeof(rules));
+        }
     };
 
     MotionProcessor();
@@ -111,6 +134,37 @@ public:
      */
     void reset();
 
+    /**
+     * @brief Numero di LED logici della lama (foldPoint) per bladeProfile
+     * @param length Saturato a BLADE_PROFILE_MAX; un cambio azzera lo smussamento
+     */
+    void setBladeLength(uint8_t length);
+
+    /**
+     * @brief Storico feature per frame con statistiche a finestra (aggiornato da process)
+     */
+    const MotionHistory& getHistory() const { return _history; }
+
+    /**
+     * @brief Sostituisce il modello del classificatore (default: GestureModel.h)
+     */
+    void setClassifier(const GestureClassifier& classifier) { _classifier = classifier; }
+
+    /**
+     * @brief Stato corrente della state machine gesture
+     */
+    const GestureStateMachine& getGestureMachine() const { return _gestureMachine; }
+
+    /**
+     * @brief Durata dell'ultima inferenza (extract + classify), microsecondi
+     */
+    uint32_t getClassifierTimeUs() const { return _classifierTimeUs; }
+
+    /**
+     * @brief Durata dell'ultima stima ego-motion, microsecondi
+     */
+    uint32_t getEgoTimeUs() const { return _egoTimeUs; }
+
     /**
      * @brief Convert gesture to string (for debug/logging)
      */
@@ -120,28 +174,89 @@ private:
     Config _config;
 
     // Gesture detection state
-    OpticalFlowDetector::Direction _lastDirection;
-    uint32_t _directionStartTime;
-    uint32_t _lastFrameTime;
-    bool _gestureCooldown;
-    uint32_t _gestureCooldownEnd;
-    uint32_t _clashCooldownEnd;
+    GestureStateMachine _gestureMachine;
     uint8_t _lastGestureConfidence;
     char _lastEffectRequest[32];
 
+    MotionHistory _history;
+    GestureClassifier _classifier;
+    uint32_t _classifierTimeUs;
+    uint32_t _egoTimeUs;
+
+    // Profilo lama smussato tra i frame
+    uint8_t _bladeLength;
+    uint8_t _bladeProfile[BLADE_PROFILE_MAX];
+
+    // Somma dei vettori blocco sub-pixel (Q4) pesati mag * confidence (una passata per frame)
+    struct BlockSums {
+        int64_t sumDxQ4;
+        int64_t sumDyQ4;
+        int32_t sumW;
+        int64_t sumDiv;     // Componente radiale rispetto al centro griglia (mezze celle)
+        int64_t sumCurl;    // Componente tangenziale
+    };
+
+    /**
+     * @brief Accumulate weighted block vectors of the current frame
+     */
+    static BlockSums _sumBlockVectors(const OpticalFlowDetector& detector);
+
+    /**
+     * @brief Separate camera (global) motion from local motion (timed in _egoTimeUs)
+     */
+    void _estimateEgoMotion(const OpticalFlowDetector& detector, EgoMotion::Estimate& out);
+
+    /**
+     * @brief true se perturbazioni e gesture usano la stima ego-motion del frame
+     */
+    bool _egoCompensated(const EgoMotion::Estimate& ego) const {
+        return _config.egoCompensation && ego.model != EgoMotion::Model::NONE;
+    }
+
+    /**
+     * @brief Push current frame features into the history ring
+     */
+    void _pushHistory(const BlockSums& sums,
+                      const EgoMotion::Estimate& ego,
+                      uint8_t intensity,
+                      float speed,
+                      uint32_t timestamp,
+                      const OpticalFlowDetector& detector);
+
     /**
      * @brief Detect gesture from motion data
+     *
+     * Calcola l'evidenza di ogni slot e avanza la state machine: il primo
+     * slot gesture scattato (ordine della tabella) è la gesture del frame,
+     * il primo slot effetto scattato la richiesta effetto.
      */
     GestureType _detectGesture(uint8_t intensity,
-                               OpticalFlowDetector::Direction direction,
                                float speed,
                                uint32_t timestamp,
-                               const OpticalFlowDetector& detector);
+                               int32_t flowX,
+                               int32_t flowY);
+
+    /**
+     * @brief Evidenza per slot in % della soglia della sua regola
+     */
+    void _gestureLevels(uint8_t intensity,
+                        float speed,
+                        int32_t flowX,
+                        int32_t flowY,
+                        const GestureClassifier::Result& classified,
+                        uint16_t levels[GestureStateMachine::SLOT_COUNT]) const;
+
+    /**
+     * @brief Classificatore sulla finestra corrente (timed in _classifierTimeUs)
+     */
+    GestureClassifier::Result _runClassifier();
 
     /**
      * @brief Calculate perturbation grid from optical flow blocks
+     * @param local Residui ego-motion da usare al posto dei vettori grezzi (nullptr = grezzi)
      */
     void _calculatePerturbationGrid(const OpticalFlowDetector& detector,
+                                    const EgoMotion::Estimate* local,
                                     uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS]);
 
     /**
@@ -152,11 +267,10 @@ private:
                                             uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS]);
 
     /**
-     * @brief Check if direction is sustained
+     * @brief Aggiorna _bladeProfile dalla griglia del frame e lo copia in out
      */
-    bool _isSustainedDirection(OpticalFlowDetector::Direction direction,
-                               uint32_t timestamp,
-                               uint16_t minDurationMs);
+    void _updateBladeProfile(const uint8_t perturbationGrid[OpticalFlowDetector::GRID_ROWS][OpticalFlowDetector::GRID_COLS],
+                             uint8_t out[BLADE_PROFILE_MAX]);
 };
 
 #endif // MOTION_PROCESSOR_H
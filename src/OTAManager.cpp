@@ -1,5 +1,11 @@
 #include "OTAManager.h"
+#include "EventDispatcher.h"
+#include <Preferences.h>
+#include <cstddef>
 #include <cstring>
+#include <esp_image_format.h>
+#include <esp_rom_crc.h>
+#include <mbedtls/version.h>
 
 // ============================================================================
 // CALLBACK CLASSES
@@ -19,6 +25,13 @@ public:
     }
 };
 
+static uint32_t readLE32(const std::string& value, size_t pos) {
+    return ((uint32_t)(uint8_t)value[pos]) |
+           ((uint32_t)(uint8_t)value[pos + 1] << 8) |
+           ((uint32_t)(uint8_t)value[pos + 2] << 16) |
+           ((uint32_t)(uint8_t)value[pos + 3] << 24);
+}
+
 class OTAControlCallbacks : public BLECharacteristicCallbacks {
     OTAManager* manager;
 public:
@@ -39,12 +52,53 @@ public:
                         ((uint32_t)value[2] << 8) |
                         ((uint32_t)value[3] << 16) |
                         ((uint32_t)value[4] << 24);
+                    OTAStreamParams stream;
+                    if (value.length() >= 37) {
+                        stream.hasSha256 = true;
+                        memcpy(stream.sha256, value.data() + 5, sizeof(stream.sha256));
+                    }
                     // IMPORTANTE: Schedula solo, non eseguire nel callback BLE!
-                    // esp_ota_begin() blocca troppo a lungo e causa disconnessione
-                    manager->scheduleStartCommand(firmwareSize);
+                    // preOtaCallback e verifiche flash bloccano troppo a lungo il task BLE
+                    manager->scheduleStartCommand(firmwareSize, stream);
+                }
+                break;
+            }
+            case OTACommand::START_WINDOWED: {
+                if (value.length() >= 6) {
+                    const uint32_t firmwareSize = readLE32(value, 1);
+                    OTAStreamParams stream;
+                    stream.window = (uint8_t)value[5];
+                    if (stream.window == 0) {
+                        stream.window = OTA_WINDOW_DEFAULT;
+                    }
+                    if (value.length() >= 12) {
+                        // Stream compresso: size = byte trasferiti, imageSize = firmware
+                        stream.encoding = (OTAEncoding)(uint8_t)value[6];
+                        stream.imageSize = readLE32(value, 7);
+                        stream.codecParam = (uint8_t)value[11];
+                    }
+                    if (value.length() >= 20) {
+                        // Delta: base attesa sul device (verificata prima di cancellare la flash)
+                        stream.sourceSize = readLE32(value, 12);
+                        stream.sourceCrc32 = readLE32(value, 16);
+                    }
+                    if (value.length() >= 52) {
+                        stream.hasSha256 = true;
+                        memcpy(stream.sha256, value.data() + 20, sizeof(stream.sha256));
+                    }
+                    if (value.length() >= 56) {
+                        // Ripresa: lo stream parte da resumeOffset dell'immagine
+                        stream.resumeOffset = readLE32(value, 52);
+                    }
+                    manager->scheduleStartCommand(firmwareSize, stream);
                 }
                 break;
             }
+            case OTACommand::QUERY_RESUME:
+                if (value.length() >= 33) {
+                    manager->handleQueryResumeCommand((const uint8_t*)value.data() + 1);
+                }
+                break;
             case OTACommand::ABORT:
                 manager->scheduleAbortCommand();
                 break;
@@ -72,7 +126,7 @@ OTAManager::OTAManager() {
     pCharOTAControl = nullptr;
     pCharOTAProgress = nullptr;
     pCharFWVersion = nullptr;
-    otaHandle = 0;
+    pCharOTAAck = nullptr;
     updatePartition = nullptr;
     preOtaCallback = nullptr;
     postOtaCallback = nullptr;
@@ -142,6 +196,16 @@ void OTAManager::begin(BLEServer* server) {
     descData->setValue("OTA Data");
     pCharOTAData->addDescriptor(descData);
 
+    // Characteristic 6: OTA_ACK (NOTIFY) - ACK/NACK cumulativi del trasferimento a finestra
+    pCharOTAAck = pService->createCharacteristic(
+        CHAR_OTA_ACK_UUID,
+        BLECharacteristic::PROPERTY_NOTIFY
+    );
+    pCharOTAAck->addDescriptor(new BLE2902());
+    BLEDescriptor* descAck = new BLEDescriptor(BLEUUID((uint16_t)0x2901));
+    descAck->setValue("OTA Ack");
+    pCharOTAAck->addDescriptor(descAck);
+
     // Avvia servizio OTA
     pService->start();
 
@@ -158,13 +222,32 @@ void OTAManager::begin(BLEServer* server) {
     Serial.println("[OTA OK] OTA Manager initialized");
     Serial.printf("[OTA] Firmware version: %s\n", FIRMWARE_VERSION);
 
-    // Coda RX per chunk OTA (processati nel loop principale)
+    // Coda RX per chunk OTA (consumati da OTAFlashTask)
     if (!rxQueue) {
         rxQueue = xQueueCreate(OTA_RX_QUEUE_DEPTH, sizeof(OTAQueuedChunk));
         if (!rxQueue) {
             Serial.println("[OTA ERROR] Failed to create RX queue");
         }
     }
+    if (!flashMutex) {
+        flashMutex = xSemaphoreCreateMutex();
+    }
+    if (rxQueue && flashMutex && !flashTask) {
+        // Core 0 con lo stack BLE: il loop (core 1) non si ferma sulle scritture flash
+        BaseType_t created = xTaskCreatePinnedToCore(
+            flashTaskEntry,
+            "OTAFlashTask",
+            4096,
+            this,
+            2,
+            &flashTask,
+            0
+        );
+        if (created != pdPASS) {
+            flashTask = nullptr;
+            Serial.println("[OTA ERROR] Failed to create OTAFlashTask");
+        }
+    }
 
     // Verifica partizioni disponibili
     const esp_partition_t* runningPartition = esp_ota_get_running_partition();
@@ -244,15 +327,34 @@ void OTAManager::resetOTAState() {
     otaStatus.startTime = 0;
     otaStatus.errorMessage = "";
 
-    if (otaHandle) {
-        esp_ota_end(otaHandle);
-        otaHandle = 0;
+    // Il writer potrebbe essere a metà di una scrittura flash
+    if (flashMutex) xSemaphoreTake(flashMutex, portMAX_DELAY);
+
+    // Sessione interrotta (timeout, errore, nuovo START): salva i settori già
+    // scritti, la parte nel buffer RAM va ritrasmessa
+    if (resumeRecordActive && flashSessionOpen) {
+        const uint32_t committed = imageFlushed & ~(uint32_t)(OTA_FLASH_BLOCK_SIZE - 1);
+        if (committed > resumeCommitted) {
+            saveResumeRecord(committed);
+        }
     }
+    resumeRecordActive = false;
+
+    flashSessionOpen = false;
+    windowed = false;
+    flashBufferLen = 0;
+    writerDone = false;
+    writerError = ESP_OK;
+    decoder.end();
+    patcher.end();
+    releaseImageSha();
 
     if (rxQueue) {
         xQueueReset(rxQueue);
     }
     rxQueueError = 0;
+
+    if (flashMutex) xSemaphoreGive(flashMutex);
 }
 
 bool OTAManager::enqueueDataChunk(const uint8_t* data, size_t length) {
@@ -266,22 +368,394 @@ bool OTAManager::enqueueDataChunk(const uint8_t* data, size_t length) {
 
     if (length > OTA_CHUNK_SIZE) {
         if (rxQueueError == 0) rxQueueError = 2;
+        EventDispatcher::getInstance().post(EventDispatcher::EVENT_OTA_DATA);
         return false;
     }
 
+    if (windowed) {
+        return enqueueWindowedChunk(data, length);
+    }
+
     OTAQueuedChunk chunk;
+    chunk.kind = QUEUED_DATA;
+    chunk.seq = 0;
+    chunk.offset = 0;
     chunk.len = static_cast<uint16_t>(length);
     memcpy(chunk.data, data, length);
 
     if (xQueueSend(rxQueue, &chunk, 0) != pdTRUE) {
+        // Senza finestra non c'è modo di recuperare il chunk perso
         if (rxQueueError == 0) rxQueueError = 1;
+        EventDispatcher::getInstance().post(EventDispatcher::EVENT_OTA_DATA);
         return false;
     }
+    return true;
+}
+
+bool OTAManager::enqueueWindowedChunk(const uint8_t* data, size_t length) {
+    if (!flashSessionOpen || length <= OTA_SEQ_HEADER_SIZE) {
+        return false;
+    }
+
+    const uint16_t seq = (uint16_t)data[0] | ((uint16_t)data[1] << 8);
+    const int16_t delta = (int16_t)(seq - rxExpectedSeq);
+
+    if (delta < 0) {
+        // Ritrasmissione di un chunk già accettato (ACK perso o timeout lato client):
+        // un solo ACK di controllo in coda basta a riallineare il client
+        if (!ackQueued) {
+            ackQueued = enqueueControl(QUEUED_ACK, 0, 0);
+        }
+        return true;
+    }
+
+    if (delta > 0) {
+        // Buco: scarta tutto fino al seq atteso (go-back-N), un NACK per buco
+        if (!nackQueued) {
+            nackQueued = enqueueControl(QUEUED_NACK, rxExpectedSeq, rxAcceptedOffset);
+        }
+        return false;
+    }
+
+    OTAQueuedChunk chunk;
+    chunk.kind = QUEUED_DATA;
+    chunk.seq = seq;
+    chunk.offset = rxAcceptedOffset;
+    chunk.len = static_cast<uint16_t>(length - OTA_SEQ_HEADER_SIZE);
+    memcpy(chunk.data, data + OTA_SEQ_HEADER_SIZE, chunk.len);
+
+    if (xQueueSend(rxQueue, &chunk, 0) != pdTRUE) {
+        // Client oltre la finestra: trattalo come un buco, verrà ritrasmesso
+        if (!nackQueued) {
+            nackQueued = enqueueControl(QUEUED_NACK, rxExpectedSeq, rxAcceptedOffset);
+        }
+        return false;
+    }
+
+    rxExpectedSeq++;
+    rxAcceptedOffset += chunk.len;
+    nackQueued = false;
+    return true;
+}
+
+bool OTAManager::enqueueControl(OTAQueuedKind kind, uint16_t seq, uint32_t offset) {
+    // Solo header: len = 0, il payload non viene copiato dal writer
+    OTAQueuedChunk chunk;
+    chunk.kind = kind;
+    chunk.seq = seq;
+    chunk.len = 0;
+    chunk.offset = offset;
+    return xQueueSendToFront(rxQueue, &chunk, 0) == pdTRUE;
+}
+
+void OTAManager::sendAck(OTAAckType type, uint16_t nextSeq, uint32_t offset) {
+    if (!pCharOTAAck) return;
+
+    OTAAckPacket packet;
+    packet.type = (uint8_t)type;
+    packet.window = type == OTAAckType::RESUME ? 0 : windowSize;
+    packet.nextSeq = nextSeq;
+    packet.offset = offset;
+
+    pCharOTAAck->setValue((uint8_t*)&packet, sizeof(packet));
+    pCharOTAAck->notify();
+}
+
+// ============================================================================
+// FLASH WRITER TASK
+// ============================================================================
+
+void OTAManager::flashTaskEntry(void* param) {
+    static_cast<OTAManager*>(param)->flashTaskLoop();
+}
+
+void OTAManager::flashTaskLoop() {
+    OTAQueuedChunk chunk;
+
+    for (;;) {
+        if (xQueueReceive(rxQueue, &chunk, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        bool sendReply = false;
+        OTAAckType replyType = OTAAckType::ACK;
+        uint16_t replySeq = 0;
+        uint32_t replyOffset = 0;
+
+        xSemaphoreTake(flashMutex, portMAX_DELAY);
+
+        // Chunk di una sessione già chiusa (abort/reset mentre era in mano al writer)
+        if (!flashSessionOpen) {
+            xSemaphoreGive(flashMutex);
+            continue;
+        }
+
+        switch (chunk.kind) {
+            case QUEUED_DATA: {
+                handleDataChunk(chunk.data, chunk.len);
+                if (!windowed) {
+                    break;
+                }
+                ackSeq = chunk.seq + 1;
+                chunksSinceAck++;
+                // ACK ogni quarto di finestra, o appena la coda si svuota
+                const uint16_t ackEvery = max<uint16_t>(1, windowSize / 4);
+                sendReply = chunksSinceAck >= ackEvery || uxQueueMessagesWaiting(rxQueue) == 0 ||
+                            otaStatus.receivedBytes >= otaStatus.totalBytes;
+                break;
+            }
+            case QUEUED_NACK:
+                sendReply = true;
+                replyType = OTAAckType::NACK;
+                replySeq = chunk.seq;
+                replyOffset = chunk.offset;
+                break;
+            case QUEUED_ACK:
+                ackQueued = false;
+                sendReply = true;
+                break;
+        }
+
+        if (sendReply && replyType == OTAAckType::ACK) {
+            replySeq = ackSeq;
+            replyOffset = otaStatus.receivedBytes;
+            chunksSinceAck = 0;
+        }
+
+        xSemaphoreGive(flashMutex);
+
+        // Notify fuori dal mutex: il callback VERIFY (task BLE) può prenderlo
+        if (sendReply) {
+            sendAck(replyType, replySeq, replyOffset);
+        }
+    }
+}
+
+bool OTAManager::flushFlashBuffer() {
+    if (flashBufferLen == 0) {
+        return true;
+    }
+
+    // Come esp_ota_write: un'immagine che non inizia con il magic non va in flash
+    esp_err_t err = ESP_OK;
+    if (imageFlushed == 0 && flashBuffer[0] != ESP_IMAGE_HEADER_MAGIC) {
+        err = ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+
+    // Scrittura diretta a settori (niente esp_ota_begin, che cancella l'intera
+    // partizione): i settori prima di imageFlushed restano validi per la ripresa
+    const size_t length = flashBufferLen;
+    if (err == ESP_OK) {
+        digestImageBlock(flashBuffer, length);
+        // Flash cifrata: scritture a multipli di 16 byte (solo l'ultimo blocco è parziale)
+        const size_t padded = (length + 15) & ~(size_t)15;
+        memset(flashBuffer + length, 0xFF, padded - length);
+        err = esp_partition_erase_range(updatePartition, imageFlushed, OTA_FLASH_BLOCK_SIZE);
+        if (err == ESP_OK) {
+            err = esp_partition_write(updatePartition, imageFlushed, flashBuffer, padded);
+        }
+    }
+    flashBufferLen = 0;
+    if (err != ESP_OK) {
+        writerError = err;
+        EventDispatcher::getInstance().post(EventDispatcher::EVENT_OTA_DATA);
+        return false;
+    }
+    imageFlushed += length;
+
+    // Checkpoint solo dopo la scrittura: l'offset salvato è sempre già in flash
+    if (resumeRecordActive && length == OTA_FLASH_BLOCK_SIZE &&
+        imageFlushed - resumeCommitted >= OTA_RESUME_CHECKPOINT_BYTES) {
+        saveResumeRecord(imageFlushed);
+    }
+
+    // Un COPY delta lungo scrive molti settori senza nuovi chunk: conta come attività
+    otaStatus.lastChunkTime = millis();
+    return true;
+}
+
+void OTAManager::digestImageBlock(const uint8_t* data, size_t length) {
+    // Blocchi da 4KB: CRC ROM + SHA-256 hardware costano poco rispetto all'erase
+    const uint32_t start = micros();
+    otaStatus.crc32 = esp_rom_crc32_le(otaStatus.crc32, data, length);
+    if (imageShaActive) {
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+        mbedtls_sha256_update(&imageSha, data, length);
+#else
+        mbedtls_sha256_update_ret(&imageSha, data, length);
+#endif
+    }
+    checksumMicros += micros() - start;
+}
+
+void OTAManager::releaseImageSha() {
+    if (imageShaActive) {
+        mbedtls_sha256_free(&imageSha);
+        imageShaActive = false;
+    }
+}
+
+bool OTAManager::writeImageData(const uint8_t* data, size_t length) {
+    if (imageWritten + length > imageBytes) {
+        writerError = ESP_ERR_INVALID_SIZE;
+        EventDispatcher::getInstance().post(EventDispatcher::EVENT_OTA_DATA);
+        return false;
+    }
+
+    // Accumula a settori: ogni flush cancella e scrive un blocco intero
+    size_t pos = 0;
+    while (pos < length) {
+        const size_t n = min(length - pos, (size_t)OTA_FLASH_BLOCK_SIZE - flashBufferLen);
+        memcpy(flashBuffer + flashBufferLen, data + pos, n);
+        flashBufferLen += n;
+        pos += n;
+        if (flashBufferLen == OTA_FLASH_BLOCK_SIZE && !flushFlashBuffer()) {
+            return false;
+        }
+    }
+    imageWritten += length;
+    return true;
+}
+
+bool OTAManager::decoderSink(void* context, const uint8_t* data, size_t length) {
+    return static_cast<OTAManager*>(context)->writeImageData(data, length);
+}
+
+bool OTAManager::patchSink(void* context, const uint8_t* data, size_t length) {
+    OTAManager* manager = static_cast<OTAManager*>(context);
+    if (manager->patcher.feed(data, length, decoderSink, manager)) {
+        return true;
+    }
+    if (manager->patcher.isCorrupt() && manager->writerError == ESP_OK) {
+        manager->writerError = ESP_ERR_INVALID_ARG;
+        EventDispatcher::getInstance().post(EventDispatcher::EVENT_OTA_DATA);
+    }
+    return false;
+}
+
+bool OTAManager::readSourcePartition(void* context, uint32_t offset, uint8_t* buffer, size_t length) {
+    OTAManager* manager = static_cast<OTAManager*>(context);
+    esp_err_t err = esp_partition_read(manager->sourcePartition, offset, buffer, length);
+    if (err != ESP_OK) {
+        manager->writerError = err;
+        EventDispatcher::getInstance().post(EventDispatcher::EVENT_OTA_DATA);
+        return false;
+    }
+    return true;
+}
+
+bool OTAManager::verifyDeltaSource(uint32_t size, uint32_t expectedCrc32) {
+    sourcePartition = esp_ota_get_running_partition();
+    if (!sourcePartition || size == 0 || size > sourcePartition->size) {
+        return false;
+    }
+
+    // CRC della base letta dalla flash: la patch vale solo contro questi byte esatti
+    uint8_t buffer[512];
+    uint32_t crc = 0;
+    for (uint32_t offset = 0; offset < size; offset += sizeof(buffer)) {
+        const uint32_t n = min<uint32_t>(sizeof(buffer), size - offset);
+        if (esp_partition_read(sourcePartition, offset, buffer, n) != ESP_OK) {
+            return false;
+        }
+        crc = esp_rom_crc32_le(crc, buffer, n);
+    }
+
+    Serial.printf("[OTA] Delta base %s: %u bytes, CRC32 0x%08X (expected 0x%08X)\n",
+        sourcePartition->label, size, crc, expectedCrc32);
+    return crc == expectedCrc32;
+}
+
+// ============================================================================
+// SESSIONE RIPRISTINABILE (NVS)
+// ============================================================================
+
+static uint32_t resumeRecordCrc(const void* record, size_t length) {
+    return esp_rom_crc32_le(0, static_cast<const uint8_t*>(record), length);
+}
+
+bool OTAManager::loadResumeRecord(OTAResumeRecord& record) {
+    Preferences prefs;
+    if (!prefs.begin(OTA_RESUME_NVS_NAMESPACE, true)) {
+        return false;
+    }
+    const size_t len = prefs.getBytes(OTA_RESUME_NVS_KEY, &record, sizeof(record));
+    prefs.end();
+
+    return len == sizeof(record) && record.magic == RESUME_MAGIC &&
+           record.version == RESUME_VERSION &&
+           record.crc == resumeRecordCrc(&record, offsetof(OTAResumeRecord, crc));
+}
+
+void OTAManager::saveResumeRecord(uint32_t committed) {
+    // Chiamato con flashMutex preso, dopo che i settori fino a committed sono in flash
+    OTAResumeRecord record;
+    memset(&record, 0, sizeof(record));
+    record.magic = RESUME_MAGIC;
+    record.version = RESUME_VERSION;
+    memcpy(record.sha256, expectedSha256, sizeof(record.sha256));
+    record.imageSize = imageBytes;
+    record.partitionAddress = updatePartition ? updatePartition->address : 0;
+    record.committed = committed;
+    record.crc = resumeRecordCrc(&record, offsetof(OTAResumeRecord, crc));
+
+    Preferences prefs;
+    if (!prefs.begin(OTA_RESUME_NVS_NAMESPACE, false)) {
+        Serial.println("[OTA ERROR] Failed to open NVS for resume record");
+        return;
+    }
+    if (prefs.putBytes(OTA_RESUME_NVS_KEY, &record, sizeof(record)) != sizeof(record)) {
+        Serial.println("[OTA ERROR] Failed to write resume record");
+    } else {
+        resumeCommitted = committed;
+    }
+    prefs.end();
+}
+
+void OTAManager::clearResumeRecord() {
+    resumeRecordActive = false;
+    resumeCommitted = 0;
+
+    Preferences prefs;
+    if (!prefs.begin(OTA_RESUME_NVS_NAMESPACE, false)) {
+        return;
+    }
+    if (prefs.isKey(OTA_RESUME_NVS_KEY)) {
+        prefs.remove(OTA_RESUME_NVS_KEY);
+    }
+    prefs.end();
+}
 
+bool OTAManager::rehashFlashedImage(uint32_t length) {
+    // Con flashMutex preso e sessione chiusa: flashBuffer è libero come scratch.
+    // Rilegge la flash invece di fidarsi del record: il digest finale copre
+    // i byte davvero presenti nella partizione
+    for (uint32_t offset = 0; offset < length; offset += OTA_FLASH_BLOCK_SIZE) {
+        const uint32_t n = min<uint32_t>(OTA_FLASH_BLOCK_SIZE, length - offset);
+        if (esp_partition_read(updatePartition, offset, flashBuffer, n) != ESP_OK) {
+            return false;
+        }
+        digestImageBlock(flashBuffer, n);
+    }
     return true;
 }
 
-void OTAManager::processRxQueue() {
+void OTAManager::handleQueryResumeCommand(const uint8_t* sha256) {
+    // Risposta sempre su OTA_ACK: offset 0 = nessuna sessione per questa immagine
+    uint32_t offset = 0;
+    OTAResumeRecord record;
+    const esp_partition_t* partition = esp_ota_get_next_update_partition(nullptr);
+    if (partition && loadResumeRecord(record) &&
+        memcmp(record.sha256, sha256, sizeof(record.sha256)) == 0 &&
+        record.partitionAddress == partition->address) {
+        offset = record.committed;
+    }
+
+    Serial.printf("[OTA] QUERY_RESUME: %u bytes resumable\n", offset);
+    sendAck(OTAAckType::RESUME, 0, offset);
+}
+
+void OTAManager::processWriterEvents() {
     if (!rxQueue) return;
 
     if (rxQueueError != 0 && otaStatus.state != OTAState::ERROR) {
@@ -296,23 +770,53 @@ void OTAManager::processRxQueue() {
         return;
     }
 
-    OTAQueuedChunk chunk;
-    uint32_t startMs = millis();
-    uint16_t processed = 0;
+    if (writerError != ESP_OK && otaStatus.state != OTAState::ERROR) {
+        const esp_err_t err = writerError;
+        if (err == ESP_ERR_INVALID_SIZE) {
+            setError("Data overflow");
+        } else if (err == ESP_ERR_INVALID_STATE) {
+            setError("Decompressed size mismatch");
+        } else if (err == ESP_ERR_INVALID_ARG) {
+            setError("Invalid delta patch");
+        } else {
+            setError("OTA write failed: " + String(esp_err_to_name(err)));
+        }
+        executeAbortCommand();
+        return;
+    }
 
-    while (xQueueReceive(rxQueue, &chunk, 0) == pdTRUE) {
-        handleDataChunk(chunk.data, chunk.len);
-        processed++;
+    // Primo chunk scritto dal writer
+    if (otaStatus.state == OTAState::WAITING && otaStatus.receivedBytes > 0) {
+        setState(OTAState::RECEIVING);
+    }
 
-        // Se lo stato cambia (errore/abort/verifica), svuota e smetti
-        if (otaStatus.state == OTAState::IDLE || otaStatus.state == OTAState::ERROR) {
-            xQueueReset(rxQueue);
-            break;
+    if (otaStatus.state != OTAState::RECEIVING) {
+        return;
+    }
+
+    // Calcola percentuale (usa uint64_t per evitare overflow e ottenere precisione)
+    const uint32_t received = otaStatus.receivedBytes;
+    otaStatus.progressPercent = ((uint64_t)received * 100) / otaStatus.totalBytes;
+
+    // Notifica progresso ogni 50KB (ridotto overhead per velocizzare trasferimento)
+    if (received - lastProgressBytes >= 51200 || (writerDone && received != lastProgressBytes)) {
+        // Log solo ogni 50KB (logging rallenta molto ESP32)
+        uint32_t elapsed = millis() - otaStatus.startTime;
+        float speed = 0.0f;
+        if (elapsed > 0) {
+            speed = (received / 1024.0f) / (elapsed / 1000.0f);  // KB/s
         }
+        Serial.printf("[OTA] Total: %u/%u (%u%%) | Speed: %.2f KB/s\n",
+            received, otaStatus.totalBytes, otaStatus.progressPercent, speed);
 
-        // Evita di bloccare troppo il loop principale
-        if (processed >= 32) break;
-        if (millis() - startMs >= 10) break;
+        notifyProgress();
+        lastProgressBytes = received;
+    }
+
+    // Se ricezione completa, passa automaticamente a verifica
+    if (writerDone) {
+        Serial.println("[OTA] All data received! Verifying...");
+        handleVerifyCommand();
     }
 }
 
@@ -344,9 +848,11 @@ bool OTAManager::checkTimeout() {
         }
     }
 
-    // Timeout in attesa del primo chunk (30 secondi)
+    // Timeout in attesa del primo chunk (30 secondi). lastChunkTime parte da
+    // startTime e avanza con le scritture flash: un primo chunk delta con un
+    // COPY lungo resta in WAITING finché il writer non lo ha applicato tutto
     if (otaStatus.state == OTAState::WAITING) {
-        if (now - otaStatus.startTime > OTA_WAITING_TIMEOUT_MS) {
+        if (now - otaStatus.lastChunkTime > OTA_WAITING_TIMEOUT_MS) {
             setError("No data received (30s timeout)");
             executeAbortCommand();
             return true;
@@ -365,88 +871,58 @@ bool OTAManager::checkTimeout() {
     return false;
 }
 
-// ============================================================================
-// CRC32 CALCULATION
-// ============================================================================
-
-uint32_t OTAManager::crc32Calculate(const uint8_t* data, size_t length) {
-    // Tabella CRC32 standard (IEEE 802.3)
-    static const uint32_t crc32_table[256] = {
-        0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
-        0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
-        0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
-        0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
-        0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec, 0x14015c4f, 0x63066cd9,
-        0xfa0f3d63, 0x8d080df5, 0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172,
-        0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b, 0x35b5a8fa, 0x42b2986c,
-        0xdbbbc9d6, 0xacbcf940, 0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
-        0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423,
-        0xcfba9599, 0xb8bda50f, 0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
-        0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d, 0x76dc4190, 0x01db7106,
-        0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
-        0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818, 0x7f6a0dbb, 0x086d3d2d,
-        0x91646c97, 0xe6635c01, 0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e,
-        0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457, 0x65b0d9c6, 0x12b7e950,
-        0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
-        0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2, 0x4adfa541, 0x3dd895d7,
-        0xa4d1c46d, 0xd3d6f4fb, 0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0,
-        0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9, 0x5005713c, 0x270241aa,
-        0xbe0b1010, 0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
-        0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17, 0x2eb40d81,
-        0xb7bd5c3b, 0xc0ba6cad, 0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a,
-        0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683, 0xe3630b12, 0x94643b84,
-        0x0d6d6a3e, 0x7a6a5aa8, 0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
-        0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb,
-        0x196c3671, 0x6e6b06e7, 0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc,
-        0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5, 0xd6d6a3e8, 0xa1d1937e,
-        0x38d8c2c4, 0x4fdff252, 0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
-        0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55,
-        0x316e8eef, 0x4669be79, 0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
-        0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f, 0xc5ba3bbe, 0xb2bd0b28,
-        0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
-        0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a, 0x9c0906a9, 0xeb0e363f,
-        0x72076785, 0x05005713, 0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38,
-        0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21, 0x86d3d2d4, 0xf1d4e242,
-        0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
-        0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c, 0x8f659eff, 0xf862ae69,
-        0x616bffd3, 0x166ccf45, 0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2,
-        0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db, 0xaed16a4a, 0xd9d65adc,
-        0x40df0b66, 0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
-        0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605, 0xcdd70693,
-        0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
-        0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
-    };
-
-    uint32_t crc = 0xFFFFFFFF;
-    for (size_t i = 0; i < length; i++) {
-        crc = crc32_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
-    }
-    return ~crc;
-}
-
 // ============================================================================
 // GESTIONE COMANDI - SCHEDULING (chiamati dal callback BLE)
 // ============================================================================
 
-void OTAManager::scheduleStartCommand(uint32_t firmwareSize) {
-    Serial.printf("[OTA] START command scheduled (size=%u bytes, %.2f KB)\n",
-        firmwareSize, firmwareSize / 1024.0f);
+void OTAManager::scheduleStartCommand(uint32_t firmwareSize, const OTAStreamParams& stream) {
+    Serial.printf("[OTA] START command scheduled (size=%u bytes, %.2f KB, window=%u, encoding=%u)\n",
+        firmwareSize, firmwareSize / 1024.0f, stream.window, (unsigned)stream.encoding);
 
-    // Validazioni rapide che possiamo fare nel callback
-    if (otaStatus.state != OTAState::IDLE && otaStatus.state != OTAState::ERROR) {
+    // Validazioni rapide che possiamo fare nel callback. Una ripresa può
+    // subentrare alla sessione rimasta aperta dopo la disconnessione del client
+    const bool resume = stream.resumeOffset > 0;
+    const bool takeover = resume &&
+        (otaStatus.state == OTAState::WAITING || otaStatus.state == OTAState::RECEIVING);
+    if (otaStatus.state != OTAState::IDLE && otaStatus.state != OTAState::ERROR && !takeover) {
         setError("OTA already in progress");
         return;
     }
 
-    if (!validateFirmwareSize(firmwareSize)) {
+    OTAStreamParams params = stream;
+    if (resume && (!params.hasSha256 || params.window == 0)) {
+        setError("Resume requires windowed transfer with SHA-256");
+        return;
+    }
+    if (params.encoding == OTAEncoding::RAW && !resume) {
+        params.imageSize = firmwareSize;
+    } else if (params.encoding == OTAEncoding::RAW) {
+        if (params.resumeOffset >= params.imageSize ||
+            firmwareSize != params.imageSize - params.resumeOffset) {
+            setError("Invalid resume size");
+            return;
+        }
+    } else if (params.window == 0 || firmwareSize == 0) {
+        setError("Compressed OTA requires windowed transfer");
+        return;
+    }
+
+    if (params.encoding == OTAEncoding::DELTA && params.sourceSize == 0) {
+        setError("Delta OTA without base");
+        return;
+    }
+
+    if (!validateFirmwareSize(params.imageSize)) {
         setError("Invalid firmware size");
         return;
     }
 
     // Schedula per esecuzione nel loop principale
-    // NON impostare stato WAITING qui! Lo farà executeStartCommand dopo esp_ota_begin
+    // NON impostare stato WAITING qui! Lo farà executeStartCommand dopo aver aperto la sessione
     pendingCmd.startPending = true;
     pendingCmd.startFirmwareSize = firmwareSize;
+    pendingCmd.startStream = params;
+    EventDispatcher::getInstance().post(EventDispatcher::EVENT_OTA_DATA);
 
     Serial.println("[OTA] Command queued, waiting for main loop to execute...");
 }
@@ -454,6 +930,7 @@ void OTAManager::scheduleStartCommand(uint32_t firmwareSize) {
 void OTAManager::scheduleAbortCommand() {
     Serial.println("[OTA] ABORT command scheduled");
     pendingCmd.abortPending = true;
+    EventDispatcher::getInstance().post(EventDispatcher::EVENT_OTA_DATA);
 }
 
 // ============================================================================
@@ -461,11 +938,12 @@ void OTAManager::scheduleAbortCommand() {
 // ============================================================================
 
 void OTAManager::processPendingCommands() {
-    // Processa START (operazione pesante - esp_ota_begin erasa flash)
+    // Processa START (operazione pesante - verifica base delta / rilettura per ripresa)
     if (pendingCmd.startPending) {
         Serial.println("[OTA] Processing pending START command...");
         pendingCmd.startPending = false;
-        executeStartCommand(pendingCmd.startFirmwareSize);
+        const OTAStreamParams stream = pendingCmd.startStream;
+        executeStartCommand(pendingCmd.startFirmwareSize, stream);
     }
 
     // Processa ABORT
@@ -473,13 +951,76 @@ void OTAManager::processPendingCommands() {
         Serial.println("[OTA] Processing pending ABORT command...");
         pendingCmd.abortPending = false;
         executeAbortCommand();
+        // ABORT esplicito del client: la sessione non verrà ripresa
+        clearResumeRecord();
     }
 }
 
-void OTAManager::executeStartCommand(uint32_t firmwareSize) {
+void OTAManager::executeStartCommand(uint32_t firmwareSize, const OTAStreamParams& stream) {
     Serial.printf("[OTA] Executing START (size=%u bytes)\n", firmwareSize);
 
-    if (preOtaCallback) {
+    if (!flashTask) {
+        setError("OTA flash task not running");
+        return;
+    }
+
+    const OTAEncoding encoding = stream.encoding;
+    const uint8_t codecParam = stream.codecParam;
+    if (encoding != OTAEncoding::RAW && encoding != OTAEncoding::HEATSHRINK &&
+        encoding != OTAEncoding::DELTA) {
+        setError("Unsupported OTA encoding");
+        return;
+    }
+
+    // Ripresa con la sessione ancora aperta (client riconnesso prima del
+    // timeout): chiude la vecchia, salvando i settori scritti. Camera già
+    // fermata, quindi niente preOtaCallback
+    const uint32_t resumeOffset = stream.resumeOffset;
+    const bool takeover = resumeOffset > 0 && isOTAInProgress();
+    if (takeover) {
+        Serial.println("[OTA] Resume takes over the interrupted session");
+        resetOTAState();
+    }
+
+    // Ottieni partizione di aggiornamento
+    updatePartition = esp_ota_get_next_update_partition(nullptr);
+    if (!updatePartition) {
+        setError("No update partition");
+        return;
+    }
+
+    // Ripresa valida solo sulla stessa immagine, nella stessa partizione e
+    // entro i settori registrati come scritti
+    if (resumeOffset > 0) {
+        OTAResumeRecord record;
+        if (!loadResumeRecord(record) ||
+            memcmp(record.sha256, stream.sha256, sizeof(record.sha256)) != 0 ||
+            record.imageSize != stream.imageSize ||
+            record.partitionAddress != updatePartition->address ||
+            resumeOffset > record.committed || resumeOffset % OTA_FLASH_BLOCK_SIZE != 0) {
+            setError("Resume offset not available");
+            if (takeover && postOtaCallback) {
+                Serial.println("[OTA] Executing post-OTA (error) callback...");
+                postOtaCallback();
+            }
+            return;
+        }
+        resumeCommitted = record.committed;
+        Serial.printf("[OTA] Resuming at %u/%u bytes (committed %u)\n",
+            resumeOffset, stream.imageSize, record.committed);
+    }
+
+    // Prima di fermare la camera e scrivere la flash: il client ripiega sull'immagine intera
+    if (encoding == OTAEncoding::DELTA && !verifyDeltaSource(stream.sourceSize, stream.sourceCrc32)) {
+        setError("Delta base mismatch");
+        if (takeover && postOtaCallback) {
+            Serial.println("[OTA] Executing post-OTA (error) callback...");
+            postOtaCallback();
+        }
+        return;
+    }
+
+    if (preOtaCallback && !takeover) {
         Serial.println("[OTA] Executing pre-OTA callback...");
         preOtaCallback();
     }
@@ -496,24 +1037,20 @@ void OTAManager::executeStartCommand(uint32_t firmwareSize) {
         return;
     }
 
-    // Ottieni partizione di aggiornamento
-    updatePartition = esp_ota_get_next_update_partition(nullptr);
-    if (!updatePartition) {
-        setError("No update partition");
-        return;
-    }
-
-    Serial.println("[OTA] Calling esp_ota_begin...");
-
-    // Usa OTA_SIZE_UNKNOWN per evitare l'erase iniziale della flash
-    // L'erase avverrà incrementalmente durante la scrittura dei chunk
-    // Questo evita il blocco prolungato che causa la disconnessione BLE
-    esp_err_t err = esp_ota_begin(updatePartition, OTA_SIZE_UNKNOWN, &otaHandle);
-    if (err != ESP_OK) {
-        setError("esp_ota_begin failed: " + String(esp_err_to_name(err)));
-        return;
+    if (encoding != OTAEncoding::RAW) {
+        // Finestra del decoder allocata ora: la camera è già stata fermata da preOtaCallback
+        if (!decoder.begin(codecParam >> 4, codecParam & 0x0F)) {
+            setError("Invalid compression parameters");
+            if (postOtaCallback) {
+                Serial.println("[OTA] Executing post-OTA (error) callback...");
+                postOtaCallback();
+            }
+            return;
+        }
+        Serial.printf("[OTA] Compressed stream: %u -> %u bytes (heatshrink w=%u l=%u%s)\n",
+            firmwareSize, stream.imageSize - resumeOffset, codecParam >> 4, codecParam & 0x0F,
+            encoding == OTAEncoding::DELTA ? ", delta" : "");
     }
-    Serial.println("[OTA] esp_ota_begin completed successfully");
 
     // Reset contatori e imposta stato
     otaStatus.totalBytes = firmwareSize;
@@ -523,22 +1060,82 @@ void OTAManager::executeStartCommand(uint32_t firmwareSize) {
     otaStatus.startTime = millis();
     otaStatus.lastChunkTime = millis();
     otaStatus.errorMessage = "";
+    lastProgressBytes = 0;
+
+    // Apre la sessione del writer: da qui i chunk in coda vengono scritti
+    xSemaphoreTake(flashMutex, portMAX_DELAY);
+    xQueueReset(rxQueue);
+    rxQueueError = 0;
+    flashBufferLen = 0;
+    writerDone = false;
+    writerError = ESP_OK;
+    windowSize = min<uint8_t>(stream.window, OTA_WINDOW_MAX);
+    rxExpectedSeq = 0;
+    rxAcceptedOffset = 0;
+    nackQueued = false;
+    ackQueued = false;
+    ackSeq = 0;
+    chunksSinceAck = 0;
+    windowed = windowSize > 0;
+    streamEncoding = encoding;
+    imageBytes = stream.imageSize;
+    imageWritten = resumeOffset;
+    imageFlushed = resumeOffset;
+    if (encoding == OTAEncoding::DELTA) {
+        patcher.begin(stream.sourceSize, readSourcePartition, this);
+    }
+    releaseImageSha();
+    mbedtls_sha256_init(&imageSha);
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+    mbedtls_sha256_starts(&imageSha, 0);
+#else
+    mbedtls_sha256_starts_ret(&imageSha, 0);
+#endif
+    imageShaActive = true;
+    expectSha256 = stream.hasSha256;
+    memcpy(expectedSha256, stream.sha256, sizeof(expectedSha256));
+    checksumMicros = 0;
+    // Ripresa: CRC e SHA ripartono dai settori già in flash
+    const bool rehashed = rehashFlashedImage(resumeOffset);
+    if (rehashed && expectSha256) {
+        if (resumeOffset == 0) {
+            resumeCommitted = 0;
+            saveResumeRecord(0);
+        }
+        resumeRecordActive = true;
+    } else if (resumeOffset == 0) {
+        // Immagine senza digest: non ripristinabile, il record vecchio non vale più
+        clearResumeRecord();
+    }
+    flashSessionOpen = rehashed;
+    xSemaphoreGive(flashMutex);
+
+    if (!rehashed) {
+        resetOTAState();
+        setError("Resume read failed");
+        if (postOtaCallback) {
+            Serial.println("[OTA] Executing post-OTA (error) callback...");
+            postOtaCallback();
+        }
+        return;
+    }
 
-    // ORA impostiamo WAITING - dopo che esp_ota_begin è completato con successo!
+    // ORA impostiamo WAITING - dopo che la sessione del writer è aperta
     setState(OTAState::WAITING);
     notifyProgress();
 
+    if (windowed) {
+        // ACK iniziale: comunica al client la finestra effettiva
+        sendAck(OTAAckType::ACK, 0, 0);
+        Serial.printf("[OTA] Windowed transfer (window=%u chunks)\n", windowSize);
+    }
+
     Serial.println("[OTA] Ready to receive firmware data");
 }
 
 void OTAManager::executeAbortCommand() {
     Serial.println("[OTA] Executing ABORT");
 
-    if (otaHandle) {
-        esp_ota_end(otaHandle);
-        otaHandle = 0;
-    }
-
     resetOTAState();
     setState(OTAState::IDLE);
 
@@ -558,17 +1155,53 @@ void OTAManager::handleVerifyCommand() {
 
     setState(OTAState::VERIFYING);
 
-    // Finalizza scrittura OTA
-    esp_err_t err = esp_ota_end(otaHandle);
-    otaHandle = 0;
+    // Chiude la sessione del writer e scrive l'ultimo blocco parziale
+    xSemaphoreTake(flashMutex, portMAX_DELAY);
+    esp_err_t err = ESP_OK;
+    if (flashBufferLen > 0 && !flushFlashBuffer()) {
+        err = writerError;
+    }
+    flashSessionOpen = false;
+    windowed = false;
+    uint8_t digest[32] = {0};
+    if (imageShaActive) {
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+        mbedtls_sha256_finish(&imageSha, digest);
+#else
+        mbedtls_sha256_finish_ret(&imageSha, digest);
+#endif
+    }
+    releaseImageSha();
+    if (err == ESP_OK && imageFlushed != imageBytes) {
+        err = ESP_ERR_INVALID_SIZE;
+    }
+    // Immagine completa (o da scartare): la sessione non è più ripristinabile
+    if (resumeRecordActive) {
+        clearResumeRecord();
+    }
+    writerDone = false;
+    decoder.end();
+    patcher.end();
+    xQueueReset(rxQueue);
+    xSemaphoreGive(flashMutex);
 
     if (err != ESP_OK) {
         setError("OTA verification failed: " + String(esp_err_to_name(err)));
         return;
     }
 
-    // Verifica integrità (ESP-IDF fa già controlli SHA256)
-    Serial.println("[OTA] Firmware verification successful");
+    // Il digest del client garantisce che sia proprio l'immagine inviata;
+    // esp_ota_set_boot_partition ne valida poi il formato (header, segmenti, hash)
+    Serial.printf("[OTA] Checksum cost: %u us (%u us/MB)\n", checksumMicros,
+        imageWritten ? (uint32_t)((uint64_t)checksumMicros * 1048576 / imageWritten) : 0);
+    if (expectSha256 && memcmp(digest, expectedSha256, sizeof(digest)) != 0) {
+        Serial.printf("[OTA] SHA-256 %02x%02x%02x%02x... expected %02x%02x%02x%02x...\n",
+            digest[0], digest[1], digest[2], digest[3],
+            expectedSha256[0], expectedSha256[1], expectedSha256[2], expectedSha256[3]);
+        setError("Image SHA-256 mismatch");
+        return;
+    }
+    Serial.printf("[OTA] Firmware verification successful%s\n", expectSha256 ? " (SHA-256 match)" : "");
 
     // Imposta la nuova partizione come boot partition
     err = esp_ota_set_boot_partition(updatePartition);
@@ -578,8 +1211,8 @@ void OTAManager::handleVerifyCommand() {
     }
 
     setState(OTAState::READY);
-    Serial.printf("[OTA] Firmware ready! Total: %u bytes, CRC32: 0x%08X\n",
-        otaStatus.receivedBytes, otaStatus.crc32);
+    Serial.printf("[OTA] Firmware ready! Image: %u bytes (transferred %u), CRC32: 0x%08X\n",
+        imageWritten, otaStatus.receivedBytes, otaStatus.crc32);
     Serial.println("[OTA] Send REBOOT command to apply update");
 }
 
@@ -600,73 +1233,56 @@ void OTAManager::handleRebootCommand() {
 // ============================================================================
 
 void OTAManager::handleDataChunk(const uint8_t* data, size_t length) {
-    // Ignora dati se non in stato WAITING o RECEIVING
-    if (otaStatus.state != OTAState::WAITING && otaStatus.state != OTAState::RECEIVING) {
-        Serial.printf("[OTA WARNING] Data received in wrong state: %d\n", (int)otaStatus.state);
+    // Chiamato da OTAFlashTask con flashMutex preso
+    if (!flashSessionOpen || writerDone || writerError != ESP_OK) {
         return;
     }
 
-    // Primo chunk ricevuto
-    if (otaStatus.state == OTAState::WAITING) {
-        setState(OTAState::RECEIVING);
-    }
-
     // Verifica overflow
     if (otaStatus.receivedBytes + length > otaStatus.totalBytes) {
-        setError("Data overflow");
-        executeAbortCommand();
+        writerError = ESP_ERR_INVALID_SIZE;
+        EventDispatcher::getInstance().post(EventDispatcher::EVENT_OTA_DATA);
         return;
     }
 
-    // Scrivi chunk nella partizione
-    esp_err_t err = esp_ota_write(otaHandle, data, length);
-    if (err != ESP_OK) {
-        setError("OTA write failed: " + String(esp_err_to_name(err)));
-        executeAbortCommand();
-        return;
+    const bool firstChunk = otaStatus.receivedBytes == 0;
+
+    // Stream compresso: il decoder scrive nel buffer flash tramite decoderSink
+    // (delta: prima passa dal patcher, che legge la partizione in esecuzione)
+    const HeatshrinkDecoder::Sink sink = streamEncoding == OTAEncoding::DELTA ? patchSink : decoderSink;
+    const bool written = streamEncoding == OTAEncoding::RAW
+        ? writeImageData(data, length)
+        : decoder.feed(data, length, sink, this);
+    if (!written) {
+        return;  // writerError già impostato dal writer
     }
 
-    // Aggiorna stato
+    // Aggiorna stato (il loop legge receivedBytes per progresso e timeout)
     otaStatus.receivedBytes += length;
     otaStatus.lastChunkTime = millis();
 
-    // Calcola CRC32 incrementale
-    uint32_t chunkCrc = crc32Calculate(data, length);
-    otaStatus.crc32 ^= chunkCrc;  // XOR per combinare CRC progressivi
-
-    // Calcola percentuale (usa uint64_t per evitare overflow e ottenere precisione)
-    otaStatus.progressPercent = ((uint64_t)otaStatus.receivedBytes * 100) / otaStatus.totalBytes;
-
-    // Log solo ogni 50KB per ridurre drasticamente l'overhead (logging rallenta molto ESP32)
-    static uint32_t lastLogBytes = 0;
-    if (otaStatus.receivedBytes - lastLogBytes >= 51200 ||
-        otaStatus.receivedBytes == otaStatus.totalBytes) {
-
-        uint32_t elapsed = millis() - otaStatus.startTime;
-        float speed = 0.0f;
-        if (elapsed > 0) {
-            speed = (otaStatus.receivedBytes / 1024.0f) / (elapsed / 1000.0f);  // KB/s
-        }
-
-        Serial.printf("[OTA] Total: %u/%u (%u%%) | Speed: %.2f KB/s\n",
-            otaStatus.receivedBytes, otaStatus.totalBytes,
-            otaStatus.progressPercent, speed);
-
-        lastLogBytes = otaStatus.receivedBytes;
-    }
-
-    // Notifica progresso ogni 50KB (ridotto overhead per velocizzare trasferimento)
-    static uint32_t lastNotifyBytes = 0;
-    if (otaStatus.receivedBytes - lastNotifyBytes >= 51200 ||
-        otaStatus.receivedBytes == otaStatus.totalBytes) {
-        notifyProgress();
-        lastNotifyBytes = otaStatus.receivedBytes;
-    }
-
-    // Se ricezione completa, passa automaticamente a verifica
     if (otaStatus.receivedBytes >= otaStatus.totalBytes) {
-        Serial.println("[OTA] All data received! Verifying...");
-        handleVerifyCommand();
+        if (streamEncoding != OTAEncoding::RAW && !decoder.flush(sink, this)) {
+            return;
+        }
+        if (streamEncoding == OTAEncoding::DELTA && !patcher.isComplete()) {
+            writerError = ESP_ERR_INVALID_ARG;
+            EventDispatcher::getInstance().post(EventDispatcher::EVENT_OTA_DATA);
+            return;
+        }
+        if (imageWritten != imageBytes) {
+            writerError = ESP_ERR_INVALID_STATE;
+            EventDispatcher::getInstance().post(EventDispatcher::EVENT_OTA_DATA);
+            return;
+        }
+        if (!flushFlashBuffer()) {
+            return;
+        }
+        writerDone = true;
+        EventDispatcher::getInstance().post(EventDispatcher::EVENT_OTA_DATA);
+    } else if (firstChunk || otaStatus.receivedBytes - lastProgressBytes >= 51200) {
+        // Il loop gestisce passaggio a RECEIVING e notify progresso
+        EventDispatcher::getInstance().post(EventDispatcher::EVENT_OTA_DATA);
     }
 }
 
@@ -678,8 +1294,8 @@ void OTAManager::update() {
     // Processa comandi pendenti (eseguiti fuori dal callback BLE)
     processPendingCommands();
 
-    // Processa dati OTA ricevuti via BLE
-    processRxQueue();
+    // Stato del writer flash (primo chunk, progresso, fine dati, errori)
+    processWriterEvents();
 
     // Controlla timeout
     checkTimeout();
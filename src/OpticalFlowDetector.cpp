@@ -20,6 +20,15 @@ OpticalFlowDetector::OpticalFlowDetector()
     , _minCentroidWeight(100.0f)
     , _motionIntensityThreshold(6)        // Ridotto a 6 per rilevare movimenti fluidi (logs: ~7-10)
     , _motionSpeedThreshold(0.4f)         // Ridotto a 0.4 per rilevare inizio movimento (logs: ~0.7)
+    , _mountAngle(0)
+    , _mountCosQ14(16384)
+    , _mountSinQ14(0)
+    , _calibrationState(CalibrationState::IDLE)
+    , _calibrationStartMs(0)
+    , _calibrationSumX(0)
+    , _calibrationSumY(0)
+    , _calibrationSumAbs(0)
+    , _calibrationFrames(0)
     , _hasPreviousFrame(false)
     , _motionActive(false)
     , _motionIntensity(0)
@@ -33,6 +42,7 @@ OpticalFlowDetector::OpticalFlowDetector()
     , _centroidY(0.0f)
     , _centroidValid(false)
     , _centroidSeeded(false)
+    , _trajectoryHead(0)
     , _trajectoryLength(0)
     , _flashIntensity(200)  // Flash default attivo (era 0)
     , _avgBrightness(0)
@@ -53,6 +63,7 @@ OpticalFlowDetector::OpticalFlowDetector()
 {
     memset(_motionVectors, 0, sizeof(_motionVectors));
     memset(_trajectory, 0, sizeof(_trajectory));
+    _resetNoiseModel();
 }
 
 OpticalFlowDetector::~OpticalFlowDetector() {
@@ -81,11 +92,12 @@ static void computeEdgeImage(const uint8_t* src,
                              int offsetX,
                              int offsetY,
                              int step,
-                             int outStep) {
+                             int outStep,
+                             int threshold) {
     // Pulisci il buffer (bordi a 0)
     memset(dst, 0, width * height);
     
-    const int threshold = 40; // SOGLIA RUMORE: piu' permissiva per rilevare contorni deboli
+    // threshold: soglia rumore sul gradiente, dal modello di rumore del detector
     
     // Calcola gradiente per ogni pixel (esclusi i bordi estremi)
     for (uint16_t y = 0; y < height - 1; y += outStep) {
@@ -249,14 +261,20 @@ bool OpticalFlowDetector::processFrame(const uint8_t* frameBuffer, size_t frameL
         _avgBrightness = _calculateAverageBrightness(frameBuffer, srcFullWidth, offsetX, offsetY);
         _updateFlashIntensity();
 
-        // Calcola movimento tramite centroide
-        _computeCentroidMotion(frameBuffer, srcFullWidth, offsetX, offsetY);
+        // Calcola movimento tramite centroide (rumore aggiornato solo a scena ferma)
+        const uint8_t diffMean = _computeCentroidMotion(frameBuffer, srcFullWidth, offsetX, offsetY);
+        if (!_motionActive) {
+            _updateNoise(_pixelNoiseQ4, diffMean);
+        }
+        _applyMountRotation();
 
         // Filtra e aggiorna stato globale (simile a optical flow ma semplificato)
         // Nota: _computeCentroidMotion ha già popolato _motionVectors con un vettore globale
         _calculateGlobalMotion(); 
+        _updateMountCalibration();
 
         // Aggiorna traiettoria
+        _tracker.predict();
         if (_motionActive) {
             _calculateCentroid(); // Usa i vettori popolati uniformemente
             _updateTrajectory();
@@ -287,7 +305,7 @@ bool OpticalFlowDetector::processFrame(const uint8_t* frameBuffer, size_t frameL
     // 2. Calcola i bordi dal frame grezzo
     const int edgeStep = 2; // Allinea il calcolo bordi al campionamento SAD
     computeEdgeImage(frameBuffer, edgeFrame, _frameWidth, _frameHeight,
-                     srcFullWidth, offsetX, offsetY, step, edgeStep);
+                     srcFullWidth, offsetX, offsetY, step, edgeStep, _edgeGate());
 
     // Primo frame: inizializza previous e non rilevare motion
     if (!_hasPreviousFrame) {
@@ -318,6 +336,10 @@ bool OpticalFlowDetector::processFrame(const uint8_t* frameBuffer, size_t frameL
     // Usa raw per evitare che la mappa dei bordi risulti troppo "vuota".
     _frameDiffAvg = _calculateFrameDiffAvg(frameBuffer, _previousRawFrame,
                                            srcFullWidth, offsetX, offsetY);
+    if (!_motionActive) {
+        // Stato del frame precedente: a scena ferma la differenza è solo rumore
+        _updateNoise(_pixelNoiseQ4, _frameDiffAvg);
+    }
     
     // Calcola optical flow
     // NOTA: Usiamo edgeFrame. _computeOpticalFlow confronterà edgeFrame con _previousFrame (che contiene i bordi precedenti)
@@ -326,20 +348,26 @@ bool OpticalFlowDetector::processFrame(const uint8_t* frameBuffer, size_t frameL
     // Filtra outliers
     _filterOutliers();
 
+    // Riferimento di montaggio: da qui in poi i vettori sono nel riferimento lama
+    _applyMountRotation();
+
     // Calcola movimento globale
     _calculateGlobalMotion();
 
     // Fallback: se l'edge flow non attiva motion ma il frame raw cambia,
     // usa il centroid tracking sul raw per aumentare la sensibilita'.
-    if (_frameDiffAvg >= 10) {
+    if (_frameDiffAvg >= _frameDiffGate()) {
         const bool edgeWeak = (_activeBlocks < _minActiveBlocks) || (_motionConfidence < 0.2f);
         if (!_motionActive || edgeWeak) {
             _computeCentroidMotion(frameBuffer, srcFullWidth, offsetX, offsetY);
+            _applyMountRotation();
             _calculateGlobalMotion();
         }
     }
+    _updateMountCalibration();
 
-    // Calcola centroide se c'è movimento
+    // Calcola centroide se c'è movimento (il filtro avanza comunque di un frame)
+    _tracker.predict();
     if (_motionActive) {
         _calculateCentroid();
         _updateTrajectory();
@@ -349,7 +377,9 @@ bool OpticalFlowDetector::processFrame(const uint8_t* frameBuffer, size_t frameL
         // Reset traiettoria se fermo per troppo tempo
         if (_trajectoryLength > 0 && (millis() - _lastMotionTime) > 1000) {
             _trajectoryLength = 0;
+            _trajectoryHead = 0;
             _centroidValid = false;
+            _tracker.reset();
         }
     }
 
@@ -370,24 +400,26 @@ bool OpticalFlowDetector::processFrame(const uint8_t* frameBuffer, size_t frameL
     return _motionActive;
 }
 
-void OpticalFlowDetector::_computeCentroidMotion(const uint8_t* currentFrame,
+uint8_t OpticalFlowDetector::_computeCentroidMotion(const uint8_t* currentFrame,
                                                  int currentFullWidth,
                                                  int offsetX,
                                                  int offsetY) {
     long sumX = 0;
     long sumY = 0;
     long totalMass = 0;
+    long totalDiff = 0;
     
     // Campionamento sparso per velocità (1 pixel ogni 4x4 = 16 pixel)
     // Sufficiente per rilevare oggetti vicini/grandi
     const int step = 4; 
-    const int threshold = 25; // Soglia minima differenza pixel
+    const int threshold = _pixelDiffGate(); // Soglia minima differenza pixel
 
     for (int y = 0; y < _frameHeight; y += step) {
         for (int x = 0; x < _frameWidth; x += step) {
             int currentIdx = (offsetY + y) * currentFullWidth + (offsetX + x);
             int prevIdx = y * _frameWidth + x;
             int diff = abs((int)currentFrame[currentIdx] - (int)_previousRawFrame[prevIdx]);
+            totalDiff += diff;
 
             if (diff > threshold) {
                 sumX += x * diff;
@@ -399,10 +431,11 @@ void OpticalFlowDetector::_computeCentroidMotion(const uint8_t* currentFrame,
 
     // Reset griglia vettori
     memset(_motionVectors, 0, sizeof(_motionVectors));
-    _frameDiffAvg = (uint8_t)min((long)255, totalMass / (long)(_frameWidth * _frameHeight / (step*step)));
+    const long samples = (long)(_frameWidth * _frameHeight / (step*step));
+    _frameDiffAvg = (uint8_t)min((long)255, totalMass / samples);
 
-    // Se c'è abbastanza "massa" di movimento
-    if (totalMass > 5000) {
+    // Se c'è abbastanza "massa" di movimento (in scala con la soglia)
+    if (totalMass > (long)CENTROID_MASS_PER_GATE * threshold) {
         float currentCx = (float)sumX / totalMass;
         float currentCy = (float)sumY / totalMass;
 
@@ -421,6 +454,8 @@ void OpticalFlowDetector::_computeCentroidMotion(const uint8_t* currentFrame,
                 for (uint8_t col = 0; col < GRID_COLS; col++) {
                     _motionVectors[row][col].dx = (int8_t)constrain(dx, -127, 127);
                     _motionVectors[row][col].dy = (int8_t)constrain(dy, -127, 127);
+                    _motionVectors[row][col].dxQ4 = (int16_t)constrain(lroundf(dx * 16.0f), -2032L, 2032L);
+                    _motionVectors[row][col].dyQ4 = (int16_t)constrain(lroundf(dy * 16.0f), -2032L, 2032L);
                     _motionVectors[row][col].confidence = 200; // Alta fiducia sintetica
                     _motionVectors[row][col].valid = true;
                 }
@@ -435,6 +470,7 @@ void OpticalFlowDetector::_computeCentroidMotion(const uint8_t* currentFrame,
     } else {
         _centroidValid = false; // Movimento perso o fermo
     }
+    return (uint8_t)min((long)255, totalDiff / samples);
 }
 
 void OpticalFlowDetector::_computeOpticalFlow(const uint8_t* currentFrame) {
@@ -462,10 +498,17 @@ void OpticalFlowDetector::_calculateBlockMotion(uint8_t row, uint8_t col, const
     );
 
     // PER-BLOCK NOISE GATE: Ignora blocchi che non sono cambiati significativamente
-    if (minSAD < BLOCK_NOISE_THRESHOLD) {
+    // (soglia dal rumore misurato sul blocco, aggiornato solo a scena ferma)
+    const uint16_t noiseGate = _blockNoiseGate(row, col);
+    if (!_motionActive) {
+        _updateNoise(_blockNoiseQ4[row][col], minSAD);
+    }
+    if (minSAD < noiseGate) {
         BlockMotionVector& vec = _motionVectors[row][col];
         vec.dx = 0;
         vec.dy = 0;
+        vec.dxQ4 = 0;
+        vec.dyQ4 = 0;
         vec.sad = minSAD;
         vec.confidence = 0;
         vec.valid = false; // Ignora blocco statico
@@ -508,8 +551,6 @@ void OpticalFlowDetector::_calculateBlockMotion(uint8_t row, uint8_t col, const
 
     // Store vector
     BlockMotionVector& vec = _motionVectors[row][col];
-    vec.dx = bestDx;
-    vec.dy = bestDy;
     vec.sad = minSAD;
 
     // Confidence: inverso di SAD normalizzato
@@ -517,6 +558,45 @@ void OpticalFlowDetector::_calculateBlockMotion(uint8_t row, uint8_t col, const
     uint32_t maxSAD = BLOCK_SIZE * BLOCK_SIZE * 255;
     vec.confidence = 255 - min((uint32_t)255, (minSAD * 255) / (maxSAD / 10));
     vec.valid = (vec.confidence >= _minConfidence);
+
+    // Sub-pixel: la ricerca a passo _searchStep quantizza a 2 px e a 30 FPS i
+    // movimenti lenti finiscono tutti a 0. SAD esatto dei 4 vicini del minimo
+    // (quelli della ricerca sono troncati dall'early exit) e vertice della parabola.
+    int16_t offsetXQ4 = 0;
+    int16_t offsetYQ4 = 0;
+    if (vec.valid) {
+        auto sadAt = [&](int16_t dx, int16_t dy) -> uint16_t {
+            const int16_t x = blockX + dx;
+            const int16_t y = blockY + dy;
+            if (x < 0 || y < 0 || x + BLOCK_SIZE > _frameWidth || y + BLOCK_SIZE > _frameHeight) {
+                return UINT16_MAX;
+            }
+            return _computeSAD(_previousFrame, currentFrame, blockX, blockY, x, y, BLOCK_SIZE, UINT16_MAX);
+        };
+        offsetXQ4 = _subPixelOffsetQ4(sadAt(bestDx - _searchStep, bestDy), minSAD,
+                                      sadAt(bestDx + _searchStep, bestDy), _searchStep);
+        offsetYQ4 = _subPixelOffsetQ4(sadAt(bestDx, bestDy - _searchStep), minSAD,
+                                      sadAt(bestDx, bestDy + _searchStep), _searchStep);
+    }
+    vec.dxQ4 = (int16_t)(bestDx * 16 + offsetXQ4);
+    vec.dyQ4 = (int16_t)(bestDy * 16 + offsetYQ4);
+    vec.dx = (int8_t)constrain((vec.dxQ4 + (vec.dxQ4 >= 0 ? 8 : -8)) / 16, -127, 127);
+    vec.dy = (int8_t)constrain((vec.dyQ4 + (vec.dyQ4 >= 0 ? 8 : -8)) / 16, -127, 127);
+}
+
+int16_t OpticalFlowDetector::_subPixelOffsetQ4(uint16_t sadMinus, uint16_t sadCenter, uint16_t sadPlus, uint8_t step) {
+    // Un vicino fuori frame (UINT16_MAX) o un minimo piatto: nessuna correzione
+    if (sadMinus == UINT16_MAX || sadPlus == UINT16_MAX) {
+        return 0;
+    }
+    const int32_t curvature = (int32_t)sadMinus + (int32_t)sadPlus - 2 * (int32_t)sadCenter;
+    if (curvature <= 0) {
+        return 0;
+    }
+    // Vertice: step * (S- - S+) / (2 * curvatura), in Q4
+    const int32_t maxOffset = (int32_t)step * 8;
+    const int32_t offset = ((int32_t)sadMinus - (int32_t)sadPlus) * (int32_t)step * 8 / curvature;
+    return (int16_t)constrain(offset, -maxOffset, maxOffset);
 }
 
 uint16_t OpticalFlowDetector::_computeSAD(
@@ -587,6 +667,98 @@ void OpticalFlowDetector::_filterOutliers() {
     }
 }
 
+void OpticalFlowDetector::_applyMountRotation() {
+    if (_mountAngle == 0) {
+        return;
+    }
+    const int32_t c = _mountCosQ14;
+    const int32_t s = _mountSinQ14;
+    for (uint8_t row = 0; row < GRID_ROWS; row++) {
+        for (uint8_t col = 0; col < GRID_COLS; col++) {
+            BlockMotionVector& vec = _motionVectors[row][col];
+            if (!vec.valid) {
+                continue;
+            }
+            // x' = x cos - y sin, y' = x sin + y cos (orario con y verso il basso)
+            const int32_t x = vec.dxQ4;
+            const int32_t y = vec.dyQ4;
+            const int32_t rx = constrain((x * c - y * s + 8192) >> 14, -2032L, 2032L);
+            const int32_t ry = constrain((x * s + y * c + 8192) >> 14, -2032L, 2032L);
+            vec.dxQ4 = (int16_t)rx;
+            vec.dyQ4 = (int16_t)ry;
+            vec.dx = (int8_t)((rx + (rx >= 0 ? 8 : -8)) / 16);
+            vec.dy = (int8_t)((ry + (ry >= 0 ? 8 : -8)) / 16);
+        }
+    }
+}
+
+void OpticalFlowDetector::_updateMountCalibration() {
+    if (_calibrationState != CalibrationState::RUNNING) {
+        return;
+    }
+
+    if (_motionActive) {
+        // Somma pesata dei flussi: la media sul gesto è il "su" visto dalla camera
+        int32_t frameX = 0;
+        int32_t frameY = 0;
+        int32_t frameW = 0;
+        for (uint8_t row = 0; row < GRID_ROWS; row++) {
+            for (uint8_t col = 0; col < GRID_COLS; col++) {
+                const BlockMotionVector& vec = _motionVectors[row][col];
+                if (vec.valid) {
+                    frameX += vec.dxQ4 * vec.confidence;
+                    frameY += vec.dyQ4 * vec.confidence;
+                    frameW += vec.confidence;
+                }
+            }
+        }
+        if (frameW > 0) {
+            frameX /= frameW;
+            frameY /= frameW;
+            _calibrationSumX += frameX;
+            _calibrationSumY += frameY;
+            _calibrationSumAbs += (int32_t)sqrtf((float)(frameX * frameX + frameY * frameY));
+            if (_calibrationFrames < UINT8_MAX) {
+                _calibrationFrames++;
+            }
+        }
+        return;
+    }
+
+    if (_calibrationFrames < CALIBRATION_MIN_FRAMES) {
+        // Gesto non ancora iniziato (o troppo breve): attendi fino al timeout
+        if (millis() - _calibrationStartMs > CALIBRATION_TIMEOUT_MS) {
+            _calibrationState = CalibrationState::FAILED;
+            Serial.println("[OPTICAL FLOW] Mount calibration failed: no gesture");
+        }
+        _calibrationSumX = 0;
+        _calibrationSumY = 0;
+        _calibrationSumAbs = 0;
+        _calibrationFrames = 0;
+        return;
+    }
+
+    // Fine gesto: un colpo dritto ha somma vettoriale ~ somma dei moduli
+    const float sumX = (float)_calibrationSumX;
+    const float sumY = (float)_calibrationSumY;
+    const float net = sqrtf(sumX * sumX + sumY * sumY);
+    if (net * 100.0f < (float)_calibrationSumAbs * CALIBRATION_MIN_COHERENCE) {
+        _calibrationState = CalibrationState::FAILED;
+        Serial.printf("[OPTICAL FLOW] Mount calibration failed: incoherent gesture (%.0f%%)\n",
+                      _calibrationSumAbs > 0 ? net * 100.0f / _calibrationSumAbs : 0.0f);
+        return;
+    }
+
+    // Angolo misurato nel riferimento già ruotato; "su" è 270° con y verso il basso
+    int32_t measured = lroundf(atan2f(sumY, sumX) * 180.0f / PI);
+    int32_t angle = ((int32_t)_mountAngle + 270 - measured) % 360;
+    if (angle < 0) {
+        angle += 360;
+    }
+    _calibrationState = CalibrationState::DONE;
+    setMountAngle((uint16_t)angle);
+}
+
 void OpticalFlowDetector::_calculateGlobalMotion() {
     // Aggrega vettori validi
     float sumDx = 0.0f;
@@ -602,8 +774,9 @@ void OpticalFlowDetector::_calculateGlobalMotion() {
         for (uint8_t col = 0; col < GRID_COLS; col++) {
             BlockMotionVector& vec = _motionVectors[row][col];
             if (vec.valid) {
-                sumDx += vec.dx * vec.confidence;
-                sumDy += vec.dy * vec.confidence;
+                // Sub-pixel: i movimenti lenti non vengono azzerati dalla quantizzazione
+                sumDx += vec.dxQ4 * (1.0f / 16.0f) * vec.confidence;
+                sumDy += vec.dyQ4 * (1.0f / 16.0f) * vec.confidence;
                 sumConfidence += vec.confidence;
                 validBlocks++;
 
@@ -722,15 +895,11 @@ void OpticalFlowDetector::_calculateCentroid() {
     float centroidX = weightedX / totalWeight;
     float centroidY = weightedY / totalWeight;
 
-    // Smooth del centroide per ridurre jitter
-    const float ALPHA = 0.7f;  // Smoothing factor
-    if (_centroidValid) {
-        _centroidX = _centroidX * (1.0f - ALPHA) + centroidX * ALPHA;
-        _centroidY = _centroidY * (1.0f - ALPHA) + centroidY * ALPHA;
-    } else {
-        _centroidX = centroidX;
-        _centroidY = centroidY;
-    }
+    // Kalman a velocità costante: niente ritardo dell'EMA sui movimenti lineari
+    _tracker.update(lroundf(centroidX * 16.0f), lroundf(centroidY * 16.0f));
+    const CentroidTracker::State& state = _tracker.getState();
+    _centroidX = state.x / 16.0f;
+    _centroidY = state.y / 16.0f;
 
     _centroidValid = true;
 }
@@ -746,55 +915,36 @@ void OpticalFlowDetector::_updateTrajectory() {
     float normX = _centroidX / (float)_frameWidth;
     float normY = _centroidY / (float)_frameHeight;
 
-    // Se traiettoria vuota, aggiungi primo punto
-    if (_trajectoryLength == 0) {
-        _trajectory[0].x = normX;
-        _trajectory[0].y = normY;
-        _trajectory[0].timestamp = now;
-        _trajectory[0].intensity = _motionIntensity;
-        _trajectory[0].speed = _motionSpeed;
-        _trajectory[0].direction = _motionDirection;
-        _trajectoryLength = 1;
-        return;
-    }
-
     // Verifica distanza dall'ultimo punto
-    TrajectoryPoint& last = _trajectory[_trajectoryLength - 1];
-    float dx = normX - last.x;
-    float dy = normY - last.y;
-    float distance = sqrtf(dx * dx + dy * dy);
-
-    // Aggiungi punto solo se movimento significativo
-    const float MIN_DISTANCE = 0.03f;  // 3% del frame
-    if (distance < MIN_DISTANCE) {
-        // Aggiorna timestamp e intensità dell'ultimo punto
-        last.timestamp = now;
-        last.intensity = max(last.intensity, _motionIntensity);
-        last.speed = _motionSpeed;
-        last.direction = _motionDirection;
-        return;
+    if (_trajectoryLength > 0) {
+        TrajectoryPoint& last = _trajectory[(_trajectoryHead + MAX_TRAJECTORY_POINTS - 1) % MAX_TRAJECTORY_POINTS];
+        float dx = normX - last.x;
+        float dy = normY - last.y;
+        float distance = sqrtf(dx * dx + dy * dy);
+
+        // Aggiungi punto solo se movimento significativo
+        const float MIN_DISTANCE = 0.03f;  // 3% del frame
+        if (distance < MIN_DISTANCE) {
+            // Aggiorna timestamp e intensità dell'ultimo punto
+            last.timestamp = now;
+            last.intensity = max(last.intensity, _motionIntensity);
+            last.speed = _motionSpeed;
+            last.direction = _motionDirection;
+            return;
+        }
     }
 
-    // Aggiungi nuovo punto se c'è spazio
+    // Scrive in testa: a buffer pieno sovrascrive il punto più vecchio
+    TrajectoryPoint& point = _trajectory[_trajectoryHead];
+    point.x = normX;
+    point.y = normY;
+    point.timestamp = now;
+    point.intensity = _motionIntensity;
+    point.speed = _motionSpeed;
+    point.direction = _motionDirection;
+    _trajectoryHead = (_trajectoryHead + 1) % MAX_TRAJECTORY_POINTS;
     if (_trajectoryLength < MAX_TRAJECTORY_POINTS) {
-        _trajectory[_trajectoryLength].x = normX;
-        _trajectory[_trajectoryLength].y = normY;
-        _trajectory[_trajectoryLength].timestamp = now;
-        _trajectory[_trajectoryLength].intensity = _motionIntensity;
-        _trajectory[_trajectoryLength].speed = _motionSpeed;
-        _trajectory[_trajectoryLength].direction = _motionDirection;
         _trajectoryLength++;
-    } else {
-        // Buffer pieno: shifta a sinistra e aggiungi in coda
-        for (uint8_t i = 0; i < MAX_TRAJECTORY_POINTS - 1; i++) {
-            _trajectory[i] = _trajectory[i + 1];
-        }
-        _trajectory[MAX_TRAJECTORY_POINTS - 1].x = normX;
-        _trajectory[MAX_TRAJECTORY_POINTS - 1].y = normY;
-        _trajectory[MAX_TRAJECTORY_POINTS - 1].timestamp = now;
-        _trajectory[MAX_TRAJECTORY_POINTS - 1].intensity = _motionIntensity;
-        _trajectory[MAX_TRAJECTORY_POINTS - 1].speed = _motionSpeed;
-        _trajectory[MAX_TRAJECTORY_POINTS - 1].direction = _motionDirection;
     }
 }
 
@@ -803,10 +953,21 @@ uint8_t OpticalFlowDetector::getTrajectory(TrajectoryPoint* outPoints) const {
         return 0;
     }
 
-    memcpy(outPoints, _trajectory, sizeof(TrajectoryPoint) * _trajectoryLength);
+    // Dal più vecchio: al massimo due tratti contigui del ring
+    const uint8_t oldest = (_trajectoryHead + MAX_TRAJECTORY_POINTS - _trajectoryLength) % MAX_TRAJECTORY_POINTS;
+    const uint8_t firstRun = min<uint8_t>(_trajectoryLength, MAX_TRAJECTORY_POINTS - oldest);
+    memcpy(outPoints, &_trajectory[oldest], sizeof(TrajectoryPoint) * firstRun);
+    memcpy(outPoints + firstRun, _trajectory, sizeof(TrajectoryPoint) * (_trajectoryLength - firstRun));
     return _trajectoryLength;
 }
 
+const OpticalFlowDetector::TrajectoryPoint* OpticalFlowDetector::getTrajectoryPoint(uint8_t age) const {
+    if (age >= _trajectoryLength) {
+        return nullptr;
+    }
+    return &_trajectory[(_trajectoryHead + MAX_TRAJECTORY_POINTS - 1 - age) % MAX_TRAJECTORY_POINTS];
+}
+
 uint8_t OpticalFlowDetector::_calculateAverageBrightness(const uint8_t* frame,
                                                          int frameFullWidth,
                                                          int offsetX,
@@ -871,6 +1032,29 @@ void OpticalFlowDetector::setMotionSpeedThreshold(float threshold) {
     Serial.printf("[OPTICAL FLOW] Motion speed threshold set: %.2f\n", _motionSpeedThreshold);
 }
 
+void OpticalFlowDetector::setMountAngle(uint16_t degrees) {
+    _mountAngle = degrees % 360;
+    const float radians = _mountAngle * PI / 180.0f;
+    _mountCosQ14 = (int16_t)lroundf(cosf(radians) * 16384.0f);
+    _mountSinQ14 = (int16_t)lroundf(sinf(radians) * 16384.0f);
+    Serial.printf("[OPTICAL FLOW] Mount angle set: %u deg\n", _mountAngle);
+}
+
+void OpticalFlowDetector::getMountRotationQ14(int16_t* outCos, int16_t* outSin) const {
+    if (outCos) *outCos = _mountCosQ14;
+    if (outSin) *outSin = _mountSinQ14;
+}
+
+void OpticalFlowDetector::startMountCalibration() {
+    _calibrationState = CalibrationState::RUNNING;
+    _calibrationStartMs = millis();
+    _calibrationSumX = 0;
+    _calibrationSumY = 0;
+    _calibrationSumAbs = 0;
+    _calibrationFrames = 0;
+    Serial.println("[OPTICAL FLOW] Mount calibration started: swing the blade up");
+}
+
 void OpticalFlowDetector::reset() {
     _motionActive = false;
     _motionIntensity = 0;
@@ -880,7 +1064,9 @@ void OpticalFlowDetector::reset() {
     _motionSpeedFilterInitialized = false;
     _motionConfidence = 0.0f;
     _activeBlocks = 0;
+    _trajectoryHead = 0;
     _trajectoryLength = 0;
+    _tracker.reset();
     _centroidX = 0.0f;
     _centroidY = 0.0f;
     _centroidValid = false;
@@ -897,6 +1083,7 @@ void OpticalFlowDetector::reset() {
     _lastFlashCheckMs = 0;
     _flashStabilizeUntilMs = 0;
     _frameDiffAvg = 0;
+    _resetNoiseModel();
     _hasPreviousFrame = false;
     _consecutiveMotionFrames = 0;
     _consecutiveStillFrames = 0;
@@ -951,6 +1138,7 @@ OpticalFlowDetector::Metrics OpticalFlowDetector::getMetrics() const {
     metrics.dominantDirection = _motionDirection;
     metrics.avgSpeed = _motionSpeed;
     metrics.frameDiff = _frameDiffAvg;
+    metrics.pixelNoise = getPixelNoise();
 
     return metrics;
 }
@@ -1045,6 +1233,20 @@ bool OpticalFlowDetector::getBlockVector(uint8_t row, uint8_t col, int8_t* outDx
     return vec.valid;
 }
 
+bool OpticalFlowDetector::getBlockVectorQ4(uint8_t row, uint8_t col, int16_t* outDxQ4, int16_t* outDyQ4, uint8_t* outConfidence) const {
+    if (row >= GRID_ROWS || col >= GRID_COLS) {
+        return false;
+    }
+
+    const BlockMotionVector& vec = _motionVectors[row][col];
+
+    if (outDxQ4) *outDxQ4 = vec.dxQ4;
+    if (outDyQ4) *outDyQ4 = vec.dyQ4;
+    if (outConfidence) *outConfidence = vec.confidence;
+
+    return vec.valid;
+}
+
 char OpticalFlowDetector::getBlockDirectionTag(uint8_t row, uint8_t col) const {
     if (row >= GRID_ROWS || col >= GRID_COLS) {
         return '?';
@@ -1103,6 +1305,21 @@ bool OpticalFlowDetector::getCentroidNormalized(float* outX, float* outY) const
     return true;
 }
 
+bool OpticalFlowDetector::getCentroidPrediction(float* outX, float* outY, float* outVx, float* outVy) const {
+    if (!_centroidValid || !_tracker.isTracking() || _frameWidth == 0 || _frameHeight == 0) {
+        return false;
+    }
+
+    const CentroidTracker::State ahead = _tracker.predictAhead(1);
+    const float scaleX = 1.0f / (16.0f * _frameWidth);
+    const float scaleY = 1.0f / (16.0f * _frameHeight);
+    if (outX) *outX = ahead.x * scaleX;
+    if (outY) *outY = ahead.y * scaleY;
+    if (outVx) *outVx = ahead.vx * scaleX;
+    if (outVy) *outVy = ahead.vy * scaleY;
+    return true;
+}
+
 bool OpticalFlowDetector::getCentroidBlock(uint8_t* outRow, uint8_t* outCol) const {
     if (!_centroidValid) {
         return false;
@@ -1119,6 +1336,65 @@ bool OpticalFlowDetector::getCentroidBlock(uint8_t* outRow, uint8_t* outCol) con
     return true;
 }
 
+// Le soglie iniziali devono coincidere con quelle fisse storiche
+static_assert(OpticalFlowDetector::noiseGate((uint32_t)OpticalFlowDetector::BLOCK_NOISE_INIT << 4,
+                                             OpticalFlowDetector::BLOCK_GATE_MULT_Q4) ==
+              OpticalFlowDetector::BLOCK_NOISE_THRESHOLD, "gate SAD iniziale != 400");
+static_assert(OpticalFlowDetector::noiseGate(OpticalFlowDetector::PIXEL_NOISE_INIT_Q4,
+                                             OpticalFlowDetector::PIXEL_GATE_MULT_Q4) == 25,
+              "soglia diff centroide iniziale != 25");
+static_assert(OpticalFlowDetector::noiseGate(OpticalFlowDetector::PIXEL_NOISE_INIT_Q4,
+                                             OpticalFlowDetector::EDGE_GATE_MULT_Q4) == 40,
+              "soglia bordi iniziale != 40");
+static_assert(OpticalFlowDetector::CENTROID_MASS_PER_GATE *
+              OpticalFlowDetector::noiseGate(OpticalFlowDetector::PIXEL_NOISE_INIT_Q4,
+                                             OpticalFlowDetector::PIXEL_GATE_MULT_Q4) == 5000,
+              "massa centroide iniziale != 5000");
+static_assert(OpticalFlowDetector::noiseGate(OpticalFlowDetector::PIXEL_NOISE_INIT_Q4,
+                                             OpticalFlowDetector::FRAME_DIFF_GATE_MULT_Q4) == 10,
+              "fallback frame diff iniziale != 10");
+
+void OpticalFlowDetector::_resetNoiseModel() {
+    // Valori iniziali: le soglie partono da quelle fisse storiche
+    const uint32_t blockNoiseQ4 = (uint32_t)BLOCK_NOISE_INIT << 4;
+    for (uint8_t row = 0; row < GRID_ROWS; row++) {
+        for (uint8_t col = 0; col < GRID_COLS; col++) {
+            _blockNoiseQ4[row][col] = blockNoiseQ4;
+        }
+    }
+    _pixelNoiseQ4 = PIXEL_NOISE_INIT_Q4;
+}
+
+void OpticalFlowDetector::_updateNoise(uint32_t& noiseQ4, uint32_t sample) {
+    uint32_t sampleQ4 = sample << 4;
+    const uint32_t limit = noiseQ4 * 4 + (1 << 4);
+    if (sampleQ4 > limit) {
+        sampleQ4 = limit;
+    }
+    // EMA intera: noise += (sample - noise) / 2^NOISE_EMA_SHIFT
+    noiseQ4 = noiseQ4 - (noiseQ4 >> NOISE_EMA_SHIFT) + (sampleQ4 >> NOISE_EMA_SHIFT);
+}
+
+uint16_t OpticalFlowDetector::_blockNoiseGate(uint8_t row, uint8_t col) const {
+    const uint32_t gate = noiseGate(_blockNoiseQ4[row][col], BLOCK_GATE_MULT_Q4);
+    return (uint16_t)constrain(gate, (uint32_t)BLOCK_GATE_MIN, (uint32_t)BLOCK_GATE_MAX);
+}
+
+uint8_t OpticalFlowDetector::_pixelDiffGate() const {
+    const uint32_t gate = noiseGate(_pixelNoiseQ4, PIXEL_GATE_MULT_Q4);
+    return (uint8_t)constrain(gate, (uint32_t)PIXEL_GATE_MIN, (uint32_t)PIXEL_GATE_MAX);
+}
+
+uint8_t OpticalFlowDetector::_edgeGate() const {
+    const uint32_t gate = noiseGate(_pixelNoiseQ4, EDGE_GATE_MULT_Q4);
+    return (uint8_t)constrain(gate, (uint32_t)EDGE_GATE_MIN, (uint32_t)EDGE_GATE_MAX);
+}
+
+uint8_t OpticalFlowDetector::_frameDiffGate() const {
+    const uint32_t gate = noiseGate(_pixelNoiseQ4, FRAME_DIFF_GATE_MULT_Q4);
+    return (uint8_t)constrain(gate, (uint32_t)FRAME_DIFF_GATE_MIN, (uint32_t)FRAME_DIFF_GATE_MAX);
+}
+
 uint8_t OpticalFlowDetector::_calculateFrameDiffAvg(const uint8_t* currentFrame,
                                                     const uint8_t* previousFrame,
                                                     int currentFullWidth,
@@ -2,6 +2,7 @@
 #define OPTICAL_FLOW_DETECTOR_H
 
 #include <Arduino.h>
+#include "CentroidTracker.h"
 
 /**
  * @brief Optical Flow Motion Detector per ESP32-CAM
@@ -14,7 +15,7 @@
  * - Speed calculation (px/frame)
  * - Confidence per motion vector
  * - Outlier filtering
- * - Smooth trajectory tracking
+ * - Centroide filtrato con Kalman (CentroidTracker) e traiettoria in ring buffer
  */
 class OpticalFlowDetector {
 public:
@@ -24,7 +25,34 @@ public:
     static constexpr uint8_t GRID_COLS = 8;
     static constexpr uint8_t GRID_ROWS = 8;
     static constexpr uint8_t TOTAL_BLOCKS = GRID_COLS * GRID_ROWS;  // 64 blocchi
-    static constexpr uint16_t BLOCK_NOISE_THRESHOLD = 400; // Soglia rumore per blocco (SAD)
+    static constexpr uint16_t BLOCK_NOISE_THRESHOLD = 400; // Soglia rumore iniziale per blocco (SAD)
+
+    // Modello di rumore adattivo: EMA misurate sui frame senza moto, soglie
+    // come multipli Q4 del rumore. I valori iniziali danno esattamente le soglie
+    // fisse storiche (400 / 25 / 40 / 5000 / 10, verificato con static_assert)
+    static constexpr uint8_t NOISE_EMA_SHIFT = 4;           // alpha = 1/16, ~0.5 s a 30 FPS
+    static constexpr uint16_t BLOCK_NOISE_INIT = 100;       // SAD a spostamento nullo iniziale
+    static constexpr uint8_t BLOCK_GATE_MULT_Q4 = 64;       // Gate SAD = 4x rumore del blocco
+    static constexpr uint16_t BLOCK_GATE_MIN = 150;
+    static constexpr uint16_t BLOCK_GATE_MAX = 4000;
+    static constexpr uint8_t PIXEL_NOISE_INIT_Q4 = 80;      // |diff| medio per pixel iniziale: 5 px
+    static constexpr uint8_t PIXEL_GATE_MULT_Q4 = 80;       // Soglia diff centroide = 5x rumore
+    static constexpr uint8_t PIXEL_GATE_MIN = 10;
+    static constexpr uint8_t PIXEL_GATE_MAX = 64;
+    static constexpr uint8_t EDGE_GATE_MULT_Q4 = 128;       // Soglia gradiente bordi = 8x rumore
+    static constexpr uint8_t EDGE_GATE_MIN = 16;
+    static constexpr uint8_t EDGE_GATE_MAX = 96;
+    static constexpr uint8_t FRAME_DIFF_GATE_MULT_Q4 = 32;  // Fallback centroide su frame diff = 2x rumore
+    static constexpr uint8_t FRAME_DIFF_GATE_MIN = 10;
+    static constexpr uint8_t FRAME_DIFF_GATE_MAX = 64;
+    static constexpr uint16_t CENTROID_MASS_PER_GATE = 200; // Massa minima centroide = 200x soglia diff
+
+    /**
+     * @brief Soglia = rumore (Q4) x moltiplicatore (Q4), arrotondata
+     */
+    static constexpr uint32_t noiseGate(uint32_t noiseQ4, uint8_t multQ4) {
+        return (noiseQ4 * multQ4 + 128) >> 8;
+    }
 
     // Algoritmo di rilevamento
     enum class Algorithm : uint8_t {
@@ -70,6 +98,14 @@ public:
      */
     uint8_t getRecommendedFlashIntensity() const { return _flashIntensity; }
 
+    /**
+     * @brief Rumore temporale stimato: |diff| medio per pixel a scena ferma
+     */
+    uint8_t getPixelNoise() const {
+        const uint32_t noise = (_pixelNoiseQ4 + 8) >> 4;
+        return noise > 255 ? 255 : (uint8_t)noise;
+    }
+
     /**
      * @brief Configura qualità motion (mappa minConfidence/minActiveBlocks)
      * @param quality 0-255 (0=rigido, 255=molto permissivo)
@@ -90,6 +126,37 @@ public:
     void setMotionSpeedThreshold(float threshold);
     float getMotionSpeedThreshold() const { return _motionSpeedThreshold; }
 
+    /**
+     * @brief Rotazione di montaggio della camera, applicata ai vettori blocco
+     *        prima di ogni aggregazione (direzione, velocità, feature, gesture)
+     * @param degrees 0-359, orario nel riferimento immagine (y verso il basso)
+     */
+    void setMountAngle(uint16_t degrees);
+    uint16_t getMountAngle() const { return _mountAngle; }
+
+    /**
+     * @brief Rotazione di montaggio in Q14 (16384 = 1.0), per ruotare anche le
+     *        posizioni dei blocchi quando servono insieme ai vettori
+     */
+    void getMountRotationQ14(int16_t* outCos, int16_t* outSin) const;
+
+    enum class CalibrationState : uint8_t {
+        IDLE = 0,
+        RUNNING,        // In attesa del gesto "su"
+        DONE,           // Angolo aggiornato
+        FAILED,         // Timeout o gesto poco coerente
+    };
+
+    static constexpr uint32_t CALIBRATION_TIMEOUT_MS = 5000;
+    static constexpr uint8_t CALIBRATION_MIN_FRAMES = 3;        // Frame con moto nel gesto
+    static constexpr uint8_t CALIBRATION_MIN_COHERENCE = 60;    // |somma| / somma |v|, %
+
+    /**
+     * @brief Avvia la calibrazione: il prossimo gesto (moto poi quiete) definisce "su"
+     */
+    void startMountCalibration();
+    CalibrationState getCalibrationState() const { return _calibrationState; }
+
     /**
      * @brief Reset stato detector
      */
@@ -161,6 +228,14 @@ public:
      */
     bool getBlockVector(uint8_t row, uint8_t col, int8_t* outDx, int8_t* outDy, uint8_t* outConfidence) const;
 
+    /**
+     * @brief Come getBlockVector ma sub-pixel (parabola sul minimo SAD)
+     * @param outDxQ4 Output: componente X in px Q4 (1/16 px)
+     * @param outDyQ4 Output: componente Y in px Q4
+     * @return true se blocco valido
+     */
+    bool getBlockVectorQ4(uint8_t row, uint8_t col, int16_t* outDxQ4, int16_t* outDyQ4, uint8_t* outConfidence) const;
+
     /**
      * @brief Restituisce tag ASCII compatto per descrivere il blocco
      * @param row Riga (0-GRID_ROWS)
@@ -185,6 +260,16 @@ public:
      */
     bool getCentroidNormalized(float* outX, float* outY) const;
 
+    /**
+     * @brief Centroide estrapolato di un frame dal filtro di Kalman (compensa la latenza)
+     * @param outX Output: X normalizzato (0.0-1.0, può uscire di poco dal frame)
+     * @param outY Output: Y normalizzato
+     * @param outVx Output: velocità X normalizzata per frame (opzionale)
+     * @param outVy Output: velocità Y normalizzata per frame (opzionale)
+     * @return true se il filtro ha almeno due misure (velocità significativa)
+     */
+    bool getCentroidPrediction(float* outX, float* outY, float* outVx, float* outVy) const;
+
     /**
      * @brief Ottieni blocco (row/col) che contiene il centroide
      * @param outRow Riga blocco
@@ -209,12 +294,19 @@ public:
     static constexpr uint8_t MAX_TRAJECTORY_POINTS = 20;
 
     /**
-     * @brief Ottieni traiettoria corrente
+     * @brief Ottieni traiettoria corrente (dal più vecchio al più recente)
      * @param outPoints Array output (min MAX_TRAJECTORY_POINTS)
      * @return Numero punti validi
      */
     uint8_t getTrajectory(TrajectoryPoint* outPoints) const;
 
+    /**
+     * @brief Singolo punto della traiettoria senza copiare il ring
+     * @param age 0 = più recente
+     * @return nullptr se age >= numero punti
+     */
+    const TrajectoryPoint* getTrajectoryPoint(uint8_t age) const;
+
     // ═══════════════════════════════════════════════════════════
     // METRICHE E DEBUG
     // ═══════════════════════════════════════════════════════════
@@ -238,6 +330,7 @@ public:
 
         // Fallback frame-diff (0-255): avg abs diff (sampled)
         uint8_t frameDiff;
+        uint8_t pixelNoise;             // Rumore stimato (getPixelNoise)
     };
 
     Metrics getMetrics() const;
@@ -253,8 +346,10 @@ private:
     // ═══════════════════════════════════════════════════════════
 
     struct BlockMotionVector {
-        int8_t dx;              // -127 to +127
+        int8_t dx;              // -127 to +127 (dxQ4 arrotondato)
         int8_t dy;              // -127 to +127
+        int16_t dxQ4;           // Sub-pixel, px Q4 (1/16 px)
+        int16_t dyQ4;
         uint8_t confidence;     // 0-255
         uint16_t sad;           // Sum of Absolute Differences
         bool valid;             // Outlier filter flag
@@ -283,6 +378,19 @@ private:
     uint8_t _motionIntensityThreshold;
     float _motionSpeedThreshold;
 
+    // Montaggio camera
+    uint16_t _mountAngle;       // Gradi
+    int16_t _mountCosQ14;
+    int16_t _mountSinQ14;
+
+    // Calibrazione montaggio
+    CalibrationState _calibrationState;
+    unsigned long _calibrationStartMs;
+    int32_t _calibrationSumX;   // Somma flussi del gesto (px Q4, riferimento ruotato)
+    int32_t _calibrationSumY;
+    int32_t _calibrationSumAbs;
+    uint8_t _calibrationFrames;
+
     // ═══════════════════════════════════════════════════════════
     // STATE
     // ═══════════════════════════════════════════════════════════
@@ -312,8 +420,12 @@ private:
     bool _centroidValid;
     bool _centroidSeeded;
 
-    // Trajectory
+    // Centroide filtrato (posizione/velocità in px Q4)
+    CentroidTracker _tracker;
+
+    // Trajectory (ring buffer: _trajectoryHead = prossimo slot da scrivere)
     TrajectoryPoint _trajectory[MAX_TRAJECTORY_POINTS];
+    uint8_t _trajectoryHead;
     uint8_t _trajectoryLength;
 
     // Auto flash
@@ -326,6 +438,10 @@ private:
     unsigned long _flashStabilizeUntilMs;
     uint8_t _frameDiffAvg;
 
+    // Modello di rumore (px Q4 / SAD Q4)
+    uint32_t _blockNoiseQ4[GRID_ROWS][GRID_COLS];   // SAD a spostamento nullo
+    uint32_t _pixelNoiseQ4;
+
     // Timing & metrics
     unsigned long _lastMotionTime;
     uint32_t _totalFramesProcessed;
@@ -350,8 +466,9 @@ private:
 
     /**
      * @brief Calcola movimento basato sul centroide della differenza (Lite Mode)
+     * @return |diff| medio di tutti i pixel campionati (campione di rumore)
      */
-    void _computeCentroidMotion(const uint8_t* currentFrame,
+    uint8_t _computeCentroidMotion(const uint8_t* currentFrame,
                                 int currentFullWidth,
                                 int offsetX,
                                 int offsetY);
@@ -375,23 +492,39 @@ private:
         uint16_t currentMinSAD = UINT16_MAX
     );
 
+    /**
+     * @brief Offset sub-pixel del minimo SAD (parabola su 3 campioni a passo step)
+     * @return Offset in px Q4, entro ±step/2
+     */
+    static int16_t _subPixelOffsetQ4(uint16_t sadMinus, uint16_t sadCenter, uint16_t sadPlus, uint8_t step);
+
     /**
      * @brief Filtra outliers usando median filter
      */
     void _filterOutliers();
 
+    /**
+     * @brief Ruota i vettori validi nel riferimento di montaggio (Q14, nessun float)
+     */
+    void _applyMountRotation();
+
+    /**
+     * @brief Accumula il gesto di calibrazione e chiude la calibrazione a fine gesto
+     */
+    void _updateMountCalibration();
+
     /**
      * @brief Calcola movimento globale da vettori
      */
     void _calculateGlobalMotion();
 
     /**
-     * @brief Calcola centroide pesato per confidence
+     * @brief Calcola centroide pesato per confidence e lo passa al filtro di Kalman
      */
     void _calculateCentroid();
 
     /**
-     * @brief Aggiorna traiettoria con smoothing Kalman-like
+     * @brief Aggiunge il centroide filtrato alla traiettoria (ring, nessuno shift)
      */
     void _updateTrajectory();
 
@@ -417,6 +550,22 @@ private:
                                    int offsetX,
                                    int offsetY) const;
 
+    /**
+     * @brief Riporta il modello di rumore ai valori iniziali
+     */
+    void _resetNoiseModel();
+
+    /**
+     * @brief Passo EMA del rumore (Q4); campioni oltre 4x la stima sono limitati
+     *        (primo frame di un movimento non ancora segnalato)
+     */
+    static void _updateNoise(uint32_t& noiseQ4, uint32_t sample);
+
+    uint16_t _blockNoiseGate(uint8_t row, uint8_t col) const;
+    uint8_t _pixelDiffGate() const;
+    uint8_t _edgeGate() const;
+    uint8_t _frameDiffGate() const;
+
     // ═══════════════════════════════════════════════════════════
     // UTILITY
     // ═══════════════════════════════════════════════════════════
@@ -0,0 +1,170 @@
+/**
+ * @file PowerManager.cpp
+ * @brief Implementation of DFS / light sleep power profiles
+ */
+
+#include "PowerManager.h"
+#include <esp_pm.h>
+#include <esp_idf_version.h>
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+typedef esp_pm_config_t PmConfig;
+#else
+typedef esp_pm_config_esp32_t PmConfig;
+#endif
+
+// max MHz, min MHz, light sleep
+const PowerManager::ProfileConfig PowerManager::_profileTable[PowerManager::PROFILE_COUNT] = {
+    {  80, 80, true  },   // IDLE
+    { 160, 80, false },   // ECO
+    { 240, 80, false },   // MOTION
+    { 240, 240, false }   // PERFORMANCE
+};
+
+// ============================================================================
+// SINGLETON ACCESS
+// ============================================================================
+
+PowerManager& PowerManager::getInstance() {
+    static PowerManager instance;
+    return instance;
+}
+
+// ============================================================================
+// INITIALIZATION
+// ============================================================================
+
+void PowerManager::begin(Profile initial) {
+    // Sonda il supporto PM con il profilo più conservativo
+    PmConfig probe = {};
+    probe.max_freq_mhz = 240;
+    probe.min_freq_mhz = 240;
+    probe.light_sleep_enable = false;
+    esp_err_t err = esp_pm_configure(&probe);
+    _pmSupported = (err == ESP_OK);
+
+    if (_pmSupported) {
+        // Light sleep richiede tickless idle: verifica una volta sola
+        probe.light_sleep_enable = true;
+        _lightSleepSupported = (esp_pm_configure(&probe) == ESP_OK);
+        probe.light_sleep_enable = false;
+        esp_pm_configure(&probe);
+    }
+
+    Serial.printf("[POWER] esp_pm %s, light sleep %s\n",
+                  _pmSupported ? "available" : "NOT available (fallback setCpuFrequencyMhz)",
+                  _lightSleepSupported ? "available" : "not available");
+
+    _profile = initial;
+    _profileSinceMs = millis();
+    _apply(initial);
+    _initialized.store(true, std::memory_order_release);
+}
+
+// ============================================================================
+// PROFILE SELECTION
+// ============================================================================
+
+PowerManager::Profile PowerManager::_selectProfile(const Inputs& inputs) const {
+    if (inputs.otaInProgress) {
+        return Profile::PERFORMANCE;
+    }
+    if (inputs.cameraActive) {
+        return Profile::MOTION;
+    }
+    if (inputs.bladeActive) {
+        return Profile::ECO;
+    }
+    return Profile::IDLE;
+}
+
+void PowerManager::update(const Inputs& inputs, uint32_t nowMs) {
+    if (!_initialized.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    const Profile requested = _selectProfile(inputs);
+
+    if (requested == _profile) {
+        _downgradePending = false;
+        return;
+    }
+
+    if (static_cast<uint8_t>(requested) < static_cast<uint8_t>(_profile)) {
+        // Downgrade: attendi che la richiesta resti stabile
+        if (!_downgradePending || _pendingDowngrade != requested) {
+            _downgradePending = true;
+            _pendingDowngrade = requested;
+            _pendingSinceMs = nowMs;
+            return;
+        }
+        if (nowMs - _pendingSinceMs < DOWNGRADE_HOLD_MS) {
+            return;
+        }
+    }
+
+    _downgradePending = false;
+
+    // Chiudi la residenza del profilo uscente
+    _residencyMs[static_cast<uint8_t>(_profile)] += nowMs - _profileSinceMs;
+    _profileSinceMs = nowMs;
+
+    const Profile previous = _profile;
+    _profile = requested;
+    _switchCount++;
+
+    if (_apply(requested)) {
+        Serial.printf("[POWER] Profile %s -> %s (%u MHz%s)\n",
+                      profileToString(previous), profileToString(requested),
+                      getMaxFreqMhz(), _lightSleepActive ? ", light sleep" : "");
+    }
+}
+
+bool PowerManager::_apply(Profile profile) {
+    const ProfileConfig& cfg = _profileTable[static_cast<uint8_t>(profile)];
+
+    if (!_pmSupported) {
+        _lightSleepActive = false;
+        if (!setCpuFrequencyMhz(cfg.maxFreqMhz)) {
+            Serial.printf("[POWER ERROR] setCpuFrequencyMhz(%u) failed\n", cfg.maxFreqMhz);
+            return false;
+        }
+        return true;
+    }
+
+    PmConfig pm = {};
+    pm.max_freq_mhz = cfg.maxFreqMhz;
+    pm.min_freq_mhz = cfg.minFreqMhz;
+    pm.light_sleep_enable = cfg.lightSleep && _lightSleepSupported;
+
+    esp_err_t err = esp_pm_configure(&pm);
+    if (err != ESP_OK) {
+        Serial.printf("[POWER ERROR] esp_pm_configure failed: %s\n", esp_err_to_name(err));
+        return false;
+    }
+
+    _lightSleepActive = pm.light_sleep_enable;
+    return true;
+}
+
+// ============================================================================
+// TELEMETRY
+// ============================================================================
+
+uint32_t PowerManager::getResidencyMs(Profile profile, uint32_t nowMs) const {
+    uint32_t total = _residencyMs[static_cast<uint8_t>(profile)];
+    if (profile == _profile && _initialized.load(std::memory_order_acquire)) {
+        total += nowMs - _profileSinceMs;
+    }
+    return total;
+}
+
+const char* PowerManager::profileToString(Profile profile) {
+    switch (profile) {
+        case Profile::IDLE:        return "idle";
+        case Profile::ECO:         return "eco";
+        case Profile::MOTION:      return "motion";
+        case Profile::PERFORMANCE: return "performance";
+        default:                   return "unknown";
+    }
+}
@@ -0,0 +1,174 @@
+#include "ResourceMonitor.h"
+#include <esp_heap_caps.h>
+
+static portMUX_TYPE gResourceMonitorMux = portMUX_INITIALIZER_UNLOCKED;
+
+#if !configUSE_TRACE_FACILITY
+// Senza trace facility non si possono enumerare i task: usa i nomi noti
+static const char* const KNOWN_TASKS[] = {
+    "loopTask", "CameraCaptureTask", "BootInitTask", "Tmr Svc",
+    "LedMirrorTask", "OTAFlashTask", "btController", "BTC_TASK", "BTU_TASK", "IDLE0", "IDLE1", "esp_timer"
+};
+#endif
+
+ResourceMonitor& ResourceMonitor::getInstance() {
+    static ResourceMonitor instance;
+    return instance;
+}
+
+void ResourceMonitor::_sampleHeap(uint32_t caps, HeapStat& stat) {
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, caps);
+
+    const uint32_t largest = info.largest_free_block;
+    stat.total = info.total_free_bytes + info.total_allocated_bytes;
+    stat.free = info.total_free_bytes;
+    stat.largestBlock = largest;
+    stat.minFree = info.minimum_free_bytes;
+    if (stat.minLargestBlock == 0 || largest < stat.minLargestBlock) {
+        stat.minLargestBlock = largest;
+    }
+}
+
+void ResourceMonitor::_updateTask(const char* name, uint32_t freeStack, uint8_t priority, int8_t core) {
+    for (uint8_t i = 0; i < _taskCount; i++) {
+        if (strncmp(_tasks[i].name, name, sizeof(_tasks[i].name)) == 0) {
+            if (freeStack < _tasks[i].minFreeStack) {
+                _tasks[i].minFreeStack = freeStack;
+            }
+            _tasks[i].priority = priority;
+            return;
+        }
+    }
+
+    if (_taskCount >= MAX_TASKS) {
+        return;
+    }
+
+    TaskStat& task = _tasks[_taskCount++];
+    strlcpy(task.name, name, sizeof(task.name));
+    task.minFreeStack = freeStack;
+    task.priority = priority;
+    task.core = core;
+}
+
+void ResourceMonitor::sample() {
+    HeapStat dram = _dram;
+    HeapStat psram = _psram;
+    _sampleHeap(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, dram);
+    _sampleHeap(MALLOC_CAP_SPIRAM, psram);
+
+    portENTER_CRITICAL(&gResourceMonitorMux);
+    _dram = dram;
+    _psram = psram;
+    portEXIT_CRITICAL(&gResourceMonitorMux);
+
+#if configUSE_TRACE_FACILITY
+    const UBaseType_t capacity = uxTaskGetNumberOfTasks() + 2;
+    TaskStatus_t* status = static_cast<TaskStatus_t*>(malloc(capacity * sizeof(TaskStatus_t)));
+    if (status == nullptr) {
+        return;
+    }
+    const UBaseType_t count = uxTaskGetSystemState(status, capacity, nullptr);
+    for (UBaseType_t i = 0; i < count; i++) {
+#ifdef configTASKLIST_INCLUDE_COREID
+        const int8_t core = (status[i].xCoreID == tskNO_AFFINITY) ? -1 : (int8_t)status[i].xCoreID;
+#else
+        const int8_t core = -1;
+#endif
+        portENTER_CRITICAL(&gResourceMonitorMux);
+        _updateTask(status[i].pcTaskName, status[i].usStackHighWaterMark,
+                    (uint8_t)status[i].uxCurrentPriority, core);
+        portEXIT_CRITICAL(&gResourceMonitorMux);
+    }
+    free(status);
+#else
+    for (const char* name : KNOWN_TASKS) {
+        TaskHandle_t handle = xTaskGetHandle(name);
+        if (handle == nullptr) {
+            continue;
+        }
+        const uint32_t freeStack = uxTaskGetStackHighWaterMark(handle);
+        portENTER_CRITICAL(&gResourceMonitorMux);
+        _updateTask(name, freeStack, (uint8_t)uxTaskPriorityGet(handle), -1);
+        portEXIT_CRITICAL(&gResourceMonitorMux);
+    }
+#endif
+
+    _sampleCount++;
+
+    // Avviso una tantum per task con stack quasi esaurito
+    static uint32_t warnedMask = 0;
+    for (uint8_t i = 0; i < _taskCount; i++) {
+        if (_tasks[i].minFreeStack < STACK_WARN_BYTES && !(warnedMask & (1UL << i))) {
+            warnedMask |= (1UL << i);
+            Serial.printf("[RESOURCES] ⚠ Task %s stack low: %lu bytes free\n",
+                          _tasks[i].name, _tasks[i].minFreeStack);
+        }
+    }
+}
+
+ResourceMonitor::HeapStat ResourceMonitor::getDram() const {
+    portENTER_CRITICAL(&gResourceMonitorMux);
+    HeapStat copy = _dram;
+    portEXIT_CRITICAL(&gResourceMonitorMux);
+    return copy;
+}
+
+ResourceMonitor::HeapStat ResourceMonitor::getPsram() const {
+    portENTER_CRITICAL(&gResourceMonitorMux);
+    HeapStat copy = _psram;
+    portEXIT_CRITICAL(&gResourceMonitorMux);
+    return copy;
+}
+
+void ResourceMonitor::toJson(JsonDocument& doc, uint8_t maxTasks) const {
+    TaskStat tasks[MAX_TASKS];
+    uint8_t taskCount;
+    HeapStat dram;
+    HeapStat psram;
+
+    portENTER_CRITICAL(&gResourceMonitorMux);
+    taskCount = _taskCount;
+    memcpy(tasks, _tasks, sizeof(TaskStat) * taskCount);
+    dram = _dram;
+    psram = _psram;
+    portEXIT_CRITICAL(&gResourceMonitorMux);
+
+    // Ordina per stack libero crescente: i task a rischio per primi
+    for (uint8_t i = 1; i < taskCount; i++) {
+        TaskStat key = tasks[i];
+        int8_t j = i - 1;
+        while (j >= 0 && tasks[j].minFreeStack > key.minFreeStack) {
+            tasks[j + 1] = tasks[j];
+            j--;
+        }
+        tasks[j + 1] = key;
+    }
+
+    doc["up"] = millis();
+    doc["n"] = _sampleCount;
+
+    // [free, largest, minFree, minLargest]
+    JsonArray d = doc["dram"].to<JsonArray>();
+    d.add(dram.free);
+    d.add(dram.largestBlock);
+    d.add(dram.minFree);
+    d.add(dram.minLargestBlock);
+
+    JsonArray p = doc["psram"].to<JsonArray>();
+    p.add(psram.free);
+    p.add(psram.largestBlock);
+    p.add(psram.minFree);
+    p.add(psram.minLargestBlock);
+
+    // [name, minFreeStack, priority, core]
+    JsonArray t = doc["tasks"].to<JsonArray>();
+    for (uint8_t i = 0; i < taskCount && i < maxTasks; i++) {
+        JsonArray row = t.add<JsonArray>();
+        row.add(tasks[i].name);
+        row.add(tasks[i].minFreeStack);
+        row.add(tasks[i].priority);
+        row.add(tasks[i].core);
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef RESOURCE_MONITOR_H
+#define RESOURCE_MONITOR_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/**
+ * @brief Campionamento periodico di stack dei task e heap DRAM/PSRAM
+ *
+ * Serve a dimensionare gli stack (es. CameraCaptureTask, oggi 10240 byte
+ * "per sicurezza") e a capire quanta RAM si può recuperare per frame buffer
+ * più grandi. Per ogni task tiene il minimo high-water mark osservato; per
+ * ogni heap free attuale, blocco più grande e i rispettivi minimi storici.
+ *
+ * Thread safety: sample() va chiamato dal loop principale; toJson() dal
+ * task BLE legge una copia protetta da spinlock.
+ */
+class ResourceMonitor {
+public:
+    static constexpr uint8_t MAX_TASKS = 20;
+    static constexpr uint32_t STACK_WARN_BYTES = 512;
+
+    struct TaskStat {
+        char name[configMAX_TASK_NAME_LEN];
+        uint32_t minFreeStack;   // Byte mai usati (minimo osservato)
+        uint8_t priority;
+        int8_t core;             // -1 = nessuna affinità
+    };
+
+    struct HeapStat {
+        uint32_t total;
+        uint32_t free;
+        uint32_t largestBlock;
+        uint32_t minFree;         // Minimo storico (heap_caps, dal boot)
+        uint32_t minLargestBlock; // Minimo osservato del blocco più grande
+    };
+
+    static ResourceMonitor& getInstance();
+
+    /**
+     * @brief Campiona task e heap (costo ~1ms con tutti i task: chiamare di rado)
+     */
+    void sample();
+
+    uint8_t getTaskCount() const { return _taskCount; }
+    HeapStat getDram() const;
+    HeapStat getPsram() const;
+    uint32_t getSampleCount() const { return _sampleCount; }
+
+    /**
+     * @brief Serializza lo stato compatto per la characteristic diagnostica
+     *
+     * Formato breve per stare in un singolo read BLE (<512 byte): i task
+     * sono ordinati per stack libero crescente e limitati a maxTasks.
+     */
+    void toJson(JsonDocument& doc, uint8_t maxTasks = 10) const;
+
+private:
+    ResourceMonitor() = default;
+    ResourceMonitor(const ResourceMonitor&) = delete;
+    ResourceMonitor& operator=(const ResourceMonitor&) = delete;
+
+    void _sampleHeap(uint32_t caps, HeapStat& stat);
+    void _updateTask(const char* name, uint32_t freeStack, uint8_t priority, int8_t core);
+
+    TaskStat _tasks[MAX_TASKS] = {};
+    uint8_t _taskCount = 0;
+    HeapStat _dram = {};
+    HeapStat _psram = {};
+    uint32_t _sampleCount = 0;
+};
+
+#endif // RESOURCE_MONITOR_H
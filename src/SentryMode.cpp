@@ -0,0 +1,208 @@
+#include "SentryMode.h"
+#include "CameraManager.h"
+#include "BLELedController.h"
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <driver/gpio.h>
+
+// PWDN camera (AI-Thinker): tenuto alto durante il deep sleep per spegnere l'OV2640
+static constexpr gpio_num_t CAMERA_PWDN_GPIO = GPIO_NUM_32;
+static constexpr uint32_t SENTRY_MAGIC = 0x53454E54;  // "SENT"
+
+// Stato sopravvive al deep sleep (RTC slow memory, ~600 byte)
+struct SentryRtcState {
+    uint32_t magic;
+    bool armed;
+    uint16_t intervalSec;
+    uint8_t thresholdPct;
+    bool refValid;
+    SentryMode::Stats stats;
+    uint8_t ref[SentryMode::THUMB_CELLS];
+};
+
+static RTC_DATA_ATTR SentryRtcState gSentryRtc;
+
+bool SentryMode::isSentryWake() {
+    return esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER &&
+           gSentryRtc.magic == SENTRY_MAGIC &&
+           gSentryRtc.armed;
+}
+
+void SentryMode::releaseCameraPowerDown() {
+    // Il PWDN resta in hold dopo qualsiasi risveglio (anche EXT0): senza
+    // rilascio esp_camera_init non riesce a riaccendere il sensore
+    gpio_hold_dis(CAMERA_PWDN_GPIO);
+    gpio_deep_sleep_hold_dis();
+}
+
+bool SentryMode::runWakeCheck(CameraManager& camera) {
+    const uint32_t sniffStartMs = (uint32_t)(esp_timer_get_time() / 1000);
+
+    bool motion = false;
+    uint8_t changedPct = 0;
+    uint16_t cx = 0, cy = 0;
+
+    if (!camera.beginSniff()) {
+        // Senza camera non possiamo decidere: torna a dormire invece di
+        // restare acceso (un boot completo a vuoto scaricherebbe la batteria)
+        Serial.println("[SENTRY] ✗ Camera sniff init failed, back to sleep");
+    } else {
+        uint8_t thumbs[2][THUMB_CELLS];
+        uint8_t captured = 0;
+
+        for (uint8_t i = 0; i < SNIFF_FRAMES; i++) {
+            uint8_t* frame = nullptr;
+            size_t len = 0;
+            if (!camera.captureFrame(&frame, &len)) {
+                continue;
+            }
+            if (i > 0) {
+                _downsample(frame, len, thumbs[captured & 1]);
+                captured++;
+            }
+            camera.releaseFrame();
+        }
+        camera.deinit();
+
+        if (captured > 0) {
+            const uint8_t* latest = thumbs[(captured - 1) & 1];
+
+            // Movimento durante lo sniff (frame consecutivi)
+            if (captured >= 2) {
+                changedPct = _changedPercent(thumbs[0], thumbs[1], &cx, &cy);
+            }
+
+            // Scena cambiata rispetto al risveglio precedente (saber spostato)
+            if (gSentryRtc.refValid) {
+                uint16_t rx = 0, ry = 0;
+                const uint8_t refPct = _changedPercent(gSentryRtc.ref, latest, &rx, &ry);
+                if (refPct > changedPct) {
+                    changedPct = refPct;
+                    cx = rx;
+                    cy = ry;
+                }
+            }
+
+            memcpy(gSentryRtc.ref, latest, THUMB_CELLS);
+            gSentryRtc.refValid = true;
+            motion = changedPct >= gSentryRtc.thresholdPct;
+        }
+    }
+
+    // Metriche ciclo
+    const uint32_t nowMs = (uint32_t)(esp_timer_get_time() / 1000);
+    const uint32_t sleepMs = (uint32_t)gSentryRtc.intervalSec * 1000;
+    Stats& stats = gSentryRtc.stats;
+    stats.cycles++;
+    stats.lastLatencyMs = nowMs;
+    stats.totalAwakeMs += nowMs;
+    stats.lastChangedPct = changedPct;
+    stats.avgCurrentUa = (uint32_t)(((uint64_t)nowMs * AWAKE_CURRENT_MA * 1000 +
+                                     (uint64_t)sleepMs * SLEEP_CURRENT_UA) /
+                                    (nowMs + sleepMs));
+
+    Serial.printf("[SENTRY] Wake #%lu: changed=%u%% (thr %u%%) centroid=(%u,%u) -> %s\n",
+                  stats.cycles, changedPct, gSentryRtc.thresholdPct, cx, cy,
+                  motion ? "MOTION, booting" : "quiet, sleeping");
+    Serial.printf("[SENTRY] Latency %lu ms (sniff %lu ms), est. avg current %lu uA, total awake %lu ms\n",
+                  nowMs, nowMs - sniffStartMs, stats.avgCurrentUa, stats.totalAwakeMs);
+
+    if (motion) {
+        // Il boot prosegue: la sentinella si riarma al prossimo powerOff(deepSleep)
+        gSentryRtc.armed = false;
+    }
+    return motion;
+}
+
+void SentryMode::enterDeepSleep(const LedState& state) {
+    if (gSentryRtc.magic != SENTRY_MAGIC) {
+        memset(&gSentryRtc, 0, sizeof(gSentryRtc));
+        gSentryRtc.magic = SENTRY_MAGIC;
+    }
+
+    gSentryRtc.armed = state.sentryModeEnabled;
+    gSentryRtc.intervalSec = state.sentryIntervalSec;
+    gSentryRtc.thresholdPct = state.sentryThresholdPct;
+    gSentryRtc.refValid = false;  // Nuova sessione: la scena va ricatturata
+    memset(&gSentryRtc.stats, 0, sizeof(gSentryRtc.stats));
+
+    _startDeepSleep();
+}
+
+void SentryMode::sleepAgain() {
+    _startDeepSleep();
+}
+
+SentryMode::Stats SentryMode::getStats() {
+    if (gSentryRtc.magic != SENTRY_MAGIC) {
+        Stats empty = {};
+        return empty;
+    }
+    return gSentryRtc.stats;
+}
+
+void SentryMode::_startDeepSleep() {
+    // Wake-up: GPIO 0 (BOOT button) su livello LOW, sempre attivo
+    esp_sleep_enable_ext0_wakeup(GPIO_NUM_0, 0);
+
+    if (gSentryRtc.armed && gSentryRtc.intervalSec > 0) {
+        esp_sleep_enable_timer_wakeup((uint64_t)gSentryRtc.intervalSec * 1000000ULL);
+        Serial.printf("[SENTRY] Armed: timer wake every %u s (threshold %u%%)\n",
+                      gSentryRtc.intervalSec, gSentryRtc.thresholdPct);
+    }
+
+    // Camera in power-down durante lo sleep
+    gpio_set_direction(CAMERA_PWDN_GPIO, GPIO_MODE_OUTPUT);
+    gpio_set_level(CAMERA_PWDN_GPIO, 1);
+    gpio_hold_en(CAMERA_PWDN_GPIO);
+    gpio_deep_sleep_hold_en();
+
+    Serial.flush();
+    esp_deep_sleep_start();
+}
+
+void SentryMode::_downsample(const uint8_t* frame, size_t len, uint8_t* thumb) {
+    constexpr uint8_t SRC = THUMB_SIZE * 4;  // 96
+    if (len < (size_t)SRC * SRC) {
+        memset(thumb, 0, THUMB_CELLS);
+        return;
+    }
+
+    for (uint8_t ty = 0; ty < THUMB_SIZE; ty++) {
+        for (uint8_t tx = 0; tx < THUMB_SIZE; tx++) {
+            const uint8_t* src = frame + (ty * 4) * SRC + tx * 4;
+            uint16_t sum = 0;
+            for (uint8_t y = 0; y < 4; y++) {
+                sum += src[0] + src[1] + src[2] + src[3];
+                src += SRC;
+            }
+            thumb[ty * THUMB_SIZE + tx] = (uint8_t)(sum >> 4);
+        }
+    }
+}
+
+uint8_t SentryMode::_changedPercent(const uint8_t* a, const uint8_t* b,
+                                    uint16_t* centroidX, uint16_t* centroidY) {
+    // Rimuove la media: un cambio globale di luce non deve svegliare il saber
+    uint32_t sumA = 0, sumB = 0;
+    for (uint16_t i = 0; i < THUMB_CELLS; i++) {
+        sumA += a[i];
+        sumB += b[i];
+    }
+    const int16_t offset = (int16_t)((int32_t)(sumB - sumA) / THUMB_CELLS);
+
+    uint16_t changed = 0;
+    uint32_t sx = 0, sy = 0;
+    for (uint16_t i = 0; i < THUMB_CELLS; i++) {
+        const int16_t diff = (int16_t)b[i] - (int16_t)a[i] - offset;
+        if (abs(diff) > CELL_DIFF_THRESHOLD) {
+            changed++;
+            sx += i % THUMB_SIZE;
+            sy += i / THUMB_SIZE;
+        }
+    }
+
+    *centroidX = changed ? (uint16_t)(sx / changed) : 0;
+    *centroidY = changed ? (uint16_t)(sy / changed) : 0;
+    return (uint8_t)((changed * 100U) / THUMB_CELLS);
+}
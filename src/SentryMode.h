@@ -0,0 +1,89 @@
+#ifndef SENTRY_MODE_H
+#define SENTRY_MODE_H
+
+#include <Arduino.h>
+
+class CameraManager;
+struct LedState;
+
+/**
+ * @brief Modalità "sentinella": risveglio da deep sleep su movimento
+ *
+ * Durante il deep sleep il timer RTC risveglia il chip ogni N secondi.
+ * Al risveglio, prima di inizializzare BLE/LED, la camera viene accesa a
+ * 96x96 grayscale, si catturano pochi frame e si confronta:
+ * - frame consecutivi dello stesso risveglio (movimento in corso)
+ * - il thumbnail attuale con quello del risveglio precedente (salvato in RTC)
+ *
+ * Se la percentuale di celle cambiate supera la soglia il boot prosegue
+ * normalmente (ignition), altrimenti si torna subito in deep sleep.
+ *
+ * Ogni ciclo registra latenza di risveglio e stima della corrente media
+ * (tempo sveglio * corrente attiva + tempo in sleep * corrente di sleep).
+ */
+class SentryMode {
+public:
+    // Thumbnail 24x24 (96x96 ridotto 4x4): entra comodamente in RTC slow memory
+    static constexpr uint8_t THUMB_SIZE = 24;
+    static constexpr uint16_t THUMB_CELLS = THUMB_SIZE * THUMB_SIZE;
+
+    // Frame catturati per ciclo (il primo viene scartato: AE non stabile)
+    static constexpr uint8_t SNIFF_FRAMES = 3;
+
+    // Differenza minima (livelli di grigio, dopo rimozione media) per cella "cambiata"
+    static constexpr uint8_t CELL_DIFF_THRESHOLD = 24;
+
+    // Stima consumi (dipende dalla scheda: calibrare con un multimetro)
+    static constexpr uint32_t AWAKE_CURRENT_MA = 120;    // ESP32 240MHz + OV2640 attivo
+    static constexpr uint32_t SLEEP_CURRENT_UA = 2500;   // ESP32-CAM in deep sleep (regolatore + PSRAM)
+
+    /**
+     * @brief Statistiche persistenti tra i risvegli (RTC memory)
+     */
+    struct Stats {
+        uint32_t cycles;            // Risvegli sentinella dall'ultimo armamento
+        uint32_t totalAwakeMs;      // Tempo sveglio cumulativo
+        uint32_t lastLatencyMs;     // Avvio app -> decisione (ultimo ciclo)
+        uint8_t lastChangedPct;     // Percentuale celle cambiate (ultimo ciclo)
+        uint32_t avgCurrentUa;      // Corrente media stimata per ciclo
+    };
+
+    /**
+     * @brief Rilascia l'hold del pin PWDN camera (chiamare ad ogni boot)
+     */
+    static void releaseCameraPowerDown();
+
+    /**
+     * @brief true se il risveglio corrente è un timer wake della sentinella
+     */
+    static bool isSentryWake();
+
+    /**
+     * @brief Esegue lo sniff camera al risveglio
+     * @return true se c'è movimento (proseguire il boot), false per tornare a dormire
+     */
+    static bool runWakeCheck(CameraManager& camera);
+
+    /**
+     * @brief Arma la sentinella (se abilitata in config) ed entra in deep sleep
+     *
+     * Wake-up: EXT0 (GPIO0/BOOT) sempre, timer solo con sentryModeEnabled.
+     * Non ritorna.
+     */
+    static void enterDeepSleep(const LedState& state);
+
+    /**
+     * @brief Torna in deep sleep con i parametri già armati (dopo sniff negativo)
+     */
+    static void sleepAgain();
+
+    static Stats getStats();
+
+private:
+    static void _startDeepSleep();
+    static void _downsample(const uint8_t* frame, size_t len, uint8_t* thumb);
+    static uint8_t _changedPercent(const uint8_t* a, const uint8_t* b,
+                                   uint16_t* centroidX, uint16_t* centroidY);
+};
+
+#endif // SENTRY_MODE_H
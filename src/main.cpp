@@ -16,6 +16,13 @@
 #include "StatusLedManager.h"
 #include "MotionProcessor.h"
 #include "LedEffectEngine.h"
+#include "EventDispatcher.h"
+#include "PowerManager.h"
+#include "SentryMode.h"
+#include "BootTimeline.h"
+#include "ResourceMonitor.h"
+#include "LedStateStore.h"
+#include "LedMirrorStream.h"
 
 // GPIO
 static constexpr uint8_t STATUS_LED_PIN = 4;   // LED integrato per stato connessione
@@ -39,6 +46,12 @@ static constexpr uint8_t MAX_SAFE_BRIGHTNESS = 255;
 static constexpr uint8_t LED_STRIP_VOLTAGE = 5;      // Voltaggio striscia LED (es. 5V)
 static constexpr uint16_t MAX_POWER_MILLIAMPS = 4500; // Limite corrente in mA (es. 4500mA = 4.5A)
 
+// Cadenza del tick di render (EventDispatcher)
+// Attivo: ~60 FPS, sopra il rate limit di 15ms di LedEffectEngine::render()
+// Idle: lama spenta e nessuna animazione, basta per blink status LED e housekeeping
+static constexpr uint16_t RENDER_PERIOD_ACTIVE_MS = 16;
+static constexpr uint16_t RENDER_PERIOD_IDLE_MS = 100;
+
 CRGB leds[NUM_LEDS];
 
 extern LedState ledState;
@@ -83,7 +96,17 @@ static uint32_t gAutoIgnitionAtMs = 0;
 
 static bool gWasCameraActiveBeforeOta = false;
 
+// Copia dello stato usata dal renderer (aggiornata solo quando cambia la versione)
+static LedSnapshot gRenderState = {};
+
+// Boot a stadi: stadio 1 (LED + config) in setup(), stadio 2 (BLE, camera) in BootInitTask
+static bool gFastConfigLoaded = false;
+static volatile bool gServicesReady = false;
+static volatile bool gBootSampleRequested = false;   // ResourceMonitor::sample() solo dal loop
+
 static void CameraCaptureTask(void* pvParameters);
+static void BootInitTask(void* pvParameters);
+static void runDeferredInit();
 // ============================================================================
 // FUNZIONI DI CALLBACK PER OTA
 // ============================================================================
@@ -566,58 +589,46 @@ static void renderLedStrip() {
 // END LEGACY renderLedStrip()
 
 void setup() {
+    BootTimeline::mark("app_start");
     Serial.begin(115200);
     Serial.println("\n=== LEDSABER (BLE GATT + OTA) ===");
 
-    initPeripherals();
+    // Sentry wake: sniff camera PRIMA di tutto il resto, se non c'è movimento
+    // si torna in deep sleep senza accendere BLE/LED
+    SentryMode::releaseCameraPowerDown();
+    if (SentryMode::isSentryWake()) {
+        if (!SentryMode::runWakeCheck(cameraManager)) {
+            SentryMode::sleepAgain();
+        }
+        BootTimeline::mark("sentry_motion");
+    }
 
-    FastLED.setMaxPowerInVoltsAndMilliamps(LED_STRIP_VOLTAGE, MAX_POWER_MILLIAMPS);
+    // ── STADIO 1: solo ciò che serve per accendere la lama ──────────────
 
-    // Collega i componenti motion al ConfigManager per salvare/caricare le impostazioni
-    configManager.setMotionComponents(&motionDetector, &motionProcessor);
+    initPeripherals();
 
-    // 1. Carica configurazione da LittleFS PRIMA di inizializzare BLE
-    if (!configManager.begin()) {
-        Serial.println("[CONFIG] Warning: using default values");
-    }
-    configManager.printDebugInfo();
+    // Dispatcher eventi PRIMA di BLE/OTA: le callback postano eventi al loop
+    EventDispatcher::getInstance().begin(RENDER_PERIOD_ACTIVE_MS);
 
-    // 2. Inizializza il dispositivo BLE e crea il Server
-    BLEDevice::init("LedSaber-BLE");
-    BLEServer* pServer = BLEDevice::createServer();
-    pServer->setCallbacks(new MainServerCallbacks());
+    // Store LedState prima della config: ogni load pubblica uno snapshot per il renderer
+    LedStateStore::getInstance().begin(&ledState);
 
-    // 3. Inizializza il servizio LED, agganciandolo al server principale
-    bleController.begin(pServer);
-    bleController.setEffectEngine(&effectEngine);  // Link EffectEngine for device control
+    FastLED.setMaxPowerInVoltsAndMilliamps(LED_STRIP_VOLTAGE, MAX_POWER_MILLIAMPS);
     effectEngine.setLedStateRef(&ledState);  // Set LedState reference for power control
-    Serial.println("*** BLE LED Service avviato ***");
-
-    // 4. Inizializza il servizio OTA, agganciandolo allo stesso server
-    otaManager.begin(pServer);
-    otaManager.setPreOtaCallback(prepareForOta);
-    otaManager.setPostOtaCallback(recoverAfterOta);
-    Serial.println("*** OTA Service avviato ***");
-
-    // 5. Inizializza il servizio Camera, agganciandolo allo stesso server
-    bleCameraService.begin(pServer);
-    Serial.println("*** Camera Service avviato ***");
+    BootTimeline::mark("leds_ready");
 
-    // 6. Inizializza il servizio Motion, agganciandolo allo stesso server
-    bleMotionService.begin(pServer);
-    Serial.println("*** Motion Service avviato ***");
+    // Collega i componenti motion al ConfigManager per salvare/caricare le impostazioni
+    configManager.setMotionComponents(&motionDetector, &motionProcessor);
 
-    // 7. Configura e avvia l'advertising DOPO aver inizializzato tutti i servizi
-    BLEAdvertising* pAdvertising = BLEDevice::getAdvertising();
-    pAdvertising->addServiceUUID(LED_SERVICE_UUID);
-    pAdvertising->addServiceUUID(OTA_SERVICE_UUID);
-    pAdvertising->addServiceUUID(CAMERA_SERVICE_UUID);
-    pAdvertising->addServiceUUID(MOTION_SERVICE_UUID);
-    // Nota: Non aggiungiamo WiFi service UUID all'advertising per risparmiare spazio
-    pAdvertising->setScanResponse(true);
-    pAdvertising->setMinPreferred(0x06);  // iPhone compatibility
-    pAdvertising->setMinPreferred(0x12);
-    pAdvertising->start();
+    // 1. Config: cache veloce (RTC/NVS), altrimenti LittleFS subito (primo boot)
+    gFastConfigLoaded = configManager.loadFastCache();
+    if (!gFastConfigLoaded) {
+        if (!configManager.begin()) {
+            Serial.println("[CONFIG] Warning: using default values");
+        }
+        configManager.saveFastCache();
+    }
+    BootTimeline::mark(gFastConfigLoaded ? "config_fast_cache" : "config_littlefs");
 
     gMotionResultQueue = xQueueCreate(3, sizeof(MotionTaskResult));  // Aumentato da 1 a 3
     if (!gMotionResultQueue) {
@@ -642,18 +653,18 @@ void setup() {
         Serial.println("[MAIN] ✓ CameraCaptureTask created on core 0");
     }
 
-    Serial.printf("Free heap: %u bytes\n", ESP.getFreeHeap());
-    Serial.println("*** THE FORCE IS IN YOU ***");
-
     // Check wake-up reason
     esp_sleep_wakeup_cause_t wakeup_reason = esp_sleep_get_wakeup_cause();
     switch (wakeup_reason) {
         case ESP_SLEEP_WAKEUP_EXT0:
             Serial.println("[BOOT] Woke up from deep sleep via GPIO (BOOT button)");
             break;
-        case ESP_SLEEP_WAKEUP_TIMER:
-            Serial.println("[BOOT] Woke up from deep sleep via timer");
+        case ESP_SLEEP_WAKEUP_TIMER: {
+            const SentryMode::Stats sentry = SentryMode::getStats();
+            Serial.printf("[BOOT] Woke up from deep sleep via sentry timer (cycle %lu, latency %lu ms)\n",
+                          sentry.cycles, sentry.lastLatencyMs);
             break;
+        }
         case ESP_SLEEP_WAKEUP_UNDEFINED:
         default:
             Serial.println("[BOOT] Normal boot (not from deep sleep)");
@@ -673,17 +684,112 @@ void setup() {
         Serial.println("[BOOT] Auto-ignition disabled: blade stays OFF at normal boot");
     }
 
+    // ── STADIO 2: BLE, config completa e camera in background ───────────
+    // Il loop parte subito e può già animare l'ignition
+    taskCreated = xTaskCreatePinnedToCore(
+        BootInitTask,
+        "BootInitTask",
+        8192,
+        nullptr,
+        2,
+        nullptr,
+        0
+    );
+    if (taskCreated != pdPASS) {
+        Serial.println("[MAIN] ✗ Failed to create BootInitTask, initializing inline");
+        runDeferredInit();
+    }
+
+    BootTimeline::mark("setup_done");
+}
+
+/**
+ * @brief Stadio 2 del boot: servizi lenti fuori dal percorso critico della lama
+ *
+ * Gira su core 0 (BootInitTask) mentre il loop su core 1 renderizza già.
+ * gServicesReady diventa true solo a servizi GATT avviati: fino ad allora
+ * il loop non tocca BLE/OTA/camera.
+ */
+static void runDeferredInit() {
+    // Config completa (parametri motion + verifica cache) se lo stadio 1 ha usato la cache
+    if (gFastConfigLoaded) {
+        if (!configManager.begin()) {
+            Serial.println("[CONFIG] Warning: using default values");
+        }
+        BootTimeline::mark("config_full");
+    }
+    configManager.printDebugInfo();
+
+    // 2. Inizializza il dispositivo BLE e crea il Server
+    BLEDevice::init("LedSaber-BLE");
+    BLEServer* pServer = BLEDevice::createServer();
+    pServer->setCallbacks(new MainServerCallbacks());
+    BootTimeline::mark("ble_stack");
+
+    // 3. Inizializza il servizio LED, agganciandolo al server principale
+    bleController.begin(pServer);
+    bleController.setEffectEngine(&effectEngine);  // Link EffectEngine for device control
+    Serial.println("*** BLE LED Service avviato ***");
+
+    // 4. Inizializza il servizio OTA, agganciandolo allo stesso server
+    otaManager.begin(pServer);
+    otaManager.setPreOtaCallback(prepareForOta);
+    otaManager.setPostOtaCallback(recoverAfterOta);
+    Serial.println("*** OTA Service avviato ***");
+
+    // 5. Inizializza il servizio Camera, agganciandolo allo stesso server
+    bleCameraService.begin(pServer);
+    Serial.println("*** Camera Service avviato ***");
+
+    // 6. Inizializza il servizio Motion, agganciandolo allo stesso server
+    bleMotionService.begin(pServer);
+    Serial.println("*** Motion Service avviato ***");
+
+    // 7. Configura e avvia l'advertising DOPO aver inizializzato tutti i servizi
+    BLEAdvertising* pAdvertising = BLEDevice::getAdvertising();
+    pAdvertising->addServiceUUID(LED_SERVICE_UUID);
+    pAdvertising->addServiceUUID(OTA_SERVICE_UUID);
+    pAdvertising->addServiceUUID(CAMERA_SERVICE_UUID);
+    pAdvertising->addServiceUUID(MOTION_SERVICE_UUID);
+    // Nota: Non aggiungiamo WiFi service UUID all'advertising per risparmiare spazio
+    pAdvertising->setScanResponse(true);
+    pAdvertising->setMinPreferred(0x06);  // iPhone compatibility
+    pAdvertising->setMinPreferred(0x12);
+    pAdvertising->start();
+    BootTimeline::mark("ble_advertising");
+
+    gServicesReady = true;
+    EventDispatcher::getInstance().post(EventDispatcher::EVENT_BLE_WRITE);
+
+    // Profili DFS/light sleep: parte in PERFORMANCE, scende dal loop in base allo stato
+    PowerManager::getInstance().begin(PowerManager::Profile::PERFORMANCE);
+
     // Auto-start Motion & Camera if enabled in config
     if (ledState.motionOnBoot) {
         Serial.println("[BOOT] Motion on boot ENABLED: starting camera and motion services...");
-        
+
         if (cameraManager.begin()) {
             bleCameraService.setCameraActive(true);
             bleMotionService.setMotionEnabled(true);
+            BootTimeline::mark("camera_ready");
         } else {
             Serial.println("[BOOT] ✗ Camera init failed during boot sequence");
         }
     }
+
+    BootTimeline::mark("boot_complete");
+    // Campione di fine boot preso dal loop: sample() non è rientrante
+    gBootSampleRequested = true;
+    EventDispatcher::getInstance().post(EventDispatcher::EVENT_BLE_WRITE);
+    Serial.printf("Free heap: %u bytes\n", ESP.getFreeHeap());
+    Serial.println("*** THE FORCE IS IN YOU ***");
+    BootTimeline::printReport();
+}
+
+static void BootInitTask(void* pvParameters) {
+    (void)pvParameters;
+    runDeferredInit();
+    vTaskDelete(nullptr);
 }
 
 void loop() {
@@ -693,6 +799,13 @@ void loop() {
     static unsigned long lastCameraUpdate = 0;
     static unsigned long lastCameraTaskInitWarning = 0;
     static unsigned long lastMotionStatusNotify = 0;
+    static unsigned long lastResourceSample = 0;
+
+    EventDispatcher& dispatcher = EventDispatcher::getInstance();
+
+    // Niente busy-polling: il loop dorme finché timer di render, task camera,
+    // callback BLE o ricezione OTA non segnalano lavoro
+    const uint32_t events = dispatcher.wait();
     const unsigned long now = millis();
 
     const bool bleConnected = bleController.isConnected();
@@ -725,10 +838,13 @@ void loop() {
         Serial.println("[MAIN] Camera streaming task stopping");
     }
 
-    if (gMotionResultQueue) {
+    bool newMotionResult = false;
+    if (gMotionResultQueue && (events & EventDispatcher::EVENT_MOTION_READY)) {
+        // Tieni solo il risultato più recente
         MotionTaskResult result;
-        if (xQueueReceive(gMotionResultQueue, &result, 0) == pdTRUE) {
+        while (xQueueReceive(gMotionResultQueue, &result, 0) == pdTRUE) {
             gCachedMotionResult = result;
+            newMotionResult = true;
         }
     }
 
@@ -740,21 +856,45 @@ void loop() {
 
         // Update BLE motion service
         bleMotionService.update(gCachedMotionResult.motionDetected, false, processedMotion);
+        // Status binario ad ogni frame; il JSON resta limitato per l'MTU
+        if (newMotionResult) {
+            bleMotionService.notifyBinaryStatus();
+        }
         if (now - lastMotionStatusNotify > 300) {
             bleMotionService.notifyStatus();
             lastMotionStatusNotify = now;
         }
     }
 
+    // Telemetria e record motion: tutti i frame in coda, non solo l'ultimo
+    if (events & EventDispatcher::EVENT_MOTION_READY) {
+        bleMotionService.flushTelemetry();
+        bleMotionService.flushRecords();
+    }
+
     // Debug loop ogni 10 secondi (disabilitato durante OTA per non rallentare)
     if (!otaManager.isOTAInProgress() && now - lastLoopDebug > 10000) {
-        Serial.printf("[LOOP] Running, OTA state: %d, heap: %u\n",
-            (int)otaManager.getState(), ESP.getFreeHeap());
+        const EventDispatcher::Stats& stats = dispatcher.getStats();
+        Serial.printf("[LOOP] Running, OTA state: %d, heap: %u, wakeups: %lu (tick %lu, motion %lu, ble %lu), tick %u ms, power: %s\n",
+            (int)otaManager.getState(), ESP.getFreeHeap(),
+            stats.wakeups, stats.renderTicks, stats.motionEvents, stats.bleWrites,
+            dispatcher.getRenderPeriod(),
+            PowerManager::profileToString(PowerManager::getInstance().getProfile()));
+        dispatcher.resetStats();
         lastLoopDebug = now;
     }
 
+    // Campiona stack/heap ogni 5 secondi (characteristic Diagnostics)
+    if (gBootSampleRequested || now - lastResourceSample > 5000) {
+        gBootSampleRequested = false;
+        ResourceMonitor::getInstance().sample();
+        lastResourceSample = now;
+    }
+
     // Aggiorna OTA Manager (controlla timeout)
-    otaManager.update();
+    if (gServicesReady) {
+        otaManager.update();
+    }
 
     StatusLedManager& ledManager = StatusLedManager::getInstance();
    // todo usare colore progressivo viola blu verde in base al progresso della barra
@@ -927,9 +1067,29 @@ void loop() {
         }
 
         // Render LED strip with motion integration
-        effectEngine.render(ledState, processedMotion);
+        // (il rate limit interno di render() assorbe i risvegli ravvicinati)
+        if (events & (EventDispatcher::EVENT_RENDER_TICK |
+                      EventDispatcher::EVENT_MOTION_READY |
+                      EventDispatcher::EVENT_BLE_WRITE)) {
+            // Snapshot immutabile del frame: le write BLE non possono cambiarlo a metà render
+            LedStateStore::getInstance().readIfChanged(gRenderState);
+            effectEngine.render(gRenderState, processedMotion);
+
+            // Mirror BLE: solo copia del frame, la codifica gira in LedMirrorTask
+            LedMirrorStream::getInstance().capture(leds, gRenderState.foldPoint, FastLED.getBrightness(), now);
+
+            // Metrica boot: primo frame con almeno un LED acceso
+            if (!BootTimeline::hasFirstLit()) {
+                for (uint16_t i = 0; i < NUM_LEDS; i++) {
+                    if (leds[i]) {
+                        BootTimeline::markFirstLit();
+                        break;
+                    }
+                }
+            }
+        }
 
-        // Notifica stato BLE solo su cambio bladeState, con heartbeat lento
+        // Notifica stato BLE su cambio bladeState o versione LedStateStore, con heartbeat lento
         if (bleConnected) {
             bleController.notifyStateIfNeeded(now, 1500);
         }
@@ -946,7 +1106,7 @@ void loop() {
         }
 
         // Aggiorna metriche camera ogni 1 secondo
-        if (now - lastCameraUpdate > 1000) {
+        if (gServicesReady && now - lastCameraUpdate > 1000) {
             bleCameraService.updateMetrics();
             bleCameraService.notifyStatus();
             lastCameraUpdate = now;
@@ -954,27 +1114,28 @@ void loop() {
 
     }
 
-    yield();
-}
-
-static OpticalFlowDetector::Direction rotateDirection90CW(OpticalFlowDetector::Direction dir) {
-    switch (dir) {
-        case OpticalFlowDetector::Direction::UP:         return OpticalFlowDetector::Direction::RIGHT;
-        case OpticalFlowDetector::Direction::UP_RIGHT:   return OpticalFlowDetector::Direction::DOWN_RIGHT;
-        case OpticalFlowDetector::Direction::RIGHT:      return OpticalFlowDetector::Direction::DOWN;
-        case OpticalFlowDetector::Direction::DOWN_RIGHT: return OpticalFlowDetector::Direction::DOWN_LEFT;
-        case OpticalFlowDetector::Direction::DOWN:       return OpticalFlowDetector::Direction::LEFT;
-        case OpticalFlowDetector::Direction::DOWN_LEFT:  return OpticalFlowDetector::Direction::UP_LEFT;
-        case OpticalFlowDetector::Direction::LEFT:       return OpticalFlowDetector::Direction::UP;
-        case OpticalFlowDetector::Direction::UP_LEFT:    return OpticalFlowDetector::Direction::UP_RIGHT;
-        default: return dir;
-    }
+    // Tick veloce solo se qualcosa anima sulla striscia, altrimenti lento:
+    // tra un tick e l'altro il core 1 resta nell'idle task
+    const bool stripAnimating = otaManager.isOTAInProgress() ||
+        ledState.bladeEnabled ||
+        effectEngine.getMode() != LedEffectEngine::Mode::IDLE ||
+        gAutoIgnitionScheduled;
+    dispatcher.setRenderPeriod(stripAnimating ? RENDER_PERIOD_ACTIVE_MS : RENDER_PERIOD_IDLE_MS);
+
+    // Profilo energetico: lama spenta + camera ferma -> 80 MHz + light sleep
+    PowerManager::Inputs powerInputs;
+    powerInputs.bladeActive = ledState.bladeEnabled || effectEngine.getMode() != LedEffectEngine::Mode::IDLE;
+    powerInputs.cameraActive = gCameraTaskStreaming;
+    powerInputs.otaInProgress = otaManager.isOTAInProgress();
+    PowerManager::getInstance().update(powerInputs, now);
 }
 
 static void CameraCaptureTask(void* pvParameters) {
     (void)pvParameters;
 
     bool motionInitialized = false;
+    // Copia locale dello stato LED (mai il master LedState da questo task)
+    LedSnapshot ledSnapshot = {};
     // Target 30 FPS = ~33ms per frame (Increased reactivity)
     const unsigned long targetFrameTimeMs = 33;
 
@@ -1011,8 +1172,11 @@ static void CameraCaptureTask(void* pvParameters) {
             }
 
             bool motionDetected = false;
+            uint32_t processMs = 0;
             if (motionInitialized) {
+                const unsigned long processStart = millis();
                 motionDetected = motionDetector.processFrame(frameBuffer, frameLength);
+                processMs = millis() - processStart;
             }
 
             cameraManager.releaseFrame();
@@ -1023,8 +1187,10 @@ static void CameraCaptureTask(void* pvParameters) {
                 result.motionDetected = motionDetected;
                 result.flashIntensity = motionDetector.getRecommendedFlashIntensity();
                 result.motionIntensity = motionDetector.getMotionIntensity();
-                result.direction = rotateDirection90CW(motionDetector.getMotionDirection());
+                result.direction = motionDetector.getMotionDirection();
                 result.timestamp = millis();
+                LedStateStore::getInstance().readIfChanged(ledSnapshot);
+                motionProcessor.setBladeLength(ledSnapshot.foldPoint);
                 result.processedMotion = motionProcessor.process(
                     result.motionIntensity,
                     result.direction,
@@ -1033,9 +1199,17 @@ static void CameraCaptureTask(void* pvParameters) {
                     motionDetector
                 );
 
+                // Telemetria completa del frame (vettori coerenti solo in questo task)
+                bleMotionService.captureTelemetry(result.processedMotion, result.direction,
+                                                  motionDetected, result.timestamp, processMs);
+                // Record dataset (solo in modalità registrazione)
+                bleMotionService.captureRecord(motionProcessor.getHistory().latest().sample);
+
                 if (gMotionResultQueue) {
                     // Usa xQueueSend con timeout 0 per non bloccare (drop se piena)
-                    xQueueSend(gMotionResultQueue, &result, 0);
+                    if (xQueueSend(gMotionResultQueue, &result, 0) == pdTRUE) {
+                        EventDispatcher::getInstance().post(EventDispatcher::EVENT_MOTION_READY);
+                    }
                 }
             }
 
@@ -0,0 +1,125 @@
+// Benchmark host della stima ego-motion: compila lo stesso sorgente del firmware.
+//
+//   g++ -O2 -std=c++17 -Isrc tools/ego_motion_bench.cpp src/EgoMotion.cpp -o ego_motion_bench
+//   ./ego_motion_bench [frame] [seed]
+//
+// Genera campi di vettori sintetici come quelli della griglia 8x8: moto globale
+// affine casuale (traslazione fino a ±12 px/frame, zoom e rotazione piccoli),
+// rumore di quantizzazione, blocchi non validi e una "mano" (rettangolo di
+// blocchi con moto indipendente) su una quota crescente della griglia.
+// Per ogni quota stampa l'errore medio della traslazione stimata accanto a
+// quello della media pesata dei blocchi (come _calculateGlobalMotion),
+// precisione e richiamo dei blocchi locali (outlierMask), blocchi globali
+// scambiati per locali e tempo per frame.
+
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "EgoMotion.h"
+
+namespace {
+struct Scene {
+    EgoMotion::Vector vectors[EgoMotion::BLOCK_COUNT];
+    bool local[EgoMotion::BLOCK_COUNT];
+    float tx;
+    float ty;
+};
+
+int8_t clamp8(float value) {
+    const long rounded = lroundf(value);
+    return (int8_t)(rounded > 127 ? 127 : (rounded < -127 ? -127 : rounded));
+}
+
+Scene makeScene(std::mt19937& rng, float localShare) {
+    std::uniform_real_distribution<float> uni(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    Scene scene = {};
+    scene.tx = 12.0f * uni(rng);
+    scene.ty = 12.0f * uni(rng);
+    const float zoom = 0.15f * uni(rng);
+    const float rot = 0.15f * uni(rng);
+
+    // Mano: rettangolo di ~localShare blocchi con vettore proprio
+    const int side = (int)lroundf(sqrtf(localShare) * EgoMotion::GRID_COLS);
+    const int r0 = side > 0 ? (int)(unit(rng) * (EgoMotion::GRID_ROWS - side + 1)) : 0;
+    const int c0 = side > 0 ? (int)(unit(rng) * (EgoMotion::GRID_COLS - side + 1)) : 0;
+    float hx = 0.0f, hy = 0.0f;
+    while (fabsf(hx - scene.tx) + fabsf(hy - scene.ty) < 8.0f) {
+        hx = 20.0f * uni(rng);
+        hy = 20.0f * uni(rng);
+    }
+
+    for (int i = 0; i < EgoMotion::BLOCK_COUNT; i++) {
+        const int row = i / EgoMotion::GRID_COLS;
+        const int col = i % EgoMotion::GRID_COLS;
+        const float x = (float)(2 * col - (EgoMotion::GRID_COLS - 1));
+        const float y = (float)(2 * row - (EgoMotion::GRID_ROWS - 1));
+        EgoMotion::Vector& v = scene.vectors[i];
+        v.valid = unit(rng) > 0.15f;    // Blocchi senza texture
+        v.confidence = (uint8_t)(60 + unit(rng) * 195);
+        scene.local[i] = side > 0 && row >= r0 && row < r0 + side && col >= c0 && col < c0 + side;
+        const float noise = 0.7f;
+        if (scene.local[i]) {
+            v.dx = clamp8(hx + noise * uni(rng));
+            v.dy = clamp8(hy + noise * uni(rng));
+        } else {
+            v.dx = clamp8(scene.tx + zoom * x - rot * y + noise * uni(rng));
+            v.dy = clamp8(scene.ty + rot * x + zoom * y + noise * uni(rng));
+        }
+        scene.local[i] = scene.local[i] && v.valid;
+    }
+    return scene;
+}
+}
+
+int main(int argc, char** argv) {
+    const int frames = argc > 1 ? atoi(argv[1]) : 20000;
+    std::mt19937 rng(argc > 2 ? (unsigned)atoi(argv[2]) : 1234u);
+    static const float SHARES[] = {0.0f, 0.1f, 0.25f, 0.4f};
+
+    printf("local%%  err_ego_px  err_mean_px  precision  recall  false/frame  affine%%  ns/frame\n");
+    for (float share : SHARES) {
+        double errEgo = 0.0, errMean = 0.0, ns = 0.0;
+        unsigned long truePos = 0, falsePos = 0, falseNeg = 0, affine = 0;
+        volatile float sink = 0.0f;
+
+        for (int f = 0; f < frames; f++) {
+            const Scene scene = makeScene(rng, share);
+            EgoMotion::Estimate est;
+            const auto start = std::chrono::steady_clock::now();
+            EgoMotion::estimate(scene.vectors, est);
+            ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            sink = sink + est.tx;
+
+            // Media pesata dei blocchi (stima globale precedente)
+            float sdx = 0.0f, sdy = 0.0f, sw = 0.0f;
+            for (int i = 0; i < EgoMotion::BLOCK_COUNT; i++) {
+                const EgoMotion::Vector& v = scene.vectors[i];
+                if (!v.valid) continue;
+                sdx += v.dx * v.confidence;
+                sdy += v.dy * v.confidence;
+                sw += v.confidence;
+            }
+            errEgo += hypotf(est.tx - scene.tx, est.ty - scene.ty);
+            errMean += sw > 0.0f ? hypotf(sdx / sw - scene.tx, sdy / sw - scene.ty) : 0.0f;
+            affine += est.model == EgoMotion::Model::AFFINE;
+
+            for (int i = 0; i < EgoMotion::BLOCK_COUNT; i++) {
+                const bool flagged = (est.outlierMask >> i) & 1ULL;
+                truePos += flagged && scene.local[i];
+                falsePos += flagged && !scene.local[i];
+                falseNeg += !flagged && scene.local[i];
+            }
+        }
+
+        const double precision = truePos + falsePos ? (double)truePos / (truePos + falsePos) : 1.0;
+        const double recall = truePos + falseNeg ? (double)truePos / (truePos + falseNeg) : 1.0;
+        printf("%5.0f   %10.3f  %11.3f  %9.3f  %6.3f  %11.2f  %7.1f  %8.0f\n",
+               share * 100.0f, errEgo / frames, errMean / frames, precision, recall,
+               (double)falsePos / frames, 100.0 * affine / frames, ns / frames);
+    }
+    return 0;
+}
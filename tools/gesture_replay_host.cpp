@@ -0,0 +1,149 @@
+// Replay host delle registrazioni motion: compila lo stesso sorgente del firmware.
+//
+//   g++ -O2 -std=c++17 -Isrc tools/gesture_replay_host.cpp src/MotionHistory.cpp src/GestureClassifier.cpp -o gesture_replay_host
+//   ./gesture_replay_host features < session.csv > features.csv
+//   ./gesture_replay_host classify < session.csv > predictions.csv
+//
+// Input: dataset CSV (header con i nomi colonna, vedi doc/GESTURE_CONTROL_BLE.md);
+// righe "#" ignorate, "# reset" svuota lo storico (sessioni concatenate).
+// Ogni riga passa da MotionHistory::push + GestureClassifier::extract come
+// sul device, quindi le feature di training coincidono con quelle a runtime.
+//
+//   features: "label,f0,...,fN" per frame
+//   classify: "label,t_ms,classe,confidenza" per frame; su stderr il tempo medio e
+//             massimo di extract + classify per frame
+// Usato da tools/gesture_train.py.
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "GestureClassifier.h"
+#include "MotionHistory.h"
+
+static const char* const COLUMNS[] = {
+    "t_ms", "flow_x_q4", "flow_y_q4", "div_q4", "curl_q4", "intensity",
+    "active_blocks", "speed_q4", "centroid_valid", "centroid_x", "centroid_y", "label",
+};
+static constexpr size_t COLUMN_COUNT = sizeof(COLUMNS) / sizeof(COLUMNS[0]);
+static constexpr size_t LABEL_COLUMN = COLUMN_COUNT - 1;
+
+static std::vector<std::string> split(const std::string& line) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while (true) {
+        const size_t comma = line.find(',', start);
+        fields.push_back(line.substr(start, comma == std::string::npos ? std::string::npos : comma - start));
+        if (comma == std::string::npos) {
+            return fields;
+        }
+        start = comma + 1;
+    }
+}
+
+int main(int argc, char** argv) {
+    const bool classify = argc > 1 && strcmp(argv[1], "classify") == 0;
+    if (argc < 2 || (!classify && strcmp(argv[1], "features") != 0)) {
+        fprintf(stderr, "usage: %s features|classify < dataset.csv\n", argv[0]);
+        return 2;
+    }
+
+    MotionHistory history;
+    GestureClassifier classifier;
+    int columnIndex[COLUMN_COUNT];
+    bool haveHeader = false;
+    unsigned long frames = 0;
+    double totalNs = 0.0;
+    double maxNs = 0.0;
+
+    char buffer[512];
+    while (fgets(buffer, sizeof(buffer), stdin) != nullptr) {
+        std::string line(buffer);
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) {
+            line.pop_back();
+        }
+        if (line.empty()) {
+            continue;
+        }
+        if (line[0] == '#') {
+            if (line.rfind("# reset", 0) == 0) {
+                history.reset();
+            }
+            continue;
+        }
+
+        // Header ripetuto all'inizio di ogni sessione concatenata
+        const std::vector<std::string> fields = split(line);
+        if (!haveHeader || fields[0] == COLUMNS[0]) {
+            for (size_t c = 0; c < COLUMN_COUNT; c++) {
+                columnIndex[c] = -1;
+                for (size_t f = 0; f < fields.size(); f++) {
+                    if (fields[f] == COLUMNS[c]) {
+                        columnIndex[c] = (int)f;
+                    }
+                }
+                if (columnIndex[c] < 0 && c != LABEL_COLUMN) {
+                    fprintf(stderr, "missing column %s\n", COLUMNS[c]);
+                    return 1;
+                }
+            }
+            haveHeader = true;
+            continue;
+        }
+
+        auto value = [&](size_t column) -> long {
+            const int index = columnIndex[column];
+            return index >= 0 && (size_t)index < fields.size() ? strtol(fields[index].c_str(), nullptr, 10) : 0;
+        };
+        MotionHistory::Sample sample;
+        memset(&sample, 0, sizeof(sample));
+        sample.timestamp = (uint32_t)value(0);
+        sample.flowXQ4 = (int16_t)value(1);
+        sample.flowYQ4 = (int16_t)value(2);
+        sample.divQ4 = (int16_t)value(3);
+        sample.curlQ4 = (int16_t)value(4);
+        sample.intensity = (uint8_t)value(5);
+        sample.activeBlocks = (uint8_t)value(6);
+        sample.speedQ4 = (uint16_t)value(7);
+        sample.centroidValid = value(8) != 0;
+        sample.centroidX = (uint8_t)value(9);
+        sample.centroidY = (uint8_t)value(10);
+        const int labelIndex = columnIndex[LABEL_COLUMN];
+        const std::string label = labelIndex >= 0 && (size_t)labelIndex < fields.size() && !fields[labelIndex].empty()
+            ? fields[labelIndex] : "none";
+
+        history.push(sample);
+
+        const auto start = std::chrono::steady_clock::now();
+        GestureClassifier::Features features;
+        GestureClassifier::Result result = {0, 0};
+        if (GestureClassifier::extract(history, features)) {
+            result = classifier.classify(features);
+        }
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        totalNs += ns;
+        if (ns > maxNs) {
+            maxNs = ns;
+        }
+        frames++;
+
+        if (classify) {
+            printf("%s,%u,%u,%u\n", label.c_str(), (unsigned)sample.timestamp, result.gesture, result.confidence);
+        } else {
+            printf("%s", label.c_str());
+            for (uint8_t f = 0; f < GestureClassifier::FEATURE_COUNT; f++) {
+                printf(",%d", features.v[f]);
+            }
+            printf("\n");
+        }
+    }
+
+    if (classify) {
+        fprintf(stderr, "frames %lu, nodes %u, extract+classify %.0f ns/frame avg, %.0f ns max\n",
+                frames, classifier.getNodeCount(), frames ? totalNs / frames : 0.0, maxNs);
+    }
+    return 0;
+}
@@ -0,0 +1,547 @@
+#!/usr/bin/env python3
+"""
+Gesture Train
+Addestra il classificatore gesture int8 (albero di decisione) dalle
+registrazioni motion etichettate e genera src/GestureModel.h.
+
+Pipeline:
+1. tools/gesture_replay_host.cpp (MotionHistory + GestureClassifier del
+   firmware compilati con g++) estrae le feature int8 per frame, identiche a
+   quelle calcolate sul device
+2. CART con pesi bilanciati per classe sulle sessioni di training
+3. scrittura della tabella constexpr dei nodi, ricompilazione del replay con
+   il nuovo modello e valutazione sulle sessioni escluse: matrice di
+   confusione, clash falsi e tempo di inferenza per frame
+
+Dataset: CSV per sessione (formato in doc/GESTURE_CONTROL_BLE.md). Senza
+registrazioni reali --synthetic genera sessioni sintetiche (swing, stop
+bruschi, affondi, rotazioni) per avere un modello di partenza.
+
+Esempi:
+  python3 tools/gesture_train.py recordings/                  # tutti i .csv
+  python3 tools/gesture_train.py --synthetic 200 --dump-synthetic /tmp/synth
+  python3 tools/gesture_train.py recordings/ --eval-only      # valuta il modello attuale
+"""
+
+import argparse
+import math
+import random
+import shutil
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+import numpy as np
+
+PROJECT_ROOT = Path(__file__).resolve().parent.parent
+MODEL_HEADER = PROJECT_ROOT / "src" / "GestureModel.h"
+
+# Ordine = MotionProcessor::GestureType / MotionProcessor::gestureToString
+CLASSES = ["none", "ignition", "retract", "clash", "stab", "spin", "twirl"]
+
+# Ordine = GestureClassifier::Feature
+FEATURES = [
+    "mean_vel_x", "mean_vel_y", "rms_vel", "mean_abs_acc", "mean_abs_jerk", "jerk",
+    "acc_along_vel", "vel_x", "vel_y", "speed", "reversals", "abs_net_turns", "mean_div",
+    "abs_mean_curl", "mean_intensity", "mean_active_blocks", "span",
+]
+
+CSV_HEADER = ("t_ms,flow_x_q4,flow_y_q4,div_q4,curl_q4,intensity,active_blocks,"
+              "speed_q4,centroid_valid,centroid_x,centroid_y,label")
+
+MAX_NODES = 255     # Indici figli uint8
+EVENT_TOLERANCE_MS = 300    # Evento predetto valido se entro questa distanza dall'intervallo etichettato
+
+
+# ============================================================================
+# SESSIONI SINTETICHE
+# ============================================================================
+
+class SyntheticSession:
+    """Sequenza di frame con fps variabile; velocità in px/s convertite in flusso Q4 per frame"""
+
+    def __init__(self, rng: random.Random):
+        self.rng = rng
+        self.fps = rng.uniform(6.0, 30.0)
+        self.t = rng.randint(1000, 5000)
+        self.cx = 128.0
+        self.cy = 128.0
+        self.rows = [CSV_HEADER]
+
+    def frame(self, vx, vy, div=0.0, curl=0.0, label="none"):
+        rng = self.rng
+        dt = 1000.0 / self.fps * rng.uniform(0.85, 1.15)
+        self.t += max(1, int(round(dt)))
+        # Rumore del block matching (quantizzazione SAD)
+        vx += rng.gauss(0, 6)
+        vy += rng.gauss(0, 6)
+        div += rng.gauss(0, 2)
+        curl += rng.gauss(0, 2)
+        scale = dt / 1000.0 * 16.0
+        fx = int(round(vx * scale))
+        fy = int(round(vy * scale))
+        # Divergenza/rotazione in px*mezze-celle per frame (dipendono dal dt come il flusso)
+        fdiv = int(round(div * scale))
+        fcurl = int(round(curl * scale))
+        speed = math.hypot(vx, vy) + abs(div) * 0.3 + abs(curl) * 0.3
+        intensity = min(255, int(speed / 3 + rng.uniform(0, 6)))
+        active = min(64, int(speed / 8 + rng.uniform(0, 3)))
+        speed_q4 = min(65535, int(round(speed * dt / 1000.0 * 16.0)))
+        self.cx = min(255.0, max(0.0, self.cx + vx * dt / 1000.0 * 0.5))
+        self.cy = min(255.0, max(0.0, self.cy + vy * dt / 1000.0 * 0.5))
+        valid = 1 if active > 2 else 0
+        self.rows.append(f"{self.t},{fx},{fy},{fdiv},{fcurl},{intensity},{active},{speed_q4},"
+                         f"{valid},{int(self.cx) if valid else 0},{int(self.cy) if valid else 0},{label}")
+
+    def frames_for(self, seconds):
+        return max(2, int(round(seconds * self.fps)))
+
+    def idle(self):
+        for _ in range(self.frames_for(self.rng.uniform(0.4, 1.5))):
+            self.frame(self.rng.gauss(0, 4), self.rng.gauss(0, 4))
+
+    def straight(self, label, angle):
+        """Ignition/retract: movimento sostenuto, etichettato dal 2° frame, poi frenata morbida"""
+        rng = self.rng
+        speed = rng.uniform(150, 350)
+        n = self.frames_for(rng.uniform(0.25, 0.5))
+        angle += rng.uniform(-0.3, 0.3)
+        for i in range(n):
+            ramp = min(1.0, (i + 1) / 2)
+            self.frame(speed * ramp * math.cos(angle), speed * ramp * math.sin(angle),
+                       label=label if i >= 1 else "none")
+        for k in (0.5, 0.2):
+            self.frame(speed * k * math.cos(angle), speed * k * math.sin(angle))
+
+    def swing(self, stop):
+        """Swing laterale: con stop brusco è un clash, con frenata graduale no"""
+        rng = self.rng
+        speed = rng.uniform(200, 450)
+        angle = rng.choice([0.0, math.pi]) + rng.uniform(-0.5, 0.5)
+        for _ in range(self.frames_for(rng.uniform(0.15, 0.45))):
+            self.frame(speed * math.cos(angle), speed * math.sin(angle))
+        if stop:
+            bounce = -rng.uniform(0.0, 0.3)
+            self.frame(speed * bounce * math.cos(angle), speed * bounce * math.sin(angle), label="clash")
+            self.frame(0.0, 0.0, label="clash")
+        else:
+            steps = rng.randint(3, 5)
+            for i in range(steps):
+                k = 1.0 - (i + 1) / (steps + 1)
+                self.frame(speed * k * math.cos(angle), speed * k * math.sin(angle))
+
+    def stab(self):
+        """Affondo verso la camera: campo in espansione, poca traslazione"""
+        rng = self.rng
+        div = rng.uniform(60, 160)
+        n = self.frames_for(rng.uniform(0.15, 0.35))
+        for i in range(n):
+            self.frame(rng.gauss(0, 20), rng.gauss(0, 20), div=div, label="stab" if i >= 1 else "none")
+        self.frame(0.0, 0.0, div=div * 0.2)
+
+    def spin(self):
+        """Rotazione della lama sul proprio asse: campo rotazionale"""
+        rng = self.rng
+        curl = rng.choice([-1, 1]) * rng.uniform(60, 160)
+        n = self.frames_for(rng.uniform(0.4, 0.9))
+        for i in range(n):
+            self.frame(rng.gauss(0, 25), rng.gauss(0, 25), curl=curl, label="spin" if i >= 2 else "none")
+
+    def twirl(self):
+        """Traiettoria circolare: il verso del flusso ruota di frame in frame"""
+        rng = self.rng
+        speed = rng.uniform(150, 300)
+        step = rng.choice([-1, 1]) * rng.uniform(0.5, 1.0)
+        angle = rng.uniform(0, 2 * math.pi)
+        n = self.frames_for(rng.uniform(0.6, 1.2))
+        n = max(n, 7)
+        for i in range(n):
+            self.frame(speed * math.cos(angle), speed * math.sin(angle), label="twirl" if i >= 4 else "none")
+            angle += step
+
+    def shake(self):
+        """Scuotimento avanti/indietro: inversioni ripetute, non è una gesture"""
+        rng = self.rng
+        speed = rng.uniform(100, 250)
+        angle = rng.uniform(0, math.pi)
+        for i in range(self.frames_for(rng.uniform(0.4, 0.8))):
+            sign = 1 if i % 2 == 0 else -1
+            self.frame(sign * speed * math.cos(angle), sign * speed * math.sin(angle))
+
+
+def synthetic_sessions(count: int, seed: int):
+    rng = random.Random(seed)
+    actions = [
+        lambda s: s.straight("ignition", -math.pi / 2),
+        lambda s: s.straight("retract", math.pi / 2),
+        lambda s: s.swing(stop=True),
+        lambda s: s.swing(stop=True),
+        lambda s: s.swing(stop=False),
+        lambda s: s.swing(stop=False),
+        SyntheticSession.stab,
+        SyntheticSession.spin,
+        SyntheticSession.twirl,
+        SyntheticSession.shake,
+    ]
+    sessions = []
+    for index in range(count):
+        session = SyntheticSession(rng)
+        for _ in range(rng.randint(4, 8)):
+            session.idle()
+            rng.choice(actions)(session)
+        session.idle()
+        sessions.append((f"synthetic_{index:03d}", "\n".join(session.rows) + "\n"))
+    return sessions
+
+
+# ============================================================================
+# REPLAY HOST
+# ============================================================================
+
+def build_replay(out_dir: Path, model: Path) -> Path:
+    """Compila il replay contro un modello specifico (copia dei sorgenti firmware + header)"""
+    compiler = shutil.which("g++") or shutil.which("clang++")
+    if compiler is None:
+        print("✗ Serve g++ o clang++ per compilare il replay del firmware")
+        sys.exit(2)
+    src_dir = out_dir / "src"
+    src_dir.mkdir(exist_ok=True)
+    for name in ("MotionHistory.h", "MotionHistory.cpp", "GestureClassifier.h", "GestureClassifier.cpp"):
+        shutil.copy(PROJECT_ROOT / "src" / name, src_dir / name)
+    shutil.copy(model, src_dir / "GestureModel.h")
+    binary = out_dir / "gesture_replay_host"
+    subprocess.run([
+        compiler, "-O2", "-std=c++17", "-Wall",
+        f"-I{src_dir}",
+        str(PROJECT_ROOT / "tools" / "gesture_replay_host.cpp"),
+        str(src_dir / "MotionHistory.cpp"),
+        str(src_dir / "GestureClassifier.cpp"),
+        "-o", str(binary),
+    ], check=True)
+    return binary
+
+
+def replay(binary: Path, mode: str, text: str):
+    result = subprocess.run([str(binary), mode], input=text.encode(), capture_output=True, check=True)
+    rows = [line.split(",") for line in result.stdout.decode().splitlines() if line]
+    return rows, result.stderr.decode().strip()
+
+
+def label_index(name: str, session: str) -> int:
+    name = name.strip().lower() or "none"
+    if name not in CLASSES:
+        print(f"✗ {session}: etichetta sconosciuta '{name}' (attese: {', '.join(CLASSES)})")
+        sys.exit(2)
+    return CLASSES.index(name)
+
+
+def extract_features(binary: Path, sessions):
+    xs, ys = [], []
+    for name, text in sessions:
+        rows, _ = replay(binary, "features", text)
+        for row in rows:
+            ys.append(label_index(row[0], name))
+            xs.append([int(v) for v in row[1:]])
+    if not xs:
+        return np.zeros((0, len(FEATURES)), dtype=np.int16), np.zeros(0, dtype=np.int16)
+    x = np.array(xs, dtype=np.int16)
+    if x.shape[1] != len(FEATURES):
+        print(f"✗ Il replay produce {x.shape[1]} feature, lo script ne conosce {len(FEATURES)}")
+        sys.exit(2)
+    return x, np.array(ys, dtype=np.int16)
+
+
+# ============================================================================
+# CART INT8
+# ============================================================================
+
+def gini(counts):
+    total = counts.sum(axis=-1)
+    with np.errstate(divide="ignore", invalid="ignore"):
+        p = counts / total[..., None]
+        g = 1.0 - (p * p).sum(axis=-1)
+    return np.nan_to_num(g), total
+
+
+def best_split(x, y, w, min_leaf):
+    """Soglia int8 migliore: istogramma pesato per (valore, classe), somme cumulative"""
+    n_classes = len(CLASSES)
+    parent, total = gini(np.bincount(y, weights=w, minlength=n_classes))
+    best = None
+    for feature in range(x.shape[1]):
+        values = x[:, feature].astype(np.int32) + 128
+        hist = np.zeros((256, n_classes))
+        np.add.at(hist, (values, y), w)
+        left = np.cumsum(hist, axis=0)[:-1]
+        right = hist.sum(axis=0) - left
+        g_left, w_left = gini(left)
+        g_right, w_right = gini(right)
+        valid = (w_left >= min_leaf) & (w_right >= min_leaf)
+        if not valid.any():
+            continue
+        impurity = (g_left * w_left + g_right * w_right) / total
+        impurity[~valid] = np.inf
+        threshold = int(np.argmin(impurity))
+        gain = parent - impurity[threshold]
+        if gain > 1e-6 and (best is None or gain > best[0]):
+            best = (gain, feature, threshold - 128)
+    return best
+
+
+def train_tree(x, y, max_depth, min_leaf):
+    n_classes = len(CLASSES)
+    # Bilanciamento attenuato (radice): pesi pieni fanno scattare gesture sui frame di riposo
+    counts = np.bincount(y, minlength=n_classes).astype(float)
+    class_weight = np.where(counts > 0, np.sqrt(len(y) / (n_classes * np.maximum(counts, 1))), 0.0)
+    w = class_weight[y]
+    min_leaf_weight = min_leaf * float(w.mean())
+
+    nodes = []
+    truncated = [False]
+
+    def leaf(mask):
+        dist = np.bincount(y[mask], weights=w[mask], minlength=n_classes)
+        cls = int(np.argmax(dist))
+        confidence = int(round(100 * dist[cls] / dist.sum())) if dist.sum() > 0 else 0
+        nodes.append([-1, 0, cls, confidence])
+
+    def grow(mask, depth):
+        index = len(nodes)
+        split = None
+        if depth < max_depth and len(np.unique(y[mask])) > 1:
+            split = best_split(x[mask], y[mask], w[mask], min_leaf_weight)
+        # Spazio per il nodo + almeno due foglie
+        if split is not None and len(nodes) + 3 > MAX_NODES:
+            truncated[0] = True
+            split = None
+        if split is None:
+            leaf(mask)
+            return index
+        _, feature, threshold = split
+        nodes.append([feature, threshold, 0, 0])
+        go_left = mask & (x[:, feature] <= threshold)
+        go_right = mask & (x[:, feature] > threshold)
+        nodes[index][2] = grow(go_left, depth + 1)
+        nodes[index][3] = grow(go_right, depth + 1)
+        return index
+
+    grow(np.ones(len(y), dtype=bool), 0)
+    if truncated[0]:
+        print(f"⚠ Raggiunto il limite di {MAX_NODES} nodi: alcuni rami sono foglie premature, riduci --max-depth")
+    return _prune(nodes)
+
+
+def _prune(nodes):
+    """Fonde gli split con due foglie della stessa classe (non cambiano la predizione)"""
+    changed = True
+    while changed:
+        changed = False
+        for node in nodes:
+            if node[0] < 0:
+                continue
+            left, right = nodes[node[2]], nodes[node[3]]
+            if left[0] < 0 and right[0] < 0 and left[2] == right[2]:
+                node[:] = [-1, 0, left[2], min(left[3], right[3])]
+                changed = True
+    # Rinumera in preordine scartando i nodi non più raggiungibili
+    out = []
+
+    def copy(index):
+        node = list(nodes[index])
+        position = len(out)
+        out.append(node)
+        if node[0] >= 0:
+            out[position][2] = copy(node[2])
+            out[position][3] = copy(node[3])
+        return position
+
+    copy(0)
+    return out
+
+
+def predict(nodes, x):
+    out = np.zeros(len(x), dtype=np.int16)
+    for row, features in enumerate(x):
+        index = 0
+        while nodes[index][0] >= 0:
+            feature, threshold, left, right = nodes[index]
+            index = left if features[feature] <= threshold else right
+        out[row] = nodes[index][2]
+    return out
+
+
+def write_header(nodes, summary: str, path: Path):
+    lines = [
+        "// Generato da tools/gesture_train.py - non modificare a mano.",
+        f"// {summary}",
+        "#ifndef GESTURE_MODEL_H",
+        "#define GESTURE_MODEL_H",
+        "",
+        '#include "GestureClassifier.h"',
+        "",
+        "namespace GestureModel {",
+        f"constexpr uint8_t FEATURE_COUNT = {len(FEATURES)};",
+        f"constexpr uint8_t CLASS_COUNT = {len(CLASSES)};",
+        f"constexpr uint16_t NODE_COUNT = {len(nodes)};",
+        "",
+        "constexpr GestureClassifier::Node NODES[NODE_COUNT] = {",
+    ]
+    for index, (feature, threshold, left, right) in enumerate(nodes):
+        if feature < 0:
+            comment = f"{CLASSES[left]} ({right}%)"
+        else:
+            comment = f"{FEATURES[feature]} <= {threshold}"
+        lines.append(f"    {{ {feature:3d}, {threshold:4d}, {left:3d}, {right:3d} }},  // {index:3d}: {comment}")
+    lines += ["};", "}  // namespace GestureModel", "", "#endif // GESTURE_MODEL_H", ""]
+    path.write_text("\n".join(lines))
+
+
+# ============================================================================
+# VALUTAZIONE
+# ============================================================================
+
+def evaluate(binary: Path, sessions, min_confidence: int, cooldown_ms: int):
+    """Confusione per frame + eventi come sul device (primo frame sopra soglia, poi cooldown)"""
+    n = len(CLASSES)
+    confusion = np.zeros((n, n), dtype=int)
+    events = {"ok": 0, "wrong": 0, "false": 0, "false_clash": 0, "missed": 0}
+    text = "".join(f"# reset\n{body}" for _, body in sessions)
+    rows, timing = replay(binary, "classify", text)
+
+    labels = [label_index(r[0], "dataset") for r in rows]
+    # Tempi resi monotoni tra sessioni: eventi e finestre non si sovrappongono
+    times = []
+    offset = 0
+    for _, body in sessions:
+        count = sum(1 for line in body.splitlines() if line and line[0] != "#" and not line.startswith("t_ms"))
+        base = len(times)
+        for r in rows[base:base + count]:
+            times.append(int(r[1]) + offset)
+        offset = times[-1] + 10 * (cooldown_ms + EVENT_TOLERANCE_MS) if times else offset
+    if len(times) != len(rows):
+        print(f"✗ Il replay ha restituito {len(rows)} frame, attesi {len(times)}")
+        sys.exit(1)
+    predicted = [int(r[2]) if int(r[3]) >= min_confidence else 0 for r in rows]
+    for label, pred in zip(labels, predicted):
+        confusion[label, pred] += 1
+
+    cooldown_end = None
+    matched_spans = set()
+    spans = []      # (classe, inizio, fine) in indici frame
+    for i, label in enumerate(labels):
+        if label and (not spans or spans[-1][0] != label or spans[-1][2] != i - 1):
+            spans.append([label, i, i])
+        elif label:
+            spans[-1][2] = i
+    for i, pred in enumerate(predicted):
+        if cooldown_end is not None and times[i] < cooldown_end and times[i] >= cooldown_end - cooldown_ms:
+            continue
+        if pred == 0:
+            continue
+        cooldown_end = times[i] + cooldown_ms
+        hits = [k for k, (cls, start, end) in enumerate(spans)
+                if times[start] - EVENT_TOLERANCE_MS <= times[i] <= times[end] + EVENT_TOLERANCE_MS]
+        if any(spans[k][0] == pred for k in hits):
+            events["ok"] += 1
+            matched_spans.update(k for k in hits if spans[k][0] == pred)
+        elif hits:
+            events["wrong"] += 1
+        else:
+            events["false"] += 1
+            if pred == CLASSES.index("clash"):
+                events["false_clash"] += 1
+    events["missed"] = len(spans) - len(matched_spans)
+    events["spans"] = len(spans)
+    return confusion, events, timing
+
+
+def print_confusion(confusion):
+    width = max(len(c) for c in CLASSES) + 1
+    print(" " * width + "".join(f"{c[:7]:>8}" for c in CLASSES) + "   recall")
+    for i, name in enumerate(CLASSES):
+        row = confusion[i]
+        recall = f"{100 * row[i] / row.sum():6.1f}%" if row.sum() else "     -"
+        print(f"{name:<{width}}" + "".join(f"{v:8d}" for v in row) + f"  {recall}")
+
+
+def load_sessions(paths):
+    sessions = []
+    for path in paths:
+        files = sorted(path.glob("**/*.csv")) if path.is_dir() else [path]
+        for file in files:
+            sessions.append((file.name, file.read_text()))
+    return sessions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Addestra il classificatore gesture int8 e genera src/GestureModel.h")
+    parser.add_argument("datasets", type=Path, nargs="*", help="File CSV o cartelle di registrazioni")
+    parser.add_argument("--synthetic", type=int, default=0, help="Sessioni sintetiche da aggiungere")
+    parser.add_argument("--dump-synthetic", type=Path, help="Salva le sessioni sintetiche in questa cartella")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--max-depth", type=int, default=8)
+    parser.add_argument("--min-leaf", type=int, default=8, help="Frame minimi (pesati) per foglia")
+    parser.add_argument("--holdout", type=float, default=0.2, help="Frazione di sessioni per la valutazione")
+    parser.add_argument("--min-confidence", type=int, default=75, help="Confidenza minima (come minConfidence della tabella gesture)")
+    parser.add_argument("--cooldown-ms", type=int, default=800, help="Cooldown tra eventi nella valutazione")
+    parser.add_argument("--output", type=Path, default=MODEL_HEADER)
+    parser.add_argument("--eval-only", action="store_true", help="Valuta il modello attuale senza riaddestrare")
+    args = parser.parse_args()
+
+    sessions = load_sessions(args.datasets)
+    if args.synthetic:
+        synthetic = synthetic_sessions(args.synthetic, args.seed)
+        if args.dump_synthetic:
+            args.dump_synthetic.mkdir(parents=True, exist_ok=True)
+            for name, text in synthetic:
+                (args.dump_synthetic / f"{name}.csv").write_text(text)
+        sessions += synthetic
+    if not sessions:
+        print("✗ Nessuna sessione: passa registrazioni CSV o usa --synthetic N")
+        sys.exit(2)
+
+    rng = random.Random(args.seed)
+    order = list(range(len(sessions)))
+    rng.shuffle(order)
+    holdout_count = int(round(len(sessions) * args.holdout)) if len(sessions) > 1 else 0
+    test = [sessions[i] for i in order[:holdout_count]]
+    train = [sessions[i] for i in order[holdout_count:]]
+    if args.eval_only:
+        test = sessions
+
+    with tempfile.TemporaryDirectory(prefix="ledsaber_gesture_") as tmp:
+        tmp_dir = Path(tmp)
+        binary = build_replay(tmp_dir, MODEL_HEADER)
+
+        if not args.eval_only:
+            x, y = extract_features(binary, train)
+            counts = np.bincount(y, minlength=len(CLASSES))
+            print(f"Training: {len(train)} sessioni, {len(y)} frame "
+                  f"({', '.join(f'{c}={counts[i]}' for i, c in enumerate(CLASSES) if counts[i])})")
+            nodes = train_tree(x, y, args.max_depth, args.min_leaf)
+            train_acc = float((predict(nodes, x) == y).mean() * 100) if len(y) else 0.0
+            depth_note = f"profondità max {args.max_depth}, {len(nodes)} nodi ({len(nodes) * 4} byte)"
+            print(f"Albero: {depth_note}, accuratezza training {train_acc:.1f}%")
+
+            summary = (f"{len(train)} sessioni / {len(y)} frame"
+                       f"{' (incl. sintetiche)' if args.synthetic else ''}, {depth_note}")
+            write_header(nodes, summary, args.output)
+            print(f"✓ Scritto {args.output}")
+            binary = build_replay(tmp_dir, args.output)
+
+        if test:
+            confusion, events, timing = evaluate(binary, test, args.min_confidence, args.cooldown_ms)
+            total = confusion.sum()
+            accuracy = 100.0 * np.trace(confusion) / total if total else 0.0
+            print(f"\nValutazione su {len(test)} sessioni, {total} frame "
+                  f"(confidenza >= {args.min_confidence}): accuratezza per frame {accuracy:.1f}%")
+            print_confusion(confusion)
+            print(f"Eventi (cooldown {args.cooldown_ms}ms): {events['ok']}/{events['spans']} gesture riconosciute, "
+                  f"{events['missed']} perse, {events['wrong']} classe errata, "
+                  f"{events['false']} falsi ({events['false_clash']} clash)")
+            print(f"Host: {timing}")
+
+
+if __name__ == "__main__":
+    main()
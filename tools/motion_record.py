@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""
+Motion Record
+Registra sessioni motion etichettate via BLE e le scrive nel formato dataset
+di tools/gesture_train.py / tools/gesture_replay_host.cpp.
+
+Il device (comando "record start") invia un record compatto per ogni frame
+elaborato sulla characteristic Motion Record, con l'etichetta corrente già
+applicata: scrivendo il nome di una gesture (es. "clash") lo script invia
+"label clash" e, dopo --mark-ms, "label none". L'etichetta resta quindi
+allineata ai frame anche con latenza BLE variabile.
+
+Se il link si ferma il device bufferizza in PSRAM; i record persi (ring pieno)
+si vedono come salti di seq e lo script inserisce "# reset", così il replay
+non calcola derivate attraverso il buco.
+
+Comandi da tastiera durante la registrazione:
+  <gesture>        marca la gesture (none, ignition, retract, clash, stab, spin, twirl)
+  hold <gesture>   etichetta fissa fino al prossimo comando
+  q                ferma e salva
+
+Esempi:
+  python3 tools/motion_record.py
+  python3 tools/motion_record.py --address AA:BB:CC:DD:EE:FF --mark-ms 600
+  python3 tools/motion_record.py --output recordings/clash_01.csv --duration 60
+"""
+
+import argparse
+import asyncio
+import sys
+import threading
+import time
+from pathlib import Path
+
+PROJECT_ROOT = Path(__file__).resolve().parent.parent
+sys.path.insert(0, str(PROJECT_ROOT))
+
+from ledsaber_control import LedSaberClient, Colors  # noqa: E402
+
+# Ordine = MotionProcessor::GestureType (label del record)
+CLASSES = ["none", "ignition", "retract", "clash", "stab", "spin", "twirl"]
+
+# Stesso formato di tools/gesture_train.py (CSV_HEADER)
+CSV_HEADER = ("t_ms,flow_x_q4,flow_y_q4,div_q4,curl_q4,intensity,active_blocks,"
+              "speed_q4,centroid_valid,centroid_x,centroid_y,label")
+
+
+class DatasetWriter:
+    """Scrive i record nel CSV dataset; un salto di seq diventa "# reset" """
+
+    def __init__(self, path: Path):
+        self.path = path
+        self.file = path.open("w", newline="\n")
+        self.file.write(CSV_HEADER + "\n")
+        self.last_seq = None
+        self.frames = 0
+        self.lost = 0
+        self.labeled = 0
+
+    def add(self, record: dict):
+        if self.last_seq is not None:
+            gap = (record["seq"] - self.last_seq - 1) & 0xFFFF
+            if gap:
+                self.lost += gap
+                self.file.write(f"# reset lost={gap}\n")
+        self.last_seq = record["seq"]
+
+        label = CLASSES[record["label"]] if record["label"] < len(CLASSES) else "none"
+        self.file.write(
+            f"{record['timestampMs']},{record['flowXQ4']},{record['flowYQ4']},"
+            f"{record['divQ4']},{record['curlQ4']},{record['intensity']},"
+            f"{record['activeBlocks']},{record['speedQ4']},{int(record['centroidValid'])},"
+            f"{record['centroidX']},{record['centroidY']},{label}\n")
+        self.frames += 1
+        if label != "none":
+            self.labeled += 1
+
+    def close(self):
+        self.file.close()
+
+
+async def read_commands(client: LedSaberClient, mark_ms: int, stop: asyncio.Event):
+    """Legge le etichette da tastiera senza bloccare la ricezione BLE"""
+    # Thread daemon: un readline pendente non blocca l'uscita con --duration
+    loop = asyncio.get_running_loop()
+    lines = asyncio.Queue()
+
+    def reader():
+        for text in sys.stdin:
+            loop.call_soon_threadsafe(lines.put_nowait, text)
+        loop.call_soon_threadsafe(lines.put_nowait, "")
+
+    threading.Thread(target=reader, daemon=True).start()
+
+    release = None
+    while not stop.is_set():
+        line = await lines.get()
+        if not line:
+            stop.set()
+            return
+        words = line.strip().lower().split()
+        if not words:
+            continue
+        if words[0] in ("q", "quit", "exit"):
+            stop.set()
+            return
+
+        hold = words[0] == "hold" and len(words) > 1
+        name = words[1] if hold else words[0]
+        if name not in CLASSES:
+            print(f"{Colors.RED}✗ Gesture sconosciuta: {name}{Colors.RESET}")
+            continue
+
+        if release:
+            release.cancel()
+            release = None
+        await client.motion_send_command(f"label {name}")
+        if not hold and name != "none":
+            async def unmark():
+                await asyncio.sleep(mark_ms / 1000.0)
+                await client.motion_send_command("label none")
+            release = asyncio.create_task(unmark())
+
+
+async def main():
+    parser = argparse.ArgumentParser(description="Registra sessioni motion etichettate via BLE")
+    parser.add_argument("--address", help="Indirizzo BLE (default: primo LedSaber trovato)")
+    parser.add_argument("--output", type=Path,
+                        help="CSV di uscita (default: recordings/session_<data>.csv)")
+    parser.add_argument("--mark-ms", type=int, default=400,
+                        help="Durata dell'etichetta dopo il nome di una gesture (default 400)")
+    parser.add_argument("--duration", type=float, default=0.0,
+                        help="Ferma dopo N secondi (default: fino a 'q')")
+    args = parser.parse_args()
+
+    output = args.output or PROJECT_ROOT / "recordings" / time.strftime("session_%Y%m%d_%H%M%S.csv")
+    output.parent.mkdir(parents=True, exist_ok=True)
+
+    client = LedSaberClient()
+    address = args.address
+    if not address:
+        devices = await client.scan()
+        if not devices:
+            print(f"{Colors.RED}✗ Nessun LedSaber trovato{Colors.RESET}")
+            return 1
+        address = devices[0].address
+    if not await client.connect(address):
+        return 1
+
+    writer = DatasetWriter(output)
+    stop = asyncio.Event()
+    try:
+        await client.motion_send_command("label none")
+        await client.start_motion_record(writer.add)
+        print(f"{Colors.CYAN}● Registrazione su {output} - gesture: {', '.join(CLASSES[1:])}, "
+              f"'q' per fermare{Colors.RESET}")
+
+        commands = asyncio.create_task(read_commands(client, args.mark_ms, stop))
+        started = time.monotonic()
+        while not stop.is_set():
+            await asyncio.sleep(0.5)
+            if args.duration and time.monotonic() - started >= args.duration:
+                stop.set()
+        commands.cancel()
+
+        await client.motion_send_command("label none")
+        await client.stop_motion_record()
+    finally:
+        writer.close()
+        await client.disconnect()
+
+    print(f"{Colors.GREEN}✓ {writer.frames} frame ({writer.labeled} etichettati), "
+          f"{writer.lost} persi -> {output}{Colors.RESET}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(asyncio.run(main()))
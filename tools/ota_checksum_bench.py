@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+"""
+OTA Checksum Bench
+Costo per MB dei checksum OTA lato host: CRC32 (zlib, stesso polinomio di
+esp_rom_crc32_le) e SHA-256 del digest inviato nel START, a blocchi da 512 byte
+(chunk BLE) e 4KB (settori, come li aggiorna il device).
+
+Il costo sul device viene stampato a fine OTA dal firmware:
+  [OTA] Checksum cost: <us> us (<us/MB> us/MB)
+
+Esempi:
+  python3 tools/ota_checksum_bench.py
+  python3 tools/ota_checksum_bench.py --size-mb 4 firmware.bin
+"""
+
+import argparse
+import hashlib
+import os
+import time
+import zlib
+from pathlib import Path
+
+
+def bench(name: str, data: bytes, block: int, update, repeat: int) -> None:
+    best = float("inf")
+    for _ in range(repeat):
+        start = time.perf_counter()
+        update(data, block)
+        best = min(best, time.perf_counter() - start)
+    mb = len(data) / (1024 * 1024)
+    print(f"  {name:<8} blocchi {block:>5} B: {best / mb * 1000:7.2f} ms/MB  ({mb / best:7.1f} MB/s)")
+
+
+def crc_blocks(data: bytes, block: int) -> int:
+    crc = 0
+    view = memoryview(data)
+    for offset in range(0, len(data), block):
+        crc = zlib.crc32(view[offset:offset + block], crc)
+    return crc
+
+
+def sha_blocks(data: bytes, block: int) -> bytes:
+    sha = hashlib.sha256()
+    view = memoryview(data)
+    for offset in range(0, len(data), block):
+        sha.update(view[offset:offset + block])
+    return sha.digest()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Costo per MB di CRC32 e SHA-256 OTA (host)")
+    parser.add_argument("firmware", type=Path, nargs="?", help="Immagine da usare (default: dati casuali)")
+    parser.add_argument("--size-mb", type=float, default=1.5, help="Dimensione dei dati casuali")
+    parser.add_argument("--repeat", type=int, default=5)
+    args = parser.parse_args()
+
+    data = args.firmware.read_bytes() if args.firmware else os.urandom(int(args.size_mb * 1024 * 1024))
+    print(f"{len(data)} byte, CRC32 0x{zlib.crc32(data):08X}, SHA-256 {hashlib.sha256(data).hexdigest()[:16]}...")
+
+    # Il risultato a blocchi deve coincidere con quello one-shot (CRC in streaming corretto)
+    assert crc_blocks(data, 512) == zlib.crc32(data)
+    assert sha_blocks(data, 4096) == hashlib.sha256(data).digest()
+
+    for block in (512, 4096):
+        bench("CRC32", data, block, crc_blocks, args.repeat)
+        bench("SHA-256", data, block, sha_blocks, args.repeat)
+
+
+if __name__ == "__main__":
+    main()
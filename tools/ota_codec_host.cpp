@@ -0,0 +1,105 @@
+// Driver host del decoder OTA: compila lo stesso sorgente del firmware.
+//
+//   g++ -O2 -std=c++17 -Iinclude tools/ota_codec_host.cpp src/HeatshrinkDecoder.cpp -o ota_codec_host
+//   g++ ... src/DeltaPatcher.cpp (anche OTA delta)
+//   ./ota_codec_host <windowBits> <lookaheadBits> [seed] [source.bin] < stream.hs > image.bin
+//
+// Lo stream viene passato al decoder a pezzi di dimensione casuale (1-512
+// byte) per simulare i chunk BLE spezzati in punti arbitrari. Con source.bin
+// l'output del decoder è una patch delta applicata da DeltaPatcher contro
+// quel file, come fa il device con la partizione in esecuzione.
+// Usato da tools/ota_compress_test.py e tools/ota_delta_test.py.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "DeltaPatcher.h"
+#include "HeatshrinkDecoder.h"
+
+static std::vector<uint8_t> source;
+static DeltaPatcher patcher;
+
+static bool writeOutput(void* context, const uint8_t* data, size_t length) {
+    FILE* out = static_cast<FILE*>(context);
+    return fwrite(data, 1, length, out) == length;
+}
+
+static bool readSource(void* context, uint32_t offset, uint8_t* buffer, size_t length) {
+    (void)context;
+    if (offset > source.size() || length > source.size() - offset) {
+        return false;
+    }
+    memcpy(buffer, source.data() + offset, length);
+    return true;
+}
+
+static bool patchOutput(void* context, const uint8_t* data, size_t length) {
+    if (!patcher.feed(data, length, writeOutput, context)) {
+        fprintf(stderr, "%s\n", patcher.isCorrupt() ? "corrupt delta patch" : "delta output error");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <windowBits> <lookaheadBits> [seed] [source.bin]\n", argv[0]);
+        return 2;
+    }
+    const int windowBits = atoi(argv[1]);
+    const int lookaheadBits = atoi(argv[2]);
+    srand(argc > 3 ? (unsigned)atoi(argv[3]) : 1u);
+
+    std::vector<uint8_t> input;
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), stdin)) > 0) {
+        input.insert(input.end(), buffer, buffer + n);
+    }
+
+    HeatshrinkDecoder::Sink sink = writeOutput;
+    if (argc > 4) {
+        FILE* file = fopen(argv[4], "rb");
+        if (file == nullptr) {
+            fprintf(stderr, "cannot open %s\n", argv[4]);
+            return 2;
+        }
+        while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            source.insert(source.end(), buffer, buffer + n);
+        }
+        fclose(file);
+        patcher.begin((uint32_t)source.size(), readSource, nullptr);
+        sink = patchOutput;
+    }
+
+    HeatshrinkDecoder decoder;
+    if (!decoder.begin((uint8_t)windowBits, (uint8_t)lookaheadBits)) {
+        fprintf(stderr, "invalid decoder parameters\n");
+        return 1;
+    }
+
+    size_t pos = 0;
+    while (pos < input.size()) {
+        size_t chunk = 1 + (size_t)(rand() % 512);
+        if (chunk > input.size() - pos) {
+            chunk = input.size() - pos;
+        }
+        if (!decoder.feed(input.data() + pos, chunk, sink, stdout)) {
+            fprintf(stderr, "sink error at input offset %zu\n", pos);
+            return 1;
+        }
+        pos += chunk;
+    }
+    if (!decoder.flush(sink, stdout)) {
+        return 1;
+    }
+    if (sink == patchOutput && !patcher.isComplete()) {
+        fprintf(stderr, "truncated delta patch\n");
+        return 1;
+    }
+
+    fprintf(stderr, "decoded %u bytes\n", (unsigned)decoder.getOutputBytes());
+    return 0;
+}
@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+"""
+OTA Compress Test
+Round-trip dei firmware reali: encoder host (ota_protocol.heatshrink_compress)
+-> decoder del firmware (src/HeatshrinkDecoder.cpp compilato con g++).
+
+Il decoder riceve lo stream a pezzi di dimensione casuale, come i chunk BLE.
+Stampa rapporto di compressione e tempo di airtime stimato; exit code 1 se
+un'immagine non torna identica.
+
+Esempi:
+  python3 tools/ota_compress_test.py                       # .pio/build/*/firmware.bin
+  python3 tools/ota_compress_test.py firmware_v1.bin firmware_v2.bin
+  python3 tools/ota_compress_test.py --window-bits 13 --lookahead-bits 5 firmware.bin
+"""
+
+import argparse
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+from pathlib import Path
+
+PROJECT_ROOT = Path(__file__).resolve().parent.parent
+sys.path.insert(0, str(PROJECT_ROOT))
+
+from ota_protocol import heatshrink_compress, HS_WINDOW_BITS, HS_LOOKAHEAD_BITS  # noqa: E402
+
+
+def build_decoder(out_dir: Path) -> Path:
+    compiler = shutil.which("g++") or shutil.which("clang++")
+    if compiler is None:
+        print("✗ Serve g++ o clang++ per compilare il decoder del firmware")
+        sys.exit(2)
+    binary = out_dir / "ota_codec_host"
+    subprocess.run([
+        compiler, "-O2", "-std=c++17", "-Wall",
+        f"-I{PROJECT_ROOT / 'include'}",
+        str(PROJECT_ROOT / "tools" / "ota_codec_host.cpp"),
+        str(PROJECT_ROOT / "src" / "HeatshrinkDecoder.cpp"),
+        str(PROJECT_ROOT / "src" / "DeltaPatcher.cpp"),
+        "-o", str(binary),
+    ], check=True)
+    return binary
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Round-trip OTA compresso (encoder host -> decoder firmware)")
+    parser.add_argument("firmware", type=Path, nargs="*", help="Immagini .bin (default: .pio/build/*/firmware.bin)")
+    parser.add_argument("--window-bits", type=int, default=HS_WINDOW_BITS)
+    parser.add_argument("--lookahead-bits", type=int, default=HS_LOOKAHEAD_BITS)
+    parser.add_argument("--link-kbps", type=float, default=60.0, help="Banda BLE per la stima dei tempi")
+    parser.add_argument("--seeds", type=int, default=3, help="Frammentazioni casuali diverse per immagine")
+    args = parser.parse_args()
+
+    images = args.firmware or sorted(PROJECT_ROOT.glob(".pio/build/*/firmware.bin"))
+    if not images:
+        print("✗ Nessun firmware trovato: compila con `platformio run` o passa i .bin come argomenti")
+        sys.exit(2)
+
+    failures = 0
+    with tempfile.TemporaryDirectory(prefix="ledsaber_ota_codec_") as tmp:
+        decoder = build_decoder(Path(tmp))
+        print(f"heatshrink w={args.window_bits} l={args.lookahead_bits} "
+              f"(RAM decoder: {1 << args.window_bits} byte di finestra)\n")
+
+        for path in images:
+            image = path.read_bytes()
+            start = time.time()
+            stream = heatshrink_compress(image, args.window_bits, args.lookahead_bits)
+            encode_s = time.time() - start
+
+            ok = True
+            for seed in range(1, args.seeds + 1):
+                result = subprocess.run(
+                    [str(decoder), str(args.window_bits), str(args.lookahead_bits), str(seed)],
+                    input=stream, capture_output=True)
+                if result.returncode != 0 or result.stdout != image:
+                    ok = False
+                    print(f"  seed {seed}: decoder rc={result.returncode}, "
+                          f"{len(result.stdout)}/{len(image)} byte, {result.stderr.decode().strip()}")
+
+            saved = 1.0 - len(stream) / len(image) if image else 0.0
+            raw_s = len(image) / 1024 / args.link_kbps
+            compressed_s = len(stream) / 1024 / args.link_kbps
+            outcome = "OK" if ok else "FAIL"
+            print(f"{path.name}: {len(image)} -> {len(stream)} byte ({saved * 100:.1f}% in meno), "
+                  f"encode {encode_s:.1f}s, airtime ~{raw_s:.0f}s -> ~{compressed_s:.0f}s  {outcome}")
+            if not ok:
+                failures += 1
+
+    if failures:
+        print(f"\n✗ {failures} immagini non ricostruite")
+        sys.exit(1)
+    print("\n✓ Tutte le immagini ricostruite identiche")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""
+OTA Delta Test
+Ricostruisce immagini da patch delta e confronta i byte trasferiti.
+
+Per ogni coppia (base, nuovo):
+1. delta_diff() in ota_protocol.py genera la patch
+2. delta_apply() (riferimento Python) deve ridare l'immagine nuova
+3. la patch compressa heatshrink passa dal decoder + DeltaPatcher del
+   firmware (compilati con g++) a pezzi casuali, come sul device
+
+Senza coppie esplicite usa .pio/build/*/firmware.bin con una modifica
+sintetica stile "ritocco di un effetto": qualche centinaio di byte inseriti a
+metà immagine, una costante cambiata e gli indirizzi IROM successivi
+rilocati. Exit code 1 se un'immagine non torna identica.
+
+Esempi:
+  python3 tools/ota_delta_test.py                               # modifica sintetica
+  python3 tools/ota_delta_test.py --pair old.bin new.bin        # build reali
+  python3 tools/ota_delta_test.py --synthetic firmware.bin
+"""
+
+import argparse
+import random
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+from pathlib import Path
+
+PROJECT_ROOT = Path(__file__).resolve().parent.parent
+sys.path.insert(0, str(PROJECT_ROOT))
+sys.path.insert(0, str(PROJECT_ROOT / "tools"))
+
+from ota_protocol import (  # noqa: E402
+    delta_apply,
+    delta_diff,
+    heatshrink_compress,
+    HS_LOOKAHEAD_BITS,
+    HS_WINDOW_BITS,
+)
+from ota_compress_test import build_decoder  # noqa: E402
+
+IROM_START = 0x400D0000
+IROM_END = 0x40400000
+
+
+def synthetic_edit(image: bytes, seed: int = 1, insert_len: int = 320) -> bytes:
+    """Nuova versione plausibile: codice inserito + rilocazione degli indirizzi successivi"""
+    rng = random.Random(seed)
+    data = bytearray(image)
+    insert_at = (len(data) * 2 // 5) & ~3
+
+    # Costante modificata (es. velocità di un effetto)
+    tweak_at = (len(data) * 7 // 10) & ~3
+    data[tweak_at:tweak_at + 4] = struct.pack('<I', rng.getrandbits(32))
+
+    # Puntatori IROM oltre il punto di inserimento spostati di insert_len
+    words = sorted({struct.unpack_from('<I', data, off)[0]
+                    for off in range(0, len(data) - 3, 4)
+                    if IROM_START <= struct.unpack_from('<I', data, off)[0] < IROM_END})
+    if words:
+        pivot = words[len(words) // 2]
+        for off in range(0, len(data) - 3, 4):
+            value = struct.unpack_from('<I', data, off)[0]
+            if pivot <= value < IROM_END:
+                struct.pack_into('<I', data, off, value + insert_len)
+
+    inserted = bytes(rng.getrandbits(8) for _ in range(insert_len))
+    return bytes(data[:insert_at]) + inserted + bytes(data[insert_at:])
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Round-trip OTA delta (patch host -> DeltaPatcher firmware)")
+    parser.add_argument("--pair", type=Path, nargs=2, action="append", default=[],
+                        metavar=("BASE", "NEW"), help="Coppia di build reali")
+    parser.add_argument("--synthetic", type=Path, nargs="*", default=None,
+                        help="Immagini da modificare sinteticamente (default: .pio/build/*/firmware.bin)")
+    parser.add_argument("--link-kbps", type=float, default=60.0, help="Banda BLE per la stima dei tempi")
+    parser.add_argument("--seeds", type=int, default=3, help="Frammentazioni casuali diverse per coppia")
+    args = parser.parse_args()
+
+    cases = [(f"{base.name} -> {new.name}", base.read_bytes(), new.read_bytes()) for base, new in args.pair]
+    if args.synthetic is not None or not cases:
+        images = args.synthetic or sorted(PROJECT_ROOT.glob(".pio/build/*/firmware.bin"))
+        for path in images:
+            image = path.read_bytes()
+            cases.append((f"{path.name} (sintetico)", image, synthetic_edit(image)))
+    if not cases:
+        print("✗ Nessun firmware trovato: compila con `platformio run` o usa --pair/--synthetic")
+        sys.exit(2)
+
+    failures = 0
+    with tempfile.TemporaryDirectory(prefix="ledsaber_ota_delta_") as tmp:
+        tmp_dir = Path(tmp)
+        decoder = build_decoder(tmp_dir)
+        print(f"delta + heatshrink w={HS_WINDOW_BITS} l={HS_LOOKAHEAD_BITS}\n")
+
+        for name, base, new in cases:
+            source_path = tmp_dir / "source.bin"
+            source_path.write_bytes(base)
+
+            start = time.time()
+            patch = delta_diff(base, new)
+            diff_s = time.time() - start
+            stream = heatshrink_compress(patch)
+            full = heatshrink_compress(new)
+
+            ok = delta_apply(base, patch) == new
+            if not ok:
+                print("  delta_apply: immagine diversa")
+            for seed in range(1, args.seeds + 1):
+                result = subprocess.run(
+                    [str(decoder), str(HS_WINDOW_BITS), str(HS_LOOKAHEAD_BITS), str(seed), str(source_path)],
+                    input=stream, capture_output=True)
+                if result.returncode != 0 or result.stdout != new:
+                    ok = False
+                    print(f"  seed {seed}: patcher rc={result.returncode}, "
+                          f"{len(result.stdout)}/{len(new)} byte, {result.stderr.decode().strip()}")
+
+            outcome = "OK" if ok else "FAIL"
+            print(f"{name}: {len(new)} byte, compresso {len(full)}, patch {len(patch)} -> {len(stream)} byte "
+                  f"(diff {diff_s:.1f}s), airtime ~{len(full) / 1024 / args.link_kbps:.0f}s -> "
+                  f"~{len(stream) / 1024 / args.link_kbps:.1f}s  {outcome}")
+            if not ok:
+                failures += 1
+
+    if failures:
+        print(f"\n✗ {failures} immagini non ricostruite")
+        sys.exit(1)
+    print("\n✓ Tutte le immagini ricostruite identiche")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,363 @@
+#!/usr/bin/env python3
+"""
+OTA Loopback
+Banco di prova locale del trasferimento OTA: nessun dispositivo BLE richiesto.
+
+Simula (a eventi discreti, tempo virtuale) il link BLE e il lato firmware
+(OTAManager: callback BLE con controllo seq, coda RX da 64 chunk, OTAFlashTask
+che scrive blocchi da 4KB e invia ACK/NACK) e ci fa girare lo stesso
+WindowedSender usato da update_saber.py.
+
+Per ogni scenario stampa KB/s, ritrasmissioni e verifica che l'immagine
+ricostruita sia identica all'originale (exit code 1 se non lo è).
+
+Esempi:
+  python3 tools/ota_loopback.py
+  python3 tools/ota_loopback.py --firmware .pio/build/esp32cam/firmware.bin --loss 0 0.01 0.05
+  python3 tools/ota_loopback.py --windows 8 16 32 56 --link-kbps 90
+"""
+
+import argparse
+import heapq
+import itertools
+import os
+import random
+import sys
+from collections import deque
+from pathlib import Path
+
+sys.path.insert(0, str(Path(__file__).resolve().parent.parent))
+
+from ota_protocol import (  # noqa: E402
+    WindowedSender,
+    OTA_ACK_STRUCT,
+    OTA_ACK_TYPE_ACK,
+    OTA_ACK_TYPE_NACK,
+    OTA_SEQ_HEADER_SIZE,
+)
+
+# Costanti firmware (include/OTAManager.h)
+RX_QUEUE_DEPTH = 64
+FLASH_BLOCK_SIZE = 4096
+WINDOW_MAX = 56
+CHUNK_SIZE = 512
+
+QUEUED_DATA, QUEUED_NACK, QUEUED_ACK = 0, 1, 2
+
+
+class Simulation:
+    """Coda di eventi con tempo virtuale (secondi)"""
+
+    def __init__(self):
+        self.now = 0.0
+        self._events = []
+        self._counter = itertools.count()
+
+    def at(self, when, callback, *args):
+        heapq.heappush(self._events, (when, next(self._counter), callback, args))
+
+    def run(self, until):
+        while self._events:
+            when, _, callback, args = heapq.heappop(self._events)
+            if when > until:
+                return False
+            self.now = when
+            callback(*args)
+            if self.finished:
+                return True
+        return self.finished
+
+    finished = False
+
+
+class Link:
+    """Una direzione del link: serializzazione (banda) + latenza + perdita"""
+
+    def __init__(self, sim, rng, bytes_per_s, latency_s, loss):
+        self.sim = sim
+        self.rng = rng
+        self.bytes_per_s = bytes_per_s
+        self.latency_s = latency_s
+        self.loss = loss
+        self.free_at = 0.0
+
+    def send(self, payload, deliver):
+        start = max(self.sim.now, self.free_at)
+        self.free_at = start + (len(payload) + 3) / self.bytes_per_s   # +3: header ATT
+        if self.rng.random() < self.loss:
+            return
+        self.sim.at(self.free_at + self.latency_s, deliver, payload)
+
+
+class SimDevice:
+    """Lato firmware: OTAManager::enqueueWindowedChunk + OTAFlashTask"""
+
+    def __init__(self, sim, total, window, flash_block_s, chunk_cost_s, windowed, notify):
+        self.sim = sim
+        self.total = total
+        self.window = min(window, WINDOW_MAX)
+        self.flash_block_s = flash_block_s
+        self.chunk_cost_s = chunk_cost_s
+        self.windowed = windowed
+        self.notify = notify
+
+        self.queue = deque()
+        self.writer_busy = False
+        self.image = bytearray()
+        self.flash_buffer_len = 0
+        self.error = None
+
+        # Callback BLE
+        self.expected_seq = 0
+        self.accepted_offset = 0
+        self.nack_queued = False
+        self.ack_queued = False
+
+        # Writer
+        self.ack_seq = 0
+        self.chunks_since_ack = 0
+        self.flash_writes = 0
+
+    @property
+    def done(self):
+        return len(self.image) >= self.total
+
+    # --- Callback BLE ------------------------------------------------------
+
+    def on_write(self, data):
+        if self.error:
+            return
+        if not self.windowed:
+            if len(self.queue) >= RX_QUEUE_DEPTH:
+                self.error = "BLE RX queue full"
+                return
+            self._push((QUEUED_DATA, 0, 0, data))
+            return
+
+        seq = data[0] | (data[1] << 8)
+        delta = (seq - self.expected_seq) & 0xFFFF
+        if delta >= 0x8000:
+            if not self.ack_queued:
+                self.ack_queued = self._push_control((QUEUED_ACK, 0, 0, b''))
+            return
+        if delta > 0 or len(self.queue) >= RX_QUEUE_DEPTH:
+            if not self.nack_queued:
+                self.nack_queued = self._push_control(
+                    (QUEUED_NACK, self.expected_seq, self.accepted_offset, b''))
+            return
+
+        payload = data[OTA_SEQ_HEADER_SIZE:]
+        self._push((QUEUED_DATA, seq, self.accepted_offset, payload))
+        self.expected_seq = (self.expected_seq + 1) & 0xFFFF
+        self.accepted_offset += len(payload)
+        self.nack_queued = False
+
+    def _push(self, item):
+        self.queue.append(item)
+        self._kick_writer()
+
+    def _push_control(self, item):
+        if len(self.queue) >= RX_QUEUE_DEPTH:
+            return False
+        self.queue.appendleft(item)   # xQueueSendToFront
+        self._kick_writer()
+        return True
+
+    # --- OTAFlashTask ------------------------------------------------------
+
+    def _kick_writer(self):
+        if not self.writer_busy and self.queue:
+            self.writer_busy = True
+            self.sim.at(self.sim.now, self._writer_step)
+
+    def _writer_step(self):
+        kind, seq, offset, payload = self.queue.popleft()
+        cost = 0.0
+
+        if kind == QUEUED_DATA:
+            self.image += payload
+            cost += self.chunk_cost_s
+            self.flash_buffer_len += len(payload)
+            while self.flash_buffer_len >= FLASH_BLOCK_SIZE:
+                self.flash_buffer_len -= FLASH_BLOCK_SIZE
+                self.flash_writes += 1
+                cost += self.flash_block_s
+            if self.done and self.flash_buffer_len:
+                self.flash_writes += 1
+                cost += self.flash_block_s * self.flash_buffer_len / FLASH_BLOCK_SIZE
+                self.flash_buffer_len = 0
+
+        # Il writer tiene flashMutex per tutta la durata della scrittura
+        self.sim.at(self.sim.now + cost, self._writer_finish, kind, seq, offset)
+
+    def _writer_finish(self, kind, seq, offset):
+        if kind == QUEUED_DATA and self.windowed:
+            self.ack_seq = (seq + 1) & 0xFFFF
+            self.chunks_since_ack += 1
+            ack_every = max(1, self.window // 4)
+            if self.chunks_since_ack >= ack_every or not self.queue or self.done:
+                self._send_ack(OTA_ACK_TYPE_ACK, self.ack_seq, len(self.image))
+        elif kind == QUEUED_NACK:
+            self._send_ack(OTA_ACK_TYPE_NACK, seq, offset)
+        elif kind == QUEUED_ACK:
+            self.ack_queued = False
+            self._send_ack(OTA_ACK_TYPE_ACK, self.ack_seq, len(self.image))
+
+        self.writer_busy = False
+        self._kick_writer()
+
+    def _send_ack(self, ack_type, next_seq, offset):
+        if ack_type == OTA_ACK_TYPE_ACK:
+            self.chunks_since_ack = 0
+        self.notify(OTA_ACK_STRUCT.pack(ack_type, self.window, next_seq, offset))
+
+
+def run_windowed(image, args, window, loss, seed):
+    sim = Simulation()
+    rng = random.Random(seed)
+    link_rate = args.link_kbps * 1024
+    uplink = Link(sim, rng, link_rate, args.latency_ms / 1000, loss)
+    downlink = Link(sim, rng, link_rate, args.latency_ms / 1000, loss)
+
+    sender = WindowedSender(image, CHUNK_SIZE, window)
+    timer = {"generation": 0}
+
+    def pump():
+        for packet in sender.next_packets():
+            uplink.send(packet, device.on_write)
+        timer["generation"] += 1
+        sim.at(sim.now + args.ack_timeout_ms / 1000, on_timeout, timer["generation"])
+
+    def on_ack(data):
+        sender.on_ack(data)
+        if sender.done:
+            sim.finished = True
+            return
+        pump()
+
+    def on_timeout(generation):
+        if generation == timer["generation"] and not sender.done:
+            sender.on_timeout()
+            pump()
+
+    device = SimDevice(sim, len(image), window, args.flash_ms / 1000, args.chunk_cost_ms / 1000,
+                       True, lambda data: downlink.send(data, on_ack))
+
+    # ACK iniziale (executeStartCommand): comunica la finestra effettiva
+    device._send_ack(OTA_ACK_TYPE_ACK, 0, 0)
+    pump()
+    ok = sim.run(until=args.max_seconds)
+
+    return {
+        "ok": ok and bytes(device.image) == image,
+        "seconds": sim.now,
+        "retransmits": sender.retransmits,
+        "nacks": sender.nacks,
+        "timeouts": sender.timeouts,
+        "flash_writes": device.flash_writes,
+        "error": None if ok else "timeout simulazione",
+    }
+
+
+def run_write_with_response(image, args, loss, seed):
+    """Riferimento: un chunk raw per round-trip (write con response, niente finestra)"""
+    sim = Simulation()
+    rng = random.Random(seed)
+    link_rate = args.link_kbps * 1024
+    uplink = Link(sim, rng, link_rate, args.latency_ms / 1000, 0.0)  # ATT ritrasmette da sé
+    state = {"offset": 0}
+
+    def send_next():
+        if state["offset"] >= len(image):
+            sim.finished = True
+            return
+        chunk = image[state["offset"]:state["offset"] + CHUNK_SIZE]
+        state["offset"] += len(chunk)
+        uplink.send(chunk, lambda data: sim.at(sim.now + args.latency_ms / 1000, send_next))
+
+    send_next()
+    sim.run(until=args.max_seconds)
+    return {"ok": state["offset"] >= len(image), "seconds": sim.now,
+            "retransmits": 0, "nacks": 0, "timeouts": 0, "flash_writes": 0, "error": None}
+
+
+def run_unpaced(image, args, loss, seed):
+    """Riferimento: chunk raw senza ACK (START classico) - la coda RX può saturarsi"""
+    sim = Simulation()
+    rng = random.Random(seed)
+    link_rate = args.link_kbps * 1024
+    uplink = Link(sim, rng, link_rate, args.latency_ms / 1000, loss)
+    device = SimDevice(sim, len(image), 0, args.flash_ms / 1000, args.chunk_cost_ms / 1000,
+                       False, lambda data: None)
+
+    for offset in range(0, len(image), CHUNK_SIZE):
+        uplink.send(image[offset:offset + CHUNK_SIZE], device.on_write)
+
+    def check_done():
+        if device.done or device.error:
+            sim.finished = True
+        elif not sim._events:
+            sim.finished = True
+        else:
+            sim.at(sim.now + 0.01, check_done)
+
+    sim.at(0.01, check_done)
+    sim.run(until=args.max_seconds)
+    ok = device.error is None and bytes(device.image) == image
+    error = device.error or (None if ok else "chunk persi (immagine incompleta)")
+    return {"ok": ok, "seconds": sim.now, "retransmits": 0, "nacks": 0, "timeouts": 0,
+            "flash_writes": device.flash_writes, "error": error}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Banco di prova OTA a finestra (loopback simulato)")
+    parser.add_argument("--firmware", type=Path, help="Immagine .bin da trasferire (default: dati casuali)")
+    parser.add_argument("--size", type=int, default=1300 * 1024, help="Dimensione immagine casuale (byte)")
+    parser.add_argument("--windows", type=int, nargs="+", default=[8, 16, 32, 56])
+    parser.add_argument("--loss", type=float, nargs="+", default=[0.0, 0.01])
+    parser.add_argument("--link-kbps", type=float, default=60.0, help="Banda utile ATT (KB/s)")
+    parser.add_argument("--latency-ms", type=float, default=15.0, help="Latenza one-way (~connection interval)")
+    parser.add_argument("--flash-ms", type=float, default=45.0, help="Erase+write di un settore da 4KB")
+    parser.add_argument("--chunk-cost-ms", type=float, default=0.05, help="Costo CPU per chunk nel writer")
+    parser.add_argument("--ack-timeout-ms", type=float, default=1000.0)
+    parser.add_argument("--max-seconds", type=float, default=600.0, help="Tempo virtuale massimo")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    if args.firmware:
+        image = args.firmware.read_bytes()
+    else:
+        image = random.Random(args.seed).randbytes(args.size) if hasattr(random.Random, "randbytes") \
+            else os.urandom(args.size)
+
+    size_kb = len(image) / 1024
+    print(f"Immagine: {len(image)} byte ({size_kb:.1f} KB) | link {args.link_kbps:.0f} KB/s, "
+          f"latenza {args.latency_ms:.1f} ms, flash {args.flash_ms:.0f} ms/4KB")
+    print(f"{'modo':<18}{'loss':>6}{'KB/s':>9}{'tempo':>9}{'ritrasm':>9}{'NACK':>6}{'timeout':>8}  esito")
+
+    failures = 0
+
+    def report(mode, loss, result, must_pass):
+        nonlocal failures
+        speed = size_kb / result["seconds"] if result["ok"] and result["seconds"] > 0 else 0.0
+        outcome = "OK" if result["ok"] else f"FAIL ({result['error']})"
+        if must_pass and not result["ok"]:
+            failures += 1
+        print(f"{mode:<18}{loss:>6.2f}{speed:>9.1f}{result['seconds']:>8.1f}s"
+              f"{result['retransmits']:>9}{result['nacks']:>6}{result['timeouts']:>8}  {outcome}")
+
+    report("write+response", 0.0, run_write_with_response(image, args, 0.0, args.seed), False)
+    for loss in args.loss:
+        report("raw (no ack)", loss, run_unpaced(image, args, loss, args.seed), False)
+        for window in args.windows:
+            result = run_windowed(image, args, window, loss, args.seed)
+            report(f"window {window}", loss, result, True)
+
+    if failures:
+        print(f"\n✗ {failures} scenari a finestra non hanno ricostruito l'immagine")
+        sys.exit(1)
+    print("\n✓ Tutti gli scenari a finestra hanno ricostruito l'immagine identica")
+
+
+if __name__ == "__main__":
+    main()
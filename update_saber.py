@@ -5,17 +5,34 @@ Script per aggiornare il firmware via Bluetooth LE usando GATT OTA service
 """
 
 import asyncio
+import hashlib
+import re
 import sys
 import os
-import struct
 import subprocess
 import time
 import tempfile
+import zlib
 import shutil
 from pathlib import Path
 from typing import Optional
 from bleak import BleakClient, BleakScanner
 from bleak.backends.characteristic import BleakGATTCharacteristic
+from ota_protocol import (
+    WindowedSender,
+    build_start,
+    build_query_resume,
+    build_start_windowed,
+    parse_ack,
+    delta_diff,
+    heatshrink_compress,
+    heatshrink_param,
+    OTA_WINDOW_DEFAULT,
+    OTA_ENCODING_RAW,
+    OTA_ENCODING_HEATSHRINK,
+    OTA_ENCODING_DELTA,
+    OTA_ACK_TYPE_RESUME,
+)
 
 # UUIDs del servizio OTA
 OTA_SERVICE_UUID = "4fafc202-1fb5-459e-8fcc-c5c9c331914b"
@@ -24,9 +41,30 @@ CHAR_OTA_STATUS_UUID = "d1e5a4c4-eb10-4a3e-8a4c-1234567890ab"     # READ + NOTIF
 CHAR_OTA_CONTROL_UUID = "e2f6b5d5-fc21-5b4f-9b5d-2345678901bc"    # WRITE
 CHAR_OTA_PROGRESS_UUID = "f3e7c6e6-0d32-4c5a-ac6e-3456789012cd"   # READ + NOTIFY
 CHAR_FW_VERSION_UUID = "a4b8d7fa-1e43-6c7d-ad8f-456789abcdef"     # READ
+CHAR_OTA_ACK_UUID = "b5c9e8f0-2a54-4d8e-be06-56789abcde01"        # NOTIFY (firmware con OTA a finestra)
 
 PROJECT_ROOT = Path(__file__).resolve().parent
 
+# Firmware caricati con successo, per versione: base per l'OTA delta successivo
+OTA_BASE_DIR = PROJECT_ROOT / ".ota_base"
+
+
+def base_firmware_path(fw_version: str) -> Path:
+    return OTA_BASE_DIR / (re.sub(r'[^A-Za-z0-9._-]', '_', fw_version) + ".bin")
+
+
+def load_base_firmware(fw_version: Optional[str]) -> Optional[bytes]:
+    """Immagine corrispondente alla versione in esecuzione sul device (se nota)"""
+    if not fw_version:
+        return None
+    path = base_firmware_path(fw_version)
+    return path.read_bytes() if path.exists() else None
+
+
+def store_base_firmware(fw_version: str, firmware_data: bytes) -> None:
+    OTA_BASE_DIR.mkdir(exist_ok=True)
+    base_firmware_path(fw_version).write_bytes(firmware_data)
+
 
 def detect_local_firmware_version() -> Optional[str]:
     """Restituisce la versione firmware locale usando git describe (se disponibile)."""
@@ -81,6 +119,9 @@ OTA_STATE_RECOVERY = 6
 # Chunk size (512 bytes come da firmware)
 CHUNK_SIZE = 512  # max (il chunk effettivo verrà adattato a MTU-3)
 
+# Riprese dopo disconnessione durante l'upload (firmware con QUERY_RESUME)
+OTA_MAX_RESUMES = 3
+
 # Colori ANSI
 class Colors:
     RESET = "\033[0m"
@@ -109,6 +150,13 @@ class OTAUpdater:
         self.mtu_acquired: bool = False
         self.device_fw_version: Optional[str] = None
         self.expected_fw_version: Optional[str] = None
+        self.windowed_supported: bool = False
+        self.compress: bool = True
+        self.delta_base: Optional[bytes] = None
+        self.sender: Optional[WindowedSender] = None
+        self.ack_event = asyncio.Event()
+        self.resume_offset: Optional[int] = None
+        self.resume_event = asyncio.Event()
 
     async def _try_acquire_mtu(self) -> None:
         """Best-effort MTU acquisition for BlueZ (Bleak 2.x may report default 23 unless acquired)."""
@@ -190,6 +238,17 @@ class OTAUpdater:
                 # Abilita notifiche per stato e progresso
                 await self.client.start_notify(CHAR_OTA_STATUS_UUID, self._status_handler)
                 await self.client.start_notify(CHAR_OTA_PROGRESS_UUID, self._progress_handler)
+
+                # Firmware recenti: trasferimento a finestra con ACK
+                self.windowed_supported = False
+                try:
+                    if self.client.services.get_characteristic(CHAR_OTA_ACK_UUID) is not None:
+                        await self.client.start_notify(CHAR_OTA_ACK_UUID, self._ack_handler)
+                        self.windowed_supported = True
+                        print(f"{Colors.CYAN}🪟 OTA a finestra supportato{Colors.RESET}")
+                except Exception as e:
+                    print(f"{Colors.YELLOW}⚠ ACK OTA non disponibile, uso modalità classica: {e}{Colors.RESET}")
+
                 await self.refresh_status()
                 print(f"{Colors.GREEN}✓ Notifiche OTA abilitate{Colors.RESET}")
 
@@ -259,6 +318,18 @@ class OTAUpdater:
                   f"{self.received_bytes}/{self.total_bytes} bytes | "
                   f"{speed:.2f} KB/s{Colors.RESET}", end='', flush=True)
 
+    def _ack_handler(self, characteristic: BleakGATTCharacteristic, data: bytearray):
+        """Handler per ACK/NACK del trasferimento a finestra"""
+        parsed = parse_ack(bytes(data))
+        if parsed is not None and parsed[0] == OTA_ACK_TYPE_RESUME:
+            # Risposta a QUERY_RESUME: non riguarda la finestra
+            self.resume_offset = parsed[3]
+            self.resume_event.set()
+            return
+        if self.sender is not None:
+            self.sender.on_ack(bytes(data))
+        self.ack_event.set()
+
     async def send_command(self, command: int, data: bytes = b'', wait_response: bool = False):
         """Invia comando OTA"""
         cmd_data = bytes([command]) + data
@@ -286,14 +357,173 @@ class OTAUpdater:
         # Leggi firmware
         with open(firmware_path, 'rb') as f:
             firmware_data = f.read()
+        print(f"  CRC32: 0x{zlib.crc32(firmware_data):08X}  SHA-256: {hashlib.sha256(firmware_data).hexdigest()[:16]}...")
+
+        # Usa MTU-3 solo se abbiamo un MTU affidabile; se Bleak riporta 23 "default", NON ridurre a 20 bytes.
+        chunk_size_max = CHUNK_SIZE
+        if self.negotiated_mtu >= 64:
+            chunk_size_max = min(CHUNK_SIZE, self.negotiated_mtu - 3)
+        elif self.negotiated_mtu > 0 and self.negotiated_mtu != 23:
+            chunk_size_max = min(CHUNK_SIZE, max(20, self.negotiated_mtu - 3))
+
+        if not self.windowed_supported:
+            # size (uint32 little-endian) + SHA-256: i firmware vecchi ignorano il digest
+            if not await self._send_start(build_start(firmware_data)):
+                return False
+            return await self._upload_classic(firmware_data, chunk_size_max)
+
+        resume_offset = 0
+        resumes = 0
+        while True:
+            started = None
+            attempts = self._stream_attempts(firmware_data, resume_offset)
+            for index, (start_cmd, transfer_data, label, is_delta) in enumerate(attempts):
+                if label:
+                    print(f"  {label}")
+                if await self._send_start(start_cmd):
+                    started = (transfer_data, is_delta)
+                    break
+                # Base diversa dal firmware in esecuzione: ripiega sull'immagine intera
+                if index + 1 < len(attempts) and "Delta base" in self.ota_error:
+                    print(f"{Colors.YELLOW}⚠ Base delta non corrispondente, invio l'immagine completa{Colors.RESET}")
+                    continue
+                break
+            if started is None and resume_offset and "Resume" in self.ota_error:
+                # Sessione non più ripristinabile (record perso o immagine diversa): da capo
+                print(f"{Colors.YELLOW}⚠ Ripresa rifiutata, invio l'immagine completa{Colors.RESET}")
+                resume_offset = 0
+                continue
+            if started is None:
+                return False
+
+            # Invio chunk
+            print(f"{Colors.CYAN}📤 Invio firmware...{Colors.RESET}")
+            if resumes == 0:
+                self.start_time = time.time()
+            transfer_data, is_delta = started
+            # Delta: i COPY lunghi tengono il writer occupato a scrivere flash senza ACK
+            max_timeouts = 40 if is_delta else 10
+            if await self._upload_windowed(transfer_data, chunk_size_max, max_timeouts):
+                print()  # Newline dopo progress bar
+                return await self._wait_verify()
+
+            # Link caduto: il device ha in flash i settori già scritti, riparte da lì
+            if self.client.is_connected or resumes >= OTA_MAX_RESUMES:
+                if self.client.is_connected:
+                    await self.send_command(OTA_CMD_ABORT)
+                return False
+            resumes += 1
+            resume_offset = await self._reconnect_for_resume(firmware_data)
+            if resume_offset is None:
+                return False
+
+    def _stream_attempts(self, firmware_data: bytes, resume_offset: int = 0) -> list:
+        """
+        Tentativi di START in ordine: delta (se c'è la base), immagine compressa, raw.
+        Con resume_offset lo stream copre solo firmware_data[resume_offset:].
+        """
+        firmware_size = len(firmware_data)
+        tail = firmware_data[resume_offset:]
+        transfer_data = tail
+        encoding = OTA_ENCODING_RAW
+        label = f"Ripresa da {resume_offset} bytes" if resume_offset else None
+        if self.compress:
+            # Stream compresso (solo firmware con OTA a finestra): meno airtime BLE
+            compressed = heatshrink_compress(tail)
+            if len(compressed) < len(tail):
+                transfer_data = compressed
+                encoding = OTA_ENCODING_HEATSHRINK
+                label = (f"Compresso: {len(compressed)} bytes "
+                         f"({100 * (1 - len(compressed) / len(tail)):.1f}% in meno)")
+                if resume_offset:
+                    label += f", ripresa da {resume_offset} bytes"
+        attempts = [(
+            build_start_windowed(len(transfer_data), OTA_WINDOW_DEFAULT, encoding, firmware_size,
+                                 heatshrink_param(), image=firmware_data, resume_offset=resume_offset),
+            transfer_data,
+            label,
+            False,
+        )]
+
+        # Delta contro il firmware in esecuzione (base salvata dall'ultimo upload)
+        if self.compress and self.delta_base is not None:
+            patch_stream = heatshrink_compress(delta_diff(self.delta_base, tail))
+            if len(patch_stream) < len(transfer_data):
+                attempts.insert(0, (
+                    build_start_windowed(len(patch_stream), OTA_WINDOW_DEFAULT, OTA_ENCODING_DELTA,
+                                         firmware_size, heatshrink_param(), source=self.delta_base,
+                                         image=firmware_data, resume_offset=resume_offset),
+                    patch_stream,
+                    f"Delta: {len(patch_stream)} bytes contro la versione {self.device_fw_version}",
+                    True,
+                ))
+        return attempts
+
+    async def _reconnect_for_resume(self, firmware_data: bytes) -> Optional[int]:
+        """Riconnette e chiede al device da dove riprendere (0 = da capo)"""
+        print(f"{Colors.YELLOW}⚠ Connessione persa durante l'upload, riconnessione...{Colors.RESET}")
+        for _ in range(3):
+            await asyncio.sleep(2.0)
+            if await self.connect(self.device_address):
+                break
+        else:
+            print(f"{Colors.RED}✗ Riconnessione fallita{Colors.RESET}")
+            return None
+
+        offset = await self._query_resume(firmware_data)
+        if offset == 0 and self.ota_state in (OTA_STATE_WAITING, OTA_STATE_RECEIVING):
+            # Sessione ancora aperta ma niente di salvato: START da capo richiede ABORT
+            await self.send_command(OTA_CMD_ABORT)
+            await asyncio.sleep(1.0)
+        print(f"{Colors.CYAN}↻ Ripresa da {offset}/{len(firmware_data)} bytes{Colors.RESET}")
+        return offset
+
+    async def _query_resume(self, firmware_data: bytes) -> int:
+        """QUERY_RESUME: byte dell'immagine già scritti in flash dal device"""
+        self.resume_offset = None
+        self.resume_event.clear()
+        await self.client.write_gatt_char(CHAR_OTA_CONTROL_UUID, build_query_resume(firmware_data),
+                                          response=True)
+        try:
+            await asyncio.wait_for(self.resume_event.wait(), 3.0)
+        except asyncio.TimeoutError:
+            # Firmware senza ripresa: nessuna risposta, si ricomincia
+            return 0
+        return self.resume_offset or 0
+
+    async def _upload_classic(self, firmware_data: bytes, chunk_size_max: int) -> bool:
+        """START classico: chunk raw senza ACK"""
+        print(f"{Colors.CYAN}📤 Invio firmware...{Colors.RESET}")
+        self.start_time = time.time()
+        firmware_size = len(firmware_data)
+        offset = 0
+
+        while offset < firmware_size:
+            chunk_size = min(chunk_size_max, firmware_size - offset)
+            chunk = firmware_data[offset:offset + chunk_size]
+
+            # Invia chunk
+            # Usa response=False per "Write Without Response", molto più veloce
+            await self.client.write_gatt_char(CHAR_OTA_DATA_UUID, chunk, response=False)
+
+            offset += chunk_size
 
-        # Invia comando START con dimensione firmware
+            # Verifica errori
+            if self.ota_state == OTA_STATE_ERROR:
+                print(f"\n{Colors.RED}✗ Errore durante upload: {self.ota_error}{Colors.RESET}")
+                await self.send_command(OTA_CMD_ABORT)
+                return False
+
+        print()  # Newline dopo progress bar
+        return await self._wait_verify()
+
+    async def _send_start(self, start_cmd: bytes) -> bool:
+        """Invia START e attende lo stato WAITING"""
         print(f"{Colors.YELLOW}📡 Invio comando START...{Colors.RESET}")
-        size_bytes = struct.pack('<I', firmware_size)  # Little-endian uint32
-        await self.send_command(OTA_CMD_START, size_bytes)
+        await self.client.write_gatt_char(CHAR_OTA_CONTROL_UUID, start_cmd, response=False)
         await self.refresh_status()
 
-        # Con OTA_SIZE_UNKNOWN, esp_ota_begin() non causa più disconnessione BLE
+        # Il device scrive la flash a settori durante il trasferimento: START non blocca il link BLE
         # Attendiamo solo che il dispositivo elabori il comando START
         print(f"{Colors.CYAN}⏳ Attendo che il dispositivo elabori il comando START...{Colors.RESET}")
 
@@ -312,54 +542,66 @@ class OTAUpdater:
                 if not await self.connect(address):
                     print(f"{Colors.RED}✗ Riconnessione fallita. Impossibile continuare.{Colors.RESET}")
                     return False
-                break
+                return True
 
             # Verifica stato OTA
             await self.refresh_status()
             if self.ota_state == OTA_STATE_WAITING:
                 print(f"{Colors.GREEN}✓ Dispositivo pronto a ricevere il firmware (stato: WAITING).{Colors.RESET}")
-                break
+                return True
             elif self.ota_state == OTA_STATE_ERROR:
                 print(f"{Colors.RED}✗ Errore durante START: {self.ota_error}{Colors.RESET}")
                 return False
-        else:
-            # Timeout - dispositivo non ha risposto
-            print(f"{Colors.RED}✗ Timeout: dispositivo non è entrato nello stato WAITING dopo {max_wait}s{Colors.RESET}")
-            return False
-
-        # Invio chunk
-        print(f"{Colors.CYAN}📤 Invio firmware...{Colors.RESET}")
-        self.start_time = time.time()
-
-        # Usa MTU-3 solo se abbiamo un MTU affidabile; se Bleak riporta 23 "default", NON ridurre a 20 bytes.
-        chunk_size_max = CHUNK_SIZE
-        if self.negotiated_mtu >= 64:
-            chunk_size_max = min(CHUNK_SIZE, self.negotiated_mtu - 3)
-        elif self.negotiated_mtu > 0 and self.negotiated_mtu != 23:
-            chunk_size_max = min(CHUNK_SIZE, max(20, self.negotiated_mtu - 3))
 
-        offset = 0
-        chunk_count = 0
-        CHUNKS_PER_BATCH = 100  # Invia 100 chunk (50KB) prima di una pausa minima
-
-        while offset < firmware_size:
-            chunk_size = min(chunk_size_max, firmware_size - offset)
-            chunk = firmware_data[offset:offset + chunk_size]
+        # Timeout - dispositivo non ha risposto
+        print(f"{Colors.RED}✗ Timeout: dispositivo non è entrato nello stato WAITING dopo {max_wait}s{Colors.RESET}")
+        return False
 
-            # Invia chunk
-            # Usa response=False per "Write Without Response", molto più veloce
-            await self.client.write_gatt_char(CHAR_OTA_DATA_UUID, chunk, response=False)
+    async def _upload_windowed(self, firmware_data: bytes, chunk_size: int, max_timeouts: int = 10) -> bool:
+        """Streaming go-back-N: al massimo `window` chunk in volo, ritrasmissione su NACK/timeout"""
+        ACK_TIMEOUT_S = 1.0
 
-            offset += chunk_size
+        self.sender = WindowedSender(firmware_data, chunk_size, OTA_WINDOW_DEFAULT)
+        sender = self.sender
+        consecutive_timeouts = 0
 
-            # Verifica errori
-            if self.ota_state == OTA_STATE_ERROR:
-                print(f"\n{Colors.RED}✗ Errore durante upload: {self.ota_error}{Colors.RESET}")
-                await self.send_command(OTA_CMD_ABORT)
-                return False
+        try:
+            while not sender.done:
+                self.ack_event.clear()
+                try:
+                    for packet in sender.next_packets():
+                        await self.client.write_gatt_char(CHAR_OTA_DATA_UUID, packet, response=False)
+                except Exception as e:
+                    # Link caduto a metà finestra: il chiamante decide se riprendere
+                    print(f"\n{Colors.RED}✗ Scrittura fallita: {e}{Colors.RESET}")
+                    return False
 
-        print()  # Newline dopo progress bar
+                if self.ota_state == OTA_STATE_ERROR:
+                    print(f"\n{Colors.RED}✗ Errore durante upload: {self.ota_error}{Colors.RESET}")
+                    return False
+                if not self.client.is_connected:
+                    print(f"\n{Colors.RED}✗ Disconnesso durante upload{Colors.RESET}")
+                    return False
 
+                try:
+                    await asyncio.wait_for(self.ack_event.wait(), ACK_TIMEOUT_S)
+                    consecutive_timeouts = 0
+                except asyncio.TimeoutError:
+                    consecutive_timeouts += 1
+                    if consecutive_timeouts > max_timeouts:
+                        print(f"\n{Colors.RED}✗ Nessun ACK dal dispositivo{Colors.RESET}")
+                        return False
+                    sender.on_timeout()
+        finally:
+            self.sender = None
+
+        elapsed = time.time() - self.start_time
+        speed = (len(firmware_data) / 1024) / elapsed if elapsed > 0 else 0
+        print(f"\n{Colors.CYAN}📊 {speed:.2f} KB/s | ritrasmessi {sender.retransmits} chunk "
+              f"(NACK {sender.nacks}, timeout {sender.timeouts}){Colors.RESET}", end='')
+        return True
+
+    async def _wait_verify(self) -> bool:
         # Attendi verifica (automatica nel firmware)
         print(f"{Colors.YELLOW}⏳ Attendo verifica firmware...{Colors.RESET}")
 
@@ -452,18 +694,27 @@ async def main():
 
     args = sys.argv[1:]
     auto_confirm = False
+    send_raw = False
+    base_path: Optional[Path] = None
     filtered_args = []
-    for arg in args:
+    arg_iter = iter(args)
+    for arg in arg_iter:
         if arg == "-YY":
             auto_confirm = True
+        elif arg == "--raw":
+            send_raw = True
+        elif arg == "--base":
+            base_path = Path(next(arg_iter, ""))
         else:
             filtered_args.append(arg)
     args = filtered_args
 
     if not args:
-        print(f"{Colors.YELLOW}Uso: {sys.argv[0]} [-YY] <firmware.bin> [indirizzo_ble]{Colors.RESET}")
+        print(f"{Colors.YELLOW}Uso: {sys.argv[0]} [-YY] [--raw] [--base old.bin] <firmware.bin> [indirizzo_ble]{Colors.RESET}")
         print(f"\nOpzioni:")
-        print(f"  -YY    Autoconferma upload e riavvio")
+        print(f"  -YY              Autoconferma upload e riavvio")
+        print(f"  --raw            Invia l'immagine senza compressione né delta")
+        print(f"  --base old.bin   Firmware in esecuzione sul device (default: {OTA_BASE_DIR.name}/<versione>.bin)")
         print(f"\nEsempio:")
         print(f"  {sys.argv[0]} .pio/build/esp32cam/firmware.bin")
         print(f"  {sys.argv[0]} -YY firmware.bin AA:BB:CC:DD:EE:FF")
@@ -473,6 +724,7 @@ async def main():
     target_address = args[1] if len(args) > 1 else None
 
     updater = OTAUpdater()
+    updater.compress = not send_raw
     local_fw_version = detect_local_firmware_version()
     if local_fw_version:
         print(f"{Colors.CYAN}💾 Versione firmware locale: {local_fw_version}{Colors.RESET}")
@@ -525,6 +777,14 @@ async def main():
             if not await updater.connect(target.address):
                 sys.exit(1)
 
+        # Base per l'OTA delta: il device ne verifica il CRC prima di usarla
+        if base_path is not None:
+            updater.delta_base = base_path.read_bytes()
+        else:
+            updater.delta_base = load_base_firmware(updater.device_fw_version)
+        if updater.delta_base is not None and not send_raw:
+            print(f"{Colors.CYAN}🧩 Base delta disponibile ({len(updater.delta_base)} bytes){Colors.RESET}")
+
         # Conferma upload
         print(f"\n{Colors.YELLOW}⚠ ATTENZIONE: Durante l'aggiornamento NON spegnere il dispositivo!{Colors.RESET}")
         if auto_confirm:
@@ -551,7 +811,10 @@ async def main():
 
             if reboot.lower() != 'n':
                 await updater.reboot_device()
-                await updater.verify_new_firmware_version()
+                new_version = await updater.verify_new_firmware_version()
+                if new_version:
+                    # Prossimo aggiornamento: delta contro questa immagine
+                    store_base_firmware(new_version, firmware_path.read_bytes())
             else:
                 print(f"{Colors.CYAN}💡 Ricorda di riavviare il dispositivo manualmente per applicare l'aggiornamento{Colors.RESET}")
         else: